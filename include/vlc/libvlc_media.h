@@ -291,6 +291,11 @@ typedef enum libvlc_media_parse_flag_t
      * when the input is asking for credentials.
      */
     libvlc_media_do_interact    = 0x08,
+    /**
+     * Preparse this item ahead of the items already waiting to be preparsed,
+     * typically because it is about to be displayed.
+     */
+    libvlc_media_parse_priority = 0x10,
 } libvlc_media_parse_flag_t;
 
 /**
@@ -213,6 +213,42 @@ static inline block_t *block_Duplicate( block_t *p_block )
     return p_dup;
 }
 
+/**
+ * Makes the payload of a block shareable.
+ *
+ * Wraps a block into a block whose payload can then be referenced by other
+ * blocks with block_Share(), without copying it. The wrapped block must not
+ * be used anymore; it is released with the last block sharing its payload.
+ *
+ * @return the block itself if it was already shareable, the wrapping block,
+ * or NULL on memory error (the block is then released).
+ */
+VLC_API block_t *block_Shared(block_t *) VLC_USED;
+
+/**
+ * Shares the payload of a block.
+ *
+ * Creates a block referencing the same payload as a block made shareable by
+ * block_Shared(), with the same properties. Both blocks are then independent,
+ * except that the payload must not be modified in place while it is shared:
+ * block_Realloc() copies it when a block grows, and block_Unshare() must be
+ * called before any other modification.
+ *
+ * @return the new block, or NULL on memory error.
+ */
+VLC_API block_t *block_Share(block_t *) VLC_USED;
+
+/**
+ * Makes the payload of a block writable.
+ *
+ * Copies the payload of a block if it is shared with other blocks
+ * (copy-on-write). Otherwise, returns the block as is.
+ *
+ * @return the block with a writable payload, or NULL on memory error (the
+ * block is then released).
+ */
+VLC_API block_t *block_Unshare(block_t *) VLC_USED;
+
 /**
  * Wraps heap in a block.
  *
@@ -619,6 +655,88 @@ static inline void vlc_fifo_Cleanup(void *fifo)
 }
 #define vlc_fifo_CleanupPush(fifo) vlc_cleanup_push(vlc_fifo_Cleanup, fifo)
 
+/**
+ * @}
+ * \defgroup block_spsc Single-producer single-consumer block FIFO
+ * Lock-free block queue between exactly two threads
+ *
+ * This is a lighter alternative to the block FIFO when a queue has a single
+ * producer thread and a single consumer thread. Queueing and dequeueing do
+ * not take any lock; the consumer only sleeps, and the producer only wakes
+ * it up, when the queue is empty.
+ *
+ * @warning Calls to block_SpscPut() must not run concurrently with each
+ * other, and neither must calls to block_SpscGet() and block_SpscTryGet().
+ * Any thread may produce or consume as long as calls are serialized.
+ * @{
+ */
+
+typedef struct block_spsc_t block_spsc_t;
+
+/**
+ * Creates a single-producer single-consumer FIFO queue of blocks.
+ *
+ * The created queue must be released with block_SpscRelease().
+ *
+ * @return the FIFO or NULL on memory error
+ */
+VLC_API block_spsc_t *block_SpscNew(void) VLC_USED VLC_MALLOC;
+
+/**
+ * Destroys a FIFO created by block_SpscNew().
+ *
+ * @note Any queued blocks are also destroyed.
+ * @warning No other threads may be using the FIFO when this function is
+ * called.
+ */
+VLC_API void block_SpscRelease(block_spsc_t *);
+
+/**
+ * Queues a linked-list of blocks at the end of a FIFO (producer side).
+ *
+ * @param block head of a block list to queue (may be NULL)
+ *
+ * @note This function is not a cancellation point.
+ */
+VLC_API void block_SpscPut(block_spsc_t *, block_t *block);
+
+/**
+ * Dequeues the first block from the FIFO (consumer side). If necessary, waits
+ * until there is one block in the queue. This function is (always)
+ * a cancellation point.
+ *
+ * @return a valid block
+ */
+VLC_API block_t *block_SpscGet(block_spsc_t *) VLC_USED;
+
+/**
+ * Dequeues the first block from the FIFO, if any (consumer side).
+ *
+ * @note This function is not a cancellation point.
+ *
+ * @return the first block in the FIFO or NULL if the FIFO is empty
+ */
+VLC_API block_t *block_SpscTryGet(block_spsc_t *) VLC_USED;
+
+/**
+ * Counts blocks in a FIFO.
+ *
+ * @note The value may already be outdated when the function returns, unless
+ * called from the consumer thread when the producer is known to be idle.
+ *
+ * @return the number of blocks in the FIFO
+ */
+VLC_API size_t block_SpscCount(const block_spsc_t *) VLC_USED;
+
+/**
+ * Counts bytes in a FIFO.
+ *
+ * See block_SpscCount() about accuracy.
+ *
+ * @return the total number of bytes
+ */
+VLC_API size_t block_SpscSize(const block_spsc_t *) VLC_USED;
+
 /** @} */
 
 /** @} */
@@ -278,6 +278,70 @@ VLC_API int filter_Blend( filter_t *, picture_t *p_dst, int i_dst_x, int i_dst_y
  */
 VLC_API void filter_DeleteBlend( filter_t * );
 
+/**
+ * \defgroup filter_slices Slice-threaded filtering
+ * Video filters can split the processing of a picture in independent slices,
+ * usually horizontal stripes, which are run in parallel by worker threads
+ * shared by all filters.
+ * @{
+ */
+
+typedef struct filter_slices_t filter_slices_t;
+
+/**
+ * Processes one slice.
+ *
+ * \param opaque data given to filter_RunSlices()
+ * \param i_slice index of the slice, from 0 to i_slices - 1
+ * \param i_slices total number of slices
+ */
+typedef void (*filter_slice_cb)( void *opaque, unsigned i_slice,
+                                 unsigned i_slices );
+
+/**
+ * Creates a slice-threading context.
+ *
+ * \param i_threads maximum number of threads running the slices of a same
+ * call to filter_RunSlices(), including the calling one (0 for the number of
+ * CPUs)
+ * \return a context, or NULL on memory error
+ */
+VLC_API filter_slices_t *filter_NewSlices( unsigned i_threads ) VLC_USED;
+
+/**
+ * Destroys a slice-threading context. NULL is accepted.
+ */
+VLC_API void filter_DeleteSlices( filter_slices_t * );
+
+/**
+ * Gets the maximum number of threads used by a context, which is also a
+ * sensible number of slices.
+ */
+VLC_API unsigned filter_GetSliceThreads( const filter_slices_t * );
+
+/**
+ * Runs all the slices, and returns once they are all done.
+ *
+ * The slices can run in any order, concurrently. If the context is NULL,
+ * they all run in the calling thread.
+ */
+VLC_API void filter_RunSlices( filter_slices_t *, unsigned i_slices,
+                               filter_slice_cb, void *opaque );
+
+/**
+ * Computes the range of lines [*pi_start, *pi_end) of a slice, out of
+ * i_lines lines split in i_slices stripes of similar heights.
+ */
+static inline void filter_GetSliceLines( int i_lines, unsigned i_slice,
+                                         unsigned i_slices,
+                                         int *pi_start, int *pi_end )
+{
+    *pi_start = (int64_t)i_lines * i_slice / i_slices;
+    *pi_end = (int64_t)i_lines * (i_slice + 1) / i_slices;
+}
+
+/** @} */
+
 /**
  * Create a picture_t *(*)( filter_t *, picture_t * ) compatible wrapper
  * using a void (*)( filter_t *, picture_t *, picture_t * ) function
@@ -402,6 +466,18 @@ VLC_API void filter_chain_DeleteFilter(filter_chain_t *chain,
  */
 VLC_API bool filter_chain_IsEmpty(const filter_chain_t *chain);
 
+/**
+ * Counts the intermediate pictures that were not taken from a pool.
+ *
+ * Pictures passed between two video filters of the chain are recycled
+ * through picture pools. The count restarts when a filter is added to or
+ * removed from the chain.
+ *
+ * \param chain filter chain
+ * eturn number of intermediate pictures allocated from the heap
+ */
+VLC_API unsigned filter_chain_GetPoolMisses(const filter_chain_t *chain);
+
 /**
  * Get last output format of the last element in the filter chain.
  *
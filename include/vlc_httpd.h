@@ -144,6 +144,15 @@ VLC_API int httpd_StreamHeader( httpd_stream_t *, uint8_t *p_data, int i_data );
 VLC_API int httpd_StreamSend( httpd_stream_t *, const block_t *p_block );
 VLC_API int httpd_StreamSetHTTPHeaders(httpd_stream_t *, const httpd_header *, size_t);
 
+/* In-memory resource that can be served while it is still being written:
+ * requests made before httpd_SegmentEnd() get the data as it arrives, with
+ * the chunked transfer encoding for HTTP/1.1 clients. */
+typedef struct httpd_segment_t httpd_segment_t;
+VLC_API httpd_segment_t * httpd_SegmentNew( httpd_host_t *, const char *psz_url, const char *psz_mime, const char *psz_user, const char *psz_password ) VLC_USED;
+VLC_API void httpd_SegmentDelete( httpd_segment_t * );
+VLC_API int httpd_SegmentSend( httpd_segment_t *, const block_t *p_block );
+VLC_API void httpd_SegmentEnd( httpd_segment_t * );
+
 /* Msg functions facilities */
 VLC_API void httpd_MsgAdd( httpd_message_t *, const char *psz_name, const char *psz_value, ... ) VLC_FORMAT( 3, 4 );
 /* return "" if not found. The string is not allocated */
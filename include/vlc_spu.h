@@ -75,6 +75,13 @@ VLC_API void spu_PutSubpicture( spu_t *, subpicture_t * );
  */
 VLC_API subpicture_t * spu_Render( spu_t *, const vlc_fourcc_t *p_chroma_list, const video_format_t *p_fmt_dst, const video_format_t *p_fmt_src, mtime_t render_subtitle_date, mtime_t render_osd_date, bool ignore_osd );
 
+/**
+ * It returns the number of regions rendered by spu_Render() since the
+ * creation of the spu_t, and the number of regions it output again
+ * unchanged from its previous call instead of rendering them.
+ */
+VLC_API void spu_GetRenderStatistics( spu_t *, unsigned *reused, unsigned *rendered );
+
 /**
  * It registers a new SPU channel.
  */
@@ -44,6 +44,10 @@
 #   include <linux/magic.h>
 #endif
 
+#ifdef HAVE_MMAP
+#   include <sys/mman.h>
+#endif
+
 #if defined( _WIN32 )
 #   include <io.h>
 #   include <ctype.h>
@@ -57,6 +61,7 @@
 #include "fs.h"
 #include <vlc_input.h>
 #include <vlc_access.h>
+#include <vlc_block.h>
 #ifdef _WIN32
 # include <vlc_charset.h>
 #endif
@@ -69,6 +74,11 @@ struct access_sys_t
     int fd;
 
     bool b_pace_control;
+#ifdef HAVE_MMAP
+    uint64_t offset; /**< read position in memory-mapped mode */
+    uint64_t size; /**< last known file size in memory-mapped mode */
+    size_t page_size;
+#endif
 };
 
 #if !defined (_WIN32) && !defined (__OS2__)
@@ -129,6 +139,15 @@ static bool IsRemote (const char *path)
 
 static ssize_t Read (stream_t *, void *, size_t);
 static int FileSeek (stream_t *, uint64_t);
+#ifdef HAVE_MMAP
+static block_t *MmapBlock (stream_t *, bool *);
+static int MmapSeek (stream_t *, uint64_t);
+
+/* Size of the file mappings, i.e. of the blocks returned in mmap mode */
+# define MMAP_WINDOW_SIZE (1 << 20)
+/* Files smaller than this are read the usual way */
+# define MMAP_MIN_FILE_SIZE (16 << 20)
+#endif
 static int NoSeek (stream_t *, uint64_t);
 static int FileControl (stream_t *, int, va_list);
 
@@ -231,6 +250,23 @@ int FileOpen( vlc_object_t *p_this )
             fcntl (fd, F_RDAHEAD, 0);
         else
             fcntl (fd, F_RDAHEAD, 1);
+#endif
+#ifdef HAVE_MMAP
+        /* Map large local files, so that blocks reference the page cache
+         * directly. A remote or truncated file would raise SIGBUS. */
+        if (S_ISREG (st.st_mode) && st.st_size >= MMAP_MIN_FILE_SIZE
+         && var_InheritBool (p_access, "file-mmap")
+         && !IsRemote(fd, p_access->psz_filepath))
+        {
+            p_access->pf_read = NULL;
+            p_access->pf_block = MmapBlock;
+            p_access->pf_seek = MmapSeek;
+            p_sys->offset = 0;
+            p_sys->size = st.st_size;
+            p_sys->page_size = sysconf (_SC_PAGESIZE);
+            msg_Dbg (p_access, "memory-mapping file (%"PRIu64" bytes)",
+                     p_sys->size);
+        }
 #endif
     }
     else
@@ -253,7 +289,7 @@ void FileClose (vlc_object_t * p_this)
 {
     stream_t     *p_access = (stream_t*)p_this;
 
-    if (p_access->pf_read == NULL)
+    if (p_access->pf_readdir != NULL)
     {
         DirClose (p_this);
         return;
@@ -287,6 +323,66 @@ static ssize_t Read (stream_t *p_access, void *p_buffer, size_t i_len)
     return val;
 }
 
+#ifdef HAVE_MMAP
+static block_t *MmapBlock (stream_t *p_access, bool *restrict eof)
+{
+    access_sys_t *p_sys = p_access->p_sys;
+
+    if (p_sys->offset >= p_sys->size)
+    {   /* The file may have grown */
+        struct stat st;
+
+        if (fstat (p_sys->fd, &st) == 0)
+            p_sys->size = st.st_size;
+        if (p_sys->offset >= p_sys->size)
+        {
+            *eof = true;
+            return NULL;
+        }
+    }
+
+    /* Mappings must start on a page boundary */
+    uint64_t start = p_sys->offset & ~(uint64_t)(p_sys->page_size - 1);
+    size_t skip = p_sys->offset - start;
+    size_t length = MMAP_WINDOW_SIZE;
+
+    if (p_sys->size - start < length)
+        length = p_sys->size - start;
+
+    void *addr = mmap (NULL, length, PROT_READ|PROT_WRITE, MAP_PRIVATE,
+                       p_sys->fd, start);
+    if (addr == MAP_FAILED)
+    {
+        msg_Err (p_access, "memory mapping error: %s", vlc_strerror_c(errno));
+        *eof = true;
+        return NULL;
+    }
+#ifdef HAVE_POSIX_MADVISE
+    posix_madvise (addr, length, POSIX_MADV_SEQUENTIAL);
+#endif
+    /* Prefetch the following window while this one is processed */
+    posix_fadvise (p_sys->fd, start + length, MMAP_WINDOW_SIZE,
+                   POSIX_FADV_WILLNEED);
+
+    block_t *block = block_mmap_Alloc (addr, length);
+    if (unlikely(block == NULL))
+        return NULL;
+
+    block->p_buffer += skip;
+    block->i_buffer -= skip;
+    p_sys->offset += block->i_buffer;
+    return block;
+}
+
+static int MmapSeek (stream_t *p_access, uint64_t i_pos)
+{
+    access_sys_t *sys = p_access->p_sys;
+
+    sys->offset = i_pos;
+    return VLC_SUCCESS;
+}
+#endif
+
 /*****************************************************************************
  * Seek: seek to a specific location in a file
  *****************************************************************************/
@@ -36,6 +36,12 @@ vlc_module_begin ()
     set_category( CAT_INPUT )
     set_subcategory( SUBCAT_INPUT_ACCESS )
     add_obsolete_string( "file-cat" )
+#ifdef HAVE_MMAP
+    add_bool( "file-mmap", false, N_("Memory-map large files"),
+              N_("Read large local files through memory mappings instead "
+                 "of copying their content. The input must not be "
+                 "truncated while it is being read."), true )
+#endif
     set_capability( "access", 50 )
     add_shortcut( "file", "fd", "stream" )
     set_callbacks( FileOpen, FileClose )
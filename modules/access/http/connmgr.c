@@ -23,6 +23,10 @@
 #endif
 
 #include <assert.h>
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
 #include <vlc_common.h>
 #include <vlc_network.h>
 #include <vlc_tls.h>
@@ -92,87 +96,256 @@ static char *vlc_http_proxy_find(const char *hostname, unsigned port,
 }
 
 
+/** Maximum number of pooled connections per manager */
+#define VLC_HTTP_MGR_MAX_CONNS 4
+
+struct vlc_http_mgr_conn
+{
+    struct vlc_http_conn *conn;
+    char *host;
+    unsigned port;
+    bool secure;
+    uint64_t last_used;
+    unsigned refs; /**< Pool slot plus requests in progress */
+};
+
 struct vlc_http_mgr
 {
     vlc_object_t *obj;
     vlc_tls_creds_t *creds;
     struct vlc_http_cookie_jar_t *jar;
-    struct vlc_http_conn *conn;
+    vlc_mutex_t lock; /**< Protects creds, conns and clock */
+    uint64_t clock;
+    struct vlc_http_mgr_conn *conns[VLC_HTTP_MGR_MAX_CONNS];
 };
 
-static struct vlc_http_conn *vlc_http_mgr_find(struct vlc_http_mgr *mgr,
-                                               const char *host, unsigned port)
+static bool vlc_http_mgr_match(const struct vlc_http_mgr_conn *entry,
+                               bool secure, const char *host, unsigned port)
 {
-    (void) host; (void) port;
-    return mgr->conn;
+    return entry != NULL && entry->secure == secure
+        && entry->port == port && !strcasecmp(entry->host, host);
 }
 
-static void vlc_http_mgr_release(struct vlc_http_mgr *mgr,
-                                 struct vlc_http_conn *conn)
+/**
+ * Drops a reference to a pooled connection.
+ *
+ * The connection is released with the last reference. Streams already
+ * opened on it keep working until they are closed.
+ * The connection manager lock must be held.
+ */
+static void vlc_http_mgr_put(struct vlc_http_mgr_conn *entry)
 {
-    assert(mgr->conn == conn);
-    mgr->conn = NULL;
+    assert(entry->refs > 0);
+
+    if (--entry->refs > 0)
+        return;
 
-    vlc_http_conn_release(conn);
+    vlc_http_conn_release(entry->conn);
+    free(entry->host);
+    free(entry);
 }
 
-static
-struct vlc_http_msg *vlc_http_mgr_reuse(struct vlc_http_mgr *mgr,
-                                        const char *host, unsigned port,
-                                        const struct vlc_http_msg *req)
+/**
+ * Removes a connection from the pool.
+ *
+ * Nothing happens if another request has already removed it. The caller
+ * must hold a reference to the entry, lest it be freed and its address
+ * reused by another connection meanwhile.
+ * The connection manager lock must be held.
+ */
+static void vlc_http_mgr_remove(struct vlc_http_mgr *mgr,
+                                struct vlc_http_mgr_conn *entry)
 {
-    struct vlc_http_conn *conn = vlc_http_mgr_find(mgr, host, port);
-    if (conn == NULL)
+    for (size_t i = 0; i < ARRAY_SIZE(mgr->conns); i++)
+        if (mgr->conns[i] == entry)
+        {   /* Drop the reference of the pool, never the last one */
+            assert(entry->refs > 1);
+            mgr->conns[i] = NULL;
+            entry->refs--;
+            break;
+        }
+}
+
+/**
+ * Adds a connection to the pool.
+ *
+ * If the pool is full, the least recently used connection is removed.
+ * The connection manager lock must be held.
+ *
+ * @return the pool entry, or NULL on error (the connection is then released).
+ */
+static struct vlc_http_mgr_conn *vlc_http_mgr_add(struct vlc_http_mgr *mgr,
+                                                  bool secure,
+                                                  const char *host,
+                                                  unsigned port,
+                                                  struct vlc_http_conn *conn)
+{
+    struct vlc_http_mgr_conn *entry = malloc(sizeof (*entry));
+    char *name = strdup(host);
+    if (unlikely(entry == NULL || name == NULL))
+    {
+        free(name);
+        free(entry);
+        vlc_http_conn_release(conn);
         return NULL;
+    }
 
-    struct vlc_http_stream *stream = vlc_http_stream_open(conn, req);
-    if (stream != NULL)
+    entry->conn = conn;
+    entry->host = name;
+    entry->port = port;
+    entry->secure = secure;
+    entry->last_used = ++mgr->clock;
+    entry->refs = 1;
+
+    struct vlc_http_mgr_conn **slot = NULL;
+
+    for (size_t i = 0; i < ARRAY_SIZE(mgr->conns); i++)
     {
-        struct vlc_http_msg *m = vlc_http_msg_get_initial(stream);
-        if (m != NULL)
-            return m;
-
-        /* NOTE: If the request were not idempotent, we would not know if it
-         * was processed by the other end. Thus POST is not used/supported so
-         * far, and CONNECT is treated as if it were idempotent (which works
-         * fine here). */
+        struct vlc_http_mgr_conn **s = &mgr->conns[i];
+
+        if (*s == NULL)
+        {
+            slot = s;
+            break;
+        }
+        if (slot == NULL || (*s)->last_used < (*slot)->last_used)
+            slot = s;
     }
-    /* Get rid of closing or reset connection */
-    vlc_http_mgr_release(mgr, conn);
-    return NULL;
+
+    if (*slot != NULL)
+        vlc_http_mgr_put(*slot);
+    *slot = entry;
+    return entry;
+}
+
+/**
+ * Opens a stream on a pooled connection to the given origin.
+ *
+ * The pool is only locked to look connections up: the request is sent
+ * without the lock, as it may block on the network.
+ * Connections that are closing or were reset are removed from the pool.
+ *
+ * On success, the caller gets a reference to the pool entry of the
+ * connection, to be passed to vlc_http_mgr_wait().
+ */
+static struct vlc_http_stream *vlc_http_mgr_open(struct vlc_http_mgr *mgr,
+                                                 bool secure, const char *host,
+                                                 unsigned port,
+                                                 const struct vlc_http_msg *req,
+                                                 struct vlc_http_mgr_conn **entryp)
+{
+    struct vlc_http_stream *stream = NULL;
+
+    vlc_mutex_lock(&mgr->lock);
+    for (size_t i = 0; i < ARRAY_SIZE(mgr->conns) && stream == NULL; i++)
+    {
+        struct vlc_http_mgr_conn *entry = mgr->conns[i];
+
+        if (!vlc_http_mgr_match(entry, secure, host, port))
+            continue;
+
+        /* Keep the connection while the lock is not held */
+        entry->refs++;
+        vlc_mutex_unlock(&mgr->lock);
+
+        errno = 0;
+        stream = vlc_http_stream_open(entry->conn, req);
+
+        int err = errno;
+
+        vlc_mutex_lock(&mgr->lock);
+        if (stream != NULL)
+        {
+            entry->last_used = ++mgr->clock;
+            *entryp = entry; /* keep the reference */
+            break;
+        }
+        /* EBUSY: HTTP/1 connection used by another request. Otherwise, get
+         * rid of closing or reset connection. */
+        if (err != EBUSY)
+            vlc_http_mgr_remove(mgr, entry);
+        vlc_http_mgr_put(entry);
+    }
+    vlc_mutex_unlock(&mgr->lock);
+    return stream;
+}
+
+/**
+ * Waits for the response to a request, and drops the reference to the pool
+ * entry of its connection (if not NULL).
+ */
+static struct vlc_http_msg *vlc_http_mgr_wait(struct vlc_http_mgr *mgr,
+                                              struct vlc_http_mgr_conn *entry,
+                                              struct vlc_http_stream *stream)
+{
+    struct vlc_http_msg *m = vlc_http_msg_get_initial(stream);
+
+    if (entry == NULL)
+        return m;
+
+    /* NOTE: If the request were not idempotent, we would not know if it
+     * was processed by the other end. Thus POST is not used/supported so
+     * far, and CONNECT is treated as if it were idempotent (which works
+     * fine here). */
+
+    vlc_mutex_lock(&mgr->lock);
+    /* Get rid of closing or reset connection, unless another request has
+     * already done so while we were waiting for the response. */
+    if (m == NULL)
+        vlc_http_mgr_remove(mgr, entry);
+    vlc_http_mgr_put(entry);
+    vlc_mutex_unlock(&mgr->lock);
+    return m;
+}
+
+static
+struct vlc_http_msg *vlc_http_mgr_reuse(struct vlc_http_mgr *mgr, bool secure,
+                                        const char *host, unsigned port,
+                                        const struct vlc_http_msg *req)
+{
+    struct vlc_http_mgr_conn *entry;
+    struct vlc_http_stream *stream;
+
+    stream = vlc_http_mgr_open(mgr, secure, host, port, req, &entry);
+    if (stream == NULL)
+        return NULL;
+    /* The response headers are awaited without the lock, so that other
+     * requests can be multiplexed on the same connection meanwhile. */
+    return vlc_http_mgr_wait(mgr, entry, stream);
 }
 
 static struct vlc_http_msg *vlc_https_request(struct vlc_http_mgr *mgr,
                                               const char *host, unsigned port,
                                               const struct vlc_http_msg *req)
 {
+    vlc_tls_creds_t *creds;
     vlc_tls_t *tls;
     bool http2 = true;
 
-    if (mgr->creds == NULL && mgr->conn != NULL)
-        return NULL; /* switch from HTTP to HTTPS not implemented */
-
+    vlc_mutex_lock(&mgr->lock);
     if (mgr->creds == NULL)
-    {   /* First TLS connection: load x509 credentials */
+        /* First TLS connection: load x509 credentials */
         mgr->creds = vlc_tls_ClientCreate(mgr->obj);
-        if (mgr->creds == NULL)
-            return NULL;
-    }
+    creds = mgr->creds;
+    vlc_mutex_unlock(&mgr->lock);
+
+    if (creds == NULL)
+        return NULL;
 
     /* TODO? non-idempotent request support */
-    struct vlc_http_msg *resp = vlc_http_mgr_reuse(mgr, host, port, req);
+    struct vlc_http_msg *resp = vlc_http_mgr_reuse(mgr, true, host, port, req);
     if (resp != NULL)
         return resp; /* existing connection reused */
 
     char *proxy = vlc_http_proxy_find(host, port, true);
     if (proxy != NULL)
     {
-        tls = vlc_https_connect_proxy(mgr->creds, mgr->creds,
+        tls = vlc_https_connect_proxy(creds, creds,
                                       host, port, &http2, proxy);
         free(proxy);
     }
     else
-        tls = vlc_https_connect(mgr->creds, host, port, &http2);
+        tls = vlc_https_connect(creds, host, port, &http2);
 
     if (tls == NULL)
         return NULL;
@@ -197,19 +370,30 @@ static struct vlc_http_msg *vlc_https_request(struct vlc_http_mgr *mgr,
         return NULL;
     }
 
-    mgr->conn = conn;
+    /* The connection is not shared yet: send the request without the lock.
+     * The stream keeps the connection alive even if it cannot be pooled. */
+    struct vlc_http_stream *stream = vlc_http_stream_open(conn, req);
+    if (stream == NULL)
+    {
+        vlc_http_conn_release(conn);
+        return NULL;
+    }
 
-    return vlc_http_mgr_reuse(mgr, host, port, req);
+    vlc_mutex_lock(&mgr->lock);
+    struct vlc_http_mgr_conn *entry = vlc_http_mgr_add(mgr, true, host, port,
+                                                       conn);
+    if (entry != NULL)
+        entry->refs++; /* until the response is received */
+    vlc_mutex_unlock(&mgr->lock);
+    return vlc_http_mgr_wait(mgr, entry, stream);
 }
 
 static struct vlc_http_msg *vlc_http_request(struct vlc_http_mgr *mgr,
                                              const char *host, unsigned port,
                                              const struct vlc_http_msg *req)
 {
-    if (mgr->creds != NULL && mgr->conn != NULL)
-        return NULL; /* switch from HTTPS to HTTP not implemented */
-
-    struct vlc_http_msg *resp = vlc_http_mgr_reuse(mgr, host, port, req);
+    struct vlc_http_msg *resp = vlc_http_mgr_reuse(mgr, false, host, port,
+                                                   req);
     if (resp != NULL)
         return resp;
 
@@ -247,7 +431,9 @@ static struct vlc_http_msg *vlc_http_request(struct vlc_http_mgr *mgr,
         return NULL;
     }
 
-    mgr->conn = conn;
+    vlc_mutex_lock(&mgr->lock);
+    vlc_http_mgr_add(mgr, false, host, port, conn);
+    vlc_mutex_unlock(&mgr->lock);
     return resp;
 }
 
@@ -273,14 +459,19 @@ struct vlc_http_mgr *vlc_http_mgr_create(vlc_object_t *obj,
     mgr->obj = obj;
     mgr->creds = NULL;
     mgr->jar = jar;
-    mgr->conn = NULL;
+    vlc_mutex_init(&mgr->lock);
+    mgr->clock = 0;
+    for (size_t i = 0; i < ARRAY_SIZE(mgr->conns); i++)
+        mgr->conns[i] = NULL;
     return mgr;
 }
 
 void vlc_http_mgr_destroy(struct vlc_http_mgr *mgr)
 {
-    if (mgr->conn != NULL)
-        vlc_http_mgr_release(mgr, mgr->conn);
+    for (size_t i = 0; i < ARRAY_SIZE(mgr->conns); i++)
+        if (mgr->conns[i] != NULL)
+            vlc_http_mgr_put(mgr->conns[i]);
+    vlc_mutex_destroy(&mgr->lock);
     if (mgr->creds != NULL)
         vlc_tls_Delete(mgr->creds);
     free(mgr);
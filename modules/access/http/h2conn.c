@@ -434,6 +434,15 @@ static struct vlc_http_stream *vlc_h2_stream_open(struct vlc_http_conn *c,
 
     vlc_h2_conn_queue(conn, f);
 
+    /* Requests without a weight keep the default priority (RFC7540 §5.3.5) */
+    unsigned weight = vlc_http_msg_get_weight(msg);
+    if (weight != 0)
+    {
+        f = vlc_h2_frame_priority(s->id, 0, false, weight);
+        if (likely(f != NULL))
+            vlc_h2_conn_queue(conn, f);
+    }
+
     s->older = conn->streams;
     if (s->older != NULL)
         s->older->newer = s;
@@ -113,17 +113,23 @@ static void conn_destroy(void)
     vlc_tls_SessionDelete(external_tls);
 }
 
-static struct vlc_http_stream *stream_open(void)
+static struct vlc_http_stream *stream_open_weight(unsigned weight)
 {
     struct vlc_http_msg *m = vlc_http_req_create("GET", "https",
                                                  "www.example.com", "/");
     assert(m != NULL);
+    vlc_http_msg_set_weight(m, weight);
 
     struct vlc_http_stream *s = vlc_http_stream_open(conn, m);
     vlc_http_msg_destroy(m);
     return s;
 }
 
+static struct vlc_http_stream *stream_open(void)
+{
+    return stream_open_weight(0);
+}
+
 static void stream_reply(uint_fast32_t id, bool nodata)
 {
     struct vlc_http_msg *m = vlc_http_resp_create(200);
@@ -177,6 +183,15 @@ int main(void)
     vlc_http_stream_close(s, false);
     conn_expect(RST_STREAM);
 
+    /* Test weighted stream */
+    sid += 2;
+    s = stream_open_weight(256);
+    assert(s != NULL);
+    conn_expect(HEADERS);
+    conn_expect(PRIORITY);
+    vlc_http_stream_close(s, false);
+    conn_expect(RST_STREAM);
+
     /* Test accepted stream */
     sid += 2;
     s = stream_open();
@@ -186,8 +201,8 @@ int main(void)
     assert(m != NULL);
     vlc_http_msg_destroy(m);
 
-    stream_data(3, "Hello ", false); /* late data */
-    stream_data(3, "world!", true);
+    stream_data(sid, "Hello ", false); /* late data */
+    stream_data(sid, "world!", true);
 
     conn_expect(HEADERS);
     conn_expect(RST_STREAM);
@@ -258,7 +258,7 @@ static struct vlc_h2_frame *data(bool eos)
 
 static struct vlc_h2_frame *priority(void)
 {
-    return localize(resize(retype(data(false), 0x2), 5));
+    return vlc_h2_frame_priority(STREAM_ID, 0, false, 16);
 }
 
 static struct vlc_h2_frame *rst_stream(void)
@@ -463,6 +463,13 @@ int main(void)
 
     /* TODO: PUSH_PROMISE, PRIORITY, padding, unknown, invalid stuff... */
 
+    /* Priority frame format */
+    struct vlc_h2_frame *f = vlc_h2_frame_priority(STREAM_ID, 3, true, 256);
+    assert(f != NULL);
+    assert(vlc_h2_frame_size(f) == 9 + 5);
+    assert(!memcmp(f->data + 9, "\x80\x00\x00\x03\xff", 5));
+    free(f);
+
     /* Dummy API test */
     assert(vlc_h2_frame_data(1, NULL, 1 << 28, false) == NULL);
 
@@ -216,6 +216,24 @@ const char *vlc_http_msg_get_authority(const struct vlc_http_msg *);
  */
 const char *vlc_http_msg_get_path(const struct vlc_http_msg *);
 
+/**
+ * Sets request weight.
+ *
+ * The weight is a hint of the share of the connection bandwidth that the
+ * request should get relative to the other concurrent requests.
+ * It is only used by HTTP/2 (see RFC7540 §5.3).
+ *
+ * @param weight weight from 1 to 256, or 0 for the protocol default
+ */
+void vlc_http_msg_set_weight(struct vlc_http_msg *, unsigned weight);
+
+/**
+ * Gets request weight.
+ *
+ * @return request weight, or 0 if not set
+ */
+unsigned vlc_http_msg_get_weight(const struct vlc_http_msg *);
+
 /**
  * Looks up a token in a header field.
  *
@@ -59,6 +59,11 @@ static void Close( vlc_object_t * );
 #define BUFFER_TEXT N_("Receive buffer")
 #define BUFFER_LONGTEXT N_("UDP receive buffer size (bytes)" )
 #define TIMEOUT_TEXT N_("UDP Source timeout (sec)")
+#define BATCH_TEXT N_("Datagrams per receive call")
+#define BATCH_LONGTEXT N_( \
+    "Maximum number of datagrams fetched from the socket in one system " \
+    "call. Batching reduces the per-packet overhead of high bit rate " \
+    "streams. Set to 1 to receive one datagram at a time." )
 
 vlc_module_begin ()
     set_shortname( N_("UDP" ) )
@@ -69,6 +74,10 @@ vlc_module_begin ()
     add_obsolete_integer( "server-port" ) /* since 2.0.0 */
     add_obsolete_integer( "udp-buffer" ) /* since 3.0.0 */
     add_integer( "udp-timeout", -1, TIMEOUT_TEXT, NULL, true )
+#ifdef HAVE_RECVMMSG
+    add_integer_with_range( "udp-batch", 32, 1, 1024,
+                            BATCH_TEXT, BATCH_LONGTEXT, true )
+#endif
 
     set_capability( "access", 0 )
     add_shortcut( "udp", "udpstream", "udp4", "udp6" )
@@ -76,17 +85,46 @@ vlc_module_begin ()
     set_callbacks( Open, Close )
 vlc_module_end ()
 
+#ifdef HAVE_RECVMMSG
+typedef union
+{
+    char buf[CMSG_SPACE(sizeof (uint32_t))];
+    struct cmsghdr align;
+} udp_cmsg_t;
+#endif
+
 struct access_sys_t
 {
     int fd;
     int timeout;
     size_t mtu;
+
+#ifdef HAVE_RECVMMSG
+    /* Batched reception */
+    unsigned batch; /* maximum datagrams per recvmmsg() */
+    unsigned head; /* next received datagram to return */
+    unsigned count; /* datagrams received by the last call */
+    block_t **blocks; /* preallocated receive buffers */
+    struct mmsghdr *msgs;
+    struct iovec *iovecs;
+    udp_cmsg_t *cmsgs;
+
+    /* Statistics */
+    uint64_t calls;
+    uint64_t datagrams;
+    uint64_t drops;
+    uint32_t overflows; /* last kernel drop counter (SO_RXQ_OVFL) */
+#endif
 };
 
 /*****************************************************************************
  * Local prototypes
  *****************************************************************************/
 static block_t *BlockUDP( stream_t *, bool * );
+#ifdef HAVE_RECVMMSG
+static block_t *BlockUDPBatch( stream_t *, bool * );
+static int OpenBatch( stream_t * );
+#endif
 static int Control( stream_t *, int, va_list );
 
 /*****************************************************************************
@@ -174,9 +212,59 @@ static int Open( vlc_object_t *p_this )
     if( sys->timeout > 0)
         sys->timeout *= 1000;
 
+#ifdef HAVE_RECVMMSG
+    sys->batch = var_InheritInteger( p_access, "udp-batch" );
+    sys->blocks = NULL;
+    if( sys->batch > 1 && OpenBatch( p_access ) != VLC_SUCCESS )
+    {
+        net_Close( sys->fd );
+        return VLC_ENOMEM;
+    }
+#endif
     return VLC_SUCCESS;
 }
 
+#ifdef HAVE_RECVMMSG
+/*****************************************************************************
+ * OpenBatch: set up the batched receive buffers
+ *****************************************************************************/
+static int OpenBatch( stream_t *p_access )
+{
+    access_sys_t *sys = p_access->p_sys;
+    vlc_object_t *obj = VLC_OBJECT(p_access);
+
+    sys->blocks = vlc_calloc( obj, sys->batch, sizeof( *sys->blocks ) );
+    sys->msgs = vlc_calloc( obj, sys->batch, sizeof( *sys->msgs ) );
+    sys->iovecs = vlc_calloc( obj, sys->batch, sizeof( *sys->iovecs ) );
+    sys->cmsgs = vlc_calloc( obj, sys->batch, sizeof( *sys->cmsgs ) );
+    if( unlikely(sys->blocks == NULL || sys->msgs == NULL
+              || sys->iovecs == NULL || sys->cmsgs == NULL) )
+        return VLC_ENOMEM;
+
+    for( unsigned i = 0; i < sys->batch; i++ )
+    {
+        struct msghdr *hdr = &sys->msgs[i].msg_hdr;
+
+        hdr->msg_iov = &sys->iovecs[i];
+        hdr->msg_iovlen = 1;
+    }
+
+    sys->head = sys->count = 0;
+    sys->calls = sys->datagrams = sys->drops = 0;
+    sys->overflows = 0;
+#ifdef SO_RXQ_OVFL
+    /* Ask the kernel to report the number of datagrams it dropped */
+    int on = 1;
+    if( setsockopt( sys->fd, SOL_SOCKET, SO_RXQ_OVFL, &on, sizeof( on ) ) )
+        msg_Dbg( p_access, "cannot track socket overflows: %s",
+                 vlc_strerror_c(errno) );
+#endif
+    ACCESS_SET_CALLBACKS( NULL, BlockUDPBatch, Control, NULL );
+    msg_Dbg( p_access, "receiving up to %u datagrams per call", sys->batch );
+    return VLC_SUCCESS;
+}
+#endif
+
 /*****************************************************************************
  * Close: free unused data structures
  *****************************************************************************/
@@ -185,6 +273,20 @@ static void Close( vlc_object_t *p_this )
     stream_t     *p_access = (stream_t*)p_this;
     access_sys_t *sys = p_access->p_sys;
 
+#ifdef HAVE_RECVMMSG
+    if( sys->blocks != NULL )
+    {
+        for( unsigned i = 0; i < sys->batch; i++ )
+            if( sys->blocks[i] != NULL )
+                block_Release( sys->blocks[i] );
+
+        if( sys->calls > 0 )
+            msg_Dbg( p_access, "received %"PRIu64" datagrams in %"PRIu64
+                     " calls (%.1f per call), %"PRIu64" dropped by the kernel",
+                     sys->datagrams, sys->calls,
+                     (double)sys->datagrams / sys->calls, sys->drops );
+    }
+#endif
     net_Close( sys->fd );
 }
 
@@ -282,3 +384,144 @@ skip:
 
     return pkt;
 }
+
+#ifdef HAVE_RECVMMSG
+/*****************************************************************************
+ * BlockUDPBatch: receive datagrams in batches
+ *****************************************************************************
+ * Datagrams are received by groups of up to sys->batch into a ring of
+ * preallocated blocks with a single recvmmsg() call, then handed to the
+ * stream one at a time without further system calls.
+ *****************************************************************************/
+static void CheckOverflows(stream_t *access, struct msghdr *hdr)
+{
+#ifdef SO_RXQ_OVFL
+    access_sys_t *sys = access->p_sys;
+
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(hdr);
+         cmsg != NULL;
+         cmsg = CMSG_NXTHDR(hdr, cmsg))
+    {
+        if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SO_RXQ_OVFL)
+            continue;
+
+        uint32_t overflows;
+        memcpy(&overflows, CMSG_DATA(cmsg), sizeof (overflows));
+
+        /* The kernel counter is cumulative and wraps around */
+        uint32_t dropped = overflows - sys->overflows;
+        if (dropped > 0)
+        {
+            msg_Warn(access, "%"PRIu32" datagram(s) dropped by the kernel "
+                     "(receive buffer overflow)", dropped);
+            sys->drops += dropped;
+            sys->overflows = overflows;
+        }
+    }
+#else
+    VLC_UNUSED(access); VLC_UNUSED(hdr);
+#endif
+}
+
+static block_t *BlockUDPBatch(stream_t *access, bool *restrict eof)
+{
+    access_sys_t *sys = access->p_sys;
+
+    if (sys->head < sys->count)
+    {
+        block_t *pkt = sys->blocks[sys->head];
+
+        sys->blocks[sys->head++] = NULL;
+        return pkt;
+    }
+
+    sys->head = sys->count = 0;
+
+    /* Refill the consumed buffers */
+    unsigned n;
+    for (n = 0; n < sys->batch; n++)
+    {
+        if (sys->blocks[n] == NULL)
+        {
+            sys->blocks[n] = block_Alloc(sys->mtu);
+            if (unlikely(sys->blocks[n] == NULL))
+                break;
+        }
+
+        struct msghdr *hdr = &sys->msgs[n].msg_hdr;
+
+        sys->iovecs[n].iov_base = sys->blocks[n]->p_buffer;
+        sys->iovecs[n].iov_len = sys->mtu;
+        hdr->msg_control = sys->cmsgs[n].buf;
+        hdr->msg_controllen = sizeof (sys->cmsgs[n]);
+        hdr->msg_flags = 0;
+    }
+
+    if (unlikely(n == 0))
+    {   /* OOM - dequeue and discard one packet */
+        char dummy;
+        recv(sys->fd, &dummy, 1, 0);
+        return NULL;
+    }
+
+    struct pollfd ufd[1];
+
+    ufd[0].fd = sys->fd;
+    ufd[0].events = POLLIN;
+
+    switch (vlc_poll_i11e(ufd, 1, sys->timeout))
+    {
+        case 0:
+            msg_Err(access, "receive time-out");
+            *eof = true;
+            /* fall through */
+        case -1:
+            return NULL;
+    }
+
+    int val = recvmmsg(sys->fd, sys->msgs, n, MSG_DONTWAIT | MSG_TRUNC, NULL);
+    if (val <= 0)
+        return NULL;
+
+    size_t mtu = sys->mtu;
+
+    for (int i = 0; i < val; i++)
+    {
+        block_t *pkt = sys->blocks[i];
+        size_t len = sys->msgs[i].msg_len;
+
+        if (sys->msgs[i].msg_hdr.msg_flags & MSG_TRUNC)
+        {
+            msg_Err(access, "%zu bytes packet truncated (MTU was %zu)",
+                    len, sys->mtu);
+            pkt->i_flags |= BLOCK_FLAG_CORRUPTED;
+            pkt->i_buffer = sys->mtu;
+            if (len > mtu)
+                mtu = len;
+        }
+        else
+            pkt->i_buffer = len;
+    }
+
+    CheckOverflows(access, &sys->msgs[val - 1].msg_hdr);
+    sys->calls++;
+    sys->datagrams += val;
+
+    if (mtu != sys->mtu)
+    {   /* Drop the spare buffers: they are too small now */
+        for (unsigned i = val; i < n; i++)
+        {
+            block_Release(sys->blocks[i]);
+            sys->blocks[i] = NULL;
+        }
+        sys->mtu = mtu;
+    }
+
+    sys->count = val;
+    sys->head = 1;
+
+    block_t *pkt = sys->blocks[0];
+    sys->blocks[0] = NULL;
+    return pkt;
+}
+#endif
@@ -43,6 +43,8 @@
 #include <vlc_fs.h>
 #include <vlc_strings.h>
 #include <vlc_charset.h>
+#include <vlc_httpd.h>
+#include <vlc_memstream.h>
 
 #include <gcrypt.h>
 #include <vlc_gcrypt.h>
@@ -105,6 +107,12 @@ static void Close( vlc_object_t * );
 #define INTITIAL_SEG_TEXT N_("Number of first segment")
 #define INITIAL_SEG_LONGTEXT N_("The number of the first segment generated")
 
+#define HTTPD_TEXT N_("Serve from memory")
+#define HTTPD_LONGTEXT N_("Keep the segments in memory and serve them with "\
+                          "the index from the built-in HTTP server, instead "\
+                          "of writing files. The segment and index paths are "\
+                          "then URL paths on the server.")
+
 vlc_module_begin ()
     set_description( N_("HTTP Live streaming output") )
     set_shortname( N_("LiveHTTP" ))
@@ -125,6 +133,8 @@ vlc_module_begin ()
               NOCACHE_TEXT, NOCACHE_LONGTEXT, true )
     add_bool( SOUT_CFG_PREFIX "generate-iv", false,
               RANDOMIV_TEXT, RANDOMIV_LONGTEXT, true )
+    add_bool( SOUT_CFG_PREFIX "httpd", false,
+              HTTPD_TEXT, HTTPD_LONGTEXT, true )
     add_string( SOUT_CFG_PREFIX "index", NULL,
                 INDEX_TEXT, INDEX_LONGTEXT, false )
     add_string( SOUT_CFG_PREFIX "index-url", NULL,
@@ -156,6 +166,7 @@ static const char *const ppsz_sout_options[] = {
     "key-loadfile",
     "generate-iv",
     "initial-segment-number",
+    "httpd",
     NULL
 };
 
@@ -171,6 +182,7 @@ typedef struct output_segment
     float f_seglength;
     uint32_t i_segment_number;
     uint8_t aes_ivs[16];
+    httpd_segment_t *p_httpd;
 } output_segment_t;
 
 struct sout_access_out_sys_t
@@ -205,6 +217,13 @@ struct sout_access_out_sys_t
     uint8_t stuffing_bytes[16];
     ssize_t stuffing_size;
     vlc_array_t segments_t;
+
+    /* Serving from memory */
+    httpd_host_t *p_httpd_host;
+    httpd_file_t *p_httpd_index;
+    httpd_segment_t *p_httpd_segment; /* segment being written */
+    vlc_mutex_t lock_index;
+    char *psz_index;
 };
 
 static int LoadCryptFile( sout_access_out_t *p_access);
@@ -212,6 +231,8 @@ static int CryptSetup( sout_access_out_t *p_access, char *keyfile );
 static int CheckSegmentChange( sout_access_out_t *p_access, block_t *p_buffer );
 static ssize_t writeSegment( sout_access_out_t *p_access );
 static ssize_t openNextFile( sout_access_out_t *p_access, sout_access_out_sys_t *p_sys );
+static int HttpdSetup( sout_access_out_t *p_access, sout_access_out_sys_t *p_sys );
+static void HttpdClose( sout_access_out_sys_t *p_sys );
 /*****************************************************************************
  * Open: open the file
  *****************************************************************************/
@@ -220,6 +241,7 @@ static int Open( vlc_object_t *p_this )
     sout_access_out_t   *p_access = (sout_access_out_t*)p_this;
     sout_access_out_sys_t *p_sys;
     char *psz_idx;
+    bool b_httpd;
 
     config_ChainParse( p_access, SOUT_CFG_PREFIX, ppsz_sout_options, p_access->p_cfg );
 
@@ -250,6 +272,7 @@ static int Open( vlc_object_t *p_this )
     p_sys->b_caching = var_GetBool( p_access, SOUT_CFG_PREFIX "caching") ;
     p_sys->b_generate_iv = var_GetBool( p_access, SOUT_CFG_PREFIX "generate-iv") ;
     p_sys->b_segment_has_data = false;
+    b_httpd = var_GetBool( p_access, SOUT_CFG_PREFIX "httpd" );
 
     vlc_array_init( &p_sys->segments_t );
 
@@ -270,7 +293,7 @@ static int Open( vlc_object_t *p_this )
             return VLC_ENOMEM;
         }
         p_sys->psz_indexPath = psz_tmp;
-        if( p_sys->i_initial_segment != 1 )
+        if( p_sys->i_initial_segment != 1 && !b_httpd )
             vlc_unlink( p_sys->psz_indexPath );
     }
 
@@ -297,6 +320,20 @@ static int Open( vlc_object_t *p_this )
         return VLC_EGENERIC;
     }
 
+    if( b_httpd && HttpdSetup( p_access, p_sys ) )
+    {
+        if( p_sys->key_uri )
+        {
+            gcry_cipher_close( p_sys->aes_ctx );
+            free( p_sys->key_uri );
+        }
+        free( p_sys->psz_keyfile );
+        free( p_sys->psz_indexUrl );
+        free( p_sys->psz_indexPath );
+        free( p_sys );
+        return VLC_EGENERIC;
+    }
+
     p_sys->i_handle = -1;
     p_sys->i_segment = p_sys->i_initial_segment-1;
     p_sys->psz_cursegPath = NULL;
@@ -307,6 +344,85 @@ static int Open( vlc_object_t *p_this )
     return VLC_SUCCESS;
 }
 
+/************************************************************************
+ * IndexCallback: Serve the last index from memory
+ ************************************************************************/
+static int IndexCallback( httpd_file_sys_t *p_args, httpd_file_t *f,
+                          uint8_t *p_request, uint8_t **pp_data, int *pi_data )
+{
+    VLC_UNUSED(f); VLC_UNUSED(p_request);
+    sout_access_out_sys_t *p_sys = (sout_access_out_sys_t *)p_args;
+
+    vlc_mutex_lock( &p_sys->lock_index );
+    if( p_sys->psz_index )
+    {
+        *pi_data = strlen( p_sys->psz_index );
+        *pp_data = malloc( *pi_data );
+        if( likely(*pp_data != NULL) )
+            memcpy( *pp_data, p_sys->psz_index, *pi_data );
+        else
+            *pi_data = 0;
+    }
+    else
+    {
+        *pp_data = NULL;
+        *pi_data = 0;
+    }
+    vlc_mutex_unlock( &p_sys->lock_index );
+
+    return VLC_SUCCESS;
+}
+
+/************************************************************************
+ * HttpdSetup: Serve the index and segments from memory
+ ************************************************************************/
+static int HttpdSetup( sout_access_out_t *p_access, sout_access_out_sys_t *p_sys )
+{
+    if( !p_sys->psz_indexPath )
+    {
+        msg_Err( p_access, "no index URL specified" );
+        return VLC_EGENERIC;
+    }
+    if( p_sys->psz_indexPath[0] != '/' || p_access->psz_path[0] != '/' )
+    {
+        msg_Err( p_access, "index and segments must be URL paths "
+                 "when served from memory" );
+        return VLC_EGENERIC;
+    }
+
+    p_sys->p_httpd_host = vlc_http_HostNew( VLC_OBJECT(p_access) );
+    if( p_sys->p_httpd_host == NULL )
+    {
+        msg_Err( p_access, "cannot start HTTP server" );
+        return VLC_EGENERIC;
+    }
+
+    vlc_mutex_init( &p_sys->lock_index );
+    p_sys->psz_index = NULL;
+    p_sys->p_httpd_segment = NULL;
+    p_sys->p_httpd_index = httpd_FileNew( p_sys->p_httpd_host,
+                                          p_sys->psz_indexPath,
+                                          "application/vnd.apple.mpegurl",
+                                          NULL, NULL, IndexCallback,
+                                          (httpd_file_sys_t *)p_sys );
+    if( p_sys->p_httpd_index == NULL )
+    {
+        msg_Err( p_access, "cannot add index %s", p_sys->psz_indexPath );
+        HttpdClose( p_sys );
+        return VLC_EGENERIC;
+    }
+    return VLC_SUCCESS;
+}
+
+static void HttpdClose( sout_access_out_sys_t *p_sys )
+{
+    if( p_sys->p_httpd_index )
+        httpd_FileDelete( p_sys->p_httpd_index );
+    httpd_HostDelete( p_sys->p_httpd_host );
+    vlc_mutex_destroy( &p_sys->lock_index );
+    free( p_sys->psz_index );
+}
+
 /************************************************************************
  * CryptSetup: Initialize encryption
  ************************************************************************/
@@ -506,6 +622,8 @@ static char *formatSegmentPath( char *psz_path, uint32_t i_seg )
 
 static void destroySegment( output_segment_t *segment )
 {
+    if( segment->p_httpd )
+        httpd_SegmentDelete( segment->p_httpd );
     free( segment->psz_filename );
     free( segment->psz_duration );
     free( segment->psz_uri );
@@ -555,6 +673,48 @@ static bool isFirstItemRemovable( sout_access_out_sys_t *p_sys, uint32_t i_first
     return duration >= (first->f_seglength + (float)(p_sys->i_numsegs * p_sys->i_seglen));
 }
 
+/************************************************************************
+ * writeIndex: Replace the index file
+ ************************************************************************/
+static int writeIndex( sout_access_out_t *p_access, sout_access_out_sys_t *p_sys,
+                       const char *psz_index, size_t i_index )
+{
+    int val;
+    FILE *fp;
+    char *psz_idxTmp;
+    if ( asprintf( &psz_idxTmp, "%s.tmp", p_sys->psz_indexPath ) < 0)
+        return -1;
+
+    fp = vlc_fopen( psz_idxTmp, "wt");
+    if ( !fp )
+    {
+        msg_Err( p_access, "cannot open index file `%s'", psz_idxTmp );
+        free( psz_idxTmp );
+        return -1;
+    }
+
+    if ( fwrite( psz_index, 1, i_index, fp ) != i_index )
+    {
+        free( psz_idxTmp );
+        fclose( fp );
+        return -1;
+    }
+    fclose( fp );
+
+    val = vlc_rename ( psz_idxTmp, p_sys->psz_indexPath);
+
+    if ( val < 0 )
+    {
+        vlc_unlink( psz_idxTmp );
+        msg_Err( p_access, "Error moving LiveHttp index file" );
+    }
+    else
+        msg_Dbg( p_access, "LiveHttpIndexComplete: %s" , p_sys->psz_indexPath );
+
+    free( psz_idxTmp );
+    return 0;
+}
+
 /************************************************************************
  * updateIndexAndDel: If necessary, update index file & delete old segments
  ************************************************************************/
@@ -579,33 +739,18 @@ static int updateIndexAndDel( sout_access_out_t *p_access, sout_access_out_sys_t
     // First update index
     if ( p_sys->psz_indexPath )
     {
-        int val;
-        FILE *fp;
-        char *psz_idxTmp;
-        if ( asprintf( &psz_idxTmp, "%s.tmp", p_sys->psz_indexPath ) < 0)
-            return -1;
+        struct vlc_memstream ms;
 
-        fp = vlc_fopen( psz_idxTmp, "wt");
-        if ( !fp )
-        {
-            msg_Err( p_access, "cannot open index file `%s'", psz_idxTmp );
-            free( psz_idxTmp );
+        if ( vlc_memstream_open( &ms ) )
             return -1;
-        }
-
-        if ( fprintf( fp, "#EXTM3U\n#EXT-X-TARGETDURATION:%zu\n#EXT-X-VERSION:3\n#EXT-X-ALLOW-CACHE:%s"
-                          "%s\n#EXT-X-MEDIA-SEQUENCE:%"PRIu32"\n%s", p_sys->i_seglen,
-                          p_sys->b_caching ? "YES" : "NO",
-                          p_sys->i_numsegs > 0 ? "" : b_isend ? "\n#EXT-X-PLAYLIST-TYPE:VOD" : "\n#EXT-X-PLAYLIST-TYPE:EVENT",
-                          i_firstseg, ((p_sys->i_initial_segment > 1) && (p_sys->i_initial_segment == i_firstseg)) ? "#EXT-X-DISCONTINUITY\n" : ""
-                          ) < 0 )
-        {
-            free( psz_idxTmp );
-            fclose( fp );
-            return -1;
-        }
-        char *psz_current_uri=NULL;
 
+        vlc_memstream_printf( &ms, "#EXTM3U\n#EXT-X-TARGETDURATION:%zu\n#EXT-X-VERSION:3\n#EXT-X-ALLOW-CACHE:%s"
+                              "%s\n#EXT-X-MEDIA-SEQUENCE:%"PRIu32"\n%s", p_sys->i_seglen,
+                              p_sys->b_caching ? "YES" : "NO",
+                              p_sys->i_numsegs > 0 ? "" : b_isend ? "\n#EXT-X-PLAYLIST-TYPE:VOD" : "\n#EXT-X-PLAYLIST-TYPE:EVENT",
+                              i_firstseg, ((p_sys->i_initial_segment > 1) && (p_sys->i_initial_segment == i_firstseg)) ? "#EXT-X-DISCONTINUITY\n" : ""
+                              );
+        const char *psz_current_uri = NULL;
 
         for ( uint32_t i = i_firstseg; i <= p_sys->i_segment; i++ )
         {
@@ -617,9 +762,7 @@ static int updateIndexAndDel( sout_access_out_t *p_access, sout_access_out_sys_t
                 ( !psz_current_uri ||  strcmp( psz_current_uri, segment->psz_key_uri ) )
               )
             {
-                int ret = 0;
-                free( psz_current_uri );
-                psz_current_uri = strdup( segment->psz_key_uri );
+                psz_current_uri = segment->psz_key_uri;
                 if( p_sys->b_generate_iv )
                 {
                     unsigned long long iv_hi = segment->aes_ivs[0];
@@ -631,55 +774,37 @@ static int updateIndexAndDel( sout_access_out_t *p_access, sout_access_out_sys_t
                         iv_lo <<= 8;
                         iv_lo |= segment->aes_ivs[8+j] & 0xff;
                     }
-                    ret = fprintf( fp, "#EXT-X-KEY:METHOD=AES-128,URI=\"%s\",IV=0X%16.16llx%16.16llx\n",
-                                   segment->psz_key_uri, iv_hi, iv_lo );
+                    vlc_memstream_printf( &ms, "#EXT-X-KEY:METHOD=AES-128,URI=\"%s\",IV=0X%16.16llx%16.16llx\n",
+                                          segment->psz_key_uri, iv_hi, iv_lo );
 
                 } else {
-                    ret = fprintf( fp, "#EXT-X-KEY:METHOD=AES-128,URI=\"%s\"\n", segment->psz_key_uri );
-                }
-                if( ret < 0 )
-                {
-                    free( psz_current_uri );
-                    free( psz_idxTmp );
-                    fclose( fp );
-                    return -1;
+                    vlc_memstream_printf( &ms, "#EXT-X-KEY:METHOD=AES-128,URI=\"%s\"\n", segment->psz_key_uri );
                 }
             }
 
-            val = fprintf( fp, "#EXTINF:%s,\n%s\n", segment->psz_duration, segment->psz_uri);
-            if ( val < 0 )
-            {
-                free( psz_current_uri );
-                free( psz_idxTmp );
-                fclose( fp );
-                return -1;
-            }
+            vlc_memstream_printf( &ms, "#EXTINF:%s,\n%s\n", segment->psz_duration, segment->psz_uri);
         }
-        free( psz_current_uri );
 
         if ( b_isend )
-        {
-            if ( fputs ( STR_ENDLIST, fp ) < 0)
-            {
-                free( psz_idxTmp );
-                fclose( fp ) ;
-                return -1;
-            }
+            vlc_memstream_puts( &ms, STR_ENDLIST );
 
-        }
-        fclose( fp );
-
-        val = vlc_rename ( psz_idxTmp, p_sys->psz_indexPath);
+        if ( vlc_memstream_close( &ms ) )
+            return -1;
 
-        if ( val < 0 )
+        if ( p_sys->p_httpd_host )
         {
-            vlc_unlink( psz_idxTmp );
-            msg_Err( p_access, "Error moving LiveHttp index file" );
+            vlc_mutex_lock( &p_sys->lock_index );
+            free( p_sys->psz_index );
+            p_sys->psz_index = ms.ptr;
+            vlc_mutex_unlock( &p_sys->lock_index );
+        }
+        else if ( writeIndex( p_access, p_sys, ms.ptr, ms.length ) )
+        {
+            free( ms.ptr );
+            return -1;
         }
         else
-            msg_Dbg( p_access, "LiveHttpIndexComplete: %s" , p_sys->psz_indexPath );
-
-        free( psz_idxTmp );
+            free( ms.ptr );
     }
 
     // Then take care of deletion
@@ -692,7 +817,7 @@ static int updateIndexAndDel( sout_access_out_t *p_access, sout_access_out_sys_t
          msg_Dbg( p_access, "Removing segment number %d", segment->i_segment_number );
          vlc_array_remove( &p_sys->segments_t, 0 );
 
-         if ( segment->psz_filename )
+         if ( segment->psz_filename && !segment->p_httpd )
          {
              vlc_unlink( segment->psz_filename );
          }
@@ -705,12 +830,37 @@ static int updateIndexAndDel( sout_access_out_t *p_access, sout_access_out_sys_t
     return 0;
 }
 
+static bool isSegmentOpen( const sout_access_out_sys_t *p_sys )
+{
+    return p_sys->i_handle >= 0 || p_sys->p_httpd_segment != NULL;
+}
+
+/*****************************************************************************
+ * segmentWrite: Write to the segment file, or append to the segment in memory
+ *****************************************************************************/
+static ssize_t segmentWrite( sout_access_out_sys_t *p_sys, void *p_data, size_t i_data )
+{
+    if( p_sys->p_httpd_segment )
+    {
+        block_t block;
+
+        block_Init( &block, p_data, i_data );
+        if( httpd_SegmentSend( p_sys->p_httpd_segment, &block ) )
+        {
+            errno = ENOMEM;
+            return -1;
+        }
+        return i_data;
+    }
+    return vlc_write( p_sys->i_handle, p_data, i_data );
+}
+
 /*****************************************************************************
  * closeCurrentSegment: Close the segment file
  *****************************************************************************/
 static void closeCurrentSegment( sout_access_out_t *p_access, sout_access_out_sys_t *p_sys, bool b_isend )
 {
-    if ( p_sys->i_handle >= 0 )
+    if ( isSegmentOpen( p_sys ) )
     {
         output_segment_t *segment = vlc_array_item_at_index( &p_sys->segments_t, vlc_array_count( &p_sys->segments_t ) - 1 );
 
@@ -724,7 +874,7 @@ static void closeCurrentSegment( sout_access_out_t *p_access, sout_access_out_sy
                msg_Err( p_access, "Couldn't encrypt 16 bytes: %s", gpg_strerror(err) );
             } else {
 
-            int ret = vlc_write( p_sys->i_handle, p_sys->stuffing_bytes, 16 );
+            ssize_t ret = segmentWrite( p_sys, p_sys->stuffing_bytes, 16 );
             if( ret != 16 )
                 msg_Err( p_access, "Couldn't write 16 bytes" );
             }
@@ -732,8 +882,16 @@ static void closeCurrentSegment( sout_access_out_t *p_access, sout_access_out_sy
         }
 
 
-        vlc_close( p_sys->i_handle );
-        p_sys->i_handle = -1;
+        if( p_sys->p_httpd_segment )
+        {
+            httpd_SegmentEnd( p_sys->p_httpd_segment );
+            p_sys->p_httpd_segment = NULL;
+        }
+        else
+        {
+            vlc_close( p_sys->i_handle );
+            p_sys->i_handle = -1;
+        }
 
         if( ! ( us_asprintf( &segment->psz_duration, "%.2f", p_sys->f_seglen ) ) )
         {
@@ -808,7 +966,8 @@ static void Close( vlc_object_t * p_this )
     {
         output_segment_t *segment = vlc_array_item_at_index( &p_sys->segments_t, 0 );
         vlc_array_remove( &p_sys->segments_t, 0 );
-        if( p_sys->b_delsegs && p_sys->i_numsegs && segment->psz_filename )
+        if( p_sys->b_delsegs && p_sys->i_numsegs && segment->psz_filename &&
+            !segment->p_httpd )
         {
             msg_Dbg( p_access, "Removing segment number %d name %s", segment->i_segment_number, segment->psz_filename );
             vlc_unlink( segment->psz_filename );
@@ -817,6 +976,9 @@ static void Close( vlc_object_t * p_this )
         destroySegment( segment );
     }
 
+    if( p_sys->p_httpd_host )
+        HttpdClose( p_sys );
+
     free( p_sys->psz_indexUrl );
     free( p_sys->psz_indexPath );
     free( p_sys );
@@ -870,14 +1032,30 @@ static ssize_t openNextFile( sout_access_out_t *p_access, sout_access_out_sys_t
         return -1;
     }
 
-    fd = vlc_open( segment->psz_filename, O_WRONLY | O_CREAT | O_LARGEFILE |
-                     O_TRUNC, 0666 );
-    if ( fd == -1 )
+    if ( p_sys->p_httpd_host )
     {
-        msg_Err( p_access, "cannot open `%s' (%s)", segment->psz_filename,
-                 vlc_strerror_c(errno) );
-        destroySegment( segment );
-        return -1;
+        fd = -1;
+        segment->p_httpd = httpd_SegmentNew( p_sys->p_httpd_host,
+                                             segment->psz_filename,
+                                             NULL, NULL, NULL );
+        if ( segment->p_httpd == NULL )
+        {
+            msg_Err( p_access, "cannot add segment %s", segment->psz_filename );
+            destroySegment( segment );
+            return -1;
+        }
+    }
+    else
+    {
+        fd = vlc_open( segment->psz_filename, O_WRONLY | O_CREAT | O_LARGEFILE |
+                         O_TRUNC, 0666 );
+        if ( fd == -1 )
+        {
+            msg_Err( p_access, "cannot open `%s' (%s)", segment->psz_filename,
+                     vlc_strerror_c(errno) );
+            destroySegment( segment );
+            return -1;
+        }
     }
 
     vlc_array_append( &p_sys->segments_t, segment );
@@ -898,9 +1076,10 @@ static ssize_t openNextFile( sout_access_out_t *p_access, sout_access_out_sys_t
 
     p_sys->psz_cursegPath = strdup(segment->psz_filename);
     p_sys->i_handle = fd;
+    p_sys->p_httpd_segment = segment->p_httpd;
     p_sys->i_segment = i_newseg;
     p_sys->b_segment_has_data = false;
-    return fd;
+    return 0;
 }
 /*****************************************************************************
  * CheckSegmentChange: Check if segment needs to be closed and new opened
@@ -910,7 +1089,7 @@ static int CheckSegmentChange( sout_access_out_t *p_access, block_t *p_buffer )
     sout_access_out_sys_t *p_sys = p_access->p_sys;
     ssize_t writevalue = 0;
 
-    if( p_sys->i_handle > 0 && p_sys->b_segment_has_data &&
+    if( isSegmentOpen( p_sys ) && p_sys->b_segment_has_data &&
        (( p_buffer->i_length + p_buffer->i_dts - p_sys->i_opendts ) >= p_sys->i_seglenm ) )
     {
         writevalue = writeSegment( p_access );
@@ -923,7 +1102,7 @@ static int CheckSegmentChange( sout_access_out_t *p_access, block_t *p_buffer )
         return writevalue;
     }
 
-    if ( unlikely( p_sys->i_handle < 0 ) )
+    if ( unlikely( !isSegmentOpen( p_sys ) ) )
     {
         p_sys->i_opendts = p_buffer->i_dts;
 
@@ -990,7 +1169,7 @@ static ssize_t writeSegment( sout_access_out_t *p_access )
 
         }
 
-        ssize_t val = vlc_write( p_sys->i_handle, output->p_buffer, output->i_buffer );
+        ssize_t val = segmentWrite( p_sys, output->p_buffer, output->i_buffer );
         if ( val == -1 )
         {
            if ( errno == EINTR )
@@ -1048,6 +1227,20 @@ static ssize_t Write( sout_access_out_t *p_access, block_t *p_buffer )
         }
         i_write += ret;
 
+        /* When serving from memory, hand the complete groups of pictures
+         * to the clients of the growing segment right away */
+        if( p_sys->p_httpd_segment && p_sys->full_segments )
+        {
+            ret = writeSegment( p_access );
+            if( ret < 0 )
+            {
+                msg_Err( p_access, "Error in write loop");
+                block_ChainRelease( p_buffer );
+                return ret;
+            }
+            i_write += ret;
+        }
+
         block_t *p_temp = p_buffer->p_next;
         p_buffer->p_next = NULL;
         block_ChainLastAppend( &p_sys->ongoing_segment_end, p_buffer );
@@ -45,11 +45,15 @@
 #   include <ws2tcpip.h>
 #else
 #   include <sys/socket.h>
+#   include <netinet/in.h>
+#   include <netinet/udp.h>
 #endif
 
 #include <vlc_network.h>
 
 #define MAX_EMPTY_BLOCKS 200
+#define MAX_BATCH_PACKETS 64 /* also the kernel limit of UDP GSO segments */
+#define LATE_DELAY 20000 /* packets sent later than this are counted late */
 
 /*****************************************************************************
  * Module descriptor
@@ -70,6 +74,16 @@ static void Close( vlc_object_t * );
                           "of packets that will be sent at a time. It " \
                           "helps reducing the scheduling load on " \
                           "heavily-loaded systems." )
+#define WINDOW_TEXT N_("Pacing window (ms)")
+#define WINDOW_LONGTEXT N_("Packets due within this time window are " \
+                           "sent together in a single system call. " \
+                           "Packets carrying a clock reference always " \
+                           "start a new group, so that they are sent on " \
+                           "time. Set to 0 to send packets one by one." )
+#define GSO_TEXT N_("Segmentation offload")
+#define GSO_LONGTEXT N_("Send each group of equally-sized packets as one " \
+                        "large datagram segmented by the kernel or the " \
+                        "network interface (UDP GSO).")
 
 vlc_module_begin ()
     set_description( N_("UDP stream output") )
@@ -79,6 +93,13 @@ vlc_module_begin ()
     add_integer( SOUT_CFG_PREFIX "caching", DEFAULT_PTS_DELAY / 1000, CACHING_TEXT, CACHING_LONGTEXT, true )
     add_integer( SOUT_CFG_PREFIX "group", 1, GROUP_TEXT, GROUP_LONGTEXT,
                                  true )
+#ifdef HAVE_SENDMMSG
+    add_integer( SOUT_CFG_PREFIX "window", 0, WINDOW_TEXT, WINDOW_LONGTEXT,
+                 true )
+#ifdef UDP_SEGMENT
+    add_bool( SOUT_CFG_PREFIX "gso", false, GSO_TEXT, GSO_LONGTEXT, true )
+#endif
+#endif
 
     set_capability( "sout access", 0 )
     add_shortcut( "udp" )
@@ -92,6 +113,12 @@ vlc_module_end ()
 static const char *const ppsz_sout_options[] = {
     "caching",
     "group",
+#ifdef HAVE_SENDMMSG
+    "window",
+#ifdef UDP_SEGMENT
+    "gso",
+#endif
+#endif
     NULL
 };
 
@@ -107,6 +134,9 @@ static ssize_t Write   ( sout_access_out_t *, block_t * );
 static int Control( sout_access_out_t *, int, va_list );
 
 static void* ThreadWrite( void * );
+#ifdef HAVE_SENDMMSG
+static void* ThreadWriteBatch( void * );
+#endif
 static block_t *NewUDPPacket( sout_access_out_t *, mtime_t );
 
 struct sout_access_out_sys_t
@@ -116,11 +146,27 @@ struct sout_access_out_sys_t
     bool          b_mtu_warning;
     size_t        i_mtu;
 
-    block_fifo_t *p_fifo;
-    block_fifo_t *p_empty_blocks;
+    block_spsc_t *p_fifo;
+    block_spsc_t *p_empty_blocks;
     block_t      *p_buffer;
 
     vlc_thread_t  thread;
+
+#ifdef HAVE_SENDMMSG
+    mtime_t       i_window;
+    bool          b_gso;
+    block_t      *p_pending; /* first packet of the next group */
+#endif
+
+    /* Transmission statistics, owned by the writer thread */
+    struct
+    {
+        uint64_t  i_packets;
+        uint64_t  i_calls;
+        uint64_t  i_late;
+        mtime_t   i_jitter; /* sum of absolute send time deviations */
+        mtime_t   i_jitter_max;
+    } stats;
 };
 
 #define DEFAULT_PORT 1234
@@ -209,16 +255,31 @@ static int Open( vlc_object_t *p_this )
     p_sys->i_handle = i_handle;
     p_sys->i_mtu = var_CreateGetInteger( p_this, "mtu" );
     p_sys->b_mtu_warning = false;
-    p_sys->p_fifo = block_FifoNew();
-    p_sys->p_empty_blocks = block_FifoNew();
+    p_sys->p_fifo = block_SpscNew();
+    p_sys->p_empty_blocks = block_SpscNew();
     p_sys->p_buffer = NULL;
+    memset( &p_sys->stats, 0, sizeof( p_sys->stats ) );
+
+    void *(*pf_thread)( void * ) = ThreadWrite;
+#ifdef HAVE_SENDMMSG
+    p_sys->i_window = UINT64_C(1000)
+                    * var_GetInteger( p_access, SOUT_CFG_PREFIX "window" );
+#ifdef UDP_SEGMENT
+    p_sys->b_gso = var_GetBool( p_access, SOUT_CFG_PREFIX "gso" );
+#else
+    p_sys->b_gso = false;
+#endif
+    p_sys->p_pending = NULL;
+    if( p_sys->i_window > 0 )
+        pf_thread = ThreadWriteBatch;
+#endif
 
-    if( vlc_clone( &p_sys->thread, ThreadWrite, p_access,
+    if( vlc_clone( &p_sys->thread, pf_thread, p_access,
                            VLC_THREAD_PRIORITY_HIGHEST ) )
     {
         msg_Err( p_access, "cannot spawn sout access thread" );
-        block_FifoRelease( p_sys->p_fifo );
-        block_FifoRelease( p_sys->p_empty_blocks );
+        block_SpscRelease( p_sys->p_fifo );
+        block_SpscRelease( p_sys->p_empty_blocks );
         net_Close (i_handle);
         free (p_sys);
         return VLC_EGENERIC;
@@ -240,10 +301,21 @@ static void Close( vlc_object_t * p_this )
 
     vlc_cancel( p_sys->thread );
     vlc_join( p_sys->thread, NULL );
-    block_FifoRelease( p_sys->p_fifo );
-    block_FifoRelease( p_sys->p_empty_blocks );
+    block_SpscRelease( p_sys->p_fifo );
+    block_SpscRelease( p_sys->p_empty_blocks );
 
     if( p_sys->p_buffer ) block_Release( p_sys->p_buffer );
+#ifdef HAVE_SENDMMSG
+    if( p_sys->p_pending ) block_Release( p_sys->p_pending );
+#endif
+
+    if( p_sys->stats.i_packets > 0 )
+        msg_Dbg( p_access, "sent %"PRIu64" packets in %"PRIu64" calls, "
+                 "%"PRIu64" late, jitter %"PRId64" us average, %"PRId64
+                 " us maximum", p_sys->stats.i_packets, p_sys->stats.i_calls,
+                 p_sys->stats.i_late,
+                 p_sys->stats.i_jitter / (mtime_t)p_sys->stats.i_packets,
+                 p_sys->stats.i_jitter_max );
 
     net_Close( p_sys->i_handle );
     free( p_sys );
@@ -296,10 +368,22 @@ static ssize_t Write( sout_access_out_t *p_access, block_t *p_buffer )
                          now - p_sys->p_buffer->i_dts
                           - p_sys->i_caching );
             }
-            block_FifoPut( p_sys->p_fifo, p_sys->p_buffer );
+            block_SpscPut( p_sys->p_fifo, p_sys->p_buffer );
             p_sys->p_buffer = NULL;
         }
 
+        /* Take blocks fitting in a datagram as they are, without copy */
+        if( !p_sys->p_buffer && p_buffer->i_buffer > 0 &&
+            p_buffer->i_buffer <= p_sys->i_mtu )
+        {
+            i_len += p_buffer->i_buffer;
+            p_next = p_buffer->p_next;
+            p_buffer->p_next = NULL;
+            p_sys->p_buffer = p_buffer;
+            p_buffer = p_next;
+            continue;
+        }
+
         i_len += p_buffer->i_buffer;
         while( p_buffer->i_buffer )
         {
@@ -313,6 +397,17 @@ static ssize_t Write( sout_access_out_t *p_access, block_t *p_buffer )
                 p_sys->p_buffer = NewUDPPacket( p_access, p_buffer->i_dts );
                 if( !p_sys->p_buffer ) break;
             }
+            else if( p_sys->p_buffer->p_start + p_sys->p_buffer->i_size <
+                     p_sys->p_buffer->p_buffer + p_sys->i_mtu )
+            {
+                /* block taken as is, make room for a whole datagram */
+                size_t i_used = p_sys->p_buffer->i_buffer;
+
+                p_sys->p_buffer = block_Realloc( p_sys->p_buffer, 0,
+                                                 p_sys->i_mtu );
+                if( !p_sys->p_buffer ) break;
+                p_sys->p_buffer->i_buffer = i_used;
+            }
 
             memcpy( p_sys->p_buffer->p_buffer + p_sys->p_buffer->i_buffer,
                     p_buffer->p_buffer, i_write );
@@ -336,7 +431,7 @@ static ssize_t Write( sout_access_out_t *p_access, block_t *p_buffer )
                              mdate() - p_sys->p_buffer->i_dts
                               - p_sys->i_caching );
                 }
-                block_FifoPut( p_sys->p_fifo, p_sys->p_buffer );
+                block_SpscPut( p_sys->p_fifo, p_sys->p_buffer );
                 p_sys->p_buffer = NULL;
             }
         }
@@ -357,19 +452,19 @@ static block_t *NewUDPPacket( sout_access_out_t *p_access, mtime_t i_dts)
     sout_access_out_sys_t *p_sys = p_access->p_sys;
     block_t *p_buffer;
 
-    while ( block_FifoCount( p_sys->p_empty_blocks ) > MAX_EMPTY_BLOCKS )
+    while ( block_SpscCount( p_sys->p_empty_blocks ) > MAX_EMPTY_BLOCKS )
     {
-        p_buffer = block_FifoGet( p_sys->p_empty_blocks );
+        p_buffer = block_SpscTryGet( p_sys->p_empty_blocks );
         block_Release( p_buffer );
     }
 
-    if( block_FifoCount( p_sys->p_empty_blocks ) == 0 )
+    p_buffer = block_SpscTryGet( p_sys->p_empty_blocks );
+    if( p_buffer == NULL )
     {
         p_buffer = block_Alloc( p_sys->i_mtu );
     }
     else
     {
-        p_buffer = block_FifoGet(p_sys->p_empty_blocks );
         p_buffer->i_flags = 0;
         p_buffer = block_Realloc( p_buffer, 0, p_sys->i_mtu );
     }
@@ -380,6 +475,23 @@ static block_t *NewUDPPacket( sout_access_out_t *p_access, mtime_t i_dts)
     return p_buffer;
 }
 
+/*****************************************************************************
+ * UpdateStats: account for a packet due at i_date and sent at i_sent
+ *****************************************************************************/
+static void UpdateStats( sout_access_out_sys_t *p_sys, mtime_t i_date,
+                         mtime_t i_sent )
+{
+    mtime_t i_delay = i_sent - i_date;
+    mtime_t i_jitter = i_delay >= 0 ? i_delay : -i_delay;
+
+    p_sys->stats.i_packets++;
+    p_sys->stats.i_jitter += i_jitter;
+    if( i_jitter > p_sys->stats.i_jitter_max )
+        p_sys->stats.i_jitter_max = i_jitter;
+    if( i_delay > LATE_DELAY )
+        p_sys->stats.i_late++;
+}
+
 /*****************************************************************************
  * ThreadWrite: Write a packet on the network at the good time.
  *****************************************************************************/
@@ -395,7 +507,7 @@ static void* ThreadWrite( void *data )
 
     for (;;)
     {
-        block_t *p_pk = block_FifoGet( p_sys->p_fifo );
+        block_t *p_pk = block_SpscGet( p_sys->p_fifo );
         mtime_t       i_date, i_sent;
 
         i_date = p_sys->i_caching + p_pk->i_dts;
@@ -407,7 +519,7 @@ static void* ThreadWrite( void *data )
                     msg_Dbg( p_access, "mmh, hole (%"PRId64" > 2s) -> drop",
                              i_date - i_date_last );
 
-                block_FifoPut( p_sys->p_empty_blocks, p_pk );
+                block_SpscPut( p_sys->p_empty_blocks, p_pk );
 
                 i_date_last = i_date;
                 i_dropped_packets++;
@@ -440,16 +552,224 @@ static void* ThreadWrite( void *data )
 
 #if 1
         i_sent = mdate();
-        if ( i_sent > i_date + 20000 )
+        if ( i_sent > i_date + LATE_DELAY )
         {
             msg_Dbg( p_access, "packet has been sent too late (%"PRId64 ")",
                      i_sent - i_date );
         }
 #endif
+        p_sys->stats.i_calls++;
+        UpdateStats( p_sys, i_date, i_sent );
 
-        block_FifoPut( p_sys->p_empty_blocks, p_pk );
+        block_SpscPut( p_sys->p_empty_blocks, p_pk );
 
         i_date_last = i_date;
     }
     return NULL;
 }
+
+#ifdef HAVE_SENDMMSG
+static void BlockChainCleanup( void *chain )
+{
+    block_ChainRelease( chain );
+}
+
+#ifdef UDP_SEGMENT
+/*****************************************************************************
+ * SendSegmented: send a group of packets as one GSO datagram
+ *****************************************************************************
+ * All packets but the last one must have the same size. Returns -1 if the
+ * group is not eligible or segmentation offload is not available.
+ *****************************************************************************/
+static int SendSegmented( sout_access_out_t *p_access, block_t *p_chain,
+                          unsigned i_count )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    struct iovec iov[MAX_BATCH_PACKETS];
+    const size_t i_segment = p_chain->i_buffer;
+    size_t i_total = 0;
+    unsigned i = 0;
+
+    for( block_t *p_pk = p_chain; p_pk != NULL; p_pk = p_pk->p_next, i++ )
+    {
+        if( p_pk->i_buffer != i_segment
+         && (p_pk->p_next != NULL || p_pk->i_buffer > i_segment) )
+            return -1;
+        iov[i].iov_base = p_pk->p_buffer;
+        iov[i].iov_len = p_pk->i_buffer;
+        i_total += p_pk->i_buffer;
+    }
+    assert( i == i_count );
+
+    if( i_segment == 0 || i_total > 65507 )
+        return -1;
+
+    union
+    {
+        char buf[CMSG_SPACE(sizeof (uint16_t))];
+        struct cmsghdr align;
+    } control;
+    struct msghdr msg = {
+        .msg_iov = iov,
+        .msg_iovlen = i_count,
+        .msg_control = control.buf,
+        .msg_controllen = sizeof (control.buf),
+    };
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR( &msg );
+    uint16_t i_size = i_segment;
+
+    cmsg->cmsg_level = IPPROTO_UDP;
+    cmsg->cmsg_type = UDP_SEGMENT;
+    cmsg->cmsg_len = CMSG_LEN(sizeof (i_size));
+    memcpy( CMSG_DATA(cmsg), &i_size, sizeof (i_size) );
+
+    if( sendmsg( p_sys->i_handle, &msg, 0 ) == -1 )
+    {
+        if( errno != EIO && errno != EINVAL && errno != ENOPROTOOPT )
+        {   /* transient error, do not resend */
+            msg_Warn( p_access, "send error: %s", vlc_strerror_c(errno) );
+            return 0;
+        }
+
+        msg_Warn( p_access, "segmentation offload not available: %s",
+                  vlc_strerror_c(errno) );
+        p_sys->b_gso = false;
+        return -1;
+    }
+    return 0;
+}
+#endif
+
+/*****************************************************************************
+ * SendBatch: send a chain of packets with as few system calls as possible
+ *****************************************************************************/
+static void SendBatch( sout_access_out_t *p_access, block_t *p_chain,
+                       unsigned i_count )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+
+#ifdef UDP_SEGMENT
+    if( p_sys->b_gso && i_count > 1
+     && SendSegmented( p_access, p_chain, i_count ) == 0 )
+    {
+        p_sys->stats.i_calls++;
+        return;
+    }
+#endif
+
+    struct mmsghdr msgs[MAX_BATCH_PACKETS];
+    struct iovec iov[MAX_BATCH_PACKETS];
+    unsigned i = 0;
+
+    for( block_t *p_pk = p_chain; p_pk != NULL; p_pk = p_pk->p_next, i++ )
+    {
+        iov[i].iov_base = p_pk->p_buffer;
+        iov[i].iov_len = p_pk->i_buffer;
+        memset( &msgs[i].msg_hdr, 0, sizeof( msgs[i].msg_hdr ) );
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    assert( i == i_count );
+
+    for( unsigned i_sent = 0; i_sent < i_count; )
+    {
+        int val = sendmmsg( p_sys->i_handle, msgs + i_sent,
+                            i_count - i_sent, 0 );
+        p_sys->stats.i_calls++;
+        if( val == -1 )
+        {
+            msg_Warn( p_access, "send error: %s", vlc_strerror_c(errno) );
+            break;
+        }
+        i_sent += val;
+    }
+}
+
+/*****************************************************************************
+ * ThreadWriteBatch: Write groups of packets on the network at the good time.
+ *****************************************************************************
+ * The first packet of a group is sent on time, together with the following
+ * packets due within the pacing window.
+ *****************************************************************************/
+static void* ThreadWriteBatch( void *data )
+{
+    sout_access_out_t *p_access = data;
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    mtime_t i_date_last = -1;
+    unsigned i_dropped_packets = 0;
+
+    for (;;)
+    {
+        block_t *p_pk = p_sys->p_pending;
+        mtime_t i_date;
+
+        p_sys->p_pending = NULL;
+        if( p_pk == NULL )
+            p_pk = block_SpscGet( p_sys->p_fifo );
+
+        i_date = p_sys->i_caching + p_pk->i_dts;
+        if( i_date_last > 0 && i_date - i_date_last > 2000000 )
+        {
+            if( !i_dropped_packets )
+                msg_Dbg( p_access, "mmh, hole (%"PRId64" > 2s) -> drop",
+                         i_date - i_date_last );
+
+            block_SpscPut( p_sys->p_empty_blocks, p_pk );
+
+            i_date_last = i_date;
+            i_dropped_packets++;
+            continue;
+        }
+
+        block_cleanup_push( p_pk );
+        mwait( i_date );
+        vlc_cleanup_pop();
+
+        /* Gather the packets due within the window */
+        block_t **pp_last = &p_pk->p_next;
+        unsigned i_count = 1;
+
+        i_date_last = i_date;
+        while( i_count < MAX_BATCH_PACKETS )
+        {
+            block_t *p_next = block_SpscTryGet( p_sys->p_fifo );
+            if( p_next == NULL )
+                break;
+
+            mtime_t i_next = p_sys->i_caching + p_next->i_dts;
+            if( i_next > i_date + p_sys->i_window
+             || (p_next->i_flags & BLOCK_FLAG_CLOCK) )
+            {
+                p_sys->p_pending = p_next;
+                break;
+            }
+
+            *pp_last = p_next;
+            pp_last = &p_next->p_next;
+            i_count++;
+            i_date_last = i_next;
+        }
+
+        vlc_cleanup_push( BlockChainCleanup, p_pk );
+        SendBatch( p_access, p_pk, i_count );
+        vlc_cleanup_pop();
+
+        if( i_dropped_packets )
+        {
+            msg_Dbg( p_access, "dropped %i packets", i_dropped_packets );
+            i_dropped_packets = 0;
+        }
+
+        mtime_t i_sent = mdate();
+        if( i_sent > i_date + LATE_DELAY )
+            msg_Dbg( p_access, "packet has been sent too late (%"PRId64 ")",
+                     i_sent - i_date );
+
+        for( block_t *p_next = p_pk; p_next != NULL; p_next = p_next->p_next )
+            UpdateStats( p_sys, p_sys->i_caching + p_next->i_dts, i_sent );
+
+        block_SpscPut( p_sys->p_empty_blocks, p_pk );
+    }
+    return NULL;
+}
+#endif
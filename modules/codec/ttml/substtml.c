@@ -951,6 +951,9 @@ static int DecodeBlock( decoder_t *p_dec, block_t *p_block )
 #ifdef TTML_DEBUG
     if( p_block->i_buffer )
     {
+        p_block = block_Unshare( p_block );
+        if( unlikely(p_block == NULL) )
+            return ret;
         p_block->p_buffer[p_block->i_buffer - 1] = 0;
         msg_Dbg(p_dec,"time %ld %s", p_block->i_dts, p_block->p_buffer);
     }
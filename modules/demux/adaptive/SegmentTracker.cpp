@@ -76,7 +76,8 @@ SegmentTrackerEvent::SegmentTrackerEvent(const ID &id, mtime_t duration)
     u.segment.id = &id;
 }
 
-SegmentTracker::SegmentTracker(AbstractAdaptationLogic *logic_, BaseAdaptationSet *adaptSet)
+SegmentTracker::SegmentTracker(AbstractAdaptationLogic *logic_, BaseAdaptationSet *adaptSet,
+                               unsigned prefetchDepth_)
 {
     first = true;
     curNumber = next = 0;
@@ -87,6 +88,7 @@ SegmentTracker::SegmentTracker(AbstractAdaptationLogic *logic_, BaseAdaptationSe
     setAdaptationLogic(logic_);
     adaptationSet = adaptSet;
     format = StreamFormat::UNSUPPORTED;
+    prefetchDepth = prefetchDepth_;
 }
 
 SegmentTracker::~SegmentTracker()
@@ -127,6 +129,7 @@ bool SegmentTracker::segmentsListReady() const
 
 void SegmentTracker::reset()
 {
+    flushPrefetched();
     notify(SegmentTrackerEvent(curRepresentation, NULL));
     curRepresentation = NULL;
     init_sent = false;
@@ -165,6 +168,7 @@ SegmentChunk * SegmentTracker::getNextChunk(bool switch_allowed,
 
     if(rep != curRepresentation)
     {
+        flushPrefetched();
         notify(SegmentTrackerEvent(curRepresentation, rep));
         prevRep = curRepresentation;
         curRepresentation = rep;
@@ -247,7 +251,9 @@ SegmentChunk * SegmentTracker::getNextChunk(bool switch_allowed,
         initializing = false;
     }
 
-    SegmentChunk *chunk = segment->toChunk(next, rep, connManager);
+    SegmentChunk *chunk = getPrefetchedChunk(segment, next);
+    if(!chunk)
+        chunk = segment->toChunk(next, rep, connManager);
 
     /* Notify new segment length for stats / logic */
     if(chunk)
@@ -274,11 +280,70 @@ SegmentChunk * SegmentTracker::getNextChunk(bool switch_allowed,
     {
         curNumber = next;
         next++;
+        prefetch(rep, connManager);
     }
 
     return chunk;
 }
 
+SegmentChunk * SegmentTracker::getPrefetchedChunk(const ISegment *segment, uint64_t number)
+{
+    /* drop the segments we've skipped */
+    while(!prefetched.empty() && prefetched.front().number < number)
+    {
+        delete prefetched.front().chunk;
+        prefetched.pop_front();
+    }
+
+    if(prefetched.empty())
+        return NULL;
+
+    if(prefetched.front().number != number || prefetched.front().segment != segment)
+    {
+        flushPrefetched();
+        return NULL;
+    }
+
+    SegmentChunk *chunk = prefetched.front().chunk;
+    prefetched.pop_front();
+    return chunk;
+}
+
+void SegmentTracker::prefetch(BaseRepresentation *rep, AbstractConnectionManager *connManager)
+{
+    /* Live playlist updates can drop the segments we would hold */
+    if(rep->getPlaylist()->isLive())
+        return;
+
+    uint64_t pos = prefetched.empty() ? next : prefetched.back().number + 1;
+    while(prefetched.size() < prefetchDepth)
+    {
+        bool b_gap;
+        uint64_t number;
+        ISegment *segment = rep->getNextSegment(BaseRepresentation::INFOTYPE_MEDIA,
+                                                pos, &number, &b_gap);
+        if(!segment)
+            break;
+
+        SegmentChunk *chunk = segment->toChunk(number, rep, connManager);
+        if(!chunk)
+            break;
+
+        PrefetchedChunk p = { number, segment, chunk };
+        prefetched.push_back(p);
+        pos = number + 1;
+    }
+}
+
+void SegmentTracker::flushPrefetched()
+{
+    while(!prefetched.empty())
+    {
+        delete prefetched.front().chunk;
+        prefetched.pop_front();
+    }
+}
+
 bool SegmentTracker::setPositionByTime(mtime_t time, bool restarted, bool tryonly)
 {
     uint64_t segnumber;
@@ -298,6 +363,7 @@ bool SegmentTracker::setPositionByTime(mtime_t time, bool restarted, bool tryonl
 
 void SegmentTracker::setPositionByNumber(uint64_t segnumber, bool restarted)
 {
+    flushPrefetched();
     if(restarted)
     {
         initializing = true;
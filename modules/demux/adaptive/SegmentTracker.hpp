@@ -43,6 +43,7 @@ namespace adaptive
     {
         class BaseAdaptationSet;
         class BaseRepresentation;
+        class ISegment;
         class SegmentChunk;
     }
 
@@ -112,7 +113,8 @@ namespace adaptive
     class SegmentTracker
     {
         public:
-            SegmentTracker(AbstractAdaptationLogic *, BaseAdaptationSet *);
+            SegmentTracker(AbstractAdaptationLogic *, BaseAdaptationSet *,
+                           unsigned = 0);
             ~SegmentTracker();
 
             StreamFormat getCurrentFormat() const;
@@ -131,6 +133,9 @@ namespace adaptive
         private:
             void setAdaptationLogic(AbstractAdaptationLogic *);
             void notify(const SegmentTrackerEvent &) const;
+            SegmentChunk * getPrefetchedChunk(const ISegment *, uint64_t);
+            void prefetch(BaseRepresentation *, AbstractConnectionManager *);
+            void flushPrefetched();
             bool first;
             bool initializing;
             bool index_sent;
@@ -142,6 +147,16 @@ namespace adaptive
             BaseAdaptationSet *adaptationSet;
             BaseRepresentation *curRepresentation;
             std::list<SegmentTrackerListenerInterface *> listeners;
+            /* media segments of curRepresentation already being downloaded
+             * ahead of the next one */
+            struct PrefetchedChunk
+            {
+                uint64_t number;
+                const ISegment *segment;
+                SegmentChunk *chunk;
+            };
+            std::list<PrefetchedChunk> prefetched;
+            unsigned prefetchDepth;
     };
 }
 
@@ -74,6 +74,18 @@ static void Close   (vlc_object_t *);
 #define ADAPT_ACCESS_TEXT N_("Use regular HTTP modules")
 #define ADAPT_ACCESS_LONGTEXT N_("Connect using http access instead of custom http code")
 
+#define ADAPT_HTTP2_TEXT N_("Use the HTTP/2 connection manager")
+#define ADAPT_HTTP2_LONGTEXT N_("Fetch playlists and segments through a shared " \
+                                "connection manager, multiplexing requests over one " \
+                                "HTTP/2 connection per server when possible")
+
+#define ADAPT_DOWNLOADS_TEXT N_("Concurrent downloads")
+#define ADAPT_DOWNLOADS_LONGTEXT N_("Maximum number of segments downloaded at the same time")
+
+#define ADAPT_PREFETCH_TEXT N_("Segments prefetch")
+#define ADAPT_PREFETCH_LONGTEXT N_("Number of segments of each stream to download " \
+                                   "ahead of the one being played")
+
 static const AbstractAdaptationLogic::LogicType pi_logics[] = {
                                 AbstractAdaptationLogic::Default,
                                 AbstractAdaptationLogic::Predictive,
@@ -120,6 +132,11 @@ vlc_module_begin ()
                      ADAPT_HEIGHT_TEXT, ADAPT_HEIGHT_TEXT, false )
         add_integer( "adaptive-bw",     250, ADAPT_BW_TEXT,     ADAPT_BW_LONGTEXT,     false )
         add_bool   ( "adaptive-use-access", false, ADAPT_ACCESS_TEXT, ADAPT_ACCESS_LONGTEXT, true );
+        add_bool   ( "adaptive-use-http2", false, ADAPT_HTTP2_TEXT, ADAPT_HTTP2_LONGTEXT, true );
+        add_integer_with_range( "adaptive-downloads", 2, 1, 8,
+                                ADAPT_DOWNLOADS_TEXT, ADAPT_DOWNLOADS_LONGTEXT, true )
+        add_integer_with_range( "adaptive-prefetch", 1, 0, 8,
+                                ADAPT_PREFETCH_TEXT, ADAPT_PREFETCH_LONGTEXT, true )
         set_callbacks( Open, Close )
 vlc_module_end ()
 
@@ -117,7 +117,7 @@ block_t * AbstractChunk::read(size_t size)
 }
 
 HTTPChunkSource::HTTPChunkSource(const std::string& url, AbstractConnectionManager *manager,
-                                 const adaptive::ID &id) :
+                                 const adaptive::ID &id, unsigned weight_) :
     AbstractChunkSource(),
     connection   (NULL),
     connManager  (manager),
@@ -126,6 +126,7 @@ HTTPChunkSource::HTTPChunkSource(const std::string& url, AbstractConnectionManag
     prepared = false;
     eof = false;
     sourceid = id;
+    weight = weight_;
     if(!init(url))
         eof = true;
 }
@@ -218,6 +219,7 @@ bool HTTPChunkSource::prepare(int i_redir)
             return false;
     }
 
+    connection->setWeight(weight);
     int i_ret = connection->request(params.getPath(), bytesRange);
     if(i_ret != VLC_SUCCESS)
     {
@@ -250,7 +252,7 @@ HTTPChunkBufferedSource::HTTPChunkBufferedSource(const std::string& url, Abstrac
     done = false;
     eof = false;
     held = false;
-    downloadstart = 0;
+    downloadtime = 0;
 }
 
 HTTPChunkBufferedSource::~HTTPChunkBufferedSource()
@@ -322,12 +324,6 @@ void HTTPChunkBufferedSource::bufferize(size_t readsize)
         return;
     }
 
-    struct
-    {
-        size_t size;
-        mtime_t time;
-    } rate = {0,0};
-
     ssize_t ret = connection->read(p_block->p_buffer, readsize);
     if(ret <= 0)
     {
@@ -335,9 +331,6 @@ void HTTPChunkBufferedSource::bufferize(size_t readsize)
         p_block = NULL;
         vlc_mutex_locker locker( &lock );
         done = true;
-        rate.size = buffered + consumed;
-        rate.time = mdate() - downloadstart;
-        downloadstart = 0;
     }
     else
     {
@@ -346,30 +339,28 @@ void HTTPChunkBufferedSource::bufferize(size_t readsize)
         buffered += p_block->i_buffer;
         block_ChainLastAppend(&pp_tail, p_block);
         if((size_t) ret < readsize)
-        {
             done = true;
-            rate.size = buffered + consumed;
-            rate.time = mdate() - downloadstart;
-            downloadstart = 0;
-        }
-    }
-
-    if(rate.size)
-    {
-        connManager->updateDownloadRate(sourceid, rate.size, rate.time);
     }
 
     vlc_cond_signal(&avail);
 }
 
-bool HTTPChunkBufferedSource::prepare()
+void HTTPChunkBufferedSource::addDownloadTime(mtime_t time)
 {
-    if(!prepared)
-    {
-        downloadstart = mdate();
-        return HTTPChunkSource::prepare();
-    }
-    return true;
+    vlc_mutex_locker locker( &lock );
+    downloadtime += time;
+}
+
+void HTTPChunkBufferedSource::notifyDownloadRate()
+{
+    vlc_mutex_lock(&lock);
+    const size_t size = buffered + consumed;
+    const mtime_t time = downloadtime;
+    downloadtime = 0;
+    vlc_mutex_unlock(&lock);
+
+    if(size)
+        connManager->updateDownloadRate(sourceid, size, time);
 }
 
 bool HTTPChunkBufferedSource::hasMoreData() const
@@ -458,7 +449,8 @@ block_t * HTTPChunkBufferedSource::read(size_t readsize)
 
 HTTPChunk::HTTPChunk(const std::string &url, AbstractConnectionManager *manager,
                      const adaptive::ID &id):
-    AbstractChunk(new HTTPChunkSource(url, manager, id))
+    AbstractChunk(new HTTPChunkSource(url, manager, id,
+                                      HTTPChunkSource::PLAYLIST_WEIGHT))
 {
 
 }
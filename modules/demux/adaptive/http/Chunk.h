@@ -84,7 +84,7 @@ namespace adaptive
         {
             public:
                 HTTPChunkSource(const std::string &url, AbstractConnectionManager *,
-                                const ID &);
+                                const ID &, unsigned = SEGMENT_WEIGHT);
                 virtual ~HTTPChunkSource();
 
                 virtual block_t *   readBlock       (); /* impl */
@@ -93,6 +93,11 @@ namespace adaptive
 
                 static const size_t CHUNK_SIZE = 32768;
 
+                /* HTTP/2 weights: playlists and keys block the playback,
+                 * so they get most of the bandwidth over the segments */
+                static const unsigned SEGMENT_WEIGHT = 16;
+                static const unsigned PLAYLIST_WEIGHT = 256;
+
             protected:
                 virtual bool      prepare(int = 0);
                 AbstractConnection    *connection;
@@ -101,6 +106,7 @@ namespace adaptive
                 bool                prepared;
                 bool                eof;
                 ID                  sourceid;
+                unsigned            weight;
 
             private:
                 bool init(const std::string &);
@@ -122,9 +128,10 @@ namespace adaptive
                 void               release();
 
             protected:
-                virtual bool       prepare(); /* reimpl */
                 void               bufferize(size_t);
                 bool               isDone() const;
+                void               addDownloadTime(mtime_t);
+                void               notifyDownloadRate();
 
             private:
                 block_t            *p_head; /* read cache buffer */
@@ -132,7 +139,7 @@ namespace adaptive
                 size_t              buffered; /* read cache size */
                 bool                done;
                 bool                eof;
-                mtime_t             downloadstart;
+                mtime_t             downloadtime;
                 mutable vlc_mutex_t lock;
                 vlc_cond_t          avail;
                 bool                held;
@@ -28,37 +28,43 @@
 
 using namespace adaptive::http;
 
-Downloader::Downloader()
+Downloader::Downloader(unsigned maxthreads_)
 {
     vlc_mutex_init(&lock);
     vlc_cond_init(&waitcond);
+    vlc_cond_init(&updatedcond);
     killed = false;
-    thread_handle_valid = false;
+    maxthreads = maxthreads_ ? maxthreads_ : 1;
+    sharedtime = 0;
+    sharedtimeupdate = 0;
 }
 
 bool Downloader::start()
 {
-    if(!thread_handle_valid &&
-       vlc_clone(&thread_handle, downloaderThread,
-                 static_cast<void *>(this), VLC_THREAD_PRIORITY_INPUT))
+    while(threads.size() < maxthreads)
     {
-        return false;
+        vlc_thread_t thread;
+        if(vlc_clone(&thread, downloaderThread,
+                     static_cast<void *>(this), VLC_THREAD_PRIORITY_INPUT))
+            break;
+        threads.push_back(thread);
     }
-    thread_handle_valid = true;
-    return true;
+    return !threads.empty();
 }
 
 Downloader::~Downloader()
 {
     vlc_mutex_lock( &lock );
     killed = true;
-    vlc_cond_signal(&waitcond);
+    vlc_cond_broadcast(&waitcond);
     vlc_mutex_unlock( &lock );
 
-    if(thread_handle_valid)
-        vlc_join(thread_handle, NULL);
+    std::vector<vlc_thread_t>::const_iterator it;
+    for(it = threads.begin(); it != threads.end(); ++it)
+        vlc_join(*it, NULL);
     vlc_mutex_destroy(&lock);
     vlc_cond_destroy(&waitcond);
+    vlc_cond_destroy(&updatedcond);
 }
 void Downloader::schedule(HTTPChunkBufferedSource *source)
 {
@@ -72,6 +78,9 @@ void Downloader::schedule(HTTPChunkBufferedSource *source)
 void Downloader::cancel(HTTPChunkBufferedSource *source)
 {
     vlc_mutex_lock(&lock);
+    /* wait for any pending read on it to complete */
+    while(isActive(source))
+        vlc_cond_wait(&updatedcond, &lock);
     source->release();
     chunks.remove(source);
     vlc_mutex_unlock(&lock);
@@ -92,27 +101,62 @@ void Downloader::DownloadSource(HTTPChunkBufferedSource *source)
         source->bufferize(HTTPChunkSource::CHUNK_SIZE);
 }
 
+bool Downloader::isActive(const HTTPChunkBufferedSource *source) const
+{
+    std::list<HTTPChunkBufferedSource *>::const_iterator it;
+    for(it = active.begin(); it != active.end(); ++it)
+        if(*it == source)
+            return true;
+    return false;
+}
+
+HTTPChunkBufferedSource * Downloader::nextSource() const
+{
+    /* oldest scheduled source not being read by another thread */
+    std::list<HTTPChunkBufferedSource *>::const_iterator it;
+    for(it = chunks.begin(); it != chunks.end(); ++it)
+        if(!isActive(*it))
+            return *it;
+    return NULL;
+}
+
+mtime_t Downloader::sharedTime()
+{
+    mtime_t now = mdate();
+    if(!active.empty() && sharedtimeupdate)
+        sharedtime += (now - sharedtimeupdate) / active.size();
+    sharedtimeupdate = now;
+    return sharedtime;
+}
+
 void Downloader::Run()
 {
     vlc_mutex_lock(&lock);
     while(1)
     {
-        while(chunks.empty() && !killed)
+        HTTPChunkBufferedSource *source;
+        while(!killed && (source = nextSource()) == NULL)
             vlc_cond_wait(&waitcond, &lock);
 
         if(killed)
             break;
 
-        if(!chunks.empty())
+        const mtime_t start = sharedTime();
+        active.push_back(source);
+        vlc_mutex_unlock(&lock);
+
+        DownloadSource(source);
+
+        vlc_mutex_lock(&lock);
+        source->addDownloadTime(sharedTime() - start);
+        active.remove(source);
+        if(source->isDone())
         {
-            HTTPChunkBufferedSource *source = chunks.front();
-            DownloadSource(source);
-            if(source->isDone())
-            {
-                chunks.pop_front();
-                source->release();
-            }
+            chunks.remove(source);
+            source->notifyDownloadRate();
+            source->release();
         }
+        vlc_cond_broadcast(&updatedcond);
     }
     vlc_mutex_unlock(&lock);
 }
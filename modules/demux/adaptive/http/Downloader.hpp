@@ -24,6 +24,7 @@
 
 #include <vlc_common.h>
 #include <list>
+#include <vector>
 
 namespace adaptive
 {
@@ -34,7 +35,7 @@ namespace adaptive
         class Downloader
         {
             public:
-                Downloader();
+                Downloader(unsigned = 1);
                 ~Downloader();
                 bool start();
                 void schedule(HTTPChunkBufferedSource *);
@@ -44,12 +45,21 @@ namespace adaptive
                 static void * downloaderThread(void *);
                 void Run();
                 void DownloadSource(HTTPChunkBufferedSource *);
-                vlc_thread_t thread_handle;
+                HTTPChunkBufferedSource * nextSource() const;
+                bool isActive(const HTTPChunkBufferedSource *) const;
+                mtime_t sharedTime();
+                std::vector<vlc_thread_t> threads;
                 vlc_mutex_t  lock;
                 vlc_cond_t   waitcond;
-                bool         thread_handle_valid;
+                vlc_cond_t   updatedcond;
+                unsigned     maxthreads;
                 bool         killed;
                 std::list<HTTPChunkBufferedSource *> chunks;
+                std::list<HTTPChunkBufferedSource *> active;
+                /* Time shared between concurrent downloads: it advances
+                 * 1/n as fast as the real clock while n downloads run */
+                mtime_t      sharedtime;
+                mtime_t      sharedtimeupdate;
         };
 
     }
@@ -26,9 +26,19 @@
 #include "Sockets.hpp"
 #include "../adaptive/tools/Helper.h"
 
+#include <algorithm>
 #include <cstdio>
+#include <cstring>
 #include <sstream>
 #include <vlc_stream.h>
+#include <vlc_block.h>
+
+extern "C"
+{
+    #include "../../../access/http/resource.h"
+    #include "../../../access/http/connmgr.h"
+    #include "../../../access/http/message.h"
+}
 
 using namespace adaptive::http;
 
@@ -38,6 +48,7 @@ AbstractConnection::AbstractConnection(vlc_object_t *p_object_)
     available = true;
     bytesRead = 0;
     contentLength = 0;
+    weight = 0;
 }
 
 AbstractConnection::~AbstractConnection()
@@ -45,6 +56,11 @@ AbstractConnection::~AbstractConnection()
 
 }
 
+void AbstractConnection::setWeight(unsigned w)
+{
+    weight = w;
+}
+
 bool AbstractConnection::prepare(const ConnectionParams &params_)
 {
     if (!available)
@@ -494,6 +510,243 @@ void StreamUrlConnection::setUsed( bool b )
        reset();
 }
 
+struct adaptive_http_resource
+{
+    struct vlc_http_resource resource;
+    bool   ranged;
+    size_t start;
+    size_t end; /* inclusive, 0 if unbounded */
+    unsigned weight;
+};
+
+static int adaptive_http_resource_req(const struct vlc_http_resource *res,
+                                      struct vlc_http_msg *req, void *)
+{
+    const struct adaptive_http_resource *r =
+            reinterpret_cast<const struct adaptive_http_resource *>(res);
+    vlc_http_msg_set_weight(req, r->weight);
+    if(!r->ranged)
+        return 0;
+
+    int ret = (r->end > 0)
+            ? vlc_http_msg_add_header(req, "Range", "bytes=%zu-%zu", r->start, r->end)
+            : vlc_http_msg_add_header(req, "Range", "bytes=%zu-", r->start);
+    return ret;
+}
+
+static int adaptive_http_resource_resp(const struct vlc_http_resource *res,
+                                       const struct vlc_http_msg *resp, void *)
+{
+    const struct adaptive_http_resource *r =
+            reinterpret_cast<const struct adaptive_http_resource *>(res);
+    if(!r->ranged)
+        return 0;
+
+    int status = vlc_http_msg_get_status(resp);
+    if(status == 206)
+    {
+        const char *str = vlc_http_msg_get_header(resp, "Content-Range");
+        uintmax_t start, end;
+        if(str == NULL || sscanf(str, "bytes %ju-%ju", &start, &end) != 2 ||
+           start != r->start || start > end)
+            return -1;
+    }
+    else if(status < 300 && r->start != 0)
+        return -1; /* whole entity returned, not what we asked for */
+
+    return 0;
+}
+
+static const struct vlc_http_resource_cbs adaptive_http_resource_callbacks =
+{
+    adaptive_http_resource_req,
+    adaptive_http_resource_resp,
+};
+
+static struct vlc_http_resource *
+adaptive_http_resource_create(struct vlc_http_mgr *mgr, const char *uri,
+                              const char *ua, const BytesRange &range,
+                              unsigned weight)
+{
+    struct adaptive_http_resource *r =
+            (struct adaptive_http_resource *) malloc(sizeof(*r));
+    if(unlikely(r == NULL))
+        return NULL;
+
+    if(vlc_http_res_init(&r->resource, &adaptive_http_resource_callbacks,
+                         mgr, uri, ua, NULL))
+    {
+        free(r);
+        return NULL;
+    }
+
+    r->ranged = range.isValid();
+    r->start = r->ranged ? range.getStartByte() : 0;
+    r->end = r->ranged ? range.getEndByte() : 0;
+    r->weight = weight;
+    return &r->resource;
+}
+
+LibVLCHTTPConnection::LibVLCHTTPConnection(vlc_object_t *p_object_,
+                                           struct vlc_http_mgr *mgr)
+    : AbstractConnection(p_object_)
+{
+    http_mgr = mgr;
+    resource = NULL;
+    p_pending = NULL;
+    psz_useragent = var_InheritString(p_object_, "http-user-agent");
+}
+
+LibVLCHTTPConnection::~LibVLCHTTPConnection()
+{
+    reset();
+    free(psz_useragent);
+}
+
+void LibVLCHTTPConnection::reset()
+{
+    if(p_pending)
+        block_Release(p_pending);
+    p_pending = NULL;
+    if(resource)
+        vlc_http_res_destroy(resource);
+    resource = NULL;
+    bytesRead = 0;
+    contentLength = 0;
+    bytesRange = BytesRange();
+}
+
+bool LibVLCHTTPConnection::canReuse(const ConnectionParams &) const
+{
+    /* Connections to the origin servers are pooled by the shared manager */
+    return available;
+}
+
+int LibVLCHTTPConnection::request(const std::string &path, const BytesRange &range)
+{
+    reset();
+
+    /* Set new path for this query */
+    params.setPath(path);
+
+    msg_Dbg(p_object, "Retrieving %s @%zu", params.getUrl().c_str(),
+                      range.isValid() ? range.getStartByte() : 0);
+
+    std::string url = params.getUrl();
+    for(int i_redir = 0; ; i_redir++)
+    {
+        resource = adaptive_http_resource_create(http_mgr, url.c_str(),
+                                                 psz_useragent, range, weight);
+        if(!resource)
+            return VLC_EGENERIC;
+
+        int status = vlc_http_res_get_status(resource);
+        if(status < 0)
+        {
+            reset();
+            return VLC_EGENERIC;
+        }
+
+        char *psz_redir = vlc_http_res_get_redirect(resource);
+        if(psz_redir == NULL)
+        {
+            if(status >= 300)
+            {
+                msg_Err(p_object, "HTTP %d error for %s", status, url.c_str());
+                reset();
+                return VLC_EGENERIC;
+            }
+            break;
+        }
+
+        url = psz_redir;
+        free(psz_redir);
+        reset();
+        if(i_redir == 3)
+            return VLC_EGENERIC;
+    }
+
+    if(range.isValid() && range.getEndByte() > 0)
+    {
+        bytesRange = range;
+        contentLength = range.getEndByte() - range.getStartByte() + 1;
+    }
+
+    uintmax_t i_size = vlc_http_msg_get_size(resource->response);
+    if(i_size != UINTMAX_MAX)
+    {
+        if(!bytesRange.isValid() || contentLength > i_size)
+            contentLength = i_size;
+    }
+    return VLC_SUCCESS;
+}
+
+ssize_t LibVLCHTTPConnection::read(void *p_buffer, size_t len)
+{
+    if(!resource)
+        return VLC_EGENERIC;
+
+    if(len == 0)
+        return VLC_SUCCESS;
+
+    const size_t toRead = (contentLength) ? contentLength - bytesRead : len;
+    if (toRead == 0)
+        return VLC_SUCCESS;
+
+    if(len > toRead)
+        len = toRead;
+
+    uint8_t *p_dst = static_cast<uint8_t *>(p_buffer);
+    size_t copied = 0;
+    bool error = false;
+    while(copied < len)
+    {
+        if(p_pending == NULL)
+        {
+            p_pending = vlc_http_res_read(resource);
+            if(p_pending == NULL) /* EOF */
+                break;
+            if(p_pending == vlc_http_error)
+            {
+                p_pending = NULL;
+                error = true;
+                break;
+            }
+        }
+
+        size_t i_copy = std::min(len - copied, p_pending->i_buffer);
+        memcpy(&p_dst[copied], p_pending->p_buffer, i_copy);
+        copied += i_copy;
+        p_pending->p_buffer += i_copy;
+        p_pending->i_buffer -= i_copy;
+        if(p_pending->i_buffer == 0)
+        {
+            block_Release(p_pending);
+            p_pending = NULL;
+        }
+    }
+
+    ssize_t ret = (error && copied == 0) ? -1 : (ssize_t) copied;
+    if(ret >= 0)
+        bytesRead += ret;
+
+    if(ret < 0 || (size_t)ret < len || /* set EOF */
+       contentLength == bytesRead )
+    {
+        reset();
+        return ret;
+    }
+
+    return ret;
+}
+
+void LibVLCHTTPConnection::setUsed( bool b )
+{
+    available = !b;
+    if(available && contentLength == bytesRead)
+       reset();
+}
+
 ConnectionFactory::ConnectionFactory()
 {
 }
@@ -531,3 +784,35 @@ AbstractConnection * StreamUrlConnectionFactory::createConnection(vlc_object_t *
 {
     return new (std::nothrow) StreamUrlConnection(p_object);
 }
+
+LibVLCHTTPConnectionFactory::LibVLCHTTPConnectionFactory()
+    : ConnectionFactory()
+{
+    http_mgr = NULL;
+}
+
+LibVLCHTTPConnectionFactory::~LibVLCHTTPConnectionFactory()
+{
+    if(http_mgr)
+        vlc_http_mgr_destroy(http_mgr);
+}
+
+AbstractConnection * LibVLCHTTPConnectionFactory::createConnection(vlc_object_t *p_object,
+                                                                   const ConnectionParams &params)
+{
+    if((params.getScheme() != "http" && params.getScheme() != "https") || params.getHostname().empty())
+        return NULL;
+
+    if(!http_mgr)
+    {
+        void *jar = NULL;
+        if(var_InheritBool(p_object, "http-forward-cookies"))
+            jar = var_InheritAddress(p_object, "http-cookies");
+
+        http_mgr = vlc_http_mgr_create(p_object, (struct vlc_http_cookie_jar_t *) jar);
+        if(!http_mgr)
+            return NULL;
+    }
+
+    return new (std::nothrow) LibVLCHTTPConnection(p_object, http_mgr);
+}
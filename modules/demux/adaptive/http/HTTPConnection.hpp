@@ -30,6 +30,9 @@
 #include <vlc_common.h>
 #include <string>
 
+struct vlc_http_mgr;
+struct vlc_http_resource;
+
 namespace adaptive
 {
     namespace http
@@ -50,6 +53,7 @@ namespace adaptive
 
                 virtual size_t  getContentLength() const;
                 virtual void    setUsed( bool ) = 0;
+                void            setWeight( unsigned );
 
             protected:
                 vlc_object_t      *p_object;
@@ -58,6 +62,7 @@ namespace adaptive
                 size_t             contentLength;
                 BytesRange         bytesRange;
                 size_t             bytesRead;
+                unsigned           weight; /* HTTP/2 weight of the next request, 0 for default */
         };
 
         class HTTPConnection : public AbstractConnection
@@ -120,6 +125,27 @@ namespace adaptive
                 stream_t *p_streamurl;
        };
 
+       class LibVLCHTTPConnection : public AbstractConnection
+       {
+            public:
+                LibVLCHTTPConnection(vlc_object_t *, struct vlc_http_mgr *);
+                virtual ~LibVLCHTTPConnection();
+
+                virtual bool    canReuse     (const ConnectionParams &) const;
+
+                virtual int     request     (const std::string& path, const BytesRange & = BytesRange());
+                virtual ssize_t read        (void *p_buffer, size_t len);
+
+                virtual void    setUsed( bool );
+
+            protected:
+                void reset();
+                struct vlc_http_mgr *http_mgr;
+                struct vlc_http_resource *resource;
+                block_t *p_pending;
+                char *psz_useragent;
+       };
+
        class ConnectionFactory
        {
            public:
@@ -133,6 +159,19 @@ namespace adaptive
            public:
                virtual AbstractConnection * createConnection(vlc_object_t *, const ConnectionParams &);
        };
+
+       /* Shares one HTTP connection manager (and thus one HTTP/2 connection
+        * per origin) between all the connections it creates */
+       class LibVLCHTTPConnectionFactory : public ConnectionFactory
+       {
+           public:
+               LibVLCHTTPConnectionFactory();
+               virtual ~LibVLCHTTPConnectionFactory();
+               virtual AbstractConnection * createConnection(vlc_object_t *, const ConnectionParams &);
+
+           private:
+               struct vlc_http_mgr *http_mgr;
+       };
     }
 }
 
@@ -61,12 +61,14 @@ HTTPConnectionManager::HTTPConnectionManager    (vlc_object_t *p_object_, Connec
     : AbstractConnectionManager( p_object_ )
 {
     vlc_mutex_init(&lock);
-    downloader = new (std::nothrow) Downloader();
+    downloader = new (std::nothrow) Downloader(var_InheritInteger(p_object, "adaptive-downloads"));
     downloader->start();
     if(!factory_)
     {
         if(var_InheritBool(p_object, "adaptive-use-access"))
             factory = new (std::nothrow) StreamUrlConnectionFactory();
+        else if(var_InheritBool(p_object, "adaptive-use-http2"))
+            factory = new (std::nothrow) LibVLCHTTPConnectionFactory();
         else
             factory = new (std::nothrow) ConnectionFactory();
     }
@@ -76,8 +78,9 @@ HTTPConnectionManager::HTTPConnectionManager    (vlc_object_t *p_object_, Connec
 HTTPConnectionManager::~HTTPConnectionManager   ()
 {
     delete downloader;
-    delete factory;
+    /* connections may depend on their factory */
     this->closeAllConnections();
+    delete factory;
     vlc_mutex_destroy(&lock);
 }
 
@@ -82,16 +82,20 @@ void RateBasedAdaptationLogic::updateDownloadRate(const ID &, size_t size, mtime
 {
     if(unlikely(time == 0))
         return;
+
+    vlc_mutex_lock(&lock);
     /* Accumulate up to observation window */
     dllength += time;
     dlsize += size;
 
     if(dllength < CLOCK_FREQ / 4)
+    {
+        vlc_mutex_unlock(&lock);
         return;
+    }
 
     const size_t bps = CLOCK_FREQ * dlsize * 8 / dllength;
 
-    vlc_mutex_lock(&lock);
     bpsAvg = average.push(bps);
 
 //    BwDebug(msg_Dbg(p_obj, "alpha1 %lf alpha0 %lf dmax %ld ds %ld", alpha,
@@ -35,6 +35,7 @@
 #include <vlc_access.h>    /* DVB-specific things */
 #include <vlc_demux.h>
 #include <vlc_input.h>
+#include <vlc_atomic.h>
 
 #include "ts_pid.h"
 #include "ts_streams.h"
@@ -181,6 +182,9 @@ static bool GatherSectionsData( demux_t *p_demux, ts_pid_t *, block_t *, size_t
 static void ProgramSetPCR( demux_t *p_demux, ts_pmt_t *p_prg, mtime_t i_pcr );
 
 static block_t* ReadTSPacket( demux_t *p_demux );
+static void FlushTSChunk( demux_sys_t *p_sys );
+static uint64_t TSTell( demux_sys_t *p_sys );
+static int TSSeek( demux_sys_t *p_sys, uint64_t i_pos );
 static int SeekToTime( demux_t *p_demux, const ts_pmt_t *, int64_t time );
 static void ReadyQueuesPostSeek( demux_t *p_demux );
 static void PCRHandle( demux_t *p_demux, ts_pid_t *, mtime_t );
@@ -386,6 +390,8 @@ static int Open( vlc_object_t *p_this )
     p_sys->i_packet_size = i_packet_size;
     p_sys->i_packet_header_size = i_packet_header_size;
     p_sys->i_ts_read = 50;
+    p_sys->bulk.p_chunk = NULL;
+    p_sys->bulk.i_next = p_sys->bulk.i_count = 0;
     p_sys->csa = NULL;
     p_sys->b_start_record = false;
 
@@ -541,6 +547,8 @@ static void Close( vlc_object_t *p_this )
 
     PIDRelease( p_demux, GetPID(p_sys, 0) );
 
+    FlushTSChunk( p_sys );
+
     vlc_mutex_lock( &p_sys->csa_lock );
     if( p_sys->csa )
     {
@@ -925,7 +933,7 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
 
         if( (i64 = stream_Size( p_sys->stream) ) > 0 )
         {
-            uint64_t offset = vlc_stream_Tell( p_sys->stream );
+            uint64_t offset = TSTell( p_sys );
             *pf = (double)offset / (double)i64;
             return VLC_SUCCESS;
         }
@@ -972,7 +980,7 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
 
         i64 = stream_Size( p_sys->stream );
         if( i64 > 0 &&
-            vlc_stream_Seek( p_sys->stream, (int64_t)(i64 * f) ) == VLC_SUCCESS )
+            TSSeek( p_sys, (int64_t)(i64 * f) ) == VLC_SUCCESS )
         {
             ReadyQueuesPostSeek( p_demux );
             return VLC_SUCCESS;
@@ -1104,9 +1112,11 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
     }
 
     case DEMUX_SET_TITLE:
+        FlushTSChunk( p_sys );
         return vlc_stream_vaControl( p_sys->stream, STREAM_SET_TITLE, args );
 
     case DEMUX_SET_SEEKPOINT:
+        FlushTSChunk( p_sys );
         return vlc_stream_vaControl( p_sys->stream, STREAM_SET_SEEKPOINT,
                                      args );
 
@@ -1684,12 +1694,183 @@ static bool PushPESBlock( demux_t *p_demux, ts_pid_t *pid, block_t *p_pkt, bool
     return b_ret;
 }
 
+/* Packets are read from the stream by chunks of up to TS_CHUNK_SIZE bytes
+ * (or one demux call worth of packets if the stream is live, so as not to
+ * wait for more data than before), and handed out as blocks pointing into
+ * the shared chunk storage. */
+#define TS_CHUNK_SIZE (256 * 1024)
+
+typedef struct ts_chunk_t
+{
+    block_t    *p_data;
+    atomic_uint i_refs;
+} ts_chunk_t;
+
+typedef struct
+{
+    block_t     self;
+    ts_chunk_t *p_chunk;
+} ts_chunk_packet_t;
+
+static void TSChunkRelease( ts_chunk_t *p_chunk )
+{
+    if( atomic_fetch_sub( &p_chunk->i_refs, 1 ) == 1 )
+    {
+        block_Release( p_chunk->p_data );
+        free( p_chunk );
+    }
+}
+
+static void TSChunkPacketRelease( block_t *p_block )
+{
+    ts_chunk_packet_t *p_pkt = container_of( p_block, ts_chunk_packet_t, self );
+    TSChunkRelease( p_pkt->p_chunk );
+    free( p_pkt );
+}
+
+static void FlushTSChunk( demux_sys_t *p_sys )
+{
+    if( p_sys->bulk.p_chunk )
+        TSChunkRelease( p_sys->bulk.p_chunk );
+    p_sys->bulk.p_chunk = NULL;
+    p_sys->bulk.i_next = p_sys->bulk.i_count = 0;
+}
+
+/* Position of the next packet to be demuxed */
+static uint64_t TSTell( demux_sys_t *p_sys )
+{
+    return vlc_stream_Tell( p_sys->stream ) -
+           (uint64_t)(p_sys->bulk.i_count - p_sys->bulk.i_next) * p_sys->i_packet_size;
+}
+
+static int TSSeek( demux_sys_t *p_sys, uint64_t i_pos )
+{
+    int i_ret = vlc_stream_Seek( p_sys->stream, i_pos );
+    if( i_ret == VLC_SUCCESS )
+        FlushTSChunk( p_sys );
+    return i_ret;
+}
+
+/* Returns how many packets from the start of the buffer are in sync */
+static unsigned CountSyncedPackets( const uint8_t *p, unsigned i_count,
+                                    unsigned i_size )
+{
+    unsigned i = 0;
+
+    /* The sync bytes are too far apart to be loaded together: check them by
+     * groups of four, without branching on each of them */
+    for( ; i + 4 <= i_count; i += 4, p += 4 * i_size )
+        if( (p[0] ^ 0x47) | (p[i_size] ^ 0x47) |
+            (p[2 * i_size] ^ 0x47) | (p[3 * i_size] ^ 0x47) )
+            break;
+
+    for( ; i < i_count && *p == 0x47; i++, p += i_size );
+    return i;
+}
+
+/* Descrambles the packets of a chunk together, as the CSA engine is much
+ * faster on many packets at once */
+static void DescrambleTSChunk( demux_sys_t *p_sys, uint8_t *p, unsigned i_count )
+{
+    uint8_t *pp_pkt[256];
+    int i_pkt = 0;
+
+    vlc_mutex_lock( &p_sys->csa_lock );
+    for( unsigned i = 0; i < i_count; i++, p += p_sys->i_packet_size )
+    {
+        uint8_t *p_pkt = p + p_sys->i_packet_header_size;
+
+        /* Same packets as ProcessTSPacket() would descramble */
+        if( (p_pkt[3]&0x80) == 0 || (p_pkt[1]&0x80) ||
+            ((p_pkt[1]&0x1f) == 0x1f && p_pkt[2] == 0xff) )
+            continue;
+
+        pp_pkt[i_pkt++] = p_pkt;
+        if( i_pkt == ARRAY_SIZE(pp_pkt) )
+        {
+            csa_DecryptBatch( p_sys->csa, pp_pkt, i_pkt, p_sys->i_csa_pkt_size );
+            i_pkt = 0;
+        }
+    }
+    csa_DecryptBatch( p_sys->csa, pp_pkt, i_pkt, p_sys->i_csa_pkt_size );
+    vlc_mutex_unlock( &p_sys->csa_lock );
+}
+
+static bool ReadTSChunk( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const unsigned i_size = p_sys->i_packet_size;
+    const uint8_t *p_peek;
+
+    FlushTSChunk( p_sys );
+
+    const unsigned i_max = p_sys->b_canfastseek ? TS_CHUNK_SIZE / i_size
+                                                : p_sys->i_ts_read;
+    ssize_t i_peek = vlc_stream_Peek( p_sys->stream, &p_peek, i_max * i_size );
+    if( i_peek < 2 * (ssize_t)i_size )
+        return false;
+
+    /* Only take the packets in sync, leaving resync to the slow path */
+    unsigned i_count = CountSyncedPackets( p_peek + p_sys->i_packet_header_size,
+                                           i_peek / i_size, i_size );
+    if( i_count < 2 )
+        return false;
+
+    ts_chunk_t *p_chunk = malloc( sizeof(*p_chunk) );
+    if( unlikely(p_chunk == NULL) )
+        return false;
+
+    p_chunk->p_data = vlc_stream_Block( p_sys->stream, i_count * i_size );
+    if( p_chunk->p_data == NULL ||
+        (i_count = p_chunk->p_data->i_buffer / i_size) == 0 )
+    {
+        if( p_chunk->p_data )
+            block_Release( p_chunk->p_data );
+        free( p_chunk );
+        return false;
+    }
+
+    if( p_sys->csa )
+        DescrambleTSChunk( p_sys, p_chunk->p_data->p_buffer, i_count );
+
+    atomic_init( &p_chunk->i_refs, 1 );
+    p_sys->bulk.p_chunk = p_chunk;
+    p_sys->bulk.i_count = i_count;
+    return true;
+}
+
+static block_t *ReadTSChunkPacket( demux_sys_t *p_sys )
+{
+    ts_chunk_t *p_chunk = p_sys->bulk.p_chunk;
+    ts_chunk_packet_t *p_pkt = malloc( sizeof(*p_pkt) );
+    if( unlikely(p_pkt == NULL) )
+        return NULL;
+
+    block_Init( &p_pkt->self, p_chunk->p_data->p_buffer +
+                              p_sys->bulk.i_next * p_sys->i_packet_size,
+                p_sys->i_packet_size );
+    p_pkt->self.pf_release = TSChunkPacketRelease;
+    /* Skip header (BluRay streams) */
+    p_pkt->self.p_buffer += p_sys->i_packet_header_size;
+    p_pkt->self.i_buffer -= p_sys->i_packet_header_size;
+
+    atomic_fetch_add( &p_chunk->i_refs, 1 );
+    p_pkt->p_chunk = p_chunk;
+
+    if( ++p_sys->bulk.i_next == p_sys->bulk.i_count )
+        FlushTSChunk( p_sys );
+    return &p_pkt->self;
+}
+
 static block_t* ReadTSPacket( demux_t *p_demux )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
 
     block_t     *p_pkt;
 
+    if( p_sys->bulk.p_chunk != NULL || ReadTSChunk( p_demux ) )
+        return ReadTSChunkPacket( p_sys );
+
     /* Get a new TS packet */
     if( !( p_pkt = vlc_stream_Block( p_sys->stream, p_sys->i_packet_size ) ) )
     {
@@ -1866,13 +2047,13 @@ static int SeekToTime( demux_t *p_demux, const ts_pmt_t *p_pmt, int64_t i_scaled
 
     /* Deal with common but worst binary search case */
     if( p_pmt->pcr.i_first == i_scaledtime && p_sys->b_canseek )
-        return vlc_stream_Seek( p_sys->stream, 0 );
+        return TSSeek( p_sys, 0 );
 
     const int64_t i_stream_size = stream_Size( p_sys->stream );
     if( !p_sys->b_canfastseek || i_stream_size < p_sys->i_packet_size )
         return VLC_EGENERIC;
 
-    const uint64_t i_initial_pos = vlc_stream_Tell( p_sys->stream );
+    const uint64_t i_initial_pos = TSTell( p_sys );
 
     /* Find the time position by using binary search algorithm. */
     uint64_t i_head_pos = 0;
@@ -1888,7 +2069,7 @@ static int SeekToTime( demux_t *p_demux, const ts_pmt_t *p_pmt, int64_t i_scaled
         uint64_t i_div = i_splitpos % p_sys->i_packet_size;
         i_splitpos -= i_div;
 
-        if ( vlc_stream_Seek( p_sys->stream, i_splitpos ) != VLC_SUCCESS )
+        if ( TSSeek( p_sys, i_splitpos ) != VLC_SUCCESS )
             break;
 
         uint64_t i_pos = i_splitpos;
@@ -1902,7 +2083,7 @@ static int SeekToTime( demux_t *p_demux, const ts_pmt_t *p_pmt, int64_t i_scaled
                 break;
             }
             else
-                i_pos = vlc_stream_Tell( p_sys->stream );
+                i_pos = TSTell( p_sys );
 
             int i_pid = PIDGet( p_pkt );
             ts_pid_t *p_pid = GetPID(p_sys, i_pid);
@@ -1957,7 +2138,7 @@ static int SeekToTime( demux_t *p_demux, const ts_pmt_t *p_pmt, int64_t i_scaled
     if( !b_found )
     {
         msg_Dbg( p_demux, "Seek():cannot find a time position." );
-        vlc_stream_Seek( p_sys->stream, i_initial_pos );
+        TSSeek( p_sys, i_initial_pos );
         return VLC_EGENERIC;
     }
     return VLC_SUCCESS;
@@ -2040,7 +2221,7 @@ static int ProbeChunk( demux_t *p_demux, int i_program, bool b_end, int64_t *pi_
                         if( b_end )
                         {
                             p_pmt->i_last_dts = *pi_pcr;
-                            p_pmt->i_last_dts_byte = vlc_stream_Tell( p_sys->stream );
+                            p_pmt->i_last_dts_byte = TSTell( p_sys );
                         }
                         /* Start, only keep first */
                         else if( b_pcrresult && p_pmt->pcr.i_first == -1 )
@@ -2068,7 +2249,7 @@ static int ProbeChunk( demux_t *p_demux, int i_program, bool b_end, int64_t *pi_
 int ProbeStart( demux_t *p_demux, int i_program )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
-    const uint64_t i_initial_pos = vlc_stream_Tell( p_sys->stream );
+    const uint64_t i_initial_pos = TSTell( p_sys );
     int64_t i_stream_size = stream_Size( p_sys->stream );
 
     int i_probe_count = 0;
@@ -2081,7 +2262,7 @@ int ProbeStart( demux_t *p_demux, int i_program )
         i_pos = p_sys->i_packet_size * i_probe_count;
         i_pos = __MIN( i_pos, i_stream_size );
 
-        if( vlc_stream_Seek( p_sys->stream, i_pos ) )
+        if( TSSeek( p_sys, i_pos ) )
             return VLC_EGENERIC;
 
         ProbeChunk( p_demux, i_program, false, &i_pcr, &b_found );
@@ -2090,7 +2271,7 @@ int ProbeStart( demux_t *p_demux, int i_program )
         i_probe_count += PROBE_CHUNK_COUNT;
     } while( i_pos > 0 && (i_pcr == -1 || !b_found) && i_probe_count < (2 * PROBE_CHUNK_COUNT) );
 
-    if( vlc_stream_Seek( p_sys->stream, i_initial_pos ) )
+    if( TSSeek( p_sys, i_initial_pos ) )
         return VLC_EGENERIC;
 
     return (b_found) ? VLC_SUCCESS : VLC_EGENERIC;
@@ -2099,7 +2280,7 @@ int ProbeStart( demux_t *p_demux, int i_program )
 int ProbeEnd( demux_t *p_demux, int i_program )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
-    const uint64_t i_initial_pos = vlc_stream_Tell( p_sys->stream );
+    const uint64_t i_initial_pos = TSTell( p_sys );
     int64_t i_stream_size = stream_Size( p_sys->stream );
 
     int i_probe_count = PROBE_CHUNK_COUNT;
@@ -2112,7 +2293,7 @@ int ProbeEnd( demux_t *p_demux, int i_program )
         i_pos = i_stream_size - (p_sys->i_packet_size * i_probe_count);
         i_pos = __MAX( i_pos, 0 );
 
-        if( vlc_stream_Seek( p_sys->stream, i_pos ) )
+        if( TSSeek( p_sys, i_pos ) )
             return VLC_EGENERIC;
 
         ProbeChunk( p_demux, i_program, true, &i_pcr, &b_found );
@@ -2121,7 +2302,7 @@ int ProbeEnd( demux_t *p_demux, int i_program )
         i_probe_count += PROBE_CHUNK_COUNT;
     } while( i_pos > 0 && (i_pcr == -1 || !b_found) && i_probe_count < (6 * PROBE_CHUNK_COUNT) );
 
-    if( vlc_stream_Seek( p_sys->stream, i_initial_pos ) )
+    if( TSSeek( p_sys, i_initial_pos ) )
         return VLC_EGENERIC;
 
     return (b_found) ? VLC_SUCCESS : VLC_EGENERIC;
@@ -2172,10 +2353,10 @@ static void ProgramSetPCR( demux_t *p_demux, ts_pmt_t *p_pmt, mtime_t i_pcr )
         es_out_Control( p_demux->out, ES_OUT_SET_GROUP_PCR, p_pmt->i_number, FROM_SCALE(i_pcr) );
         /* growing files/named fifo handling */
         if( p_sys->b_access_control == false &&
-            vlc_stream_Tell( p_sys->stream ) > p_pmt->i_last_dts_byte )
+            TSTell( p_sys ) > p_pmt->i_last_dts_byte )
         {
             p_pmt->i_last_dts = i_pcr;
-            p_pmt->i_last_dts_byte = vlc_stream_Tell( p_sys->stream );
+            p_pmt->i_last_dts_byte = TSTell( p_sys );
         }
     }
 }
@@ -60,6 +60,14 @@ struct demux_sys_t
     /* how many TS packet we read at once */
     unsigned    i_ts_read;
 
+    /* TS packets read from the stream in a single chunk, not demuxed yet */
+    struct
+    {
+        struct ts_chunk_t *p_chunk;
+        unsigned    i_next;
+        unsigned    i_count;
+    } bulk;
+
     bool        b_ignore_time_for_positions;
 
     ts_standards_e standard;
@@ -322,7 +322,7 @@ vlc_vaapi_OpenChroma(vlc_object_t *obj)
         filter_sys->dest_pics = NULL;
     }
 
-    if (CopyInitCache(&filter_sys->cache, filter->fmt_in.video.i_width))
+    if (CopyInitCacheSlices(&filter_sys->cache, filter->fmt_in.video.i_width, 0))
     {
         if (is_upload)
         {
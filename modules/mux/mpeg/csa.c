@@ -26,7 +26,10 @@
 # include "config.h"
 #endif
 
+#include <assert.h>
+
 #include <vlc_common.h>
+#include <vlc_cpu.h>
 
 #include "csa.h"
 
@@ -131,6 +134,8 @@ int csa_UseKey( vlc_object_t *p_caller, csa_t *c, bool use_odd )
 #ifndef TS_NO_CSA_CK_MSG
         msg_Dbg( p_caller, "using the %s key for scrambling",
                  use_odd ? "odd" : "even" );
+#else
+    VLC_UNUSED(p_caller);
 #endif
     return VLC_SUCCESS;
 }
@@ -610,3 +615,193 @@ static void csa_BlockCypher( uint8_t kk[57], uint8_t bd[8], uint8_t ib[8] )
     }
 }
 
+
+/*****************************************************************************
+ * Batch processing
+ *****************************************************************************/
+typedef struct
+{
+    uint8_t *p_payload;
+    int      i_blocks;  /* complete 8 bytes blocks */
+    int      i_residue;
+    bool     b_odd;
+} csa_lane_t;
+
+/* Same packet handling as csa_Decrypt(), returns false if there is nothing
+ * to descramble */
+static bool csa_LaneDecrypt( csa_lane_t *p_lane, uint8_t *pkt, int i_pkt_size )
+{
+    int i_hdr = 4;
+
+    if( (pkt[3]&0x80) == 0 )
+        return false;
+    p_lane->b_odd = pkt[3]&0x40;
+    pkt[3] &= 0x3f;
+
+    if( pkt[3]&0x20 )
+        i_hdr += pkt[4] + 1;
+    if( 188 - i_hdr < 8 || i_pkt_size - i_hdr <= 0 )
+        return false;
+
+    p_lane->p_payload = &pkt[i_hdr];
+    p_lane->i_blocks  = (i_pkt_size - i_hdr) / 8;
+    p_lane->i_residue = (i_pkt_size - i_hdr) % 8;
+    return true;
+}
+
+/* Same packet handling as csa_Encrypt() */
+static bool csa_LaneEncrypt( csa_lane_t *p_lane, uint8_t *pkt, int i_pkt_size,
+                             bool use_odd )
+{
+    int i_hdr = 4;
+
+    pkt[3] |= use_odd ? 0xc0 : 0x80;
+    if( pkt[3]&0x20 )
+        i_hdr += pkt[4] + 1;
+    if( i_pkt_size - i_hdr < 8 )
+    {
+        pkt[3] &= 0x3f;
+        return false;
+    }
+
+    p_lane->p_payload = &pkt[i_hdr];
+    p_lane->i_blocks  = (i_pkt_size - i_hdr) / 8;
+    p_lane->i_residue = (i_pkt_size - i_hdr) % 8;
+    p_lane->b_odd     = use_odd;
+    return true;
+}
+
+/* Number of stream cypher blocks used after the initialisation */
+static int csa_LaneStreamBlocks( const csa_lane_t *p_lane )
+{
+    if( p_lane->i_residue > 0 )
+        return __MAX( p_lane->i_blocks, 1 );
+    return __MAX( p_lane->i_blocks - 1, 0 );
+}
+
+/* Transposes the 64x64 bits matrix m[], the first column being the most
+ * significant bits */
+static void csa_Transpose64( uint64_t m[64] )
+{
+    uint64_t mask = UINT64_C(0x00000000ffffffff);
+
+    for( unsigned j = 32; j != 0; j >>= 1, mask ^= mask << j )
+        for( unsigned k = 0; k < 64; k = (k + j + 1) & ~j )
+        {
+            const uint64_t t = (m[k] ^ (m[k + j] >> j)) & mask;
+
+            m[k] ^= t;
+            m[k + j] ^= t << j;
+        }
+}
+
+#define bs_word uint64_t
+#define BS_WORDS 1
+#define CSA_BS(name) csa_##name##_C
+#define BS_TARGET
+#include "csa_bitslice.h"
+#undef BS_TARGET
+#undef CSA_BS
+#undef BS_WORDS
+#undef bs_word
+
+#if defined(__GNUC__) && defined(CAN_COMPILE_SSE2)
+typedef uint64_t csa_word_sse2 __attribute__ ((__vector_size__ (16)));
+# define bs_word csa_word_sse2
+# define BS_WORDS 2
+# define CSA_BS(name) csa_##name##_SSE2
+# define BS_TARGET __attribute__ ((__target__ ("sse2")))
+# include "csa_bitslice.h"
+# undef BS_TARGET
+# undef CSA_BS
+# undef BS_WORDS
+# undef bs_word
+#endif
+
+#if defined(__GNUC__) && defined(CAN_COMPILE_AVX2)
+typedef uint64_t csa_word_avx2 __attribute__ ((__vector_size__ (32)));
+# define bs_word csa_word_avx2
+# define BS_WORDS 4
+# define CSA_BS(name) csa_##name##_AVX2
+# define BS_TARGET __attribute__ ((__target__ ("avx2")))
+# include "csa_bitslice.h"
+# undef BS_TARGET
+# undef CSA_BS
+# undef BS_WORDS
+# undef bs_word
+#endif
+
+static const struct
+{
+    unsigned i_cpu;
+    int      i_lanes;
+    void   (*pf_decrypt)( const csa_t *, uint8_t **, int, int );
+    void   (*pf_encrypt)( const csa_t *, uint8_t **, int, int );
+} csa_engines[] =
+{
+    /* widest first */
+#if defined(__GNUC__) && defined(CAN_COMPILE_AVX2)
+    { VLC_CPU_AVX2, 256, csa_Decrypt_AVX2, csa_Encrypt_AVX2 },
+#endif
+#if defined(__GNUC__) && defined(CAN_COMPILE_SSE2)
+    { VLC_CPU_SSE2, 128, csa_Decrypt_SSE2, csa_Encrypt_SSE2 },
+#endif
+    { 0,             64, csa_Decrypt_C,    csa_Encrypt_C },
+};
+
+/* Below that many packets, the byte-serial cypher is faster */
+#define CSA_BATCH_MIN 3
+
+static void csa_Batch( csa_t *c, uint8_t **pp_pkt, int i_pkt, int i_pkt_size,
+                       bool b_encrypt )
+{
+    const unsigned i_cpu = vlc_CPU();
+
+    while( i_pkt >= CSA_BATCH_MIN )
+    {
+        /* the narrowest engine taking all the packets, or the widest one */
+        size_t i_engine = ARRAY_SIZE(csa_engines);
+
+        for( size_t i = 0; i < ARRAY_SIZE(csa_engines); i++ )
+        {
+            if( (csa_engines[i].i_cpu & i_cpu) != csa_engines[i].i_cpu )
+                continue;
+            if( i_engine != ARRAY_SIZE(csa_engines) &&
+                i_pkt > csa_engines[i].i_lanes )
+                break;
+            i_engine = i;
+        }
+
+        const int i_count = __MIN( i_pkt, csa_engines[i_engine].i_lanes );
+        if( b_encrypt )
+            csa_engines[i_engine].pf_encrypt( c, pp_pkt, i_count, i_pkt_size );
+        else
+            csa_engines[i_engine].pf_decrypt( c, pp_pkt, i_count, i_pkt_size );
+        pp_pkt += i_count;
+        i_pkt -= i_count;
+    }
+
+    for( int i = 0; i < i_pkt; i++ )
+    {
+        if( b_encrypt )
+            csa_Encrypt( c, pp_pkt[i], i_pkt_size );
+        else
+            csa_Decrypt( c, pp_pkt[i], i_pkt_size );
+    }
+}
+
+/*****************************************************************************
+ * csa_DecryptBatch:
+ *****************************************************************************/
+void csa_DecryptBatch( csa_t *c, uint8_t **pp_pkt, int i_pkt, int i_pkt_size )
+{
+    csa_Batch( c, pp_pkt, i_pkt, i_pkt_size, false );
+}
+
+/*****************************************************************************
+ * csa_EncryptBatch:
+ *****************************************************************************/
+void csa_EncryptBatch( csa_t *c, uint8_t **pp_pkt, int i_pkt, int i_pkt_size )
+{
+    csa_Batch( c, pp_pkt, i_pkt, i_pkt_size, true );
+}
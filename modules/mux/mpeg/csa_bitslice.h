@@ -0,0 +1,568 @@
+/*****************************************************************************
+ * csa_bitslice.h: bitsliced CSA scrambler/descrambler
+ *****************************************************************************
+ * Copyright (C) 2004-2005 Laurent Aimar
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* This file is included by csa.c once per engine, with:
+ *  - bs_word: the machine word, made of BS_WORDS 64-bits integers,
+ *  - CSA_BS(name): the name of a function for this engine,
+ *  - BS_TARGET: the attributes of the functions of this engine.
+ *
+ * The stream cypher is bitsliced: bit i of a word belongs to packet i, so
+ * that one word operation clocks the registers of BS_LANES packets at once.
+ * The block cypher is byte-sliced instead: byte i of a word belongs to block
+ * i, and only its 8-bits sbox lookup is done one byte at a time.
+ *
+ * Everything here is derived from the byte-serial code and tables of csa.c:
+ * the bitsliced sboxes are looked up from the same tables. */
+
+#define BS_LANES (64 * BS_WORDS)
+#define BS_BYTES (8 * BS_WORDS)
+
+#define BS_SPLAT(x) ((bs_word){ 0 } + (uint64_t)(x))
+
+typedef union
+{
+    bs_word  w;
+    uint64_t q[BS_WORDS];
+    uint8_t  b[BS_BYTES];
+} CSA_BS(slice_t);
+
+/*****************************************************************************
+ * Stream cypher
+ *****************************************************************************/
+typedef struct
+{
+    /* A[i_pos + k - 1] and B[i_pos + k - 1] hold the k-th nibbles, so that
+     * the registers are shifted by moving i_pos down */
+    bs_word A[32 + 10][4];
+    bs_word B[32 + 10][4];
+    bs_word X[4], Y[4], Z[4];
+    bs_word D[4], E[4], F[4];
+    bs_word p, q, r;
+    unsigned i_pos;
+} CSA_BS(stream_t);
+
+/* Looks up one of the 5 to 2 bits sboxes of the stream cypher (sbox1..sbox7
+ * above) for every lane, as a tree of multiplexers on the input bits, i4
+ * being the most significant one. The table is known at compile time, so
+ * the leaves fold into constants or into i0 or its complement. */
+BS_TARGET
+static inline bs_word CSA_BS(Mux)( bs_word sel, bs_word a, bs_word b )
+{
+    return a ^ (sel & (a ^ b)); /* sel ? b : a */
+}
+
+BS_TARGET
+static inline void CSA_BS(Sbox)( const int sbox[0x20],
+                                 bs_word i4, bs_word i3, bs_word i2,
+                                 bs_word i1, bs_word i0,
+                                 bs_word *hi, bs_word *lo )
+{
+    const bs_word sel[4] = { i1, i2, i3, i4 };
+    bs_word h[16], l[16];
+
+    for( int k = 0; k < 16; k++ )
+    {
+        const int a = sbox[2 * k], b = sbox[2 * k + 1];
+
+        h[k] = CSA_BS(Mux)( i0, BS_SPLAT(-(uint64_t)(a >> 1)),
+                                BS_SPLAT(-(uint64_t)(b >> 1)) );
+        l[k] = CSA_BS(Mux)( i0, BS_SPLAT(-(uint64_t)(a & 1)),
+                                BS_SPLAT(-(uint64_t)(b & 1)) );
+    }
+
+    for( int n = 8, j = 0; n > 0; n /= 2, j++ )
+        for( int k = 0; k < n; k++ )
+        {
+            h[k] = CSA_BS(Mux)( sel[j], h[2 * k], h[2 * k + 1] );
+            l[k] = CSA_BS(Mux)( sel[j], l[2 * k], l[2 * k + 1] );
+        }
+
+    *hi = h[0];
+    *lo = l[0];
+}
+
+/* One iteration of the inner loop of csa_StreamCypher(). in_a and in_b are
+ * the nibbles fed into A and B during initialisation, NULL afterwards. */
+BS_TARGET
+static inline void CSA_BS(StreamClock)( CSA_BS(stream_t) *s,
+                                        const bs_word *in_a,
+                                        const bs_word *in_b,
+                                        bs_word *op_hi, bs_word *op_lo )
+{
+    if( s->i_pos == 0 )
+    {
+        memmove( s->A[32], s->A[0], sizeof(s->A[0]) * 10 );
+        memmove( s->B[32], s->B[0], sizeof(s->B[0]) * 10 );
+        s->i_pos = 32;
+    }
+
+    /* A[k] and B[k] are the k-th nibbles, as in csa_StreamCypher() */
+    bs_word (*A)[4] = &s->A[s->i_pos - 1];
+    bs_word (*B)[4] = &s->B[s->i_pos - 1];
+    bs_word s1h, s1l, s2h, s2l, s3h, s3l, s4h, s4l, s5h, s5l, s6h, s6l,
+            s7h, s7l;
+
+    CSA_BS(Sbox)( sbox1, A[4][0], A[1][2], A[6][1], A[7][3], A[9][0], &s1h, &s1l );
+    CSA_BS(Sbox)( sbox2, A[2][1], A[3][2], A[6][3], A[7][0], A[9][1], &s2h, &s2l );
+    CSA_BS(Sbox)( sbox3, A[1][3], A[2][0], A[5][1], A[5][3], A[6][2], &s3h, &s3l );
+    CSA_BS(Sbox)( sbox4, A[3][3], A[1][1], A[2][3], A[4][2], A[8][0], &s4h, &s4l );
+    CSA_BS(Sbox)( sbox5, A[5][2], A[4][3], A[6][0], A[8][1], A[9][2], &s5h, &s5l );
+    CSA_BS(Sbox)( sbox6, A[3][1], A[4][1], A[5][0], A[7][2], A[9][3], &s6h, &s6l );
+    CSA_BS(Sbox)( sbox7, A[2][2], A[3][0], A[7][1], A[8][2], A[8][3], &s7h, &s7l );
+
+    /* 4x4 xor to produce extra nibble for T3 */
+    const bs_word extra_B[4] = {
+        B[9][2] ^ B[6][3] ^ B[3][1] ^ B[8][0],
+        B[5][3] ^ B[8][2] ^ B[4][0] ^ B[5][1],
+        B[6][0] ^ B[8][1] ^ B[3][3] ^ B[4][2],
+        B[3][0] ^ B[6][1] ^ B[7][2] ^ B[9][3],
+    };
+
+    bs_word next_A1[4], next_B1[4];
+    for( int i = 0; i < 4; i++ )
+    {
+        /* T1 and T2 */
+        next_A1[i] = A[10][i] ^ s->X[i];
+        next_B1[i] = B[7][i] ^ B[10][i] ^ s->Y[i];
+        if( in_a != NULL )
+        {
+            next_A1[i] ^= s->D[i] ^ in_a[i];
+            next_B1[i] ^= in_b[i];
+        }
+    }
+
+    /* T4: F = q ? Z + E + r : E, and E = F */
+    bs_word carry = s->r;
+    for( int i = 0; i < 4; i++ )
+    {
+        const bs_word sum = s->Z[i] ^ s->E[i];
+        const bs_word next_E = s->F[i];
+
+        s->F[i] = s->E[i] ^ (s->q & (sum ^ carry ^ s->E[i]));
+        carry = (s->Z[i] & s->E[i]) | (carry & sum);
+
+        /* T3 */
+        s->D[i] = s->E[i] ^ s->Z[i] ^ extra_B[i];
+        s->E[i] = next_E;
+    }
+    s->r ^= s->q & (carry ^ s->r);
+
+    s->i_pos--;
+    for( int i = 0; i < 4; i++ )
+    {
+        /* if p=1, rotate next_B1 left */
+        s->A[s->i_pos][i] = next_A1[i];
+        s->B[s->i_pos][i] = next_B1[i] ^ (s->p & (next_B1[i] ^ next_B1[(i + 3) & 3]));
+    }
+
+    s->X[0] = s1h; s->X[1] = s2h; s->X[2] = s3l; s->X[3] = s4l;
+    s->Y[0] = s3h; s->Y[1] = s4h; s->Y[2] = s5l; s->Y[3] = s6l;
+    s->Z[0] = s5h; s->Z[1] = s6h; s->Z[2] = s1l; s->Z[3] = s2l;
+    s->p = s7h;
+    s->q = s7l;
+
+    *op_hi = s->D[2] ^ s->D[3];
+    *op_lo = s->D[0] ^ s->D[1];
+}
+
+/* Bitsliced words are indexed by bit, most significant first: word 8*i+j is
+ * bit 7-j of the i-th byte of the 8 bytes key/block of each packet. */
+BS_TARGET
+static void CSA_BS(StreamInit)( CSA_BS(stream_t) *s,
+                                const CSA_BS(slice_t) ck[64],
+                                const CSA_BS(slice_t) sb[64] )
+{
+    memset( s, 0, sizeof(*s) );
+    s->i_pos = 32;
+
+    /* load first 32 bits of CK into A[1]..A[8]
+     * load last  32 bits of CK into B[1]..B[8] */
+    for( int i = 0; i < 4; i++ )
+        for( int j = 0; j < 4; j++ )
+        {
+            s->A[s->i_pos + 2*i + 0][j] = ck[8*i + 3 - j].w;
+            s->A[s->i_pos + 2*i + 1][j] = ck[8*i + 7 - j].w;
+            s->B[s->i_pos + 2*i + 0][j] = ck[8*(4+i) + 3 - j].w;
+            s->B[s->i_pos + 2*i + 1][j] = ck[8*(4+i) + 7 - j].w;
+        }
+
+    for( int i = 0; i < 8; i++ )
+    {
+        bs_word in1[4], in2[4], op_hi, op_lo;
+
+        for( int j = 0; j < 4; j++ )
+        {
+            in1[j] = sb[8*i + 3 - j].w;
+            in2[j] = sb[8*i + 7 - j].w;
+        }
+        CSA_BS(StreamClock)( s, in1, in2, &op_hi, &op_lo );
+        CSA_BS(StreamClock)( s, in2, in1, &op_hi, &op_lo );
+        CSA_BS(StreamClock)( s, in1, in2, &op_hi, &op_lo );
+        CSA_BS(StreamClock)( s, in2, in1, &op_hi, &op_lo );
+    }
+}
+
+BS_TARGET
+static void CSA_BS(StreamBlock)( CSA_BS(stream_t) *s, CSA_BS(slice_t) cb[64] )
+{
+    for( int i = 0; i < 64; i += 2 )
+        CSA_BS(StreamClock)( s, NULL, NULL, &cb[i].w, &cb[i + 1].w );
+}
+
+/* Converts between the first 8 bytes at pp_data[] of each of the i_count
+ * lanes and bitsliced words */
+BS_TARGET
+static void CSA_BS(SliceLoad)( CSA_BS(slice_t) sl[64],
+                               const uint8_t **pp_data, int i_count )
+{
+    for( int i = 0; i < BS_WORDS; i++ )
+    {
+        uint64_t m[64] = { 0 };
+
+        for( int j = 0; j < 64 && 64 * i + j < i_count; j++ )
+            m[j] = GetQWBE( pp_data[64 * i + j] );
+        csa_Transpose64( m );
+        for( int j = 0; j < 64; j++ )
+            sl[j].q[i] = m[j];
+    }
+}
+
+BS_TARGET
+static void CSA_BS(SliceStore)( const CSA_BS(slice_t) sl[64],
+                                uint8_t (*p_data)[8], int i_count )
+{
+    for( int i = 0; 64 * i < i_count; i++ )
+    {
+        uint64_t m[64];
+
+        for( int j = 0; j < 64; j++ )
+            m[j] = sl[j].q[i];
+        csa_Transpose64( m );
+        for( int j = 0; j < 64 && 64 * i + j < i_count; j++ )
+            SetQWBE( p_data[64 * i + j], m[j] );
+    }
+}
+
+/* Runs the stream cypher of up to BS_LANES packets, and xors its output
+ * into their payload from the second block on */
+BS_TARGET
+static void CSA_BS(StreamXor)( const csa_t *c, const csa_lane_t *p_lanes,
+                               int i_lanes )
+{
+    const uint8_t *pp_data[BS_LANES];
+    CSA_BS(slice_t) ck[64], sb[64];
+    CSA_BS(stream_t) s;
+    uint8_t stream[BS_LANES][8];
+    int i_blocks = 0;
+
+    for( int i = 0; i < i_lanes; i++ )
+    {
+        pp_data[i] = p_lanes[i].b_odd ? c->o_ck : c->e_ck;
+        i_blocks = __MAX( i_blocks, csa_LaneStreamBlocks( &p_lanes[i] ) );
+    }
+    CSA_BS(SliceLoad)( ck, pp_data, i_lanes );
+    for( int i = 0; i < i_lanes; i++ )
+        pp_data[i] = p_lanes[i].p_payload;
+    CSA_BS(SliceLoad)( sb, pp_data, i_lanes );
+
+    CSA_BS(StreamInit)( &s, ck, sb );
+
+    for( int i = 1; i <= i_blocks; i++ )
+    {
+        CSA_BS(StreamBlock)( &s, sb );
+        CSA_BS(SliceStore)( sb, stream, i_lanes );
+
+        for( int j = 0; j < i_lanes; j++ )
+        {
+            const csa_lane_t *p_lane = &p_lanes[j];
+            uint8_t *p = &p_lane->p_payload[8 * i];
+            int i_size = 8;
+
+            if( i >= p_lane->i_blocks )
+            {
+                /* last stream block goes to the residue */
+                if( i != csa_LaneStreamBlocks( p_lane ) )
+                    continue;
+                p = &p_lane->p_payload[8 * p_lane->i_blocks];
+                i_size = p_lane->i_residue;
+            }
+            for( int k = 0; k < i_size; k++ )
+                p[k] ^= stream[j][k];
+        }
+    }
+}
+
+/*****************************************************************************
+ * Block cypher
+ *****************************************************************************/
+/* block_perm[] */
+BS_TARGET
+static inline bs_word CSA_BS(BlockPerm)( bs_word x )
+{
+    return ((x << 1) & BS_SPLAT(0x5252525252525252)) |
+           ((x << 3) & BS_SPLAT(0x2020202020202020)) |
+           ((x << 6) & BS_SPLAT(0x8080808080808080)) |
+           ((x >> 2) & BS_SPLAT(0x0404040404040404)) |
+           ((x >> 4) & BS_SPLAT(0x0808080808080808)) |
+           ((x >> 6) & BS_SPLAT(0x0101010101010101));
+}
+
+/* block_sbox[kk ^ x] */
+BS_TARGET
+static inline bs_word CSA_BS(BlockSbox)( bs_word kk, bs_word x )
+{
+    CSA_BS(slice_t) u = { .w = kk ^ x };
+
+    for( int i = 0; i < BS_BYTES; i++ )
+        u.b[i] = block_sbox[u.b[i]];
+    return u.w;
+}
+
+/* Byte-sliced round keys of BS_BYTES blocks, given which of them use the
+ * odd key */
+BS_TARGET
+static void CSA_BS(BlockKeys)( const csa_t *c, bs_word odd,
+                               bs_word kk[57] )
+{
+    for( int i = 1; i <= 56; i++ )
+    {
+        const uint64_t e = c->e_kk[i] * UINT64_C(0x0101010101010101);
+        const uint64_t o = c->o_kk[i] * UINT64_C(0x0101010101010101);
+
+        kk[i] = BS_SPLAT(e) ^ (odd & BS_SPLAT(e ^ o));
+    }
+}
+
+BS_TARGET
+static void CSA_BS(BlockDecypher)( const bs_word kk[57], bs_word R[8] )
+{
+    bs_word R1 = R[0], R2 = R[1], R3 = R[2], R4 = R[3],
+            R5 = R[4], R6 = R[5], R7 = R[6], R8 = R[7];
+
+    /* loop over kk[56]..kk[1] */
+    for( int i = 56; i > 0; i-- )
+    {
+        const bs_word sbox_out = CSA_BS(BlockSbox)( kk[i], R7 );
+        const bs_word perm_out = CSA_BS(BlockPerm)( sbox_out );
+        const bs_word next_R8 = R7;
+
+        R7 = R6 ^ perm_out;
+        R6 = R5;
+        R5 = R4 ^ R8 ^ sbox_out;
+        R4 = R3 ^ R8 ^ sbox_out;
+        R3 = R2 ^ R8 ^ sbox_out;
+        R2 = R1;
+        R1 = R8 ^ sbox_out;
+        R8 = next_R8;
+    }
+
+    R[0] = R1; R[1] = R2; R[2] = R3; R[3] = R4;
+    R[4] = R5; R[5] = R6; R[6] = R7; R[7] = R8;
+}
+
+BS_TARGET
+static void CSA_BS(BlockCypher)( const bs_word kk[57], bs_word R[8] )
+{
+    bs_word R1 = R[0], R2 = R[1], R3 = R[2], R4 = R[3],
+            R5 = R[4], R6 = R[5], R7 = R[6], R8 = R[7];
+
+    /* loop over kk[1]..kk[56] */
+    for( int i = 1; i <= 56; i++ )
+    {
+        const bs_word sbox_out = CSA_BS(BlockSbox)( kk[i], R8 );
+        const bs_word perm_out = CSA_BS(BlockPerm)( sbox_out );
+        const bs_word next_R1 = R2;
+
+        R2 = R3 ^ R1;
+        R3 = R4 ^ R1;
+        R4 = R5 ^ R1;
+        R5 = R6;
+        R6 = R7 ^ perm_out;
+        R7 = R8;
+        R8 = R1 ^ sbox_out;
+        R1 = next_R1;
+    }
+
+    R[0] = R1; R[1] = R2; R[2] = R3; R[3] = R4;
+    R[4] = R5; R[5] = R6; R[6] = R7; R[7] = R8;
+}
+
+/* Loads and stores the i_count blocks at pp_block[] as byte-sliced words */
+BS_TARGET
+static void CSA_BS(BlockLoad)( bs_word R[8], uint8_t **pp_block,
+                               int i_count )
+{
+    for( int i = 0; i < 8; i++ )
+    {
+        CSA_BS(slice_t) u = { .w = BS_SPLAT(0) };
+
+        for( int j = 0; j < i_count; j++ )
+            u.b[j] = pp_block[j][i];
+        R[i] = u.w;
+    }
+}
+
+BS_TARGET
+static void CSA_BS(BlockStore)( const bs_word R[8], uint8_t **pp_block,
+                                int i_count )
+{
+    CSA_BS(slice_t) u[8];
+
+    for( int i = 0; i < 8; i++ )
+        u[i].w = R[i];
+    for( int j = 0; j < i_count; j++ )
+        for( int i = 0; i < 8; i++ )
+            pp_block[j][i] = u[i].b[j];
+}
+
+/*****************************************************************************
+ * Packets
+ *****************************************************************************/
+/* Decyphers the blocks at pp_block[], and xors them with the following
+ * ones (or zeros when pp_next[i] is NULL) */
+BS_TARGET
+static void CSA_BS(DecryptBlocks)( const csa_t *c, uint8_t **pp_block,
+                                   uint8_t **pp_next, bs_word odd,
+                                   int i_count )
+{
+    bs_word kk[57], R[8];
+    uint8_t bd[BS_BYTES][8];
+    uint8_t *pp_bd[BS_BYTES];
+
+    CSA_BS(BlockKeys)( c, odd, kk );
+    CSA_BS(BlockLoad)( R, pp_block, i_count );
+    CSA_BS(BlockDecypher)( kk, R );
+
+    for( int i = 0; i < i_count; i++ )
+        pp_bd[i] = bd[i];
+    CSA_BS(BlockStore)( R, pp_bd, i_count );
+
+    /* in order, so that the next block is still unchanged when read */
+    for( int i = 0; i < i_count; i++ )
+        for( int j = 0; j < 8; j++ )
+            pp_block[i][j] = bd[i][j] ^ (pp_next[i] ? pp_next[i][j] : 0);
+}
+
+BS_TARGET
+static void CSA_BS(Decrypt)( const csa_t *c, uint8_t **pp_pkt, int i_pkt,
+                             int i_pkt_size )
+{
+    csa_lane_t lanes[BS_LANES];
+    int i_lanes = 0;
+
+    assert( i_pkt <= BS_LANES );
+    for( int i = 0; i < i_pkt; i++ )
+        if( csa_LaneDecrypt( &lanes[i_lanes], pp_pkt[i], i_pkt_size ) )
+            i_lanes++;
+    if( i_lanes == 0 )
+        return;
+
+    /* The stream only depends on the first block: xor it first, so that
+     * every block only needs its ib[] and the next one, and decypher the
+     * blocks of all the packets together */
+    CSA_BS(StreamXor)( c, lanes, i_lanes );
+
+    uint8_t *pp_block[BS_BYTES], *pp_next[BS_BYTES];
+    CSA_BS(slice_t) odd;
+    int i_count = 0;
+
+    for( int i = 0; i < i_lanes; i++ )
+    {
+        const csa_lane_t *p_lane = &lanes[i];
+
+        for( int j = 0; j < p_lane->i_blocks; j++ )
+        {
+            if( i_count == BS_BYTES )
+            {
+                CSA_BS(DecryptBlocks)( c, pp_block, pp_next, odd.w, i_count );
+                i_count = 0;
+            }
+            pp_block[i_count] = &p_lane->p_payload[8 * j];
+            pp_next[i_count] = j + 1 < p_lane->i_blocks ?
+                               &p_lane->p_payload[8 * (j + 1)] : NULL;
+            odd.b[i_count] = p_lane->b_odd ? 0xff : 0x00;
+            i_count++;
+        }
+    }
+    if( i_count > 0 )
+        CSA_BS(DecryptBlocks)( c, pp_block, pp_next, odd.w, i_count );
+}
+
+BS_TARGET
+static void CSA_BS(Encrypt)( const csa_t *c, uint8_t **pp_pkt, int i_pkt,
+                             int i_pkt_size )
+{
+    csa_lane_t lanes[BS_LANES];
+    int i_lanes = 0;
+
+    assert( i_pkt <= BS_LANES );
+    for( int i = 0; i < i_pkt; i++ )
+        if( csa_LaneEncrypt( &lanes[i_lanes], pp_pkt[i], i_pkt_size,
+                             c->use_odd ) )
+            i_lanes++;
+    if( i_lanes == 0 )
+        return;
+
+    /* The blocks of a packet are chained from the last one: cypher the
+     * chains of BS_BYTES packets in parallel */
+    bs_word kk[57];
+    CSA_BS(BlockKeys)( c, c->use_odd ? BS_SPLAT(UINT64_MAX) : BS_SPLAT(0),
+                       kk );
+
+    for( int i = 0; i < i_lanes; i += BS_BYTES )
+    {
+        const int i_count = __MIN( i_lanes - i, BS_BYTES );
+        const csa_lane_t *p_lanes = &lanes[i];
+        uint8_t *pp_block[BS_BYTES];
+        uint8_t dummy[8] = { 0 }; /* for the packets with fewer blocks */
+        bs_word R[8] = { BS_SPLAT(0) };
+        int i_blocks = 0;
+
+        for( int j = 0; j < i_count; j++ )
+            i_blocks = __MAX( i_blocks, p_lanes[j].i_blocks );
+
+        /* ib[n+1] = 0, ib[i] = BlockCypher( block[i-1] ^ ib[i+1] ),
+         * and ib[i] replaces block[i-1] */
+        for( int j = 0; j < i_blocks; j++ )
+        {
+            bs_word block[8];
+
+            for( int k = 0; k < i_count; k++ )
+            {
+                const int i_block = p_lanes[k].i_blocks - 1 - j;
+                pp_block[k] = i_block >= 0 ?
+                              &p_lanes[k].p_payload[8 * i_block] : dummy;
+            }
+            CSA_BS(BlockLoad)( block, pp_block, i_count );
+            for( int k = 0; k < 8; k++ )
+                R[k] ^= block[k];
+
+            CSA_BS(BlockCypher)( kk, R );
+            CSA_BS(BlockStore)( R, pp_block, i_count );
+        }
+    }
+
+    /* the stream is initialised with ib[1] */
+    CSA_BS(StreamXor)( c, lanes, i_lanes );
+}
+
+#undef BS_SPLAT
+#undef BS_BYTES
+#undef BS_LANES
@@ -0,0 +1,269 @@
+/*****************************************************************************
+ * csa_test.c: CSA scrambler/descrambler tests
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#define TS_NO_CSA_CK_MSG
+#include "csa.c"
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define PACKETS 600
+
+/* Output of csa_Encrypt() for the packets built below, with the control
+ * words set in main(), recorded before the batch engines were added.
+ * This is a regression check of the byte-serial code, not a check
+ * against an independent DVB-CSA implementation. */
+static const uint8_t kat_full[184] = {
+    0xbd, 0xa5, 0x06, 0x4c, 0x2a, 0x83, 0x74, 0x03,
+    0x15, 0xe1, 0x05, 0xc3, 0x03, 0xaa, 0x29, 0x94,
+    0x38, 0x2d, 0xe8, 0xe8, 0xcb, 0xe8, 0xfd, 0x52,
+    0x08, 0x9b, 0x08, 0x44, 0xb4, 0xe1, 0xe2, 0x94,
+    0xc4, 0x9a, 0xea, 0x34, 0xff, 0x7c, 0xa9, 0x3c,
+    0xac, 0xfe, 0x92, 0x30, 0xec, 0x60, 0x9a, 0x15,
+    0x4b, 0x53, 0x74, 0xb8, 0x8b, 0x90, 0xb2, 0xbb,
+    0x53, 0x7d, 0x59, 0xdb, 0x89, 0xfa, 0x08, 0xac,
+    0xbc, 0x4e, 0xad, 0x2c, 0x86, 0xc7, 0x07, 0xaf,
+    0xae, 0x56, 0x9d, 0x3a, 0xec, 0x3c, 0xd4, 0x47,
+    0xf9, 0xb7, 0x65, 0xda, 0x14, 0xcb, 0xc4, 0xb4,
+    0xc3, 0x88, 0xf3, 0x55, 0xee, 0x42, 0x3c, 0xdf,
+    0x8c, 0x8c, 0x96, 0xdc, 0x8f, 0x7b, 0x12, 0x3e,
+    0xb5, 0xc0, 0xe1, 0x49, 0xd5, 0x38, 0x32, 0x2b,
+    0x5f, 0xe7, 0x49, 0x6c, 0x21, 0x4a, 0xfb, 0x48,
+    0xc1, 0xca, 0x73, 0x4c, 0x9e, 0x3e, 0x2f, 0xb9,
+    0x7c, 0xb9, 0x63, 0xb5, 0x2e, 0xa0, 0x4f, 0x38,
+    0x9a, 0xa1, 0xb9, 0xc9, 0xba, 0x08, 0x02, 0x69,
+    0x6d, 0x00, 0xbc, 0xaa, 0xd2, 0x94, 0x47, 0x14,
+    0x74, 0xd4, 0x47, 0xbc, 0x13, 0x97, 0xea, 0x1d,
+    0x6d, 0x92, 0x8d, 0xcd, 0xaa, 0x6c, 0xa2, 0xbb,
+    0xba, 0x80, 0xfd, 0xe0, 0x00, 0x4b, 0x90, 0xf4,
+    0xba, 0x58, 0x4c, 0x0a, 0x52, 0x84, 0xeb, 0xbb,
+};
+
+static const uint8_t kat_short[23] = {
+    0x3d, 0xd2, 0xbb, 0xb8, 0x96, 0xde, 0x06, 0x1b,
+    0x4a, 0x6a, 0x57, 0xf0, 0x5c, 0xf2, 0x04, 0x89,
+    0xf4, 0x93, 0xd3, 0x02, 0x23, 0x64, 0xb5,
+};
+
+/* Full payload with the even key */
+static void kat_full_packet(uint8_t *pkt)
+{
+    pkt[0] = 0x47; pkt[1] = 0x01; pkt[2] = 0x00; pkt[3] = 0x10;
+    for (int i = 4; i < 188; i++)
+        pkt[i] = i;
+}
+
+/* 23 bytes payload after an adaptation field, with the odd key */
+static void kat_short_packet(uint8_t *pkt)
+{
+    pkt[0] = 0x47; pkt[1] = 0x01; pkt[2] = 0x00; pkt[3] = 0x31;
+    pkt[4] = 160; pkt[5] = 0x00;
+    memset(pkt + 6, 0xff, 159);
+    for (int i = 165; i < 188; i++)
+        pkt[i] = i * 7;
+}
+
+static void random_packet(uint8_t *pkt)
+{
+    pkt[0] = 0x47;
+    pkt[1] = rand();
+    pkt[2] = rand();
+    pkt[3] = 0x10 | (rand() & 0xcf);
+    for (int i = 4; i < 188; i++)
+        pkt[i] = rand();
+    if (pkt[3] & 0x20)
+        pkt[4] = rand() % 184; /* adaptation field length */
+}
+
+typedef void (*batch_cb)(csa_t *, uint8_t **, int, int);
+
+static void test_kat(csa_t *c, batch_cb encrypt, batch_cb decrypt)
+{
+    uint8_t pkts[8][188], ref[8][188];
+    uint8_t *pp[8];
+
+    for (int i = 0; i < 8; i++)
+    {
+        if (i & 1)
+            kat_short_packet(pkts[i]);
+        else
+            kat_full_packet(pkts[i]);
+        pp[i] = pkts[i];
+    }
+    memcpy(ref, pkts, sizeof (pkts));
+
+    /* the key is per batch when scrambling */
+    for (int i = 0; i < 2; i++)
+    {
+        uint8_t *pp_half[4] = { pp[i], pp[i + 2], pp[i + 4], pp[i + 6] };
+
+        csa_UseKey(NULL, c, i);
+        encrypt(c, pp_half, 4, 188);
+    }
+
+    for (int i = 0; i < 8; i++)
+    {
+        assert(!memcmp(pkts[i], ref[i], 3));
+        if (i & 1)
+        {
+            assert(pkts[i][3] == 0xf1);
+            assert(!memcmp(pkts[i] + 4, ref[i] + 4, 161));
+            assert(!memcmp(pkts[i] + 165, kat_short, sizeof (kat_short)));
+        }
+        else
+        {
+            assert(pkts[i][3] == 0x90);
+            assert(!memcmp(pkts[i] + 4, kat_full, sizeof (kat_full)));
+        }
+    }
+
+    /* and per packet when descrambling */
+    decrypt(c, pp, 8, 188);
+    assert(!memcmp(pkts, ref, sizeof (pkts)));
+}
+
+static void test_batch(csa_t *c, batch_cb encrypt, batch_cb decrypt,
+                       int count, int size)
+{
+    uint8_t (*pkts)[188] = malloc(2 * count * 188);
+    uint8_t (*ref)[188] = pkts + count;
+    uint8_t **pp = malloc(count * sizeof (*pp));
+    assert(pkts != NULL && pp != NULL);
+
+    for (int i = 0; i < count; i++)
+    {
+        random_packet(pkts[i]);
+        pp[i] = pkts[i];
+    }
+    memcpy(ref, pkts, count * 188);
+
+    csa_UseKey(NULL, c, count & 1);
+    encrypt(c, pp, count, size);
+    for (int i = 0; i < count; i++)
+        csa_Encrypt(c, ref[i], size);
+    assert(!memcmp(pkts, ref, count * 188));
+
+    /* mix both keys, and some clear packets */
+    for (int i = 0; i < count; i++)
+    {
+        random_packet(pkts[i]);
+        if (pkts[i][3] & 0x80)
+        {
+            csa_UseKey(NULL, c, pkts[i][3] & 0x40);
+            csa_Encrypt(c, pkts[i], size);
+        }
+    }
+    memcpy(ref, pkts, count * 188);
+
+    decrypt(c, pp, count, size);
+    for (int i = 0; i < count; i++)
+        csa_Decrypt(c, ref[i], size);
+    assert(!memcmp(pkts, ref, count * 188));
+
+    free(pp);
+    free(pkts);
+}
+
+static void bench(csa_t *c, const char *name, batch_cb encrypt,
+                  batch_cb decrypt)
+{
+    static uint8_t pkts[PACKETS][188];
+    uint8_t *pp[PACKETS];
+
+    for (int i = 0; i < PACKETS; i++)
+    {
+        kat_full_packet(pkts[i]);
+        pp[i] = pkts[i];
+    }
+
+    mtime_t ts = mdate();
+    encrypt(c, pp, PACKETS, 188);
+    decrypt(c, pp, PACKETS, 188);
+    ts = mdate() - ts;
+
+    printf("%s: %"PRId64" packets/s\n", name,
+           (int64_t)2 * PACKETS * CLOCK_FREQ / __MAX(ts, 1));
+}
+
+static void serial_encrypt(csa_t *c, uint8_t **pp, int count, int size)
+{
+    for (int i = 0; i < count; i++)
+        csa_Encrypt(c, pp[i], size);
+}
+
+static void serial_decrypt(csa_t *c, uint8_t **pp, int count, int size)
+{
+    for (int i = 0; i < count; i++)
+        csa_Decrypt(c, pp[i], size);
+}
+
+static unsigned engine;
+
+#define ENGINE_CB(name, op) \
+static void name(csa_t *c, uint8_t **pp, int count, int size) \
+{ \
+    for (int i = 0; i < count; i += csa_engines[engine].i_lanes) \
+        csa_engines[engine].op(c, pp + i, \
+                               __MIN(count - i, csa_engines[engine].i_lanes), \
+                               size); \
+}
+ENGINE_CB(engine_encrypt, pf_encrypt)
+ENGINE_CB(engine_decrypt, pf_decrypt)
+
+int main(void)
+{
+    csa_t *c = csa_New();
+    assert(c != NULL);
+
+    assert(csa_SetCW(NULL, c, (char *)"0x0123456789abcdef", true) == 0);
+    assert(csa_SetCW(NULL, c, (char *)"fedcba9876543210", false) == 0);
+
+    srand(0);
+    test_kat(c, serial_encrypt, serial_decrypt);
+    test_kat(c, csa_EncryptBatch, csa_DecryptBatch);
+    bench(c, "serial", serial_encrypt, serial_decrypt);
+
+    for (engine = 0; engine < ARRAY_SIZE(csa_engines); engine++)
+    {
+        const unsigned cpu = csa_engines[engine].i_cpu;
+        char name[16];
+
+        if ((vlc_CPU() & cpu) != cpu)
+            continue;
+
+        test_kat(c, engine_encrypt, engine_decrypt);
+        for (int size = 184; size <= 188; size++)
+            test_batch(c, engine_encrypt, engine_decrypt,
+                       csa_engines[engine].i_lanes + 3, size);
+        test_batch(c, engine_encrypt, engine_decrypt, 12, 12);
+
+        snprintf(name, sizeof (name), "%d lanes",
+                 csa_engines[engine].i_lanes);
+        bench(c, name, engine_encrypt, engine_decrypt);
+    }
+
+    for (int count = 0; count < 300; count += 7)
+        test_batch(c, csa_EncryptBatch, csa_DecryptBatch, count, 188);
+
+    csa_Delete(c);
+    return 0;
+}
@@ -323,6 +323,14 @@ static inline void BufferChainClean( sout_buffer_chain_t *c )
     BufferChainInit( c );
 }
 
+typedef struct
+{
+    uint8_t *p_buffer;  /* 188 bytes inside an output block */
+    mtime_t  i_dts;     /* PES date, then sending date */
+    mtime_t  i_length;
+    uint32_t i_flags;
+} ts_packet_t;
+
 typedef struct
 {
     sout_buffer_chain_t chain_pes;
@@ -381,6 +389,13 @@ struct sout_mux_sys_t
 
     mtime_t         i_pcr;  /* last PCR emited */
 
+    /* packets being muxed, written back to back in the output blocks */
+    ts_packet_t     *p_packets;
+    int             i_packets;
+    int             i_packets_max;
+    sout_buffer_chain_t chain_out;
+    size_t          i_block_size; /* as many packets as fit in the MTU */
+
     csa_t           *csa;
     int             i_csa_pkt_size;
     bool            b_crypt_audio;
@@ -473,15 +488,19 @@ static int Mux      ( sout_mux_t * );
 
 static block_t *FixPES( sout_mux_t *p_mux, block_fifo_t *p_fifo );
 static block_t *Add_ADTS( block_t *, const es_format_t * );
-static void TSSchedule  ( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
+static void TSSchedule  ( sout_mux_t *p_mux, int i_first, int i_count,
                           mtime_t i_pcr_length, mtime_t i_pcr_dts );
-static void TSDate      ( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
+static void TSDate      ( sout_mux_t *p_mux, int i_first, int i_count,
                           mtime_t i_pcr_length, mtime_t i_pcr_dts );
+static void TSSend      ( sout_mux_t *p_mux );
 static void GetPAT( sout_mux_t *p_mux, sout_buffer_chain_t *c );
 static void GetPMT( sout_mux_t *p_mux, sout_buffer_chain_t *c );
 
-static block_t *TSNew( sout_mux_t *p_mux, sout_input_sys_t *p_stream, bool b_pcr );
-static void TSSetPCR( block_t *p_ts, mtime_t i_dts );
+static ts_packet_t *TSAppend( sout_mux_t *p_mux, uint32_t i_flags );
+static void TSAppendPSI( sout_mux_t *p_mux, uint32_t i_flags );
+static void TSNew( sout_mux_t *p_mux, sout_input_sys_t *p_stream,
+                   uint8_t *p_ts, bool b_pcr );
+static void TSSetPCR( uint8_t *p_ts, mtime_t i_dts );
 
 static csa_t *csaSetup( vlc_object_t *p_this )
 {
@@ -549,6 +568,8 @@ static int Open( vlc_object_t *p_this )
     if( !p_sys )
         return VLC_ENOMEM;
     p_sys->i_num_pmt = 1;
+    BufferChainInit( &p_sys->chain_out );
+    p_sys->i_block_size = 188 * __MAX( var_InheritInteger( p_mux, "mtu" ) / 188, 1 );
 
     p_sys->p_dvbpsi = dvbpsi_new( &dvbpsi_messages, DVBPSI_MSG_DEBUG );
     if( !p_sys->p_dvbpsi )
@@ -773,6 +794,7 @@ static void Close( vlc_object_t * p_this )
         free( p_sys->sdt.desc[i].psz_provider );
     }
 
+    free( p_sys->p_packets );
     free( p_sys );
 }
 
@@ -1037,18 +1059,6 @@ static void DelStream( sout_mux_t *p_mux, sout_input_t *p_input )
     p_sys->i_pmt_version_number %= 32;
 }
 
-static void SetHeader( sout_buffer_chain_t *c,
-                        int depth )
-{
-    block_t *p_ts = BufferChainPeek( c );
-    while( depth > 0 )
-    {
-        p_ts = p_ts->p_next;
-        depth--;
-    }
-    p_ts->i_flags |= BLOCK_FLAG_HEADER;
-}
-
 static block_t *Pack_Opus(block_t *p_data)
 {
     lldiv_t d = lldiv(p_data->i_buffer, 255);
@@ -1155,6 +1165,10 @@ static block_t *Encap_J2K( block_t *p_data, const es_format_t *p_fmt )
     }
     else
     {
+        /* The header is written in place of the stripped boxes */
+        p_data = block_Unshare( p_data );
+        if( unlikely(!p_data) )
+            return NULL;
         p_data->p_buffer += (i_offset - 38);
         p_data->i_buffer -= (i_offset - 38);
     }
@@ -1197,7 +1211,6 @@ static bool MuxStreams(sout_mux_t *p_mux )
     sout_mux_sys_t  *p_sys = p_mux->p_sys;
     sout_input_sys_t *p_pcr_stream = (sout_input_sys_t*)p_sys->p_pcr_input->p_sys;
 
-    sout_buffer_chain_t chain_ts;
     mtime_t i_shaping_delay = p_pcr_stream->state.b_key_frame
         ? p_pcr_stream->state.i_pes_length
         : p_sys->i_shaping_delay;
@@ -1478,13 +1491,12 @@ static bool MuxStreams(sout_mux_t *p_mux )
     i_packet_count += (8 * i_pcr_length / p_sys->i_pcr_delay + 175) / 176;
 
     /* 3: mux PES into TS */
-    BufferChainInit( &chain_ts );
+    p_sys->i_packets = 0;
     /* append PAT/PMT  -> FIXME with big pcr delay it won't have enough pat/pmt */
     bool pat_was_previous = true; //This is to prevent unnecessary double PAT/PMT insertions
-    GetPAT( p_mux, &chain_ts );
-    GetPMT( p_mux, &chain_ts );
+    TSAppendPSI( p_mux, 0 );
     int i_packet_pos = 0;
-    i_packet_count += chain_ts.i_depth;
+    i_packet_count += p_sys->i_packets;
     /* msg_Dbg( p_mux, "estimated pck=%d", i_packet_count ); */
 
     const mtime_t i_pcr_dts = p_pcr_stream->state.i_pes_dts;
@@ -1528,42 +1540,50 @@ static bool MuxStreams(sout_mux_t *p_mux )
                 i_pcr_length / i_packet_count;
         }
 
-        /* Build the TS packet */
-        block_t *p_ts = TSNew( p_mux, p_stream, b_pcr );
-        if( p_sys->csa != NULL &&
-             (p_input->p_fmt->i_cat != AUDIO_ES || p_sys->b_crypt_audio) &&
-             (p_input->p_fmt->i_cat != VIDEO_ES || p_sys->b_crypt_video) )
-        {
-            p_ts->i_flags |= BLOCK_FLAG_SCRAMBLED;
-        }
-        i_packet_pos++;
+        block_t *p_pes = p_stream->state.chain_pes.p_first;
+        const bool b_key_frame = p_stream->state.i_pes_used <= 0 &&
+            (p_pes->i_flags & (BLOCK_FLAG_TYPE_I | BLOCK_FLAG_NO_KEYFRAME))
+                == BLOCK_FLAG_TYPE_I;
 
         /* Write PAT/PMT before every keyframe if use-key-frames is enabled,
          * this helps to do segmenting with livehttp-output so it can cut segment
          * and start new one with pat,pmt,keyframe*/
         if( ( p_sys->b_use_key_frames ) &&
             ( p_input->p_fmt->i_cat == VIDEO_ES ) &&
-            ( p_ts->i_flags & BLOCK_FLAG_TYPE_I ) )
+            ( b_key_frame ) )
         {
             if( likely( !pat_was_previous ) )
             {
-                int startcount = chain_ts.i_depth;
-                GetPAT( p_mux, &chain_ts );
-                GetPMT( p_mux, &chain_ts );
-                SetHeader( &chain_ts, startcount );
-                i_packet_count += (chain_ts.i_depth - startcount );
-            } else {
-                SetHeader( &chain_ts, 0); //We just inserted pat/pmt,so just flag it instead of adding new one
+                int startcount = p_sys->i_packets;
+                TSAppendPSI( p_mux, BLOCK_FLAG_HEADER );
+                i_packet_count += (p_sys->i_packets - startcount );
+            } else if( p_sys->i_packets > 0 ) {
+                p_sys->p_packets[0].i_flags |= BLOCK_FLAG_HEADER; //We just inserted pat/pmt,so just flag it instead of adding new one
             }
         }
         pat_was_previous = false;
 
-        /* */
-        BufferChainAppend( &chain_ts, p_ts );
+        /* Build the TS packet */
+        ts_packet_t *p_ts = TSAppend( p_mux, b_key_frame ? BLOCK_FLAG_TYPE_I : 0 );
+        if( unlikely(p_ts == NULL) )
+            break;
+
+        p_ts->i_dts = p_pes->i_dts;
+        if( b_pcr )
+            p_ts->i_flags |= BLOCK_FLAG_CLOCK;
+        if( p_sys->csa != NULL &&
+             (p_input->p_fmt->i_cat != AUDIO_ES || p_sys->b_crypt_audio) &&
+             (p_input->p_fmt->i_cat != VIDEO_ES || p_sys->b_crypt_video) )
+        {
+            p_ts->i_flags |= BLOCK_FLAG_SCRAMBLED;
+        }
+        TSNew( p_mux, p_stream, p_ts->p_buffer, b_pcr );
+        i_packet_pos++;
     }
 
     /* 4: date and send */
-    TSSchedule( p_mux, &chain_ts, i_pcr_length, i_pcr_dts );
+    TSSchedule( p_mux, 0, p_sys->i_packets, i_pcr_length, i_pcr_dts );
+    TSSend( p_mux );
     return false;
 }
 
@@ -1695,117 +1715,214 @@ static block_t *Add_ADTS( block_t *p_data, const es_format_t *p_fmt )
     return p_new_block;
 }
 
-static void TSSchedule( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
+/* Reserves the next TS packet, in a new output block when the current one is
+ * full or when the packet must start a block (headers and keyframes) */
+static ts_packet_t *TSAppend( sout_mux_t *p_mux, uint32_t i_flags )
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+
+    if( p_sys->i_packets == p_sys->i_packets_max )
+    {
+        int i_max = __MAX( 2 * p_sys->i_packets_max, 256 );
+        ts_packet_t *p_packets = realloc( p_sys->p_packets,
+                                          i_max * sizeof( *p_packets ) );
+        if( unlikely(p_packets == NULL) )
+            return NULL;
+        p_sys->p_packets = p_packets;
+        p_sys->i_packets_max = i_max;
+    }
+
+    block_t *p_out = NULL;
+    if( p_sys->chain_out.p_first != NULL )
+        p_out = container_of( p_sys->chain_out.pp_last, block_t, p_next );
+
+    if( p_out == NULL || p_out->i_buffer == p_sys->i_block_size ||
+        (i_flags & (BLOCK_FLAG_HEADER | BLOCK_FLAG_TYPE_I)) )
+    {
+        p_out = block_Alloc( p_sys->i_block_size );
+        if( unlikely(p_out == NULL) )
+            return NULL;
+        p_out->i_buffer = 0;
+        BufferChainAppend( &p_sys->chain_out, p_out );
+    }
+
+    ts_packet_t *p_ts = &p_sys->p_packets[p_sys->i_packets++];
+    p_ts->p_buffer = &p_out->p_buffer[p_out->i_buffer];
+    p_ts->i_dts    = 0;
+    p_ts->i_length = 0;
+    p_ts->i_flags  = i_flags;
+    p_out->i_buffer += 188;
+    return p_ts;
+}
+
+/* Appends the PAT and PMT packets, the first one being flagged with i_flags */
+static void TSAppendPSI( sout_mux_t *p_mux, uint32_t i_flags )
+{
+    sout_buffer_chain_t chain_psi;
+    block_t *p_psi;
+
+    BufferChainInit( &chain_psi );
+    GetPAT( p_mux, &chain_psi );
+    GetPMT( p_mux, &chain_psi );
+
+    while( ( p_psi = BufferChainGet( &chain_psi ) ) )
+    {
+        ts_packet_t *p_ts = TSAppend( p_mux, i_flags );
+        if( likely(p_ts != NULL) )
+        {
+            memcpy( p_ts->p_buffer, p_psi->p_buffer, 188 );
+            p_ts->i_dts = p_psi->i_dts;
+            i_flags = 0;
+        }
+        block_Release( p_psi );
+    }
+}
+
+static void TSSchedule( sout_mux_t *p_mux, int i_first, int i_count,
                         mtime_t i_pcr_length, mtime_t i_pcr_dts )
 {
     sout_mux_sys_t  *p_sys = p_mux->p_sys;
-    sout_buffer_chain_t new_chain;
-    int i_packet_count = p_chain_ts->i_depth;
-
-    BufferChainInit( &new_chain );
+    const ts_packet_t *p_packets = &p_sys->p_packets[i_first];
 
     if ( i_pcr_length <= 0 )
     {
-        i_pcr_length = i_packet_count;
+        i_pcr_length = i_count;
     }
 
-    for (int i = 0; i < i_packet_count; i++ )
+    for (int i = 0; i < i_count; i++ )
     {
-        block_t *p_ts = BufferChainGet( p_chain_ts );
-        mtime_t i_new_dts = i_pcr_dts + i_pcr_length * i / i_packet_count;
+        mtime_t i_new_dts = i_pcr_dts + i_pcr_length * i / i_count;
 
-        BufferChainAppend( &new_chain, p_ts );
-
-        if (!p_ts->i_dts || p_ts->i_dts + p_sys->i_dts_delay * 2/3 >= i_new_dts)
+        if (!p_packets[i].i_dts ||
+            p_packets[i].i_dts + p_sys->i_dts_delay * 2/3 >= i_new_dts)
             continue;
 
-        mtime_t i_max_diff = i_new_dts - p_ts->i_dts;
-        mtime_t i_cut_dts = p_ts->i_dts;
+        mtime_t i_max_diff = i_new_dts - p_packets[i].i_dts;
+        mtime_t i_cut_dts = p_packets[i].i_dts;
 
-        p_ts = BufferChainPeek( p_chain_ts );
         i++;
-        i_new_dts = i_pcr_dts + i_pcr_length * i / i_packet_count;
-        while ( p_ts != NULL && i_new_dts - p_ts->i_dts >= i_max_diff )
+        i_new_dts = i_pcr_dts + i_pcr_length * i / i_count;
+        while ( i < i_count && i_new_dts - p_packets[i].i_dts >= i_max_diff )
         {
-            p_ts = BufferChainGet( p_chain_ts );
-            i_max_diff = i_new_dts - p_ts->i_dts;
-            i_cut_dts = p_ts->i_dts;
-            BufferChainAppend( &new_chain, p_ts );
+            i_max_diff = i_new_dts - p_packets[i].i_dts;
+            i_cut_dts = p_packets[i].i_dts;
 
-            p_ts = BufferChainPeek( p_chain_ts );
             i++;
-            i_new_dts = i_pcr_dts + i_pcr_length * i / i_packet_count;
+            i_new_dts = i_pcr_dts + i_pcr_length * i / i_count;
         }
         msg_Dbg( p_mux, "adjusting rate at %"PRId64"/%"PRId64" (%d/%d)",
-                 i_cut_dts - i_pcr_dts, i_pcr_length, new_chain.i_depth,
-                 p_chain_ts->i_depth );
-        if ( new_chain.i_depth )
-            TSDate( p_mux, &new_chain, i_cut_dts - i_pcr_dts, i_pcr_dts );
-        if ( p_chain_ts->i_depth )
-            TSSchedule( p_mux, p_chain_ts, i_pcr_dts + i_pcr_length - i_cut_dts,
-                        i_cut_dts );
+                 i_cut_dts - i_pcr_dts, i_pcr_length, i, i_count - i );
+        TSDate( p_mux, i_first, i, i_cut_dts - i_pcr_dts, i_pcr_dts );
+        if ( i < i_count )
+            TSSchedule( p_mux, i_first + i, i_count - i,
+                        i_pcr_dts + i_pcr_length - i_cut_dts, i_cut_dts );
         return;
     }
 
-    if ( new_chain.i_depth )
-        TSDate( p_mux, &new_chain, i_pcr_length, i_pcr_dts );
+    if ( i_count )
+        TSDate( p_mux, i_first, i_count, i_pcr_length, i_pcr_dts );
+}
+
+/* Scrambles the flagged packets together, as the CSA engine is much
+ * faster on many packets at once */
+static void TSScramble( sout_mux_t *p_mux )
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+    uint8_t *pp_pkt[256];
+    int i_pkt = 0;
+
+    vlc_mutex_lock( &p_sys->csa_lock );
+    for( int i = 0; i < p_sys->i_packets; i++ )
+    {
+        if( !(p_sys->p_packets[i].i_flags & BLOCK_FLAG_SCRAMBLED) )
+            continue;
+
+        pp_pkt[i_pkt++] = p_sys->p_packets[i].p_buffer;
+        if( i_pkt == ARRAY_SIZE(pp_pkt) )
+        {
+            csa_EncryptBatch( p_sys->csa, pp_pkt, i_pkt, p_sys->i_csa_pkt_size );
+            i_pkt = 0;
+        }
+    }
+    csa_EncryptBatch( p_sys->csa, pp_pkt, i_pkt, p_sys->i_csa_pkt_size );
+    vlc_mutex_unlock( &p_sys->csa_lock );
 }
 
-static void TSDate( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
+static void TSDate( sout_mux_t *p_mux, int i_first, int i_count,
                     mtime_t i_pcr_length, mtime_t i_pcr_dts )
 {
     sout_mux_sys_t  *p_sys = p_mux->p_sys;
-    int i_packet_count = p_chain_ts->i_depth;
+    ts_packet_t *p_packets = &p_sys->p_packets[i_first];
 
     if ( i_pcr_length / 1000 > 0 )
     {
-        int i_bitrate = ((uint64_t)i_packet_count * 188 * 8000)
+        int i_bitrate = ((uint64_t)i_count * 188 * 8000)
                           / (uint64_t)(i_pcr_length / 1000);
         if ( p_sys->i_bitrate_max && p_sys->i_bitrate_max < i_bitrate )
         {
             msg_Warn( p_mux, "max bitrate exceeded at %"PRId64
                       " (%d bi/s for %d pkt in %"PRId64" us)",
                       i_pcr_dts + p_sys->i_shaping_delay * 3 / 2 - mdate(),
-                      i_bitrate, i_packet_count, i_pcr_length);
+                      i_bitrate, i_count, i_pcr_length);
         }
     }
     else
     {
         /* This shouldn't happen, but happens in some rare heavy load
          * and packet losses conditions. */
-        i_pcr_length = i_packet_count;
+        i_pcr_length = i_count;
     }
 
-    /* msg_Dbg( p_mux, "real pck=%d", i_packet_count ); */
-    for (int i = 0; i < i_packet_count; i++ )
+    /* msg_Dbg( p_mux, "real pck=%d", i_count ); */
+    for (int i = 0; i < i_count; i++ )
     {
-        block_t *p_ts = BufferChainGet( p_chain_ts );
-        mtime_t i_new_dts = i_pcr_dts + i_pcr_length * i / i_packet_count;
+        ts_packet_t *p_ts = &p_packets[i];
 
-        p_ts->i_dts    = i_new_dts;
-        p_ts->i_length = i_pcr_length / i_packet_count;
+        p_ts->i_dts    = i_pcr_dts + i_pcr_length * i / i_count;
+        p_ts->i_length = i_pcr_length / i_count;
 
         if( p_ts->i_flags & BLOCK_FLAG_CLOCK )
         {
             /* msg_Dbg( p_mux, "pcr=%lld ms", p_ts->i_dts / 1000 ); */
-            TSSetPCR( p_ts, p_ts->i_dts - p_sys->first_dts );
+            TSSetPCR( p_ts->p_buffer, p_ts->i_dts - p_sys->first_dts );
         }
-        if( p_ts->i_flags & BLOCK_FLAG_SCRAMBLED )
-        {
-            vlc_mutex_lock( &p_sys->csa_lock );
-            csa_Encrypt( p_sys->csa, p_ts->p_buffer, p_sys->i_csa_pkt_size );
-            vlc_mutex_unlock( &p_sys->csa_lock );
-        }
-
         /* latency */
         p_ts->i_dts += p_sys->i_shaping_delay * 3 / 2;
+    }
+}
+
+/* Sends the output blocks, dated after their first packet */
+static void TSSend( sout_mux_t *p_mux )
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+    const ts_packet_t *p_ts = p_sys->p_packets;
+
+    if( p_sys->csa != NULL )
+        TSScramble( p_mux );
 
-        sout_AccessOutWrite( p_mux->p_access, p_ts );
+    for( block_t *p_out = p_sys->chain_out.p_first; p_out != NULL;
+         p_out = p_out->p_next )
+    {
+        const int i_count = p_out->i_buffer / 188;
+
+        p_out->i_dts    = p_ts->i_dts;
+        p_out->i_length = 0;
+        p_out->i_flags  = p_ts->i_flags & (BLOCK_FLAG_HEADER | BLOCK_FLAG_TYPE_I);
+        for( int i = 0; i < i_count; i++, p_ts++ )
+        {
+            p_out->i_length += p_ts->i_length;
+            p_out->i_flags  |= p_ts->i_flags & BLOCK_FLAG_CLOCK;
+        }
     }
+
+    if( p_sys->chain_out.p_first != NULL )
+        sout_AccessOutWrite( p_mux->p_access, p_sys->chain_out.p_first );
+    BufferChainInit( &p_sys->chain_out );
+    p_sys->i_packets = 0;
 }
 
-static block_t *TSNew( sout_mux_t *p_mux, sout_input_sys_t *p_stream,
-                       bool b_pcr )
+static void TSNew( sout_mux_t *p_mux, sout_input_sys_t *p_stream,
+                   uint8_t *p_ts, bool b_pcr )
 {
     VLC_UNUSED(p_mux);
     block_t *p_pes = p_stream->state.chain_pes.p_first;
@@ -1827,20 +1944,11 @@ static block_t *TSNew( sout_mux_t *p_mux, sout_input_sys_t *p_stream,
         b_adaptation_field = true;
     }
 
-    block_t *p_ts = block_Alloc( 188 );
-
-    if (b_new_pes && !(p_pes->i_flags & BLOCK_FLAG_NO_KEYFRAME) && p_pes->i_flags & BLOCK_FLAG_TYPE_I)
-    {
-        p_ts->i_flags |= BLOCK_FLAG_TYPE_I;
-    }
-
-    p_ts->i_dts = p_pes->i_dts;
-
-    p_ts->p_buffer[0] = 0x47;
-    p_ts->p_buffer[1] = ( b_new_pes ? 0x40 : 0x00 ) |
+    p_ts[0] = 0x47;
+    p_ts[1] = ( b_new_pes ? 0x40 : 0x00 ) |
         ( ( p_stream->ts.i_pid >> 8 )&0x1f );
-    p_ts->p_buffer[2] = p_stream->ts.i_pid & 0xff;
-    p_ts->p_buffer[3] = ( b_adaptation_field ? 0x30 : 0x10 ) |
+    p_ts[2] = p_stream->ts.i_pid & 0xff;
+    p_ts[3] = ( b_adaptation_field ? 0x30 : 0x10 ) |
         p_stream->ts.i_continuity_counter;
 
     p_stream->ts.i_continuity_counter = (p_stream->ts.i_continuity_counter+1)%16;
@@ -1851,30 +1959,28 @@ static block_t *TSNew( sout_mux_t *p_mux, sout_input_sys_t *p_stream,
         int i_stuffing = i_payload_max - i_payload;
         if( b_pcr )
         {
-            p_ts->i_flags |= BLOCK_FLAG_CLOCK;
-
-            p_ts->p_buffer[4] = 7 + i_stuffing;
-            p_ts->p_buffer[5] = 1 << 4; /* PCR_flag */
+            p_ts[4] = 7 + i_stuffing;
+            p_ts[5] = 1 << 4; /* PCR_flag */
             if( p_stream->ts.b_discontinuity )
             {
-                p_ts->p_buffer[5] |= 0x80; /* flag TS dicontinuity */
+                p_ts[5] |= 0x80; /* flag TS dicontinuity */
                 p_stream->ts.b_discontinuity = false;
             }
-            memset(&p_ts->p_buffer[12], 0xff, i_stuffing);
+            memset(&p_ts[12], 0xff, i_stuffing);
         }
         else
         {
-            p_ts->p_buffer[4] = --i_stuffing;
+            p_ts[4] = --i_stuffing;
             if( i_stuffing-- )
             {
-                p_ts->p_buffer[5] = 0;
-                memset(&p_ts->p_buffer[6], 0xff, i_stuffing);
+                p_ts[5] = 0;
+                memset(&p_ts[6], 0xff, i_stuffing);
             }
         }
     }
 
     /* copy payload */
-    memcpy( &p_ts->p_buffer[188 - i_payload],
+    memcpy( &p_ts[188 - i_payload],
             &p_pes->p_buffer[p_stream->state.i_pes_used], i_payload );
 
     p_stream->state.i_pes_used += i_payload;
@@ -1903,21 +2009,19 @@ static block_t *TSNew( sout_mux_t *p_mux, sout_input_sys_t *p_stream,
         }
         p_stream->state.i_pes_used = 0;
     }
-
-    return p_ts;
 }
 
-static void TSSetPCR( block_t *p_ts, mtime_t i_dts )
+static void TSSetPCR( uint8_t *p_ts, mtime_t i_dts )
 {
     mtime_t i_pcr = 9 * i_dts / 100;
 
-    p_ts->p_buffer[6]  = ( i_pcr >> 25 )&0xff;
-    p_ts->p_buffer[7]  = ( i_pcr >> 17 )&0xff;
-    p_ts->p_buffer[8]  = ( i_pcr >> 9  )&0xff;
-    p_ts->p_buffer[9]  = ( i_pcr >> 1  )&0xff;
-    p_ts->p_buffer[10] = ( i_pcr << 7  )&0x80;
-    p_ts->p_buffer[10] |= 0x7e;
-    p_ts->p_buffer[11] = 0; /* we don't set PCR extension */
+    p_ts[6]  = ( i_pcr >> 25 )&0xff;
+    p_ts[7]  = ( i_pcr >> 17 )&0xff;
+    p_ts[8]  = ( i_pcr >> 9  )&0xff;
+    p_ts[9]  = ( i_pcr >> 1  )&0xff;
+    p_ts[10] = ( i_pcr << 7  )&0x80;
+    p_ts[10] |= 0x7e;
+    p_ts[11] = 0; /* we don't set PCR extension */
 }
 
 void GetPAT( sout_mux_t *p_mux, sout_buffer_chain_t *c )
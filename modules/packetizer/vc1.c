@@ -238,7 +238,10 @@ static block_t *Packetize( decoder_t *p_dec, block_t **pp_block )
             ( p_block->i_buffer < i_startcode ||
               memcmp( p_block->p_buffer, p_vc1_startcode, i_startcode ) ) )
         {
+            /* The start code is written in place */
             *pp_block = p_block = block_Realloc( p_block, i_startcode+1, p_block->i_buffer );
+            if( p_block )
+                *pp_block = p_block = block_Unshare( p_block );
             if( p_block )
             {
                 memcpy( p_block->p_buffer, p_vc1_startcode, i_startcode );
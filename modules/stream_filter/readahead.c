@@ -0,0 +1,619 @@
+/*****************************************************************************
+ * readahead.c: asynchronous read-ahead for local and mounted files
+ *****************************************************************************
+ * Copyright © 2018 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#ifdef HAVE_LINUX_IO_URING_H
+# include <sys/mman.h>
+# include <sys/syscall.h>
+# include <sys/uio.h>
+# include <linux/io_uring.h>
+#endif
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_stream.h>
+#include <vlc_atomic.h>
+#include <vlc_fs.h>
+#include <vlc_url.h>
+
+#if defined (HAVE_LINUX_IO_URING_H) && defined (__NR_io_uring_setup)
+# define HAVE_URING 1
+#endif
+
+#ifndef HAVE_POSIX_FADVISE
+# define posix_fadvise(fd, off, len, adv)
+#endif
+
+/* Consecutive failed reads before giving up as on end of stream */
+#define READ_RETRIES 3
+
+/*
+ * The file is read in chunks through a window of slots covering consecutive
+ * ranges from the current position. With io_uring, every slot of the window
+ * is a read in flight, so that the device (or the file server) always has
+ * several requests to work on. Without io_uring, the kernel is only asked to
+ * read the window ahead (POSIX_FADV_WILLNEED) and slots are read
+ * synchronously when they are needed.
+ */
+
+enum slot_state
+{
+    SLOT_FREE,
+    SLOT_ADVISED, /**< range assigned, to be read synchronously */
+    SLOT_PENDING, /**< read submitted, not completed yet */
+    SLOT_DONE, /**< read completed, result is valid */
+};
+
+struct slot
+{
+    enum slot_state state;
+    uint64_t offset;
+    ssize_t result; /**< bytes read, or negative error code */
+    struct iovec iov; /**< buffer and requested length */
+};
+
+#ifdef HAVE_URING
+struct uring
+{
+    int fd;
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sq_ring, *cq_ring;
+    size_t sq_ring_size, cq_ring_size, sqes_size;
+};
+#endif
+
+struct stream_sys_t
+{
+    int fd;
+    uint64_t offset; /**< current read position */
+    uint64_t window_end; /**< end of the last range submitted */
+    size_t chunk_size;
+    unsigned depth;
+    unsigned in_flight;
+    unsigned errors; /**< consecutive read errors */
+    struct slot *slots;
+#ifdef HAVE_URING
+    struct uring *ring;
+#endif
+
+    struct
+    {
+        unsigned long hits; /**< reads served without waiting */
+        unsigned long waits; /**< reads waiting for a slot */
+        unsigned long restarts; /**< seeks outside of the window */
+        unsigned max_in_flight;
+    } stats;
+};
+
+#ifdef HAVE_URING
+static int uring_setup(unsigned entries, struct io_uring_params *p)
+{
+    return syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int uring_enter(int fd, unsigned submit, unsigned wait, unsigned flags)
+{
+    return syscall(__NR_io_uring_enter, fd, submit, wait, flags, NULL, 0);
+}
+
+static void UringDestroy(struct uring *ring)
+{
+    if (ring->sqes != MAP_FAILED)
+        munmap(ring->sqes, ring->sqes_size);
+    if (ring->cq_ring != MAP_FAILED && ring->cq_ring != ring->sq_ring)
+        munmap(ring->cq_ring, ring->cq_ring_size);
+    if (ring->sq_ring != MAP_FAILED)
+        munmap(ring->sq_ring, ring->sq_ring_size);
+    vlc_close(ring->fd);
+    free(ring);
+}
+
+static struct uring *UringCreate(unsigned entries)
+{
+    struct io_uring_params p;
+
+    memset(&p, 0, sizeof (p));
+
+    int fd = uring_setup(entries, &p);
+    if (fd < 0)
+        return NULL; /* not supported, or disabled by policy */
+
+    struct uring *ring = malloc(sizeof (*ring));
+    if (unlikely(ring == NULL))
+    {
+        vlc_close(fd);
+        return NULL;
+    }
+
+    ring->fd = fd;
+    ring->sq_ring_size = p.sq_off.array + p.sq_entries * sizeof (unsigned);
+    ring->cq_ring_size = p.cq_off.cqes
+                       + p.cq_entries * sizeof (struct io_uring_cqe);
+    ring->sqes_size = p.sq_entries * sizeof (struct io_uring_sqe);
+    ring->cq_ring = ring->sqes = MAP_FAILED;
+
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        if (ring->cq_ring_size > ring->sq_ring_size)
+            ring->sq_ring_size = ring->cq_ring_size;
+        ring->cq_ring_size = ring->sq_ring_size;
+    }
+
+    ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ|PROT_WRITE,
+                         MAP_SHARED|MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ring == MAP_FAILED)
+        goto error;
+
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+        ring->cq_ring = ring->sq_ring;
+    else
+    {
+        ring->cq_ring = mmap(NULL, ring->cq_ring_size, PROT_READ|PROT_WRITE,
+                             MAP_SHARED|MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (ring->cq_ring == MAP_FAILED)
+            goto error;
+    }
+
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ|PROT_WRITE,
+                      MAP_SHARED|MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED)
+        goto error;
+
+    char *sq = ring->sq_ring, *cq = ring->cq_ring;
+
+    ring->sq_head = (unsigned *)(sq + p.sq_off.head);
+    ring->sq_tail = (unsigned *)(sq + p.sq_off.tail);
+    ring->sq_mask = (unsigned *)(sq + p.sq_off.ring_mask);
+    ring->sq_array = (unsigned *)(sq + p.sq_off.array);
+    ring->cq_head = (unsigned *)(cq + p.cq_off.head);
+    ring->cq_tail = (unsigned *)(cq + p.cq_off.tail);
+    ring->cq_mask = (unsigned *)(cq + p.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+    return ring;
+
+error:
+    UringDestroy(ring);
+    return NULL;
+}
+
+/* The ring indices are shared with the kernel */
+static unsigned UringLoad(const unsigned *p)
+{
+    return atomic_load_explicit((const _Atomic unsigned *)p,
+                                memory_order_acquire);
+}
+
+static void UringStore(unsigned *p, unsigned v)
+{
+    atomic_store_explicit((_Atomic unsigned *)p, v, memory_order_release);
+}
+
+static int UringSubmit(struct uring *ring, int fd, struct slot *slot,
+                       uint64_t user_data)
+{
+    unsigned tail = *ring->sq_tail;
+
+    if (tail - UringLoad(ring->sq_head) > *ring->sq_mask)
+        return -1; /* full, cannot happen with one entry per slot */
+
+    unsigned index = tail & *ring->sq_mask;
+    struct io_uring_sqe *sqe = &ring->sqes[index];
+
+    memset(sqe, 0, sizeof (*sqe));
+    sqe->opcode = IORING_OP_READV;
+    sqe->fd = fd;
+    sqe->addr = (uintptr_t)&slot->iov;
+    sqe->len = 1;
+    sqe->off = slot->offset;
+    sqe->user_data = user_data;
+
+    ring->sq_array[index] = index;
+    UringStore(ring->sq_tail, tail + 1);
+
+    int val;
+    do
+        val = uring_enter(ring->fd, 1, 0, 0);
+    while (val < 0 && errno == EINTR);
+
+    /* Once the kernel has consumed the entry, the read completes eventually,
+     * even if io_uring_enter() failed. */
+    if (UringLoad(ring->sq_head) != tail)
+        return 0;
+
+    /* Otherwise (EAGAIN, EBUSY...), withdraw it before reading synchronously,
+     * lest the next submission picks it up as well. */
+    UringStore(ring->sq_tail, tail);
+    if (val >= 0)
+        errno = EAGAIN;
+    return -1;
+}
+
+/* Collects completions, waiting for at least one if wait is true */
+static int UringReap(struct uring *ring, struct slot *slots, unsigned *count,
+                     bool wait)
+{
+    unsigned head = *ring->cq_head;
+
+    while (wait && head == UringLoad(ring->cq_tail))
+        if (uring_enter(ring->fd, 0, 1, IORING_ENTER_GETEVENTS) < 0
+         && errno != EINTR)
+            return -1;
+
+    for (unsigned tail = UringLoad(ring->cq_tail); head != tail; head++)
+    {
+        const struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+        struct slot *slot = &slots[cqe->user_data];
+
+        assert(slot->state == SLOT_PENDING);
+        slot->result = cqe->res;
+        slot->state = SLOT_DONE;
+        (*count)--;
+    }
+    UringStore(ring->cq_head, head);
+    return 0;
+}
+#endif
+
+/* Starts reading the range of a slot */
+static void Start(stream_t *stream, struct slot *slot)
+{
+    stream_sys_t *sys = stream->p_sys;
+
+#ifdef HAVE_URING
+    if (sys->ring != NULL)
+    {
+        if (UringSubmit(sys->ring, sys->fd, slot, slot - sys->slots) == 0)
+        {
+            slot->state = SLOT_PENDING;
+            if (++sys->in_flight > sys->stats.max_in_flight)
+                sys->stats.max_in_flight = sys->in_flight;
+            return;
+        }
+
+        msg_Warn(stream, "asynchronous read error: %s",
+                 vlc_strerror_c(errno));
+    }
+#endif
+    /* Read on demand, but let the kernel start reading ahead */
+    posix_fadvise(sys->fd, slot->offset, sys->chunk_size,
+                  POSIX_FADV_WILLNEED);
+    slot->state = SLOT_ADVISED;
+}
+
+static void Submit(stream_t *stream, struct slot *slot)
+{
+    stream_sys_t *sys = stream->p_sys;
+
+    slot->offset = sys->window_end;
+    slot->iov.iov_len = sys->chunk_size;
+    sys->window_end += sys->chunk_size;
+    Start(stream, slot);
+}
+
+static void Drain(stream_t *stream)
+{
+    stream_sys_t *sys = stream->p_sys;
+
+#ifdef HAVE_URING
+    while (sys->in_flight > 0)
+        if (UringReap(sys->ring, sys->slots, &sys->in_flight, true))
+            break;
+#endif
+    for (unsigned i = 0; i < sys->depth; i++)
+        sys->slots[i].state = SLOT_FREE;
+    sys->window_end = sys->offset;
+}
+
+static void Fill(stream_t *stream)
+{
+    stream_sys_t *sys = stream->p_sys;
+
+    for (unsigned i = 0; i < sys->depth; i++)
+    {
+        struct slot *slot = &sys->slots[i];
+
+        /* Recycle the completed slots already passed by */
+        if (slot->state == SLOT_DONE
+         && slot->offset + slot->iov.iov_len <= sys->offset)
+            slot->state = SLOT_FREE;
+        if (slot->state == SLOT_FREE
+         && sys->window_end - sys->offset < sys->depth * sys->chunk_size)
+            Submit(stream, slot);
+    }
+}
+
+static struct slot *Find(stream_t *stream)
+{
+    stream_sys_t *sys = stream->p_sys;
+
+    for (unsigned i = 0; i < sys->depth; i++)
+    {
+        struct slot *slot = &sys->slots[i];
+
+        if (slot->state != SLOT_FREE
+         && slot->offset <= sys->offset
+         && sys->offset - slot->offset < slot->iov.iov_len)
+            return slot;
+    }
+    return NULL;
+}
+
+/* Reports a failed read, to be tried again (if slot is not NULL, by reading
+ * its range again) unless it failed too many times in a row */
+static ssize_t Retry(stream_t *stream, struct slot *slot, int errnum)
+{
+    stream_sys_t *sys = stream->p_sys;
+
+    msg_Err(stream, "read error: %s", vlc_strerror_c(errnum));
+    if (++sys->errors > READ_RETRIES)
+        return 0;
+
+    if (slot != NULL)
+        Start(stream, slot);
+    return -1;
+}
+
+static ssize_t Read(stream_t *stream, void *buf, size_t length)
+{
+    stream_sys_t *sys = stream->p_sys;
+
+#ifdef HAVE_URING
+    if (sys->ring != NULL && sys->in_flight > 0)
+        UringReap(sys->ring, sys->slots, &sys->in_flight, false);
+#endif
+
+    struct slot *slot = Find(stream);
+    if (slot == NULL)
+    {   /* Seek out of the window: restart it from the current position */
+        sys->stats.restarts++;
+        Drain(stream);
+        Fill(stream);
+        slot = Find(stream);
+        assert(slot != NULL);
+    }
+
+    switch (slot->state)
+    {
+        case SLOT_DONE:
+            sys->stats.hits++;
+            break;
+#ifdef HAVE_URING
+        case SLOT_PENDING:
+            sys->stats.waits++;
+            while (slot->state == SLOT_PENDING)
+                if (UringReap(sys->ring, sys->slots, &sys->in_flight, true))
+                    return Retry(stream, NULL, errno);
+            break;
+#endif
+        case SLOT_ADVISED:
+            sys->stats.waits++;
+            slot->result = pread(sys->fd, slot->iov.iov_base,
+                                 slot->iov.iov_len, slot->offset);
+            if (slot->result < 0)
+                slot->result = -errno;
+            slot->state = SLOT_DONE;
+            break;
+        default:
+            vlc_assert_unreachable();
+    }
+
+    if (slot->result < 0)
+        return Retry(stream, slot, -slot->result);
+    sys->errors = 0;
+
+    size_t skip = sys->offset - slot->offset;
+    if (skip >= (size_t)slot->result)
+    {   /* Short read, normally the end of the file */
+        ssize_t val = pread(sys->fd, buf, length, sys->offset);
+        if (val < 0)
+            return Retry(stream, NULL, errno);
+        if (val == 0)
+            return 0;
+
+        /* The file grew, or the read was interrupted: restart the window */
+        sys->offset += val;
+        Drain(stream);
+        return val;
+    }
+
+    if (length > (size_t)slot->result - skip)
+        length = slot->result - skip;
+
+    memcpy(buf, (char *)slot->iov.iov_base + skip, length);
+    sys->offset += length;
+
+    /* Keep the window full */
+    if (sys->offset - slot->offset >= (size_t)slot->result)
+        Fill(stream);
+    return length;
+}
+
+static int Seek(stream_t *stream, uint64_t offset)
+{
+    stream_sys_t *sys = stream->p_sys;
+
+    /* Seeking is free: Read() restarts the window if needed */
+    sys->offset = offset;
+    return VLC_SUCCESS;
+}
+
+static int Control(stream_t *stream, int query, va_list args)
+{
+    stream_sys_t *sys = stream->p_sys;
+
+    switch (query)
+    {
+        case STREAM_CAN_SEEK:
+        case STREAM_CAN_FASTSEEK:
+            *va_arg(args, bool *) = true;
+            break;
+
+        case STREAM_GET_SIZE:
+        {
+            struct stat st;
+
+            if (fstat(sys->fd, &st))
+                return VLC_EGENERIC;
+            *va_arg(args, uint64_t *) = st.st_size;
+            break;
+        }
+
+        case STREAM_CAN_PAUSE:
+        case STREAM_CAN_CONTROL_PACE:
+        case STREAM_GET_PTS_DELAY:
+        case STREAM_GET_META:
+        case STREAM_GET_CONTENT_TYPE:
+        case STREAM_SET_PAUSE_STATE:
+            return vlc_stream_vaControl(stream->p_source, query, args);
+
+        default:
+            return VLC_EGENERIC;
+    }
+    return VLC_SUCCESS;
+}
+
+static int Open(vlc_object_t *obj)
+{
+    stream_t *stream = (stream_t *)obj;
+
+    if (stream->psz_url == NULL)
+        return VLC_EGENERIC;
+
+    /* Only files can be read at arbitrary offsets concurrently */
+    char *path = vlc_uri2path(stream->psz_url);
+    if (path == NULL)
+        return VLC_EGENERIC;
+
+    int fd = vlc_open(path, O_RDONLY);
+    free(path);
+    if (fd == -1)
+        return VLC_EGENERIC;
+
+    struct stat st;
+    if (fstat(fd, &st) || !S_ISREG(st.st_mode))
+    {
+        vlc_close(fd);
+        return VLC_EGENERIC;
+    }
+
+    stream_sys_t *sys = malloc(sizeof (*sys));
+    if (unlikely(sys == NULL))
+    {
+        vlc_close(fd);
+        return VLC_ENOMEM;
+    }
+
+    sys->fd = fd;
+    sys->offset = 0;
+    sys->window_end = 0;
+    sys->chunk_size = var_InheritInteger(stream, "readahead-chunk-size") << 10;
+    sys->depth = var_InheritInteger(stream, "readahead-depth");
+    sys->in_flight = 0;
+    sys->errors = 0;
+    memset(&sys->stats, 0, sizeof (sys->stats));
+
+    sys->slots = calloc(sys->depth, sizeof (*sys->slots));
+    char *buffers = malloc(sys->depth * sys->chunk_size);
+    if (unlikely(sys->slots == NULL || buffers == NULL))
+    {
+        free(buffers);
+        free(sys->slots);
+        free(sys);
+        vlc_close(fd);
+        return VLC_ENOMEM;
+    }
+
+    for (unsigned i = 0; i < sys->depth; i++)
+    {
+        sys->slots[i].state = SLOT_FREE;
+        sys->slots[i].iov.iov_base = buffers + i * sys->chunk_size;
+    }
+
+#ifdef HAVE_URING
+    sys->ring = UringCreate(sys->depth);
+    if (sys->ring == NULL)
+        msg_Dbg(stream, "io_uring not available, reading synchronously");
+#endif
+    msg_Dbg(stream, "reading ahead %u x %zu KiB", sys->depth,
+            sys->chunk_size >> 10);
+
+    stream->p_sys = sys;
+    stream->pf_read = Read;
+    stream->pf_seek = Seek;
+    stream->pf_control = Control;
+    return VLC_SUCCESS;
+}
+
+static void Close(vlc_object_t *obj)
+{
+    stream_t *stream = (stream_t *)obj;
+    stream_sys_t *sys = stream->p_sys;
+
+    Drain(stream);
+
+    unsigned long reads = sys->stats.hits + sys->stats.waits;
+    if (reads > 0)
+        msg_Dbg(stream, "%lu%% of %lu reads served without waiting, "
+                "%lu window restarts, up to %u reads in flight",
+                sys->stats.hits * 100 / reads, reads, sys->stats.restarts,
+                sys->stats.max_in_flight);
+
+#ifdef HAVE_URING
+    if (sys->ring != NULL)
+        UringDestroy(sys->ring);
+#endif
+    free(sys->slots[0].iov.iov_base);
+    free(sys->slots);
+    vlc_close(sys->fd);
+    free(sys);
+}
+
+vlc_module_begin()
+    set_category(CAT_INPUT)
+    set_subcategory(SUBCAT_INPUT_STREAM_FILTER)
+    set_capability("stream_filter", 0)
+    add_shortcut("readahead")
+
+    set_description(N_("Asynchronous file read-ahead"))
+    set_callbacks(Open, Close)
+
+    add_integer("readahead-depth", 8, N_("Read-ahead depth"),
+                N_("Number of chunks read ahead of the current position"),
+                true)
+        change_integer_range(1, 64)
+    add_integer("readahead-chunk-size", 256, N_("Read-ahead chunk size"),
+                N_("Size of each chunk read ahead (KiB)"), true)
+        change_integer_range(4, 1 << 14)
+vlc_module_end()
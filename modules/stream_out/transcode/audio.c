@@ -131,6 +131,39 @@ static int transcode_audio_initialize_encoder( sout_stream_id_sys_t *id, sout_st
     return VLC_SUCCESS;
 }
 
+static void ReleaseBlock( void *item )
+{
+    block_Release( item );
+}
+
+static void EncoderStage( void *opaque, void *item )
+{
+    sout_stream_id_sys_t *id = opaque;
+    block_t *p_audio_buf = item;
+
+    block_t *p_block = id->p_encoder->pf_encode_audio( id->p_encoder, p_audio_buf );
+    block_Release( p_audio_buf );
+
+    vlc_mutex_lock( &id->lock_out );
+    block_ChainAppend( &id->p_buffers, p_block );
+    vlc_mutex_unlock( &id->lock_out );
+}
+
+/* Waits for the queued buffers to be encoded, and picks up the encoded
+ * blocks. */
+static void transcode_audio_drain( sout_stream_id_sys_t *id, block_t **out )
+{
+    if( id->p_encoder_stage == NULL )
+        return;
+
+    transcode_stage_Drain( id->p_encoder_stage );
+
+    vlc_mutex_lock( &id->lock_out );
+    block_ChainAppend( out, id->p_buffers );
+    id->p_buffers = NULL;
+    vlc_mutex_unlock( &id->lock_out );
+}
+
 static int decoder_queue_audio( decoder_t *p_dec, block_t *p_audio )
 {
     sout_stream_id_sys_t *id = p_dec->p_queue_ctx;
@@ -207,6 +240,13 @@ static int transcode_audio_new( sout_stream_t *p_stream,
 
 void transcode_audio_close( sout_stream_id_sys_t *id )
 {
+    /* Stop the encoder thread */
+    if( id->p_encoder_stage )
+        transcode_stage_Delete( id->p_encoder_stage );
+    id->p_encoder_stage = NULL;
+    block_ChainRelease( id->p_buffers );
+    id->p_buffers = NULL;
+
     /* Close decoder */
     if( id->p_decoder->p_module )
         module_unneed( id->p_decoder, id->p_decoder->p_module );
@@ -339,6 +379,12 @@ int transcode_audio_process( sout_stream_t *p_stream,
 
         p_audio_buf->i_dts = p_audio_buf->i_pts;
 
+        if( id->p_encoder_stage != NULL )
+        {
+            transcode_stage_Push( id->p_encoder_stage, p_audio_buf );
+            continue;
+        }
+
         block_t *p_block = id->p_encoder->pf_encode_audio( id->p_encoder, p_audio_buf );
 
         block_ChainAppend( out, p_block );
@@ -349,11 +395,22 @@ error:
         b_error = true;
     } while( p_audio_bufs );
 
+    if( id->p_encoder_stage != NULL )
+    {
+        /* Pick up what the encoder thread has output so far */
+        vlc_mutex_lock( &id->lock_out );
+        block_ChainAppend( out, id->p_buffers );
+        id->p_buffers = NULL;
+        vlc_mutex_unlock( &id->lock_out );
+    }
+
 end:
     /* Drain encoder */
     if( unlikely( !b_error && in == NULL ) )
     {
         block_t *p_block;
+
+        transcode_audio_drain( id, out );
         do {
            p_block = id->p_encoder->pf_encode_audio(id->p_encoder, NULL );
            block_ChainAppend( out, p_block );
@@ -396,6 +453,24 @@ bool transcode_audio_add( sout_stream_t *p_stream, const es_format_t *p_fmt,
         return false;
     }
 
+    /* Encode on a separate thread, with a bounded queue from the decoder */
+    if( p_sys->i_threads > 0 )
+    {
+        int i_priority = p_sys->b_high_priority ? VLC_THREAD_PRIORITY_OUTPUT :
+                           VLC_THREAD_PRIORITY_AUDIO;
+
+        id->p_encoder_stage = transcode_stage_New( VLC_OBJECT( p_stream ),
+                                                   "audio encoder",
+                                                   p_sys->pool_size, i_priority,
+                                                   EncoderStage, ReleaseBlock,
+                                                   id );
+        if( id->p_encoder_stage == NULL )
+        {
+            transcode_audio_close( id );
+            return false;
+        }
+    }
+
     /* Open output stream */
     id->id = sout_StreamIdAdd( p_stream->p_next, &id->p_encoder->fmt_out );
     id->b_transcode = true;
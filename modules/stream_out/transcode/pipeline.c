@@ -0,0 +1,195 @@
+/*****************************************************************************
+ * pipeline.c: transcoding stream output module (pipeline stages)
+ *****************************************************************************
+ * Copyright (C) 2018 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Preamble
+ *****************************************************************************/
+
+#include "transcode.h"
+
+struct transcode_stage_t
+{
+    vlc_object_t    *p_obj;
+    const char      *psz_name;
+    void            (*pf_process)( void *, void * );
+    void            (*pf_release)( void * );
+    void            *opaque;
+
+    vlc_thread_t    thread;
+    vlc_mutex_t     lock;
+    vlc_cond_t      wait; /**< Signaled when an item is queued */
+    vlc_cond_t      room; /**< Signaled when an item is dequeued or done */
+    bool            b_busy;
+    bool            b_abort;
+
+    /* Statistics */
+    unsigned        i_items;
+    unsigned        i_max_queued;
+    mtime_t         i_queued; /**< Total time spent by items in the queue */
+    mtime_t         i_processing; /**< Total time spent processing items */
+
+    /* Ring buffer of the queued items */
+    unsigned        i_depth;
+    unsigned        i_first;
+    unsigned        i_count;
+    struct
+    {
+        void        *item;
+        mtime_t     i_date;
+    } queue[];
+};
+
+static void *StageThread( void *data )
+{
+    transcode_stage_t *p_stage = data;
+    int canc = vlc_savecancel();
+
+    vlc_mutex_lock( &p_stage->lock );
+    for( ;; )
+    {
+        while( p_stage->i_count == 0 && !p_stage->b_abort )
+            vlc_cond_wait( &p_stage->wait, &p_stage->lock );
+        if( p_stage->b_abort )
+            break;
+
+        void *item = p_stage->queue[p_stage->i_first].item;
+        mtime_t i_start = mdate();
+
+        p_stage->i_queued += i_start - p_stage->queue[p_stage->i_first].i_date;
+        p_stage->i_first = (p_stage->i_first + 1) % p_stage->i_depth;
+        p_stage->i_count--;
+        p_stage->b_busy = true;
+        vlc_cond_broadcast( &p_stage->room );
+        vlc_mutex_unlock( &p_stage->lock );
+
+        p_stage->pf_process( p_stage->opaque, item );
+
+        vlc_mutex_lock( &p_stage->lock );
+        p_stage->i_processing += mdate() - i_start;
+        p_stage->i_items++;
+        p_stage->b_busy = false;
+        vlc_cond_broadcast( &p_stage->room );
+    }
+    vlc_mutex_unlock( &p_stage->lock );
+
+    vlc_restorecancel( canc );
+    return NULL;
+}
+
+transcode_stage_t *transcode_stage_New( vlc_object_t *p_obj,
+                                        const char *psz_name,
+                                        unsigned i_depth, int i_priority,
+                                        void (*pf_process)( void *, void * ),
+                                        void (*pf_release)( void * ),
+                                        void *opaque )
+{
+    if( i_depth == 0 )
+        i_depth = 1;
+
+    transcode_stage_t *p_stage = malloc( sizeof( *p_stage )
+                                 + i_depth * sizeof( p_stage->queue[0] ) );
+    if( unlikely(p_stage == NULL) )
+        return NULL;
+
+    p_stage->p_obj = p_obj;
+    p_stage->psz_name = psz_name;
+    p_stage->pf_process = pf_process;
+    p_stage->pf_release = pf_release;
+    p_stage->opaque = opaque;
+    vlc_mutex_init( &p_stage->lock );
+    vlc_cond_init( &p_stage->wait );
+    vlc_cond_init( &p_stage->room );
+    p_stage->b_busy = false;
+    p_stage->b_abort = false;
+    p_stage->i_items = 0;
+    p_stage->i_max_queued = 0;
+    p_stage->i_queued = 0;
+    p_stage->i_processing = 0;
+    p_stage->i_depth = i_depth;
+    p_stage->i_first = 0;
+    p_stage->i_count = 0;
+
+    if( vlc_clone( &p_stage->thread, StageThread, p_stage, i_priority ) )
+    {
+        msg_Err( p_obj, "cannot spawn %s thread", psz_name );
+        vlc_cond_destroy( &p_stage->room );
+        vlc_cond_destroy( &p_stage->wait );
+        vlc_mutex_destroy( &p_stage->lock );
+        free( p_stage );
+        return NULL;
+    }
+    return p_stage;
+}
+
+void transcode_stage_Push( transcode_stage_t *p_stage, void *item )
+{
+    vlc_mutex_lock( &p_stage->lock );
+    /* Backpressure: wait for the stage to catch up */
+    while( p_stage->i_count == p_stage->i_depth )
+        vlc_cond_wait( &p_stage->room, &p_stage->lock );
+
+    unsigned i = (p_stage->i_first + p_stage->i_count) % p_stage->i_depth;
+
+    p_stage->queue[i].item = item;
+    p_stage->queue[i].i_date = mdate();
+    p_stage->i_count++;
+    if( p_stage->i_count > p_stage->i_max_queued )
+        p_stage->i_max_queued = p_stage->i_count;
+    vlc_cond_signal( &p_stage->wait );
+    vlc_mutex_unlock( &p_stage->lock );
+}
+
+void transcode_stage_Drain( transcode_stage_t *p_stage )
+{
+    vlc_mutex_lock( &p_stage->lock );
+    while( p_stage->i_count > 0 || p_stage->b_busy )
+        vlc_cond_wait( &p_stage->room, &p_stage->lock );
+    vlc_mutex_unlock( &p_stage->lock );
+}
+
+void transcode_stage_Delete( transcode_stage_t *p_stage )
+{
+    vlc_mutex_lock( &p_stage->lock );
+    p_stage->b_abort = true;
+    vlc_cond_signal( &p_stage->wait );
+    vlc_mutex_unlock( &p_stage->lock );
+
+    vlc_join( p_stage->thread, NULL );
+
+    /* Drop what was not processed */
+    for( ; p_stage->i_count > 0; p_stage->i_count-- )
+    {
+        p_stage->pf_release( p_stage->queue[p_stage->i_first].item );
+        p_stage->i_first = (p_stage->i_first + 1) % p_stage->i_depth;
+    }
+
+    if( p_stage->i_items > 0 )
+        msg_Dbg( p_stage->p_obj, "%s: %u items, %"PRId64" us queued and "
+                 "%"PRId64" us processing on average, up to %u/%u queued",
+                 p_stage->psz_name, p_stage->i_items,
+                 p_stage->i_queued / p_stage->i_items,
+                 p_stage->i_processing / p_stage->i_items,
+                 p_stage->i_max_queued, p_stage->i_depth );
+
+    vlc_cond_destroy( &p_stage->room );
+    vlc_cond_destroy( &p_stage->wait );
+    vlc_mutex_destroy( &p_stage->lock );
+    free( p_stage );
+}
@@ -111,8 +111,10 @@ static int transcode_spu_new( sout_stream_t *p_stream, sout_stream_id_sys_t *id
         }
     }
 
+    vlc_mutex_lock( &p_sys->spu_lock );
     if( !p_sys->p_spu )
         p_sys->p_spu = spu_Create( p_stream, NULL );
+    vlc_mutex_unlock( &p_sys->spu_lock );
 
     return VLC_SUCCESS;
 }
@@ -130,11 +132,14 @@ void transcode_spu_close( sout_stream_t *p_stream, sout_stream_id_sys_t *id)
     if( id->p_encoder->p_module )
         module_unneed( id->p_encoder, id->p_encoder->p_module );
 
+    /* The video filter stages may be rendering with it */
+    vlc_mutex_lock( &p_sys->spu_lock );
     if( p_sys->p_spu )
     {
         spu_Destroy( p_sys->p_spu );
         p_sys->p_spu = NULL;
     }
+    vlc_mutex_unlock( &p_sys->spu_lock );
 }
 
 int transcode_spu_process( sout_stream_t *p_stream,
@@ -171,7 +176,11 @@ int transcode_spu_process( sout_stream_t *p_stream,
         }
 
         if( p_sys->b_soverlay )
+        {
+            vlc_mutex_lock( &p_sys->spu_lock );
             spu_PutSubpicture( p_sys->p_spu, p_subpic );
+            vlc_mutex_unlock( &p_sys->spu_lock );
+        }
         else
         {
             block_t *p_block;
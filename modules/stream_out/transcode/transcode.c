@@ -80,6 +80,13 @@
 #define VFILTER_LONGTEXT N_( \
     "Video filters will be applied to the video streams (after overlays " \
     "are applied). You can enter a colon-separated list of filters." )
+#define RENDITION_TEXT N_("Rendition")
+#define RENDITION_LONGTEXT N_( \
+    "Additional rendition of the video, encoded from the same decoded " \
+    "pictures: {width=...,height=...,vb=...,dst=...} where dst is the " \
+    "stream output chain of the rendition. It can be repeated to build an " \
+    "adaptive bitrate ladder, from the largest rendition to the smallest, " \
+    "each one being scaled from the previous one." )
 
 #define AENC_TEXT N_("Audio encoder")
 #define AENC_LONGTEXT N_( \
@@ -128,8 +135,9 @@
     "Runs the optional encoder thread at the OUTPUT priority instead of " \
     "VIDEO." )
 #define POOL_TEXT N_("Picture pool size")
-#define POOL_LONGTEXT N_( "Defines how many pictures we allow to be in pool "\
-    "between decoder/encoder threads when threads > 0" )
+#define POOL_LONGTEXT N_( "Defines how many pictures or audio buffers we "\
+    "allow to be queued between decoder, filter and encoder threads when "\
+    "threads > 0" )
 
 
 static const char *const ppsz_deinterlace_type[] =
@@ -178,6 +186,8 @@ vlc_module_begin ()
                  MAXHEIGHT_LONGTEXT, true )
     add_module_list( SOUT_CFG_PREFIX "vfilter", "video filter",
                      NULL, VFILTER_TEXT, VFILTER_LONGTEXT, false )
+    add_string( SOUT_CFG_PREFIX "rendition", NULL, RENDITION_TEXT,
+                RENDITION_LONGTEXT, true )
 
     set_section( N_("Audio"), NULL )
     add_module( SOUT_CFG_PREFIX "aenc", "encoder", NULL, AENC_TEXT,
@@ -224,7 +234,7 @@ static const char *const ppsz_sout_options[] = {
     "deinterlace-module", "threads", "aenc", "acodec", "ab", "alang",
     "afilter", "samplerate", "channels", "senc", "scodec", "soverlay",
     "sfilter", "high-priority", "maxwidth", "maxheight", "pool-size",
-    NULL
+    "rendition", NULL
 };
 
 /*****************************************************************************
@@ -234,6 +244,58 @@ static sout_stream_id_sys_t *Add( sout_stream_t *, const es_format_t * );
 static void              Del ( sout_stream_t *, sout_stream_id_sys_t * );
 static int               Send( sout_stream_t *, sout_stream_id_sys_t *, block_t* );
 
+/*****************************************************************************
+ * AddRendition: parses a rendition of the ABR ladder and creates its chain
+ *****************************************************************************/
+static void AddRendition( sout_stream_t *p_stream, sout_stream_sys_t *p_sys,
+                          const char *psz_opts )
+{
+    transcode_rendition_t *p_rend = calloc( 1, sizeof( *p_rend ) );
+    config_chain_t *p_cfg = NULL;
+    const char *psz_dst = NULL;
+
+    if( unlikely(p_rend == NULL) )
+        return;
+
+    config_ChainParseOptions( &p_cfg, psz_opts );
+    for( config_chain_t *p = p_cfg; p != NULL; p = p->p_next )
+    {
+        if( p->psz_value == NULL )
+            continue;
+        if( !strcmp( p->psz_name, "width" ) )
+            p_rend->i_width = atoi( p->psz_value );
+        else if( !strcmp( p->psz_name, "height" ) )
+            p_rend->i_height = atoi( p->psz_value );
+        else if( !strcmp( p->psz_name, "vb" ) )
+            p_rend->i_vbitrate = atoi( p->psz_value );
+        else if( !strcmp( p->psz_name, "dst" ) )
+            psz_dst = p->psz_value;
+        else
+            msg_Err( p_stream, " * ignore unknown rendition option `%s'",
+                     p->psz_name );
+    }
+    if( p_rend->i_vbitrate < 16000 ) p_rend->i_vbitrate *= 1000;
+
+    if( psz_dst != NULL )
+    {
+        msg_Dbg( p_stream, " * adding rendition %ux%u %dkb/s to `%s'",
+                 p_rend->i_width, p_rend->i_height,
+                 p_rend->i_vbitrate / 1000, psz_dst );
+        p_rend->p_stream = sout_StreamChainNew( p_stream->p_sout, psz_dst,
+                                                NULL, &p_rend->p_last );
+    }
+    else
+        msg_Err( p_stream, " * ignore rendition without destination" );
+    config_ChainDestroy( p_cfg );
+
+    if( p_rend->p_stream == NULL )
+    {
+        free( p_rend );
+        return;
+    }
+    TAB_APPEND( p_sys->i_renditions, p_sys->pp_renditions, p_rend );
+}
+
 /*****************************************************************************
  * Open:
  *****************************************************************************/
@@ -355,6 +417,14 @@ static int Open( vlc_object_t *p_this )
         p_sys->psz_vf2 = NULL;
     free( psz_string );
 
+    TAB_INIT( p_sys->i_renditions, p_sys->pp_renditions );
+    for( config_chain_t *p_cfg = p_stream->p_cfg; p_cfg != NULL;
+         p_cfg = p_cfg->p_next )
+    {
+        if( !strcmp( p_cfg->psz_name, "rendition" ) && p_cfg->psz_value )
+            AddRendition( p_stream, p_sys, p_cfg->psz_value );
+    }
+
     if( var_GetBool( p_stream, SOUT_CFG_PREFIX "deinterlace" ) )
         psz_string = var_GetString( p_stream,
                                     SOUT_CFG_PREFIX "deinterlace-module" );
@@ -377,8 +447,8 @@ static int Open( vlc_object_t *p_this )
     }
 
     /* Subpictures transcoding parameters */
+    vlc_mutex_init( &p_sys->spu_lock );
     p_sys->p_spu = NULL;
-    p_sys->p_spu_blend = NULL;
     p_sys->psz_senc = NULL;
     p_sys->p_spu_cfg = NULL;
     p_sys->i_scodec = 0;
@@ -443,6 +513,14 @@ static void Close( vlc_object_t * p_this )
 
     free( p_sys->psz_vf2 );
 
+    for( int i = 0; i < p_sys->i_renditions; i++ )
+    {
+        sout_StreamChainDelete( p_sys->pp_renditions[i]->p_stream,
+                                p_sys->pp_renditions[i]->p_last );
+        free( p_sys->pp_renditions[i] );
+    }
+    TAB_CLEAN( p_sys->i_renditions, p_sys->pp_renditions );
+
     config_ChainDestroy( p_sys->p_video_cfg );
     free( p_sys->psz_venc );
 
@@ -453,7 +531,7 @@ static void Close( vlc_object_t * p_this )
     free( p_sys->psz_senc );
 
     if( p_sys->p_spu ) spu_Destroy( p_sys->p_spu );
-    if( p_sys->p_spu_blend ) filter_DeleteBlend( p_sys->p_spu_blend );
+    vlc_mutex_destroy( &p_sys->spu_lock );
 
     free( p_sys );
 }
@@ -476,6 +554,8 @@ static void DeleteSoutStreamID( sout_stream_id_sys_t *id )
             vlc_object_release( id->p_encoder );
         }
 
+        free( id->pp_rendition_ids );
+        vlc_mutex_destroy(&id->lock_out);
         vlc_mutex_destroy(&id->fifo.lock);
         free( id );
     }
@@ -492,6 +572,7 @@ static sout_stream_id_sys_t *Add( sout_stream_t *p_stream,
         goto error;
 
     vlc_mutex_init(&id->fifo.lock);
+    vlc_mutex_init(&id->lock_out);
     id->id = NULL;
     id->p_decoder = NULL;
     id->p_encoder = NULL;
@@ -544,6 +625,23 @@ static sout_stream_id_sys_t *Add( sout_stream_t *p_stream,
     if(!success)
         goto error;
 
+    /* The other ES are copied as they are in every rendition, the video is
+     * added to them when its encoders are opened */
+    if( id->id != NULL && p_sys->i_renditions > 0 )
+    {
+        id->pp_rendition_ids = calloc( p_sys->i_renditions, sizeof( void * ) );
+        if( unlikely(id->pp_rendition_ids == NULL) )
+        {
+            Del( p_stream, id );
+            return NULL;
+        }
+        for( int i = 0; i < p_sys->i_renditions; i++ )
+            id->pp_rendition_ids[i] =
+                sout_StreamIdAdd( p_sys->pp_renditions[i]->p_stream,
+                                  id->b_transcode ? &id->p_encoder->fmt_out
+                                                  : p_fmt );
+    }
+
     return id;
 
 error:
@@ -553,6 +651,8 @@ error:
 
 static void Del( sout_stream_t *p_stream, sout_stream_id_sys_t *id )
 {
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+
     if( id->b_transcode )
     {
         switch( id->p_decoder->fmt_in.i_cat )
@@ -574,10 +674,53 @@ static void Del( sout_stream_t *p_stream, sout_stream_id_sys_t *id )
     }
 
     if( id->id ) sout_StreamIdDel( p_stream->p_next, id->id );
+    for( int i = 0; id->pp_rendition_ids && i < p_sys->i_renditions; i++ )
+        if( id->pp_rendition_ids[i] )
+            sout_StreamIdDel( p_sys->pp_renditions[i]->p_stream,
+                              id->pp_rendition_ids[i] );
 
     DeleteSoutStreamID( id );
 }
 
+/* Sends the output to the renditions too, sharing the payloads */
+static void SendRenditions( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
+                            block_t **pp_out )
+{
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+
+    if( id->pp_rendition_ids == NULL )
+        return;
+
+    for( block_t **pp = pp_out; *pp != NULL; )
+    {
+        block_t *p_next = (*pp)->p_next;
+
+        *pp = block_Shared( *pp );
+        if( unlikely(*pp == NULL) )
+            *pp = p_next;
+        else
+            pp = &(*pp)->p_next;
+    }
+
+    for( int i = 0; i < p_sys->i_renditions; i++ )
+    {
+        block_t *p_copy = NULL;
+        block_t **pp_last = &p_copy;
+
+        if( id->pp_rendition_ids[i] == NULL )
+            continue;
+        for( block_t *p_block = *pp_out; p_block; p_block = p_block->p_next )
+        {
+            block_t *p_share = block_Share( p_block );
+            if( p_share )
+                block_ChainLastAppend( &pp_last, p_share );
+        }
+        if( p_copy )
+            sout_StreamIdSend( p_sys->pp_renditions[i]->p_stream,
+                               id->pp_rendition_ids[i], p_copy );
+    }
+}
+
 static int Send( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
                  block_t *p_buffer )
 {
@@ -586,7 +729,12 @@ static int Send( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
     if( !id->b_transcode )
     {
         if( id->id )
+        {
+            SendRenditions( p_stream, id, &p_buffer );
+            if( p_buffer == NULL )
+                return VLC_ENOMEM;
             return sout_StreamIdSend( p_stream->p_next, id->id, p_buffer );
+        }
 
         block_Release( p_buffer );
         return VLC_EGENERIC;
@@ -625,6 +773,11 @@ static int Send( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
     }
 
     if( p_out )
+    {
+        SendRenditions( p_stream, id, &p_out );
+        if( p_out == NULL )
+            return VLC_ENOMEM;
         return sout_StreamIdSend( p_stream->p_next, id->id, p_out );
+    }
     return VLC_SUCCESS;
 }
@@ -9,22 +9,35 @@
 #include <vlc_es.h>
 #include <vlc_codec.h>
 
-#include <vlc_picture_fifo.h>
-
 /*100ms is around the limit where people are noticing lipsync issues*/
 #define MASTER_SYNC_MAX_DRIFT 100000
 
+typedef struct transcode_stage_t transcode_stage_t;
+
+/* Rendition of an ABR ladder: the video is decoded once, then scaled and
+ * encoded again for each rendition, which has its own output chain */
+typedef struct
+{
+    unsigned int    i_width, i_height; /**< 0 to keep the aspect ratio */
+    int             i_vbitrate;
+    sout_stream_t   *p_stream;
+    sout_stream_t   *p_last;
+} transcode_rendition_t;
+
+/* Encoder of a rendition for a video ES */
+typedef struct
+{
+    encoder_t       *p_encoder;
+    filter_chain_t  *p_f_chain; /**< Scaler from the previous rendition */
+    void            *id; /**< id in the rendition chain */
+    block_t         *p_buffers; /**< Encoded, protected by lock_out */
+    transcode_stage_t *p_stage; /**< Scaler and encoder, with threads */
+    sout_stream_id_sys_t *p_es; /**< Video ES of the ladder */
+} transcode_rung_t;
+
 struct sout_stream_sys_t
 {
-    sout_stream_id_sys_t *id_video;
-    block_t         *p_buffers;
-    vlc_mutex_t     lock_out;
-    vlc_cond_t      cond;
-    bool            b_abort;
-    picture_fifo_t *pp_pics;
-    vlc_sem_t       picture_pool_has_room;
     uint32_t        pool_size;
-    vlc_thread_t    thread;
 
     /* Audio */
     vlc_fourcc_t    i_acodec;   /* codec audio (0 if not transcode) */
@@ -54,13 +67,17 @@ struct sout_stream_sys_t
 
     char            *psz_vf2;
 
+    /* ABR ladder, from the largest rendition to the smallest */
+    int             i_renditions;
+    transcode_rendition_t **pp_renditions;
+
     /* SPU */
     vlc_fourcc_t    i_scodec;   /* codec spu (0 if not transcode) */
     char            *psz_senc;
     bool            b_soverlay;
     config_chain_t  *p_spu_cfg;
+    vlc_mutex_t     spu_lock; /**< Protects p_spu from the filter stages */
     spu_t           *p_spu;
-    filter_t        *p_spu_blend;
 
     /* Sync */
     bool            b_master_sync;
@@ -106,6 +123,7 @@ struct sout_stream_id_sys_t
          {
              filter_chain_t  *p_f_chain; /**< Video filters */
              filter_chain_t  *p_uf_chain; /**< User-specified video filters */
+             filter_t        *p_spu_blend; /**< Subpicture overlay */
              video_format_t  fmt_input_video;
          };
          struct
@@ -119,12 +137,44 @@ struct sout_stream_id_sys_t
     /* Encoder */
     encoder_t       *p_encoder;
 
+    /* Pipeline, when threads are enabled */
+    transcode_stage_t *p_filter_stage; /**< Video filters and overlays */
+    transcode_stage_t *p_encoder_stage;
+    vlc_mutex_t     lock_out;
+    block_t         *p_buffers; /**< Encoded by the encoder stage */
+
+    /* ABR ladder */
+    void            **pp_rendition_ids; /**< Copies of the output */
+    int             i_rungs;
+    transcode_rung_t *p_rungs; /**< Encoded renditions of the video */
+
     /* Sync */
     date_t          next_input_pts; /**< Incoming calculated PTS */
     date_t          next_output_pts; /**< output calculated PTS */
 
 };
 
+/* PIPELINE */
+
+/**
+ * Creates a pipeline stage: a thread processing the items of a bounded queue
+ * in order.
+ *
+ * pf_release is called for the items which were not processed when the stage
+ * is deleted.
+ */
+transcode_stage_t *transcode_stage_New( vlc_object_t *, const char *psz_name,
+                                        unsigned i_depth, int i_priority,
+                                        void (*pf_process)( void *, void * ),
+                                        void (*pf_release)( void * ),
+                                        void *opaque );
+/** Queues an item, waiting while the queue is full */
+void transcode_stage_Push( transcode_stage_t *, void *item );
+/** Waits until all the queued items are processed */
+void transcode_stage_Drain( transcode_stage_t * );
+/** Stops the stage and logs its statistics */
+void transcode_stage_Delete( transcode_stage_t * );
+
 /* SPU */
 
 void transcode_spu_close  ( sout_stream_t *, sout_stream_id_sys_t * );
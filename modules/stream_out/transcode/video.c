@@ -97,58 +97,80 @@ static picture_t *transcode_video_filter_buffer_new( filter_t *p_filter )
     return picture_NewFromFormat( &p_filter->fmt_out.video );
 }
 
-static void* EncoderThread( void *obj )
+static void FilterStage( void *, void * );
+
+static void ReleasePicture( void *item )
 {
-    sout_stream_sys_t *p_sys = (sout_stream_sys_t*)obj;
-    sout_stream_id_sys_t *id = p_sys->id_video;
-    picture_t *p_pic = NULL;
-    int canc = vlc_savecancel ();
-    block_t *p_block = NULL;
+    picture_Release( item );
+}
+
+/* Scales and encodes a rendition, returns the scaled picture */
+static picture_t *EncodeRendition( sout_stream_id_sys_t *id,
+                                   transcode_rung_t *p_rung, picture_t *p_src )
+{
+    picture_t *p_scaled = filter_chain_VideoFilter( p_rung->p_f_chain, p_src );
+    if( p_scaled == NULL )
+        return NULL;
+
+    block_t *p_block = p_rung->p_encoder->pf_encode_video( p_rung->p_encoder,
+                                                           p_scaled );
+    vlc_mutex_lock( &id->lock_out );
+    block_ChainAppend( &p_rung->p_buffers, p_block );
+    vlc_mutex_unlock( &id->lock_out );
+    return p_scaled;
+}
 
-    vlc_mutex_lock( &p_sys->lock_out );
+/* Scales the picture down the ladder from the i_first-th rendition, each
+ * rendition from the previous one, and encodes the renditions. A rendition
+ * with its own stage takes over the rest of the ladder on its thread. */
+static void EncodeRenditions( sout_stream_id_sys_t *id, int i_first,
+                              picture_t *p_pic )
+{
+    picture_t *p_src = picture_Hold( p_pic );
 
-    for( ;; )
+    for( int i = i_first; i < id->i_rungs && p_src != NULL; i++ )
     {
-        while( !p_sys->b_abort &&
-               (p_pic = picture_fifo_Pop( p_sys->pp_pics )) == NULL )
-            vlc_cond_wait( &p_sys->cond, &p_sys->lock_out );
-        vlc_sem_post( &p_sys->picture_pool_has_room );
+        transcode_rung_t *p_rung = &id->p_rungs[i];
 
-        if( p_pic )
+        if( p_rung->id == NULL )
+            continue;
+        if( p_rung->p_stage != NULL )
         {
-            /* release lock while encoding */
-            vlc_mutex_unlock( &p_sys->lock_out );
-            p_block = id->p_encoder->pf_encode_video( id->p_encoder, p_pic );
-            picture_Release( p_pic );
-            vlc_mutex_lock( &p_sys->lock_out );
-
-            block_ChainAppend( &p_sys->p_buffers, p_block );
+            transcode_stage_Push( p_rung->p_stage, p_src );
+            return;
         }
 
-        if( p_sys->b_abort )
-            break;
+        p_src = EncodeRendition( id, p_rung, p_src );
     }
+    if( p_src != NULL )
+        picture_Release( p_src );
+}
+
+static void RenditionStage( void *opaque, void *item )
+{
+    transcode_rung_t *p_rung = opaque;
+    sout_stream_id_sys_t *id = p_rung->p_es;
 
-    /*Encode what we have in the buffer on closing*/
-    while( (p_pic = picture_fifo_Pop( p_sys->pp_pics )) != NULL )
+    picture_t *p_scaled = EncodeRendition( id, p_rung, item );
+    if( p_scaled != NULL )
     {
-        vlc_sem_post( &p_sys->picture_pool_has_room );
-        p_block = id->p_encoder->pf_encode_video( id->p_encoder, p_pic );
-        picture_Release( p_pic );
-        block_ChainAppend( &p_sys->p_buffers, p_block );
+        EncodeRenditions( id, p_rung - id->p_rungs + 1, p_scaled );
+        picture_Release( p_scaled );
     }
+}
 
-    /*Now flush encoder*/
-    do {
-        p_block = id->p_encoder->pf_encode_video(id->p_encoder, NULL );
-        block_ChainAppend( &p_sys->p_buffers, p_block );
-    } while( p_block );
-
-    vlc_mutex_unlock( &p_sys->lock_out );
+static void EncoderStage( void *opaque, void *item )
+{
+    sout_stream_id_sys_t *id = opaque;
+    picture_t *p_pic = item;
 
-    vlc_restorecancel (canc);
+    block_t *p_block = id->p_encoder->pf_encode_video( id->p_encoder, p_pic );
+    EncodeRenditions( id, 0, p_pic );
+    picture_Release( p_pic );
 
-    return NULL;
+    vlc_mutex_lock( &id->lock_out );
+    block_ChainAppend( &id->p_buffers, p_block );
+    vlc_mutex_unlock( &id->lock_out );
 }
 
 static int decoder_queue_video( decoder_t *p_dec, picture_t *p_pic )
@@ -173,6 +195,12 @@ static picture_t *transcode_dequeue_all_pics( sout_stream_id_sys_t *id )
     return p_pics;
 }
 
+static int transcode_video_priority( const sout_stream_sys_t *p_sys )
+{
+    return p_sys->b_high_priority ? VLC_THREAD_PRIORITY_OUTPUT
+                                  : VLC_THREAD_PRIORITY_VIDEO;
+}
+
 static int transcode_video_new( sout_stream_t *p_stream, sout_stream_id_sys_t *id )
 {
     sout_stream_sys_t *p_sys = p_stream->p_sys;
@@ -268,29 +296,25 @@ static int transcode_video_new( sout_stream_t *p_stream, sout_stream_id_sys_t *i
     if( p_sys->i_threads <= 0 )
         return VLC_SUCCESS;
 
-    int i_priority = p_sys->b_high_priority ? VLC_THREAD_PRIORITY_OUTPUT :
-                       VLC_THREAD_PRIORITY_VIDEO;
-    p_sys->id_video = id;
-    p_sys->pp_pics = picture_fifo_New();
-    if( p_sys->pp_pics == NULL )
-    {
-        msg_Err( p_stream, "cannot create picture fifo" );
-        module_unneed( id->p_decoder, id->p_decoder->p_module );
-        id->p_decoder->p_module = NULL;
-        return VLC_ENOMEM;
-    }
-
-    vlc_sem_init( &p_sys->picture_pool_has_room, p_sys->pool_size );
-    vlc_mutex_init( &p_sys->lock_out );
-    vlc_cond_init( &p_sys->cond );
-    p_sys->p_buffers = NULL;
-    p_sys->b_abort = false;
-    if( vlc_clone( &p_sys->thread, EncoderThread, p_sys, i_priority ) )
+    /* Decoding stays on the calling thread, filtering and encoding each get
+     * their own thread, with bounded queues in between. */
+    int i_priority = transcode_video_priority( p_sys );
+    id->p_encoder_stage = transcode_stage_New( VLC_OBJECT( p_stream ),
+                                               "video encoder",
+                                               p_sys->pool_size, i_priority,
+                                               EncoderStage, ReleasePicture,
+                                               id );
+    if( id->p_encoder_stage != NULL )
+        id->p_filter_stage = transcode_stage_New( VLC_OBJECT( p_stream ),
+                                                  "video filters",
+                                                  p_sys->pool_size, i_priority,
+                                                  FilterStage, ReleasePicture,
+                                                  id );
+    if( id->p_filter_stage == NULL )
     {
-        msg_Err( p_stream, "cannot spawn encoder thread" );
-        vlc_mutex_destroy( &p_sys->lock_out );
-        vlc_cond_destroy( &p_sys->cond );
-        picture_fifo_Delete( p_sys->pp_pics );
+        if( id->p_encoder_stage != NULL )
+            transcode_stage_Delete( id->p_encoder_stage );
+        id->p_encoder_stage = NULL;
         module_unneed( id->p_decoder, id->p_decoder->p_module );
         id->p_decoder->p_module = NULL;
         return VLC_EGENERIC;
@@ -645,27 +669,256 @@ static int transcode_video_encoder_open( sout_stream_t *p_stream,
     return VLC_SUCCESS;
 }
 
-void transcode_video_close( sout_stream_t *p_stream,
-                                   sout_stream_id_sys_t *id )
+/* Takes care of the scaling and chroma conversions of a rendition, as
+ * conversion_video_filter_append() does for the main encoder */
+static int transcode_video_rung_convert( transcode_rung_t *p_rung )
 {
-    if( p_stream->p_sys->i_threads >= 1 && !p_stream->p_sys->b_abort )
+    const es_format_t *p_fmt_out = filter_chain_GetFmtOut( p_rung->p_f_chain );
+    const es_format_t *p_fmt_in = &p_rung->p_encoder->fmt_in;
+
+    if( p_fmt_out->video.i_chroma != p_fmt_in->video.i_chroma ||
+        p_fmt_out->video.i_width != p_fmt_in->video.i_width ||
+        p_fmt_out->video.i_height != p_fmt_in->video.i_height )
+        return filter_chain_AppendConverter( p_rung->p_f_chain, p_fmt_out,
+                                             p_fmt_in );
+    return VLC_SUCCESS;
+}
+
+/* Sizes a rendition from its source, the previous rendition of the ladder,
+ * and creates the scaler between them. */
+static int transcode_video_rung_init( sout_stream_t *p_stream,
+                                      transcode_rung_t *p_rung,
+                                      const transcode_rendition_t *p_rend,
+                                      const es_format_t *p_src )
+{
+    filter_owner_t owner = {
+        .sys = p_stream->p_sys,
+        .video = {
+            .buffer_new = transcode_video_filter_buffer_new,
+        },
+    };
+    encoder_t *p_enc = p_rung->p_encoder;
+    unsigned i_src_width = p_src->video.i_visible_width;
+    unsigned i_src_height = p_src->video.i_visible_height;
+    unsigned i_width = p_rend->i_width;
+    unsigned i_height = p_rend->i_height;
+
+    if( i_src_width == 0 || i_src_height == 0 )
+        return VLC_EGENERIC;
+
+    /* Keep the aspect ratio of the pixels unless both sizes are given */
+    if( i_width == 0 && i_height == 0 )
     {
-        vlc_mutex_lock( &p_stream->p_sys->lock_out );
-        p_stream->p_sys->b_abort = true;
-        vlc_cond_signal( &p_stream->p_sys->cond );
-        vlc_mutex_unlock( &p_stream->p_sys->lock_out );
+        i_width = i_src_width;
+        i_height = i_src_height;
+    }
+    else if( i_height == 0 )
+        i_height = (uint64_t)i_src_height * i_width / i_src_width;
+    else if( i_width == 0 )
+        i_width = (uint64_t)i_src_width * i_height / i_src_height;
+    i_width = __MAX( 2, i_width & ~1 );
+    i_height = __MAX( 2, i_height & ~1 );
+
+    /* An opened encoder keeps the chroma it asked for */
+    const vlc_fourcc_t i_chroma = p_enc->p_module ? p_enc->fmt_in.i_codec
+                                                  : p_src->i_codec;
+
+    es_format_Clean( &p_enc->fmt_in );
+    es_format_Copy( &p_enc->fmt_in, p_src );
+    p_enc->fmt_in.i_codec = p_enc->fmt_in.video.i_chroma = i_chroma;
+    p_enc->fmt_in.video.i_width = p_enc->fmt_in.video.i_visible_width = i_width;
+    p_enc->fmt_in.video.i_height = p_enc->fmt_in.video.i_visible_height = i_height;
+    p_enc->fmt_in.video.i_x_offset = p_enc->fmt_in.video.i_y_offset = 0;
+    vlc_ureduce( &p_enc->fmt_in.video.i_sar_num, &p_enc->fmt_in.video.i_sar_den,
+                 (uint64_t)p_src->video.i_sar_num * i_src_width * i_height,
+                 (uint64_t)p_src->video.i_sar_den * i_src_height * i_width, 0 );
+
+    p_enc->fmt_out.video.i_width = p_enc->fmt_out.video.i_visible_width = i_width;
+    p_enc->fmt_out.video.i_height = p_enc->fmt_out.video.i_visible_height = i_height;
+    p_enc->fmt_out.video.i_sar_num = p_enc->fmt_in.video.i_sar_num;
+    p_enc->fmt_out.video.i_sar_den = p_enc->fmt_in.video.i_sar_den;
+    p_enc->fmt_out.video.i_frame_rate = p_enc->fmt_in.video.i_frame_rate;
+    p_enc->fmt_out.video.i_frame_rate_base = p_enc->fmt_in.video.i_frame_rate_base;
+    p_enc->fmt_out.video.orientation = p_enc->fmt_in.video.orientation;
+
+    msg_Dbg( p_stream, "rendition %ux%u from %ux%u", i_width, i_height,
+             i_src_width, i_src_height );
+
+    if( p_rung->p_f_chain )
+        filter_chain_Delete( p_rung->p_f_chain );
+    p_rung->p_f_chain = filter_chain_NewVideo( p_stream, false, &owner );
+    if( unlikely(p_rung->p_f_chain == NULL) )
+        return VLC_ENOMEM;
+    filter_chain_Reset( p_rung->p_f_chain, p_src, p_src );
+
+    return transcode_video_rung_convert( p_rung );
+}
+
+static void transcode_video_rung_close( const transcode_rendition_t *p_rend,
+                                        transcode_rung_t *p_rung )
+{
+    if( p_rung->p_stage )
+        transcode_stage_Delete( p_rung->p_stage );
+    p_rung->p_stage = NULL;
+
+    if( p_rung->id )
+        sout_StreamIdDel( p_rend->p_stream, p_rung->id );
+    p_rung->id = NULL;
+    block_ChainRelease( p_rung->p_buffers );
+    p_rung->p_buffers = NULL;
 
-        vlc_join( p_stream->p_sys->thread, NULL );
+    if( p_rung->p_f_chain )
+        filter_chain_Delete( p_rung->p_f_chain );
+    p_rung->p_f_chain = NULL;
 
-        picture_fifo_Delete( p_stream->p_sys->pp_pics );
-        block_ChainRelease( p_stream->p_sys->p_buffers );
+    if( p_rung->p_encoder )
+    {
+        if( p_rung->p_encoder->p_module )
+            module_unneed( p_rung->p_encoder, p_rung->p_encoder->p_module );
+        es_format_Clean( &p_rung->p_encoder->fmt_in );
+        es_format_Clean( &p_rung->p_encoder->fmt_out );
+        vlc_object_release( p_rung->p_encoder );
     }
+    p_rung->p_encoder = NULL;
+}
+
+/* Opens the encoders of the renditions, once the main one is opened. A
+ * rendition which cannot be encoded is left out of the ladder. */
+static void transcode_video_rungs_open( sout_stream_t *p_stream,
+                                        sout_stream_id_sys_t *id )
+{
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+    const es_format_t *p_src = &id->p_encoder->fmt_in;
 
-    if( p_stream->p_sys->i_threads >= 1 )
+    if( p_sys->i_renditions == 0 )
+        return;
+
+    id->p_rungs = calloc( p_sys->i_renditions, sizeof( *id->p_rungs ) );
+    if( unlikely(id->p_rungs == NULL) )
+        return;
+    id->i_rungs = p_sys->i_renditions;
+
+    for( int i = 0; i < id->i_rungs; i++ )
     {
-        vlc_mutex_destroy( &p_stream->p_sys->lock_out );
-        vlc_cond_destroy( &p_stream->p_sys->cond );
+        const transcode_rendition_t *p_rend = p_sys->pp_renditions[i];
+        transcode_rung_t *p_rung = &id->p_rungs[i];
+        encoder_t *p_enc = sout_EncoderCreate( p_stream );
+
+        if( unlikely(p_enc == NULL) )
+            continue;
+        p_enc->p_module = NULL;
+        es_format_Init( &p_enc->fmt_in, VIDEO_ES, 0 );
+        es_format_Init( &p_enc->fmt_out, VIDEO_ES, p_sys->i_vcodec );
+        p_enc->fmt_out.i_id    = id->p_encoder->fmt_out.i_id;
+        p_enc->fmt_out.i_group = id->p_encoder->fmt_out.i_group;
+        p_enc->fmt_out.i_bitrate = p_rend->i_vbitrate ? p_rend->i_vbitrate
+                                                      : p_sys->i_vbitrate;
+        p_enc->i_threads = p_sys->i_threads;
+        p_enc->p_cfg = p_sys->p_video_cfg;
+        p_rung->p_encoder = p_enc;
+
+        if( transcode_video_rung_init( p_stream, p_rung, p_rend, p_src ) )
+        {
+            msg_Err( p_stream, "cannot scale rendition %d", i );
+            transcode_video_rung_close( p_rend, p_rung );
+            continue;
+        }
+
+        p_enc->p_module = module_need( p_enc, "encoder", p_sys->psz_venc, true );
+        if( p_enc->p_module )
+        {
+            /* The encoder may have asked for another chroma */
+            p_enc->fmt_in.video.i_chroma = p_enc->fmt_in.i_codec;
+            p_enc->fmt_out.i_codec =
+                vlc_fourcc_GetCodec( VIDEO_ES, p_enc->fmt_out.i_codec );
+            if( transcode_video_rung_convert( p_rung ) == VLC_SUCCESS )
+                p_rung->id = sout_StreamIdAdd( p_rend->p_stream,
+                                               &p_enc->fmt_out );
+        }
+        if( p_rung->id == NULL )
+        {
+            msg_Err( p_stream, "cannot encode rendition %d", i );
+            transcode_video_rung_close( p_rend, p_rung );
+            continue;
+        }
+        p_src = &p_enc->fmt_in;
+
+        /* Each rendition is scaled and encoded on its own thread, fed by the
+         * main encoder stage or by the previous rendition */
+        if( id->p_encoder_stage != NULL )
+        {
+            p_rung->p_es = id;
+            p_rung->p_stage = transcode_stage_New( VLC_OBJECT( p_stream ),
+                                                   "video rendition",
+                                                   p_sys->pool_size,
+                                                   transcode_video_priority( p_sys ),
+                                                   RenditionStage,
+                                                   ReleasePicture, p_rung );
+            if( p_rung->p_stage == NULL )
+                msg_Warn( p_stream, "rendition %d encoded synchronously", i );
+        }
     }
+}
+
+/* Follows a change of the main encoder input down the ladder */
+static void transcode_video_rungs_init( sout_stream_t *p_stream,
+                                        sout_stream_id_sys_t *id )
+{
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+    const es_format_t *p_src = &id->p_encoder->fmt_in;
+
+    for( int i = 0; i < id->i_rungs; i++ )
+    {
+        transcode_rung_t *p_rung = &id->p_rungs[i];
+
+        if( p_rung->id == NULL )
+            continue;
+        if( transcode_video_rung_init( p_stream, p_rung,
+                                       p_sys->pp_renditions[i], p_src ) )
+        {
+            msg_Err( p_stream, "cannot scale rendition %d", i );
+            transcode_video_rung_close( p_sys->pp_renditions[i], p_rung );
+            continue;
+        }
+        p_src = &p_rung->p_encoder->fmt_in;
+    }
+}
+
+/* Sends the encoded renditions to their chains */
+static void transcode_video_send_renditions( sout_stream_t *p_stream,
+                                             sout_stream_id_sys_t *id )
+{
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+
+    for( int i = 0; i < id->i_rungs; i++ )
+    {
+        transcode_rung_t *p_rung = &id->p_rungs[i];
+
+        vlc_mutex_lock( &id->lock_out );
+        block_t *p_out = p_rung->p_buffers;
+        p_rung->p_buffers = NULL;
+        vlc_mutex_unlock( &id->lock_out );
+
+        if( p_out )
+            sout_StreamIdSend( p_sys->pp_renditions[i]->p_stream,
+                               p_rung->id, p_out );
+    }
+}
+
+void transcode_video_close( sout_stream_t *p_stream,
+                                   sout_stream_id_sys_t *id )
+{
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+
+    /* Stop the pipeline, the filter stage feeds the encoder stage */
+    if( id->p_filter_stage )
+        transcode_stage_Delete( id->p_filter_stage );
+    id->p_filter_stage = NULL;
+    if( id->p_encoder_stage )
+        transcode_stage_Delete( id->p_encoder_stage );
+    id->p_encoder_stage = NULL;
+    block_ChainRelease( id->p_buffers );
+    id->p_buffers = NULL;
 
     /* Close decoder */
     if( id->p_decoder->p_module )
@@ -677,11 +930,19 @@ void transcode_video_close( sout_stream_t *p_stream,
     if( id->p_encoder->p_module )
         module_unneed( id->p_encoder, id->p_encoder->p_module );
 
+    for( int i = 0; i < id->i_rungs; i++ )
+        transcode_video_rung_close( p_sys->pp_renditions[i], &id->p_rungs[i] );
+    free( id->p_rungs );
+    id->p_rungs = NULL;
+    id->i_rungs = 0;
+
     /* Close filters */
     if( id->p_f_chain )
         filter_chain_Delete( id->p_f_chain );
     if( id->p_uf_chain )
         filter_chain_Delete( id->p_uf_chain );
+    if( id->p_spu_blend )
+        filter_DeleteBlend( id->p_spu_blend );
 }
 
 static void OutputFrame( sout_stream_t *p_stream, picture_t *p_pic, sout_stream_id_sys_t *id, block_t **out )
@@ -691,64 +952,122 @@ static void OutputFrame( sout_stream_t *p_stream, picture_t *p_pic, sout_stream_
     /*
      * Encoding
      */
-    /* Check if we have a subpicture to overlay */
-    if( p_sys->p_spu )
+    /* Check if we have a subpicture to overlay. This runs on the filter
+     * stage when threads are enabled, while the SPU ES is added and deleted
+     * by the stream output. */
+    video_format_t fmt = id->p_encoder->fmt_in.video;
+    if( fmt.i_visible_width <= 0 || fmt.i_visible_height <= 0 )
     {
-        video_format_t fmt = id->p_encoder->fmt_in.video;
-        if( fmt.i_visible_width <= 0 || fmt.i_visible_height <= 0 )
-        {
-            fmt.i_visible_width  = fmt.i_width;
-            fmt.i_visible_height = fmt.i_height;
-            fmt.i_x_offset       = 0;
-            fmt.i_y_offset       = 0;
-        }
+        fmt.i_visible_width  = fmt.i_width;
+        fmt.i_visible_height = fmt.i_height;
+        fmt.i_x_offset       = 0;
+        fmt.i_y_offset       = 0;
+    }
 
-        subpicture_t *p_subpic = spu_Render( p_sys->p_spu, NULL, &fmt,
-                                             &id->p_decoder->fmt_out.video,
-                                             p_pic->date, p_pic->date, false );
+    subpicture_t *p_subpic = NULL;
+    vlc_mutex_lock( &p_sys->spu_lock );
+    if( p_sys->p_spu )
+        p_subpic = spu_Render( p_sys->p_spu, NULL, &fmt,
+                               &id->fmt_input_video,
+                               p_pic->date, p_pic->date, false );
+    vlc_mutex_unlock( &p_sys->spu_lock );
 
-        /* Overlay subpicture */
-        if( p_subpic )
+    /* Overlay subpicture */
+    if( p_subpic )
+    {
+        if( picture_IsReferenced( p_pic ) && filter_chain_IsEmpty( id->p_f_chain ) )
         {
-            if( picture_IsReferenced( p_pic ) && filter_chain_IsEmpty( id->p_f_chain ) )
+            /* We can't modify the picture, we need to duplicate it,
+             * in this point the picture is already p_encoder->fmt.in format*/
+            picture_t *p_tmp = video_new_buffer_encoder( id->p_encoder );
+            if( likely( p_tmp ) )
             {
-                /* We can't modify the picture, we need to duplicate it,
-                 * in this point the picture is already p_encoder->fmt.in format*/
-                picture_t *p_tmp = video_new_buffer_encoder( id->p_encoder );
-                if( likely( p_tmp ) )
-                {
-                    picture_Copy( p_tmp, p_pic );
-                    picture_Release( p_pic );
-                    p_pic = p_tmp;
-                }
+                picture_Copy( p_tmp, p_pic );
+                picture_Release( p_pic );
+                p_pic = p_tmp;
             }
-            if( unlikely( !p_sys->p_spu_blend ) )
-                p_sys->p_spu_blend = filter_NewBlend( VLC_OBJECT( p_sys->p_spu ), &fmt );
-            if( likely( p_sys->p_spu_blend ) )
-                picture_BlendSubpicture( p_pic, p_sys->p_spu_blend, p_subpic );
-            subpicture_Delete( p_subpic );
         }
+        if( unlikely( !id->p_spu_blend ) )
+            id->p_spu_blend = filter_NewBlend( VLC_OBJECT( p_stream ), &fmt );
+        if( likely( id->p_spu_blend ) )
+            picture_BlendSubpicture( p_pic, id->p_spu_blend, p_subpic );
+        subpicture_Delete( p_subpic );
     }
 
-    if( p_sys->i_threads == 0 )
+    if( id->p_encoder_stage != NULL )
+        transcode_stage_Push( id->p_encoder_stage, p_pic );
+    else
     {
         block_t *p_block;
 
         p_block = id->p_encoder->pf_encode_video( id->p_encoder, p_pic );
         block_ChainAppend( out, p_block );
+        EncodeRenditions( id, 0, p_pic );
+        picture_Release( p_pic );
     }
+}
 
-    if( p_sys->i_threads )
-    {
-        vlc_sem_wait( &p_sys->picture_pool_has_room );
-        vlc_mutex_lock( &p_sys->lock_out );
-        picture_fifo_Push( p_sys->pp_pics, p_pic );
-        vlc_cond_signal( &p_sys->cond );
-        vlc_mutex_unlock( &p_sys->lock_out );
+/* Run the filter and output chains; first with the picture,
+ * and then with NULL as many times as we need until they
+ * stop outputting frames.
+ */
+static void transcode_video_filter( sout_stream_t *p_stream,
+                                    sout_stream_id_sys_t *id,
+                                    picture_t *p_pic, block_t **out )
+{
+    for ( ;; ) {
+        picture_t *p_filtered_pic = p_pic;
+
+        /* Run filter chain */
+        if( id->p_f_chain )
+            p_filtered_pic = filter_chain_VideoFilter( id->p_f_chain, p_filtered_pic );
+        if( !p_filtered_pic )
+            break;
+
+        for ( ;; ) {
+            picture_t *p_user_filtered_pic = p_filtered_pic;
+
+            /* Run user specified filter chain */
+            if( id->p_uf_chain )
+                p_user_filtered_pic = filter_chain_VideoFilter( id->p_uf_chain, p_user_filtered_pic );
+            if( !p_user_filtered_pic )
+                break;
+
+            OutputFrame( p_stream, p_user_filtered_pic, id, out );
+
+            p_filtered_pic = NULL;
+        }
+
+        p_pic = NULL;
     }
+}
 
-    if ( p_sys->i_threads == 0 )
-        picture_Release( p_pic );
+static void FilterStage( void *opaque, void *item )
+{
+    sout_stream_id_sys_t *id = opaque;
+    sout_stream_t *p_stream = (sout_stream_t *)id->p_decoder->p_owner;
+
+    /* Filtered pictures go to the encoder stage */
+    transcode_video_filter( p_stream, id, item, NULL );
+}
+
+/* Waits for the pictures in the pipeline to be encoded, and picks up the
+ * encoded blocks. */
+static void transcode_video_drain( sout_stream_id_sys_t *id, block_t **out )
+{
+    if( id->p_encoder_stage == NULL )
+        return;
+
+    transcode_stage_Drain( id->p_filter_stage );
+    transcode_stage_Drain( id->p_encoder_stage );
+    for( int i = 0; i < id->i_rungs; i++ )
+        if( id->p_rungs[i].p_stage != NULL )
+            transcode_stage_Drain( id->p_rungs[i].p_stage );
+
+    vlc_mutex_lock( &id->lock_out );
+    block_ChainAppend( out, id->p_buffers );
+    id->p_buffers = NULL;
+    vlc_mutex_unlock( &id->lock_out );
 }
 
 int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
@@ -788,6 +1107,9 @@ int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
                         id->fmt_input_video.i_sar_num, id->p_decoder->fmt_out.video.i_sar_num,
                         id->fmt_input_video.i_sar_den, id->p_decoder->fmt_out.video.i_sar_den
                     );
+            /* The filters and the encoder format are about to change */
+            transcode_video_drain( id, out );
+
             /* Close filters */
             if( id->p_f_chain )
                 filter_chain_Delete( id->p_f_chain );
@@ -804,6 +1126,7 @@ int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
             transcode_video_encoder_init( p_stream, id );
             transcode_video_filter_init( p_stream, id );
             conversion_video_filter_append( id );
+            transcode_video_rungs_init( p_stream, id );
             memcpy( &id->fmt_input_video, &id->p_decoder->fmt_out.video, sizeof(video_format_t));
         }
 
@@ -829,80 +1152,55 @@ int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
                 b_error = true;
                 continue;
             }
+            transcode_video_rungs_open( p_stream, id );
         }
 
-        /* Run the filter and output chains; first with the picture,
-         * and then with NULL as many times as we need until they
-         * stop outputting frames.
-         */
-        for ( ;; ) {
-            picture_t *p_filtered_pic = p_pic;
-
-            /* Run filter chain */
-            if( id->p_f_chain )
-                p_filtered_pic = filter_chain_VideoFilter( id->p_f_chain, p_filtered_pic );
-            if( !p_filtered_pic )
-                break;
-
-            for ( ;; ) {
-                picture_t *p_user_filtered_pic = p_filtered_pic;
-
-                /* Run user specified filter chain */
-                if( id->p_uf_chain )
-                    p_user_filtered_pic = filter_chain_VideoFilter( id->p_uf_chain, p_user_filtered_pic );
-                if( !p_user_filtered_pic )
-                    break;
-
-                OutputFrame( p_stream, p_user_filtered_pic, id, out );
-
-                p_filtered_pic = NULL;
-            }
-
-            p_pic = NULL;
-        }
+        if( id->p_filter_stage != NULL )
+            transcode_stage_Push( id->p_filter_stage, p_pic );
+        else
+            transcode_video_filter( p_stream, id, p_pic, out );
     } while( p_pics );
 
-    if( p_sys->i_threads >= 1 )
+    if( id->p_encoder_stage != NULL )
     {
         /* Pick up any return data the encoder thread wants to output. */
-        vlc_mutex_lock( &p_sys->lock_out );
-        *out = p_sys->p_buffers;
-        p_sys->p_buffers = NULL;
-        vlc_mutex_unlock( &p_sys->lock_out );
+        vlc_mutex_lock( &id->lock_out );
+        block_ChainAppend( out, id->p_buffers );
+        id->p_buffers = NULL;
+        vlc_mutex_unlock( &id->lock_out );
     }
 
 end:
-    if( unlikely( in == NULL ) )
+    if( unlikely( in == NULL ) && id->p_encoder->p_module )
     {
-        if( p_sys->i_threads == 0 )
-        {
-            if( id->p_encoder->p_module )
-            {
-                block_t *p_block;
-                do {
-                    p_block = id->p_encoder->pf_encode_video(id->p_encoder, NULL );
-                    block_ChainAppend( out, p_block );
-                } while( p_block );
-            }
-        }
-        else
+        if( id->p_encoder_stage != NULL )
         {
             msg_Dbg( p_stream, "Flushing thread and waiting that");
-            vlc_mutex_lock( &p_stream->p_sys->lock_out );
-            p_stream->p_sys->b_abort = true;
-            vlc_cond_signal( &p_stream->p_sys->cond );
-            vlc_mutex_unlock( &p_stream->p_sys->lock_out );
+            transcode_video_drain( id, out );
+            msg_Dbg( p_stream, "Flushing done");
+        }
 
-            vlc_join( p_stream->p_sys->thread, NULL );
-            vlc_mutex_lock( &p_sys->lock_out );
-            *out = p_sys->p_buffers;
-            p_sys->p_buffers = NULL;
-            vlc_mutex_unlock( &p_sys->lock_out );
+        block_t *p_block;
+        do {
+            p_block = id->p_encoder->pf_encode_video(id->p_encoder, NULL );
+            block_ChainAppend( out, p_block );
+        } while( p_block );
 
-            msg_Dbg( p_stream, "Flushing done");
+        for( int i = 0; i < id->i_rungs; i++ )
+        {
+            encoder_t *p_enc = id->p_rungs[i].p_encoder;
+
+            if( id->p_rungs[i].id == NULL )
+                continue;
+            do {
+                p_block = p_enc->pf_encode_video( p_enc, NULL );
+                block_ChainAppend( &id->p_rungs[i].p_buffers, p_block );
+            } while( p_block );
         }
     }
 
+    transcode_video_send_renditions( p_stream, id );
+
     return b_error ? VLC_EGENERIC : VLC_SUCCESS;
 }
 
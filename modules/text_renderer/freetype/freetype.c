@@ -115,6 +115,13 @@ static void Destroy( vlc_object_t * );
 #define SHADOW_ANGLE_TEXT N_("Shadow angle")
 #define SHADOW_DISTANCE_TEXT N_("Shadow distance")
 
+#define CACHE_SIZE_TEXT N_("Glyph cache size (KiB)")
+#define CACHE_SIZE_LONGTEXT N_("Maximum size of the cache of loaded and " \
+    "rendered glyphs, in kibibytes. 0 disables the cache." )
+#define SHAPING_CACHE_SIZE_TEXT N_("Shaping cache size (KiB)")
+#define SHAPING_CACHE_SIZE_LONGTEXT N_("Maximum size of the cache of shaped " \
+    "runs of text, in kibibytes. 0 disables the cache." )
+
 #define TEXT_DIRECTION_TEXT N_("Text direction")
 #define TEXT_DIRECTION_LONGTEXT N_("Paragraph base direction for the Unicode bi-directional algorithm.")
 
@@ -233,6 +240,13 @@ vlc_module_begin ()
     add_bool( "freetype-yuvp", false, YUVP_TEXT,
               YUVP_LONGTEXT, true )
 
+    add_integer( "freetype-cache-size", 4096, CACHE_SIZE_TEXT,
+                 CACHE_SIZE_LONGTEXT, true )
+#ifdef HAVE_HARFBUZZ
+    add_integer( "freetype-shaping-cache-size", 512, SHAPING_CACHE_SIZE_TEXT,
+                 SHAPING_CACHE_SIZE_LONGTEXT, true )
+#endif
+
 #ifdef HAVE_FRIBIDI
     add_integer_with_range( "freetype-text-direction", 0, 0, 2, TEXT_DIRECTION_TEXT,
                             TEXT_DIRECTION_LONGTEXT, false )
@@ -1202,6 +1216,7 @@ static int Render( filter_t *p_filter, subpicture_region_t *p_region_out,
     }
 
     FreeLines( p_lines );
+    TrimGlyphCaches( p_filter );
 
     free( psz_text );
     FreeStylesArray( pp_styles, i_styles );
@@ -1253,6 +1268,8 @@ static int Create( vlc_object_t *p_this )
 
     p_sys->i_scale = 100;
 
+    InitGlyphCaches( p_filter );
+
     /* default style to apply to uncomplete segmeents styles */
     p_sys->p_default_style = text_style_Create( STYLE_FULLY_SET );
     if(unlikely(!p_sys->p_default_style))
@@ -1371,6 +1388,9 @@ static void Destroy( vlc_object_t *p_this )
     DumpDictionary( p_filter, &p_sys->fallback_map, true, -1 );
 #endif
 
+    /* Cached glyphs, before the faces they are keyed with */
+    FreeGlyphCaches( p_filter );
+
     /* Text styles */
     text_style_Delete( p_sys->p_default_style );
     text_style_Delete( p_sys->p_forced_style );
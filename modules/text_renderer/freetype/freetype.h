@@ -47,6 +47,8 @@
 #include FT_GLYPH_H
 #include FT_STROKER_H
 
+#include "lru.h"
+
 /* Consistency between Freetype versions and platforms */
 #define FT_FLOOR(X)     ((X & -64) >> 6)
 #define FT_CEIL(X)      (((X + 63) & -64) >> 6)
@@ -79,6 +81,9 @@ struct filter_sys_t
     FT_Face        p_face;          /* handle to face object */
     FT_Stroker     p_stroker;       /* handle to path stroker object */
 
+    lru_cache_t   *p_glyph_cache;   /* loaded and rendered glyphs */
+    lru_cache_t   *p_shape_cache;   /* shaped runs of text */
+
     text_style_t  *p_default_style;
     text_style_t  *p_forced_style;  /* Renderer overridings */
 
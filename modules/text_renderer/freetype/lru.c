@@ -0,0 +1,231 @@
+/*****************************************************************************
+ * lru.c : Least recently used cache
+ *****************************************************************************
+ * Copyright (C) 2018 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/** \ingroup freetype_lru
+ * @{
+ * \file
+ * Least recently used cache
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+
+#include "lru.h"
+
+typedef struct lru_entry_t lru_entry_t;
+struct lru_entry_t
+{
+    lru_entry_t *p_hash_next;  /**< next entry in the same bucket */
+    lru_entry_t *p_prev;       /**< more recently used entry */
+    lru_entry_t *p_next;       /**< less recently used entry */
+    void        *p_value;
+    size_t       i_size;
+    uint32_t     i_hash;
+    size_t       i_key;
+    unsigned char key[];
+};
+
+struct lru_cache_t
+{
+    lru_entry_t **pp_buckets;
+    size_t        i_buckets;   /**< power of 2 */
+
+    lru_entry_t  *p_first;     /**< most recently used */
+    lru_entry_t  *p_last;      /**< least recently used */
+
+    size_t        i_max_size;
+    void        (*pf_release)( void * );
+
+    lru_cache_stats_t stats;
+};
+
+/* FNV-1a */
+static uint32_t Hash( const unsigned char *p_key, size_t i_key )
+{
+    uint32_t i_hash = 2166136261u;
+    for( size_t i = 0; i < i_key; i++ )
+        i_hash = ( i_hash ^ p_key[i] ) * 16777619u;
+    return i_hash;
+}
+
+static void Unlink( lru_cache_t *p_cache, lru_entry_t *p_entry )
+{
+    if( p_entry->p_prev )
+        p_entry->p_prev->p_next = p_entry->p_next;
+    else
+        p_cache->p_first = p_entry->p_next;
+    if( p_entry->p_next )
+        p_entry->p_next->p_prev = p_entry->p_prev;
+    else
+        p_cache->p_last = p_entry->p_prev;
+}
+
+static void PushFront( lru_cache_t *p_cache, lru_entry_t *p_entry )
+{
+    p_entry->p_prev = NULL;
+    p_entry->p_next = p_cache->p_first;
+    if( p_cache->p_first )
+        p_cache->p_first->p_prev = p_entry;
+    else
+        p_cache->p_last = p_entry;
+    p_cache->p_first = p_entry;
+}
+
+static void Grow( lru_cache_t *p_cache )
+{
+    size_t i_buckets = p_cache->i_buckets * 2;
+    lru_entry_t **pp_buckets = calloc( i_buckets, sizeof( *pp_buckets ) );
+    if( !pp_buckets )
+        return; /* keep the current table, only longer chains */
+
+    for( size_t i = 0; i < p_cache->i_buckets; i++ )
+    {
+        for( lru_entry_t *p_entry = p_cache->pp_buckets[i]; p_entry; )
+        {
+            lru_entry_t *p_next = p_entry->p_hash_next;
+            lru_entry_t **pp = &pp_buckets[p_entry->i_hash & (i_buckets - 1)];
+            p_entry->p_hash_next = *pp;
+            *pp = p_entry;
+            p_entry = p_next;
+        }
+    }
+    free( p_cache->pp_buckets );
+    p_cache->pp_buckets = pp_buckets;
+    p_cache->i_buckets = i_buckets;
+}
+
+lru_cache_t *LRUCache_New( size_t i_max_size, void (*pf_release)( void * ) )
+{
+    lru_cache_t *p_cache = calloc( 1, sizeof( *p_cache ) );
+    if( !p_cache )
+        return NULL;
+
+    p_cache->i_buckets = 64;
+    p_cache->pp_buckets = calloc( p_cache->i_buckets,
+                                  sizeof( *p_cache->pp_buckets ) );
+    if( !p_cache->pp_buckets )
+    {
+        free( p_cache );
+        return NULL;
+    }
+    p_cache->i_max_size = i_max_size;
+    p_cache->pf_release = pf_release;
+    return p_cache;
+}
+
+void LRUCache_Delete( lru_cache_t *p_cache )
+{
+    for( lru_entry_t *p_entry = p_cache->p_first; p_entry; )
+    {
+        lru_entry_t *p_next = p_entry->p_next;
+        p_cache->pf_release( p_entry->p_value );
+        free( p_entry );
+        p_entry = p_next;
+    }
+    free( p_cache->pp_buckets );
+    free( p_cache );
+}
+
+void *LRUCache_Get( lru_cache_t *p_cache, const void *p_key, size_t i_key )
+{
+    const uint32_t i_hash = Hash( p_key, i_key );
+
+    for( lru_entry_t *p_entry =
+             p_cache->pp_buckets[i_hash & (p_cache->i_buckets - 1)];
+         p_entry; p_entry = p_entry->p_hash_next )
+    {
+        if( p_entry->i_hash == i_hash && p_entry->i_key == i_key
+         && !memcmp( p_entry->key, p_key, i_key ) )
+        {
+            if( p_cache->p_first != p_entry )
+            {
+                Unlink( p_cache, p_entry );
+                PushFront( p_cache, p_entry );
+            }
+            p_cache->stats.i_hits++;
+            return p_entry->p_value;
+        }
+    }
+
+    p_cache->stats.i_misses++;
+    return NULL;
+}
+
+int LRUCache_Put( lru_cache_t *p_cache, const void *p_key, size_t i_key,
+                  void *p_value, size_t i_size )
+{
+    lru_entry_t *p_entry = malloc( sizeof( *p_entry ) + i_key );
+    if( !p_entry )
+    {
+        p_cache->pf_release( p_value );
+        return VLC_ENOMEM;
+    }
+
+    p_entry->p_value = p_value;
+    p_entry->i_size = i_size + sizeof( *p_entry ) + i_key;
+    p_entry->i_hash = Hash( p_key, i_key );
+    p_entry->i_key = i_key;
+    memcpy( p_entry->key, p_key, i_key );
+
+    if( p_cache->stats.i_entries >= p_cache->i_buckets )
+        Grow( p_cache );
+
+    lru_entry_t **pp =
+        &p_cache->pp_buckets[p_entry->i_hash & (p_cache->i_buckets - 1)];
+    p_entry->p_hash_next = *pp;
+    *pp = p_entry;
+    PushFront( p_cache, p_entry );
+
+    p_cache->stats.i_entries++;
+    p_cache->stats.i_size += p_entry->i_size;
+    return VLC_SUCCESS;
+}
+
+void LRUCache_Trim( lru_cache_t *p_cache )
+{
+    while( p_cache->stats.i_size > p_cache->i_max_size && p_cache->p_last )
+    {
+        lru_entry_t *p_entry = p_cache->p_last;
+
+        lru_entry_t **pp =
+            &p_cache->pp_buckets[p_entry->i_hash & (p_cache->i_buckets - 1)];
+        while( *pp != p_entry )
+            pp = &(*pp)->p_hash_next;
+        *pp = p_entry->p_hash_next;
+        Unlink( p_cache, p_entry );
+
+        p_cache->stats.i_entries--;
+        p_cache->stats.i_size -= p_entry->i_size;
+        p_cache->stats.i_evictions++;
+
+        p_cache->pf_release( p_entry->p_value );
+        free( p_entry );
+    }
+}
+
+void LRUCache_GetStats( const lru_cache_t *p_cache, lru_cache_stats_t *p_stats )
+{
+    *p_stats = p_cache->stats;
+}
+
+/** @} */
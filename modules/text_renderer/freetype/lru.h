@@ -0,0 +1,94 @@
+/*****************************************************************************
+ * lru.h : Least recently used cache
+ *****************************************************************************
+ * Copyright (C) 2018 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef LRU_H
+#define LRU_H
+
+/** \defgroup freetype_lru LRU cache
+ * \ingroup freetype
+ * Caches the results of glyph loading, rendering and shaping
+ * @{
+ * \file
+ * Least recently used cache
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Maps keys, which are arbitrary byte strings, to values owned by the cache.
+ * Each value is accounted with a size, and the least recently used values
+ * are released when the total size exceeds the limit.
+ *
+ * Eviction only happens in LRUCache_Trim(), so the values returned by
+ * LRUCache_Get() remain valid until then.
+ */
+typedef struct lru_cache_t lru_cache_t;
+
+typedef struct
+{
+    uint64_t i_hits;
+    uint64_t i_misses;
+    uint64_t i_evictions;
+    size_t   i_entries;
+    size_t   i_size;     /**< accounted size of the entries, in bytes */
+} lru_cache_stats_t;
+
+/**
+ * Creates a cache.
+ *
+ * \param i_max_size maximum total size of the values [IN]
+ * \param pf_release releases a value [IN]
+ * \return the cache or NULL on error
+ */
+lru_cache_t *LRUCache_New( size_t i_max_size, void (*pf_release)( void * ) );
+
+/**
+ * Releases all the values and the cache.
+ */
+void LRUCache_Delete( lru_cache_t *p_cache );
+
+/**
+ * Looks up a value, and marks it as the most recently used.
+ *
+ * \return the value, or NULL if it is not in the cache
+ */
+void *LRUCache_Get( lru_cache_t *p_cache, const void *p_key, size_t i_key );
+
+/**
+ * Adds a value to the cache, which takes ownership of it.
+ * The key must not be in the cache yet.
+ *
+ * \param i_size size accounted for the value [IN]
+ * \return VLC_SUCCESS, or VLC_ENOMEM in which case the value is released
+ */
+int LRUCache_Put( lru_cache_t *p_cache, const void *p_key, size_t i_key,
+                  void *p_value, size_t i_size );
+
+/**
+ * Releases the least recently used values until the size limit is met.
+ */
+void LRUCache_Trim( lru_cache_t *p_cache );
+
+void LRUCache_GetStats( const lru_cache_t *p_cache, lru_cache_stats_t *p_stats );
+
+/** @} */
+
+#endif
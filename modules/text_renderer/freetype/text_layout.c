@@ -65,6 +65,7 @@
 #include "freetype.h"
 #include "text_layout.h"
 #include "platform_fonts.h"
+#include "lru.h"
 
 /* Win32 */
 #ifdef _WIN32
@@ -115,6 +116,41 @@ typedef struct run_desc_t
 
 } run_desc_t;
 
+/**
+ * Key of the glyph cache. A face is loaded at a single size, so it also
+ * identifies the size. There is no padding, so that keys can be compared
+ * as bytes.
+ */
+typedef struct glyph_key_t
+{
+    FT_Face  p_face;
+    uint32_t i_glyph_index;
+    uint16_t i_type;            /**< GLYPH_CACHE_* */
+    uint16_t i_flags;           /**< GLYPH_KEY_* */
+    int32_t  i_radius;          /**< outline stroker radius, 26.6 */
+    int32_t  i_origin_x;        /**< subpixel origin of bitmaps, 26.6 */
+    int32_t  i_origin_y;
+    int32_t  i_reserved;
+} glyph_key_t;
+
+enum
+{
+    GLYPH_CACHE_OUTLINES,       /**< glyph outline, stroked outline, advance */
+    GLYPH_CACHE_GLYPH_BITMAP,
+    GLYPH_CACHE_OUTLINE_BITMAP,
+};
+
+#define GLYPH_KEY_BOLD      0x1 /**< synthetic bold */
+#define GLYPH_KEY_ITALIC    0x2 /**< synthetic italic */
+#define GLYPH_KEY_OUTLINE   0x4
+
+typedef struct cached_glyph_t
+{
+    FT_Glyph  p_glyph;          /**< outline of the glyph, or its bitmap */
+    FT_Glyph  p_outline;        /**< stroked outline, if any */
+    FT_Vector advance;
+} cached_glyph_t;
+
 /**
  * Glyph bitmaps. Advance and offset are 26.6 values
  */
@@ -130,6 +166,7 @@ typedef struct glyph_bitmaps_t
     int      i_y_offset;
     int      i_x_advance;
     int      i_y_advance;
+    glyph_key_t key;            /**< cache key of the outlines */
 } glyph_bitmaps_t;
 
 typedef struct paragraph_t
@@ -240,6 +277,235 @@ static void BBoxEnlarge( FT_BBox *p_max, const FT_BBox *p )
     p_max->yMax = __MAX(p_max->yMax, p->yMax);
 }
 
+static void ReleaseCachedGlyph( void *p_data )
+{
+    cached_glyph_t *p_cached = p_data;
+
+    if( p_cached->p_glyph )
+        FT_Done_Glyph( p_cached->p_glyph );
+    if( p_cached->p_outline )
+        FT_Done_Glyph( p_cached->p_outline );
+    free( p_cached );
+}
+
+static size_t GlyphSize( FT_Glyph glyph )
+{
+    if( !glyph )
+        return 0;
+
+    if( glyph->format == FT_GLYPH_FORMAT_OUTLINE )
+    {
+        const FT_Outline *p_outline = &( (FT_OutlineGlyph) glyph )->outline;
+        return sizeof( FT_OutlineGlyphRec )
+             + p_outline->n_points * ( sizeof( FT_Vector ) + 1 )
+             + p_outline->n_contours * sizeof( short );
+    }
+    if( glyph->format == FT_GLYPH_FORMAT_BITMAP )
+    {
+        const FT_Bitmap *p_bitmap = &( (FT_BitmapGlyph) glyph )->bitmap;
+        return sizeof( FT_BitmapGlyphRec )
+             + p_bitmap->rows * abs( p_bitmap->pitch );
+    }
+    return sizeof( FT_GlyphRec );
+}
+
+static void CacheGlyph( filter_t *p_filter, const glyph_key_t *p_key,
+                        FT_Glyph glyph, FT_Glyph outline, FT_Vector advance )
+{
+    cached_glyph_t *p_cached = malloc( sizeof( *p_cached ) );
+    if( !p_cached )
+        return;
+
+    p_cached->p_glyph = NULL;
+    p_cached->p_outline = NULL;
+    p_cached->advance = advance;
+    if( FT_Glyph_Copy( glyph, &p_cached->p_glyph )
+     || ( outline && FT_Glyph_Copy( outline, &p_cached->p_outline ) ) )
+    {
+        ReleaseCachedGlyph( p_cached );
+        return;
+    }
+
+    LRUCache_Put( p_filter->p_sys->p_glyph_cache, p_key, sizeof( *p_key ),
+                  p_cached, sizeof( *p_cached ) + GlyphSize( p_cached->p_glyph )
+                                                + GlyphSize( p_cached->p_outline ) );
+}
+
+/**
+ * Load the outline of a glyph, and its stroked outline if the key asks for
+ * one, from the cache if possible. The glyphs belong to the caller.
+ */
+static int LoadGlyphOutlines( filter_t *p_filter, FT_Face p_face,
+                              const glyph_key_t *p_key,
+                              FT_Glyph *pp_glyph, FT_Glyph *pp_outline,
+                              FT_Vector *p_advance )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    if( p_sys->p_glyph_cache )
+    {
+        const cached_glyph_t *p_cached =
+            LRUCache_Get( p_sys->p_glyph_cache, p_key, sizeof( *p_key ) );
+        if( p_cached )
+        {
+            if( FT_Glyph_Copy( p_cached->p_glyph, pp_glyph ) )
+                return VLC_EGENERIC;
+            if( !p_cached->p_outline
+             || FT_Glyph_Copy( p_cached->p_outline, pp_outline ) )
+                *pp_outline = NULL;
+            *p_advance = p_cached->advance;
+            return VLC_SUCCESS;
+        }
+    }
+
+    if( FT_Load_Glyph( p_face, p_key->i_glyph_index,
+                       FT_LOAD_NO_BITMAP | FT_LOAD_DEFAULT )
+     && FT_Load_Glyph( p_face, p_key->i_glyph_index, FT_LOAD_DEFAULT ) )
+        return VLC_EGENERIC;
+
+    if( p_key->i_flags & GLYPH_KEY_BOLD )
+        FT_GlyphSlot_Embolden( p_face->glyph );
+    if( p_key->i_flags & GLYPH_KEY_ITALIC )
+        FT_GlyphSlot_Oblique( p_face->glyph );
+
+    if( FT_Get_Glyph( p_face->glyph, pp_glyph ) )
+        return VLC_EGENERIC;
+
+    *pp_outline = NULL;
+    if( p_key->i_flags & GLYPH_KEY_OUTLINE )
+    {
+        *pp_outline = *pp_glyph;
+        if( FT_Glyph_StrokeBorder( pp_outline, p_sys->p_stroker, 0, 0 ) )
+            *pp_outline = NULL;
+    }
+
+    *p_advance = p_face->glyph->advance;
+
+    if( p_sys->p_glyph_cache )
+        CacheGlyph( p_filter, p_key, *pp_glyph, *pp_outline, *p_advance );
+    return VLC_SUCCESS;
+}
+
+/**
+ * Render a glyph or outline at the pen position, like FT_Glyph_To_Bitmap().
+ * Bitmaps are cached for their subpixel origin, and moved by whole pixels
+ * to the pen position.
+ */
+static FT_Error RenderGlyph( filter_t *p_filter, const glyph_key_t *p_key,
+                             int i_type, FT_Glyph *pp_glyph,
+                             const FT_Vector *p_pen, FT_Bool destroy )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    FT_Vector origin = { .x = p_pen->x & 63, .y = p_pen->y & 63 };
+    FT_Error i_error;
+
+    /* Bitmap glyphs are not moved by FT_Glyph_To_Bitmap() */
+    if( !p_sys->p_glyph_cache
+     || (*pp_glyph)->format != FT_GLYPH_FORMAT_OUTLINE )
+    {
+        origin = *p_pen;
+        return FT_Glyph_To_Bitmap( pp_glyph, FT_RENDER_MODE_NORMAL,
+                                   &origin, destroy );
+    }
+
+    glyph_key_t key = *p_key;
+    key.i_type = i_type;
+    key.i_origin_x = origin.x;
+    key.i_origin_y = origin.y;
+    if( i_type == GLYPH_CACHE_GLYPH_BITMAP )
+    {
+        /* The glyph itself does not depend on the outline */
+        key.i_flags &= ~GLYPH_KEY_OUTLINE;
+        key.i_radius = 0;
+    }
+
+    const cached_glyph_t *p_cached =
+        LRUCache_Get( p_sys->p_glyph_cache, &key, sizeof( key ) );
+    FT_Glyph bitmap;
+    if( p_cached )
+    {
+        i_error = FT_Glyph_Copy( p_cached->p_glyph, &bitmap );
+        if( i_error )
+            return i_error;
+    }
+    else
+    {
+        bitmap = *pp_glyph;
+        i_error = FT_Glyph_To_Bitmap( &bitmap, FT_RENDER_MODE_NORMAL,
+                                      &origin, 0 );
+        if( i_error )
+            return i_error;
+        CacheGlyph( p_filter, &key, bitmap, NULL, (FT_Vector) { 0, 0 } );
+    }
+
+    ( (FT_BitmapGlyph) bitmap )->left += ( p_pen->x - origin.x ) / 64;
+    ( (FT_BitmapGlyph) bitmap )->top  += ( p_pen->y - origin.y ) / 64;
+
+    if( destroy )
+        FT_Done_Glyph( *pp_glyph );
+    *pp_glyph = bitmap;
+    return 0;
+}
+
+#ifdef HAVE_HARFBUZZ
+static void ReleaseShapedRun( void *p_data )
+{
+    free( p_data );
+}
+#endif
+
+void InitGlyphCaches( filter_t *p_filter )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    int64_t i_size = var_InheritInteger( p_filter, "freetype-cache-size" );
+    if( i_size > 0 )
+        p_sys->p_glyph_cache = LRUCache_New( i_size * 1024,
+                                             ReleaseCachedGlyph );
+#ifdef HAVE_HARFBUZZ
+    i_size = var_InheritInteger( p_filter, "freetype-shaping-cache-size" );
+    if( i_size > 0 )
+        p_sys->p_shape_cache = LRUCache_New( i_size * 1024,
+                                             ReleaseShapedRun );
+#endif
+}
+
+void TrimGlyphCaches( filter_t *p_filter )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    if( p_sys->p_glyph_cache )
+        LRUCache_Trim( p_sys->p_glyph_cache );
+    if( p_sys->p_shape_cache )
+        LRUCache_Trim( p_sys->p_shape_cache );
+}
+
+static void FreeGlyphCache( filter_t *p_filter, lru_cache_t *p_cache,
+                            const char *psz_name )
+{
+    lru_cache_stats_t stats;
+
+    if( !p_cache )
+        return;
+
+    LRUCache_GetStats( p_cache, &stats );
+    msg_Dbg( p_filter, "%s cache: %"PRIu64" hits, %"PRIu64" misses, "
+             "%"PRIu64" evictions, %zu entries (%zu bytes)", psz_name,
+             stats.i_hits, stats.i_misses, stats.i_evictions,
+             stats.i_entries, stats.i_size );
+    LRUCache_Delete( p_cache );
+}
+
+void FreeGlyphCaches( filter_t *p_filter )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    FreeGlyphCache( p_filter, p_sys->p_glyph_cache, "glyph" );
+    FreeGlyphCache( p_filter, p_sys->p_shape_cache, "shaping" );
+    p_sys->p_glyph_cache = NULL;
+    p_sys->p_shape_cache = NULL;
+}
+
 static paragraph_t *NewParagraph( filter_t *p_filter,
                                   int i_size,
                                   const uni_char_t *p_code_points,
@@ -642,6 +908,71 @@ static int ItemizeParagraph( filter_t *p_filter, paragraph_t *p_paragraph )
 }
 
 #ifdef HAVE_HARFBUZZ
+/**
+ * Shaped run in the shaping cache, keyed by a shape_key_t followed by the
+ * code points of the run.
+ */
+typedef struct shaped_run_t
+{
+    unsigned int         i_glyph_count;
+    hb_glyph_info_t     *p_glyph_infos;
+    hb_glyph_position_t *p_glyph_positions;
+} shaped_run_t;
+
+typedef struct shape_key_t
+{
+    FT_Face  p_face;
+    uint32_t i_script;
+    uint32_t i_direction;
+} shape_key_t;
+
+static void *NewShapeKey( const run_desc_t *p_run, const uni_char_t *p_text,
+                          size_t *pi_key )
+{
+    const size_t i_text = p_run->i_end_offset - p_run->i_start_offset;
+    shape_key_t header;
+    unsigned char *p_key;
+
+    memset( &header, 0, sizeof( header ) );
+    header.p_face = p_run->p_face;
+    header.i_script = p_run->script;
+    header.i_direction = p_run->direction;
+
+    *pi_key = sizeof( header ) + i_text * sizeof( *p_text );
+    p_key = malloc( *pi_key );
+    if( p_key )
+    {
+        memcpy( p_key, &header, sizeof( header ) );
+        memcpy( p_key + sizeof( header ), p_text + p_run->i_start_offset,
+                i_text * sizeof( *p_text ) );
+    }
+    return p_key;
+}
+
+static void CacheShapedRun( filter_t *p_filter, const void *p_key,
+                            size_t i_key, const run_desc_t *p_run )
+{
+    const unsigned i_count = p_run->i_glyph_count;
+    const size_t i_size = sizeof( shaped_run_t )
+                        + i_count * sizeof( hb_glyph_info_t )
+                        + i_count * sizeof( hb_glyph_position_t );
+    shaped_run_t *p_shaped = malloc( i_size );
+    if( !p_shaped )
+        return;
+
+    p_shaped->i_glyph_count = i_count;
+    p_shaped->p_glyph_infos = (hb_glyph_info_t *) ( p_shaped + 1 );
+    p_shaped->p_glyph_positions =
+        (hb_glyph_position_t *) ( p_shaped->p_glyph_infos + i_count );
+    memcpy( p_shaped->p_glyph_infos, p_run->p_glyph_infos,
+            i_count * sizeof( hb_glyph_info_t ) );
+    memcpy( p_shaped->p_glyph_positions, p_run->p_glyph_positions,
+            i_count * sizeof( hb_glyph_position_t ) );
+
+    LRUCache_Put( p_filter->p_sys->p_shape_cache, p_key, i_key,
+                  p_shaped, i_size );
+}
+
 /**
  * Shape an itemized paragraph using HarfBuzz.
  * This is where the glyphs of complex scripts get their positions
@@ -695,11 +1026,35 @@ static int ShapeParagraphHarfBuzz( filter_t *p_filter,
         else
             p_face = p_run->p_face;
 
+        /*
+         * Runs shaped before are taken from the cache. Their glyph infos and
+         * positions then belong to the cache, which is only trimmed after
+         * the whole text is laid out.
+         */
+        void *p_key = NULL;
+        size_t i_key = 0;
+        if( p_sys->p_shape_cache )
+        {
+            p_key = NewShapeKey( p_run, p_paragraph->p_code_points, &i_key );
+            const shaped_run_t *p_shaped = p_key ?
+                LRUCache_Get( p_sys->p_shape_cache, p_key, i_key ) : NULL;
+            if( p_shaped )
+            {
+                free( p_key );
+                p_run->p_glyph_infos = p_shaped->p_glyph_infos;
+                p_run->p_glyph_positions = p_shaped->p_glyph_positions;
+                p_run->i_glyph_count = p_shaped->i_glyph_count;
+                i_total_glyphs += p_run->i_glyph_count;
+                continue;
+            }
+        }
+
         p_run->p_hb_font = hb_ft_font_create( p_face, 0 );
         if( !p_run->p_hb_font )
         {
             msg_Err( p_filter,
                      "ShapeParagraphHarfBuzz(): hb_ft_font_create() error" );
+            free( p_key );
             goto error;
         }
 
@@ -708,6 +1063,7 @@ static int ShapeParagraphHarfBuzz( filter_t *p_filter,
         {
             msg_Err( p_filter,
                      "ShapeParagraphHarfBuzz(): hb_buffer_create() error" );
+            free( p_key );
             goto error;
         }
 
@@ -734,9 +1090,16 @@ static int ShapeParagraphHarfBuzz( filter_t *p_filter,
         {
             msg_Err( p_filter,
                      "ShapeParagraphHarfBuzz() invalid glyph count in shaped run" );
+            free( p_key );
             goto error;
         }
 
+        if( p_key )
+        {
+            CacheShapedRun( p_filter, p_key, i_key, p_run );
+            free( p_key );
+        }
+
         i_total_glyphs += p_run->i_glyph_count;
     }
 
@@ -800,8 +1163,10 @@ static int ShapeParagraphHarfBuzz( filter_t *p_filter,
 
     for( int i = 0; i < p_paragraph->i_runs_count; ++i )
     {
-        hb_font_destroy( p_paragraph->p_runs[ i ].p_hb_font );
-        hb_buffer_destroy( p_paragraph->p_runs[ i ].p_buffer );
+        if( p_paragraph->p_runs[ i ].p_hb_font )
+            hb_font_destroy( p_paragraph->p_runs[ i ].p_hb_font );
+        if( p_paragraph->p_runs[ i ].p_buffer )
+            hb_buffer_destroy( p_paragraph->p_runs[ i ].p_buffer );
     }
     FreeParagraph( *p_old_paragraph );
     *p_old_paragraph = p_new_paragraph;
@@ -955,6 +1320,18 @@ static int LoadGlyphs( filter_t *p_filter, paragraph_t *p_paragraph,
         else
             p_face = p_run->p_face;
 
+        glyph_key_t key;
+        memset( &key, 0, sizeof( key ) );
+        key.p_face = p_face;
+        key.i_type = GLYPH_CACHE_OUTLINES;
+
+        if( ( p_style->i_style_flags & STYLE_BOLD )
+              && !( p_face->style_flags & FT_STYLE_FLAG_BOLD ) )
+            key.i_flags |= GLYPH_KEY_BOLD;
+        if( ( p_style->i_style_flags & STYLE_ITALIC )
+              && !( p_face->style_flags & FT_STYLE_FLAG_ITALIC ) )
+            key.i_flags |= GLYPH_KEY_ITALIC;
+
         if( p_sys->p_stroker && (p_style->i_style_flags & STYLE_OUTLINE) )
         {
             double f_outline_thickness =
@@ -965,6 +1342,8 @@ static int LoadGlyphs( filter_t *p_filter, paragraph_t *p_paragraph,
                             i_radius,
                             FT_STROKER_LINECAP_ROUND,
                             FT_STROKER_LINEJOIN_ROUND, 0 );
+            key.i_flags |= GLYPH_KEY_OUTLINE;
+            key.i_radius = i_radius;
         }
 
         for( int j = p_run->i_start_offset; j < p_run->i_end_offset; ++j )
@@ -1017,39 +1396,24 @@ static int LoadGlyphs( filter_t *p_filter, paragraph_t *p_paragraph,
                     SKIP_GLYPH( p_bitmaps )
             }
 
-            if( FT_Load_Glyph( p_face, i_glyph_index,
-                               FT_LOAD_NO_BITMAP | FT_LOAD_DEFAULT )
-             && FT_Load_Glyph( p_face, i_glyph_index, FT_LOAD_DEFAULT ) )
-                SKIP_GLYPH( p_bitmaps )
-
-            if( ( p_style->i_style_flags & STYLE_BOLD )
-                  && !( p_face->style_flags & FT_STYLE_FLAG_BOLD ) )
-                FT_GlyphSlot_Embolden( p_face->glyph );
-            if( ( p_style->i_style_flags & STYLE_ITALIC )
-                  && !( p_face->style_flags & FT_STYLE_FLAG_ITALIC ) )
-                FT_GlyphSlot_Oblique( p_face->glyph );
+            key.i_glyph_index = i_glyph_index;
+            p_bitmaps->key = key;
 
-            if( FT_Get_Glyph( p_face->glyph, &p_bitmaps->p_glyph ) )
+            FT_Vector advance;
+            if( LoadGlyphOutlines( p_filter, p_face, &key, &p_bitmaps->p_glyph,
+                                   &p_bitmaps->p_outline, &advance ) )
                 SKIP_GLYPH( p_bitmaps )
 
 #undef SKIP_GLYPH
 
-            if( p_filter->p_sys->p_stroker && (p_style->i_style_flags & STYLE_OUTLINE) )
-            {
-                p_bitmaps->p_outline = p_bitmaps->p_glyph;
-                if( FT_Glyph_StrokeBorder( &p_bitmaps->p_outline,
-                                           p_filter->p_sys->p_stroker, 0, 0 ) )
-                    p_bitmaps->p_outline = 0;
-            }
-
             if( p_style->i_shadow_alpha != STYLE_ALPHA_TRANSPARENT )
                 p_bitmaps->p_shadow = p_bitmaps->p_outline ?
                                       p_bitmaps->p_outline : p_bitmaps->p_glyph;
 
             if( b_overwrite_advance )
             {
-                p_bitmaps->i_x_advance = p_face->glyph->advance.x;
-                p_bitmaps->i_y_advance = p_face->glyph->advance.y;
+                p_bitmaps->i_x_advance = advance.x;
+                p_bitmaps->i_y_advance = advance.y;
             }
         }
 
@@ -1152,8 +1516,10 @@ static int LayoutLine( filter_t *p_filter,
 
         if( p_bitmaps->p_shadow )
         {
-            if( FT_Glyph_To_Bitmap( &p_bitmaps->p_shadow, FT_RENDER_MODE_NORMAL,
-                                    &pen_shadow, 0 ) )
+            const int i_type = p_bitmaps->p_shadow == p_bitmaps->p_outline ?
+                               GLYPH_CACHE_OUTLINE_BITMAP : GLYPH_CACHE_GLYPH_BITMAP;
+            if( RenderGlyph( p_filter, &p_bitmaps->key, i_type,
+                             &p_bitmaps->p_shadow, &pen_shadow, 0 ) )
                 p_bitmaps->p_shadow = 0;
             else
                 FT_Glyph_Get_CBox( p_bitmaps->p_shadow, ft_glyph_bbox_pixels,
@@ -1161,8 +1527,8 @@ static int LayoutLine( filter_t *p_filter,
         }
         if( p_bitmaps->p_glyph )
         {
-            if( FT_Glyph_To_Bitmap( &p_bitmaps->p_glyph, FT_RENDER_MODE_NORMAL,
-                                    &pen_new, 1 ) )
+            if( RenderGlyph( p_filter, &p_bitmaps->key, GLYPH_CACHE_GLYPH_BITMAP,
+                             &p_bitmaps->p_glyph, &pen_new, 1 ) )
             {
                 FT_Done_Glyph( p_bitmaps->p_glyph );
                 if( p_bitmaps->p_outline )
@@ -1178,8 +1544,8 @@ static int LayoutLine( filter_t *p_filter,
         }
         if( p_bitmaps->p_outline )
         {
-            if( FT_Glyph_To_Bitmap( &p_bitmaps->p_outline, FT_RENDER_MODE_NORMAL,
-                                    &pen_new, 1 ) )
+            if( RenderGlyph( p_filter, &p_bitmaps->key, GLYPH_CACHE_OUTLINE_BITMAP,
+                             &p_bitmaps->p_outline, &pen_new, 1 ) )
             {
                 FT_Done_Glyph( p_bitmaps->p_outline );
                 p_bitmaps->p_outline = 0;
@@ -59,6 +59,21 @@ struct line_desc_t
     FT_BBox          bbox;
 };
 
+/**
+ * Create the glyph and shaping caches, with the sizes set by the options.
+ * A cache with a size of 0 is disabled.
+ */
+void InitGlyphCaches( filter_t *p_filter );
+
+/**
+ * Release the least recently used cache entries above the size limits.
+ * Glyphs and shaped runs taken from the caches remain valid until then,
+ * so this must not be called while laying out text.
+ */
+void TrimGlyphCaches( filter_t *p_filter );
+
+void FreeGlyphCaches( filter_t *p_filter );
+
 void FreeLines( line_desc_t *p_lines );
 line_desc_t *NewLine( int i_count );
 
@@ -29,32 +29,59 @@
 #include <vlc_common.h>
 #include <vlc_picture.h>
 #include <vlc_cpu.h>
+#include <vlc_filter.h>
 #include <assert.h>
 
 #include "copy.h"
 
-int CopyInitCache(copy_cache_t *cache, unsigned width)
+#ifdef CAN_COMPILE_SSE2
+# include <emmintrin.h>
+# define VLC_SSE2 __attribute__ ((__target__ ("sse2")))
+#endif
+#ifdef CAN_COMPILE_AVX2
+# include <immintrin.h>
+# define VLC_AVX2 __attribute__ ((__target__ ("avx2")))
+#endif
+
+/* Minimal size of the first plane of a slice, in bytes */
+#define COPY_SLICE_MIN_SIZE (1 << 20)
+
+int CopyInitCacheSlices(copy_cache_t *cache, unsigned width, unsigned threads)
 {
+    if (threads == 0)
+        threads = vlc_GetCPUCount();
+    cache->slices = threads > 1 ? filter_NewSlices(threads) : NULL;
+
 #ifdef CAN_COMPILE_SSE2
+    /* One buffer per thread */
     cache->size = __MAX((width + 0x3f) & ~ 0x3f, 8192);
-    cache->buffer = aligned_alloc(64, cache->size);
-    if (!cache->buffer)
+    cache->buffer = aligned_alloc(64, cache->size *
+                                      filter_GetSliceThreads(cache->slices));
+    if (!cache->buffer) {
+        filter_DeleteSlices(cache->slices);
+        cache->slices = NULL;
         return VLC_EGENERIC;
+    }
 #else
-    (void) cache; (void) width;
+    (void) width;
 #endif
     return VLC_SUCCESS;
 }
 
+int CopyInitCache(copy_cache_t *cache, unsigned width)
+{
+    return CopyInitCacheSlices(cache, width, 1);
+}
+
 void CopyCleanCache(copy_cache_t *cache)
 {
 #ifdef CAN_COMPILE_SSE2
     aligned_free(cache->buffer);
     cache->buffer = NULL;
     cache->size   = 0;
-#else
-    (void) cache;
 #endif
+    filter_DeleteSlices(cache->slices);
+    cache->slices = NULL;
 }
 
 #ifdef CAN_COMPILE_SSE2
@@ -94,6 +121,168 @@ void CopyCleanCache(copy_cache_t *cache)
 # define vlc_CPU_SSE2() ((cpu & VLC_CPU_SSE2) != 0)
 #endif
 
+#ifdef CAN_COMPILE_AVX2
+# ifndef __AVX2__
+#  undef vlc_CPU_AVX2
+#  define vlc_CPU_AVX2() ((cpu & VLC_CPU_AVX2) != 0)
+# endif
+
+/* AVX2 versions of CopyFromUswc(), Copy2d(), SSE_InterleaveUV() and
+ * SSE_SplitUV(), the cache buffer lines being aligned on 32 bytes.
+ */
+VLC_AVX2
+static void AVX2_CopyFromUswc(uint8_t *dst, size_t dst_pitch,
+                              const uint8_t *src, size_t src_pitch,
+                              unsigned width, unsigned height)
+{
+    assert(((intptr_t)dst & 0x1f) == 0 && (dst_pitch & 0x1f) == 0);
+
+    _mm_mfence();
+
+    for (unsigned y = 0; y < height; y++) {
+        const unsigned unaligned = (-(uintptr_t)src) & 0x1f;
+        unsigned x = 0;
+
+        if (width >= 32) {
+            if (unaligned) {
+                _mm256_store_si256((__m256i *)dst,
+                                   _mm256_loadu_si256((const __m256i *)src));
+                x = unaligned;
+            }
+            /* The streaming loads need aligned addresses */
+            for (; x+127 < width; x += 128) {
+                __m256i v0 = _mm256_stream_load_si256((__m256i *)&src[x +  0]);
+                __m256i v1 = _mm256_stream_load_si256((__m256i *)&src[x + 32]);
+                __m256i v2 = _mm256_stream_load_si256((__m256i *)&src[x + 64]);
+                __m256i v3 = _mm256_stream_load_si256((__m256i *)&src[x + 96]);
+                _mm256_storeu_si256((__m256i *)&dst[x +  0], v0);
+                _mm256_storeu_si256((__m256i *)&dst[x + 32], v1);
+                _mm256_storeu_si256((__m256i *)&dst[x + 64], v2);
+                _mm256_storeu_si256((__m256i *)&dst[x + 96], v3);
+            }
+            for (; x+31 < width; x += 32)
+                _mm256_storeu_si256((__m256i *)&dst[x],
+                        _mm256_stream_load_si256((__m256i *)&src[x]));
+        }
+
+        for (; x < width; x++)
+            dst[x] = src[x];
+
+        src += src_pitch;
+        dst += dst_pitch;
+    }
+    _mm_mfence();
+}
+
+VLC_AVX2
+static void AVX2_Copy2d(uint8_t *dst, size_t dst_pitch,
+                        const uint8_t *src, size_t src_pitch,
+                        unsigned width, unsigned height)
+{
+    assert(((intptr_t)src & 0x1f) == 0 && (src_pitch & 0x1f) == 0);
+
+    for (unsigned y = 0; y < height; y++) {
+        unsigned x = 0;
+
+        if (((intptr_t)dst & 0x1f) == 0) {
+            for (; x+127 < width; x += 128) {
+                __m256i v0 = _mm256_load_si256((const __m256i *)&src[x +  0]);
+                __m256i v1 = _mm256_load_si256((const __m256i *)&src[x + 32]);
+                __m256i v2 = _mm256_load_si256((const __m256i *)&src[x + 64]);
+                __m256i v3 = _mm256_load_si256((const __m256i *)&src[x + 96]);
+                _mm256_stream_si256((__m256i *)&dst[x +  0], v0);
+                _mm256_stream_si256((__m256i *)&dst[x + 32], v1);
+                _mm256_stream_si256((__m256i *)&dst[x + 64], v2);
+                _mm256_stream_si256((__m256i *)&dst[x + 96], v3);
+            }
+        }
+        for (; x+31 < width; x += 32)
+            _mm256_storeu_si256((__m256i *)&dst[x],
+                                _mm256_load_si256((const __m256i *)&src[x]));
+
+        for (; x < width; x++)
+            dst[x] = src[x];
+
+        src += src_pitch;
+        dst += dst_pitch;
+    }
+    _mm_sfence();
+}
+
+VLC_AVX2
+static void AVX2_InterleaveUV(uint8_t *dst, size_t dst_pitch,
+                              const uint8_t *srcu, size_t srcu_pitch,
+                              const uint8_t *srcv, size_t srcv_pitch,
+                              unsigned width, unsigned height)
+{
+    assert(!((intptr_t)srcu & 0x1f) && !(srcu_pitch & 0x1f) &&
+           !((intptr_t)srcv & 0x1f) && !(srcv_pitch & 0x1f));
+
+    for (unsigned y = 0; y < height; y++) {
+        unsigned x = 0;
+
+        for (; x+31 < width; x += 32) {
+            __m256i u = _mm256_load_si256((const __m256i *)&srcu[x]);
+            __m256i v = _mm256_load_si256((const __m256i *)&srcv[x]);
+            /* Interleaving works within 128 bits lanes */
+            __m256i lo = _mm256_unpacklo_epi8(u, v);
+            __m256i hi = _mm256_unpackhi_epi8(u, v);
+            _mm256_storeu_si256((__m256i *)&dst[2*x +  0],
+                                _mm256_permute2x128_si256(lo, hi, 0x20));
+            _mm256_storeu_si256((__m256i *)&dst[2*x + 32],
+                                _mm256_permute2x128_si256(lo, hi, 0x31));
+        }
+
+        for (; x < width; x++) {
+            dst[2*x+0] = srcu[x];
+            dst[2*x+1] = srcv[x];
+        }
+        srcu += srcu_pitch;
+        srcv += srcv_pitch;
+        dst += dst_pitch;
+    }
+}
+
+VLC_AVX2
+static void AVX2_SplitUV(uint8_t *dstu, size_t dstu_pitch,
+                         uint8_t *dstv, size_t dstv_pitch,
+                         const uint8_t *src, size_t src_pitch,
+                         unsigned width, unsigned height)
+{
+    const __m256i shuffle = _mm256_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14,
+                                             1, 3, 5, 7, 9, 11, 13, 15,
+                                             0, 2, 4, 6, 8, 10, 12, 14,
+                                             1, 3, 5, 7, 9, 11, 13, 15);
+
+    assert(((intptr_t)src & 0x1f) == 0 && (src_pitch & 0x1f) == 0);
+
+    for (unsigned y = 0; y < height; y++) {
+        unsigned x = 0;
+
+        for (; x+31 < width; x += 32) {
+            __m256i a = _mm256_load_si256((const __m256i *)&src[2*x +  0]);
+            __m256i b = _mm256_load_si256((const __m256i *)&src[2*x + 32]);
+            /* U and V in the low and high 64 bits of each lane, then in
+             * the low and high lane */
+            a = _mm256_permute4x64_epi64(_mm256_shuffle_epi8(a, shuffle), 0xd8);
+            b = _mm256_permute4x64_epi64(_mm256_shuffle_epi8(b, shuffle), 0xd8);
+            _mm256_storeu_si256((__m256i *)&dstu[x],
+                                _mm256_permute2x128_si256(a, b, 0x20));
+            _mm256_storeu_si256((__m256i *)&dstv[x],
+                                _mm256_permute2x128_si256(a, b, 0x31));
+        }
+
+        for (; x < width; x++) {
+            dstu[x] = src[2*x+0];
+            dstv[x] = src[2*x+1];
+        }
+        src  += src_pitch;
+        dstu += dstu_pitch;
+        dstv += dstv_pitch;
+    }
+}
+#endif /* CAN_COMPILE_AVX2 */
+
 /* Optimized copy from "Uncacheable Speculative Write Combining" memory
  * as used by some video surface.
  * XXX It is really efficient only when SSE4.1 is available.
@@ -106,6 +295,11 @@ static void CopyFromUswc(uint8_t *dst, size_t dst_pitch,
 {
 #if defined (__SSE4_1__) || !defined(CAN_COMPILE_SSSE3)
     VLC_UNUSED(cpu);
+#endif
+#ifdef CAN_COMPILE_AVX2
+    if (vlc_CPU_AVX2())
+        return AVX2_CopyFromUswc(dst, dst_pitch, src, src_pitch,
+                                 width, height);
 #endif
     assert(((intptr_t)dst & 0x0f) == 0 && (dst_pitch & 0x0f) == 0);
 
@@ -150,8 +344,14 @@ static void CopyFromUswc(uint8_t *dst, size_t dst_pitch,
 VLC_SSE
 static void Copy2d(uint8_t *dst, size_t dst_pitch,
                    const uint8_t *src, size_t src_pitch,
-                   unsigned width, unsigned height)
+                   unsigned width, unsigned height, unsigned cpu)
 {
+#ifdef CAN_COMPILE_AVX2
+    if (vlc_CPU_AVX2())
+        return AVX2_Copy2d(dst, dst_pitch, src, src_pitch, width, height);
+#else
+    VLC_UNUSED(cpu);
+#endif
     assert(((intptr_t)src & 0x0f) == 0 && (src_pitch & 0x0f) == 0);
 
     for (unsigned y = 0; y < height; y++) {
@@ -371,8 +571,8 @@ static void SSE_CopyPlane(uint8_t *dst, size_t dst_pitch,
                           uint8_t *cache, size_t cache_size,
                           unsigned height, unsigned cpu)
 {
-    const unsigned w16 = (src_pitch+15) & ~15;
-    const unsigned hstep = cache_size / w16;
+    const unsigned w32 = (src_pitch+31) & ~31;
+    const unsigned hstep = cache_size / w32;
     assert(hstep > 0);
 
     if (src_pitch == dst_pitch)
@@ -382,14 +582,14 @@ static void SSE_CopyPlane(uint8_t *dst, size_t dst_pitch,
         const unsigned hblock =  __MIN(hstep, height - y);
 
         /* Copy a bunch of line into our cache */
-        CopyFromUswc(cache, w16,
+        CopyFromUswc(cache, w32,
                      src, src_pitch,
                      src_pitch, hblock, cpu);
 
         /* Copy from our cache to the destination */
         Copy2d(dst, dst_pitch,
-               cache, w16,
-               src_pitch, hblock);
+               cache, w32,
+               src_pitch, hblock, cpu);
 
         /* */
         src += src_pitch * hblock;
@@ -406,8 +606,8 @@ SSE_InterleavePlanes(uint8_t *dst, size_t dst_pitch,
                      unsigned int cpu)
 {
     assert(srcu_pitch == srcv_pitch);
-    unsigned int const  w16 = (srcu_pitch+15) & ~15;
-    unsigned int const  hstep = (cache_size) / (2*w16);
+    unsigned int const  w32 = (srcu_pitch+31) & ~31;
+    unsigned int const  hstep = (cache_size) / (2*w32);
     assert(hstep > 0);
 
     for (unsigned int y = 0; y < height; y += hstep)
@@ -415,14 +615,20 @@ SSE_InterleavePlanes(uint8_t *dst, size_t dst_pitch,
         unsigned int const      hblock = __MIN(hstep, height - y);
 
         /* Copy a bunch of line into our cache */
-        CopyFromUswc(cache, w16, srcu, srcu_pitch,
+        CopyFromUswc(cache, w32, srcu, srcu_pitch,
                      srcu_pitch, hblock, cpu);
-        CopyFromUswc(cache+w16*hblock, w16, srcv, srcv_pitch,
+        CopyFromUswc(cache+w32*hblock, w32, srcv, srcv_pitch,
                      srcv_pitch, hblock, cpu);
 
         /* Copy from our cache to the destination */
-        SSE_InterleaveUV(dst, dst_pitch, cache, w16,
-                         cache+w16*hblock, w16, srcu_pitch, hblock, cpu);
+#ifdef CAN_COMPILE_AVX2
+        if (vlc_CPU_AVX2())
+            AVX2_InterleaveUV(dst, dst_pitch, cache, w32,
+                              cache+w32*hblock, w32, srcu_pitch, hblock);
+        else
+#endif
+        SSE_InterleaveUV(dst, dst_pitch, cache, w32,
+                         cache+w32*hblock, w32, srcu_pitch, hblock, cpu);
 
         /* */
         srcu += hblock * srcu_pitch;
@@ -437,20 +643,27 @@ static void SSE_SplitPlanes(uint8_t *dstu, size_t dstu_pitch,
                             uint8_t *cache, size_t cache_size,
                             unsigned height, unsigned cpu)
 {
-    const unsigned w16 = (src_pitch+15) & ~15;
-    const unsigned hstep = cache_size / w16;
+    const unsigned w32 = (src_pitch+31) & ~31;
+    const unsigned hstep = cache_size / w32;
     assert(hstep > 0);
 
     for (unsigned y = 0; y < height; y += hstep) {
         const unsigned hblock =  __MIN(hstep, height - y);
 
         /* Copy a bunch of line into our cache */
-        CopyFromUswc(cache, w16, src, src_pitch,
+        CopyFromUswc(cache, w32, src, src_pitch,
                      src_pitch, hblock, cpu);
 
-        /* Copy from our cache to the destination */
+        /* Copy from our cache to the destination, a line holds
+         * src_pitch / 2 pixels */
+#ifdef CAN_COMPILE_AVX2
+        if (vlc_CPU_AVX2())
+            AVX2_SplitUV(dstu, dstu_pitch, dstv, dstv_pitch,
+                         cache, w32, src_pitch / 2, hblock);
+        else
+#endif
         SSE_SplitUV(dstu, dstu_pitch, dstv, dstv_pitch,
-                    cache, w16, src_pitch, hblock, cpu);
+                    cache, w32, src_pitch / 2, hblock, cpu);
 
         /* */
         src  += src_pitch  * hblock;
@@ -459,31 +672,31 @@ static void SSE_SplitPlanes(uint8_t *dstu, size_t dstu_pitch,
     }
 }
 
-static void SSE_CopyFromNv12ToYv12(picture_t *dst,
+static void SSE_CopyFromNv12ToYv12(plane_t *dst,
                                    uint8_t *src[2], size_t src_pitch[2],
                                    unsigned height,
                                    copy_cache_t *cache, unsigned cpu)
 {
-    SSE_CopyPlane(dst->p[0].p_pixels, dst->p[0].i_pitch,
+    SSE_CopyPlane(dst[0].p_pixels, dst[0].i_pitch,
                   src[0], src_pitch[0],
                   cache->buffer, cache->size,
                   height, cpu);
-    SSE_SplitPlanes(dst->p[2].p_pixels, dst->p[2].i_pitch,
-                    dst->p[1].p_pixels, dst->p[1].i_pitch,
+    SSE_SplitPlanes(dst[2].p_pixels, dst[2].i_pitch,
+                    dst[1].p_pixels, dst[1].i_pitch,
                     src[1], src_pitch[1],
                     cache->buffer, cache->size,
                     (height+1)/2, cpu);
     asm volatile ("emms");
 }
 
-static void SSE_CopyFromYv12ToYv12(picture_t *dst,
+static void SSE_CopyFromYv12ToYv12(plane_t *dst,
                                    uint8_t *src[3], size_t src_pitch[3],
                                    unsigned height,
                                    copy_cache_t *cache, unsigned cpu)
 {
     for (unsigned n = 0; n < 3; n++) {
         const unsigned d = n > 0 ? 2 : 1;
-        SSE_CopyPlane(dst->p[n].p_pixels, dst->p[n].i_pitch,
+        SSE_CopyPlane(dst[n].p_pixels, dst[n].i_pitch,
                       src[n], src_pitch[n],
                       cache->buffer, cache->size,
                       (height+d-1)/d, cpu);
@@ -492,16 +705,16 @@ static void SSE_CopyFromYv12ToYv12(picture_t *dst,
 }
 
 
-static void SSE_CopyFromNv12ToNv12(picture_t *dst,
+static void SSE_CopyFromNv12ToNv12(plane_t *dst,
                              uint8_t *src[2], size_t src_pitch[2],
                              unsigned height,
                              copy_cache_t *cache, unsigned cpu)
 {
-    SSE_CopyPlane(dst->p[0].p_pixels, dst->p[0].i_pitch,
+    SSE_CopyPlane(dst[0].p_pixels, dst[0].i_pitch,
                   src[0], src_pitch[0],
                   cache->buffer, cache->size,
                   height, cpu);
-    SSE_CopyPlane(dst->p[1].p_pixels, dst->p[1].i_pitch,
+    SSE_CopyPlane(dst[1].p_pixels, dst[1].i_pitch,
                   src[1], src_pitch[1],
                   cache->buffer, cache->size,
                   height/2, cpu);
@@ -509,35 +722,117 @@ static void SSE_CopyFromNv12ToNv12(picture_t *dst,
 }
 
 static void
-SSE_CopyFromNv12ToI420(picture_t *dest, uint8_t *src[2],
+SSE_CopyFromNv12ToI420(plane_t *dest, uint8_t *src[2],
                        size_t src_pitch[2], unsigned int height,
                        copy_cache_t *cache, unsigned int cpu)
 {
-    SSE_CopyPlane(dest->p[0].p_pixels, dest->p[0].i_pitch,
+    SSE_CopyPlane(dest[0].p_pixels, dest[0].i_pitch,
                   src[0], src_pitch[0], cache->buffer, cache->size,
                   height, cpu);
-    SSE_SplitPlanes(dest->p[1].p_pixels, dest->p[1].i_pitch,
-                    dest->p[2].p_pixels, dest->p[2].i_pitch,
+    SSE_SplitPlanes(dest[1].p_pixels, dest[1].i_pitch,
+                    dest[2].p_pixels, dest[2].i_pitch,
                     src[1], src_pitch[1], cache->buffer, cache->size,
                     height / 2, cpu);
     asm volatile ("emms");
 }
 
-static void SSE_CopyFromI420ToNv12(picture_t *dst,
+static void SSE_CopyFromI420ToNv12(plane_t *dst,
                              uint8_t *src[3], size_t src_pitch[3],
                              unsigned height,
                              copy_cache_t *cache, unsigned cpu)
 {
-    SSE_CopyPlane(dst->p[0].p_pixels, dst->p[0].i_pitch,
+    SSE_CopyPlane(dst[0].p_pixels, dst[0].i_pitch,
                   src[0], src_pitch[0],
                   cache->buffer, cache->size,
                   height, cpu);
-    SSE_InterleavePlanes(dst->p[1].p_pixels, dst->p[1].i_pitch,
+    SSE_InterleavePlanes(dst[1].p_pixels, dst[1].i_pitch,
                          src[U_PLANE], src_pitch[U_PLANE],
                          src[V_PLANE], src_pitch[V_PLANE],
                          cache->buffer, cache->size, height / 2, cpu);
     asm volatile ("emms");
 }
+
+/* 10 bits planar to P010: the samples are shifted to the most significant
+ * bits, and U and V interleaved */
+VLC_SSE2
+static void SSE2_CopyFromI420_10ToP010(plane_t *dst, uint8_t *src[3],
+                                       size_t src_pitch[3], unsigned height)
+{
+    const unsigned width = src_pitch[0] / 2;
+    for (unsigned y = 0; y < height; y++) {
+        const uint16_t *srcY = (const uint16_t *)(src[Y_PLANE] + y * src_pitch[Y_PLANE]);
+        uint16_t *dstY = (uint16_t *)(dst[0].p_pixels + y * dst[0].i_pitch);
+        unsigned x = 0;
+
+        for (; x+7 < width; x += 8)
+            _mm_storeu_si128((__m128i *)&dstY[x], _mm_slli_epi16(
+                             _mm_loadu_si128((const __m128i *)&srcY[x]), 6));
+        for (; x < width; x++)
+            dstY[x] = srcY[x] << 6;
+    }
+
+    const unsigned chroma_width = src_pitch[1] / 2;
+    for (unsigned y = 0; y < height / 2; y++) {
+        const uint16_t *srcU = (const uint16_t *)(src[U_PLANE] + y * src_pitch[U_PLANE]);
+        const uint16_t *srcV = (const uint16_t *)(src[V_PLANE] + y * src_pitch[V_PLANE]);
+        uint16_t *dstUV = (uint16_t *)(dst[1].p_pixels + y * dst[1].i_pitch);
+        unsigned x = 0;
+
+        for (; x+7 < chroma_width; x += 8) {
+            __m128i u = _mm_slli_epi16(_mm_loadu_si128((const __m128i *)&srcU[x]), 6);
+            __m128i v = _mm_slli_epi16(_mm_loadu_si128((const __m128i *)&srcV[x]), 6);
+            _mm_storeu_si128((__m128i *)&dstUV[2*x + 0], _mm_unpacklo_epi16(u, v));
+            _mm_storeu_si128((__m128i *)&dstUV[2*x + 8], _mm_unpackhi_epi16(u, v));
+        }
+        for (; x < chroma_width; x++) {
+            dstUV[2*x+0] = srcU[x] << 6;
+            dstUV[2*x+1] = srcV[x] << 6;
+        }
+    }
+}
+
+#ifdef CAN_COMPILE_AVX2
+VLC_AVX2
+static void AVX2_CopyFromI420_10ToP010(plane_t *dst, uint8_t *src[3],
+                                       size_t src_pitch[3], unsigned height)
+{
+    const unsigned width = src_pitch[0] / 2;
+    for (unsigned y = 0; y < height; y++) {
+        const uint16_t *srcY = (const uint16_t *)(src[Y_PLANE] + y * src_pitch[Y_PLANE]);
+        uint16_t *dstY = (uint16_t *)(dst[0].p_pixels + y * dst[0].i_pitch);
+        unsigned x = 0;
+
+        for (; x+15 < width; x += 16)
+            _mm256_storeu_si256((__m256i *)&dstY[x], _mm256_slli_epi16(
+                             _mm256_loadu_si256((const __m256i *)&srcY[x]), 6));
+        for (; x < width; x++)
+            dstY[x] = srcY[x] << 6;
+    }
+
+    const unsigned chroma_width = src_pitch[1] / 2;
+    for (unsigned y = 0; y < height / 2; y++) {
+        const uint16_t *srcU = (const uint16_t *)(src[U_PLANE] + y * src_pitch[U_PLANE]);
+        const uint16_t *srcV = (const uint16_t *)(src[V_PLANE] + y * src_pitch[V_PLANE]);
+        uint16_t *dstUV = (uint16_t *)(dst[1].p_pixels + y * dst[1].i_pitch);
+        unsigned x = 0;
+
+        for (; x+15 < chroma_width; x += 16) {
+            __m256i u = _mm256_slli_epi16(_mm256_loadu_si256((const __m256i *)&srcU[x]), 6);
+            __m256i v = _mm256_slli_epi16(_mm256_loadu_si256((const __m256i *)&srcV[x]), 6);
+            __m256i lo = _mm256_unpacklo_epi16(u, v);
+            __m256i hi = _mm256_unpackhi_epi16(u, v);
+            _mm256_storeu_si256((__m256i *)&dstUV[2*x +  0],
+                                _mm256_permute2x128_si256(lo, hi, 0x20));
+            _mm256_storeu_si256((__m256i *)&dstUV[2*x + 16],
+                                _mm256_permute2x128_si256(lo, hi, 0x31));
+        }
+        for (; x < chroma_width; x++) {
+            dstUV[2*x+0] = srcU[x] << 6;
+            dstUV[2*x+1] = srcV[x] << 6;
+        }
+    }
+}
+#endif
 #undef COPY64
 #endif /* CAN_COMPILE_SSE2 */
 
@@ -571,8 +866,31 @@ static void SplitPlanes(uint8_t *dstu, size_t dstu_pitch,
     }
 }
 
-void CopyFromNv12ToYv12(picture_t *dst, uint8_t *src[2], size_t src_pitch[2],
-                        unsigned height, copy_cache_t *cache)
+static void InterleavePlanes(uint8_t *dst, size_t dst_pitch,
+                             const uint8_t *srcu, size_t srcu_pitch,
+                             const uint8_t *srcv, size_t srcv_pitch,
+                             unsigned width, unsigned height)
+{
+    for (unsigned y = 0; y < height; y++) {
+        for (unsigned x = 0; x < width; x++) {
+            dst[2*x+0] = srcu[x];
+            dst[2*x+1] = srcv[x];
+        }
+        srcu += srcu_pitch;
+        srcv += srcv_pitch;
+        dst  += dst_pitch;
+    }
+}
+
+/*
+ * The conversions of a range of lines. The destination planes follow the
+ * layout of the picture planes, the chroma planes having half the lines.
+ */
+typedef void (*copy_planes_t)(plane_t *dst, uint8_t *src[], size_t src_pitch[],
+                              unsigned height, copy_cache_t *cache);
+
+static void CopyNv12ToYv12(plane_t *dst, uint8_t *src[], size_t src_pitch[],
+                           unsigned height, copy_cache_t *cache)
 {
 #ifdef CAN_COMPILE_SSE2
     unsigned cpu = vlc_CPU();
@@ -582,15 +900,15 @@ void CopyFromNv12ToYv12(picture_t *dst, uint8_t *src[2], size_t src_pitch[2],
     (void) cache;
 #endif
 
-    CopyPlane(dst->p[0].p_pixels, dst->p[0].i_pitch,
+    CopyPlane(dst[0].p_pixels, dst[0].i_pitch,
               src[0], src_pitch[0], height);
-    SplitPlanes(dst->p[2].p_pixels, dst->p[2].i_pitch,
-                dst->p[1].p_pixels, dst->p[1].i_pitch,
+    SplitPlanes(dst[2].p_pixels, dst[2].i_pitch,
+                dst[1].p_pixels, dst[1].i_pitch,
                 src[1], src_pitch[1], height/2);
 }
 
-void CopyFromNv12ToNv12(picture_t *dst, uint8_t *src[2], size_t src_pitch[2],
-                  unsigned height, copy_cache_t *cache)
+static void CopyNv12ToNv12(plane_t *dst, uint8_t *src[], size_t src_pitch[],
+                           unsigned height, copy_cache_t *cache)
 {
 #ifdef CAN_COMPILE_SSE2
     unsigned cpu = vlc_CPU();
@@ -601,14 +919,14 @@ void CopyFromNv12ToNv12(picture_t *dst, uint8_t *src[2], size_t src_pitch[2],
     (void) cache;
 #endif
 
-    CopyPlane(dst->p[0].p_pixels, dst->p[0].i_pitch,
+    CopyPlane(dst[0].p_pixels, dst[0].i_pitch,
               src[0], src_pitch[0], height);
-    CopyPlane(dst->p[1].p_pixels, dst->p[1].i_pitch,
+    CopyPlane(dst[1].p_pixels, dst[1].i_pitch,
               src[1], src_pitch[1], height/2);
 }
 
-void CopyFromNv12ToI420(picture_t *dst, uint8_t *src[2], size_t src_pitch[2],
-                        unsigned height, copy_cache_t *cache)
+static void CopyNv12ToI420(plane_t *dst, uint8_t *src[], size_t src_pitch[],
+                           unsigned height, copy_cache_t *cache)
 {
 #ifdef CAN_COMPILE_SSE2
     unsigned    cpu = vlc_CPU();
@@ -619,15 +937,15 @@ void CopyFromNv12ToI420(picture_t *dst, uint8_t *src[2], size_t src_pitch[2],
     VLC_UNUSED(cache);
 #endif
 
-    CopyPlane(dst->p[0].p_pixels, dst->p[0].i_pitch,
+    CopyPlane(dst[0].p_pixels, dst[0].i_pitch,
               src[0], src_pitch[0], height);
-    SplitPlanes(dst->p[1].p_pixels, dst->p[1].i_pitch,
-                dst->p[2].p_pixels, dst->p[2].i_pitch,
+    SplitPlanes(dst[1].p_pixels, dst[1].i_pitch,
+                dst[2].p_pixels, dst[2].i_pitch,
                 src[1], src_pitch[1], height/2);
 }
 
-void CopyFromI420ToNv12(picture_t *dst, uint8_t *src[3], size_t src_pitch[3],
-                        unsigned height, copy_cache_t *cache)
+static void CopyI420ToNv12(plane_t *dst, uint8_t *src[], size_t src_pitch[],
+                           unsigned height, copy_cache_t *cache)
 {
 #ifdef CAN_COMPILE_SSE2
     unsigned cpu = vlc_CPU();
@@ -638,75 +956,51 @@ void CopyFromI420ToNv12(picture_t *dst, uint8_t *src[3], size_t src_pitch[3],
     (void) cache;
 #endif
 
-    CopyPlane(dst->p[0].p_pixels, dst->p[0].i_pitch,
+    CopyPlane(dst[0].p_pixels, dst[0].i_pitch,
               src[0], src_pitch[0], height);
-
-    const unsigned copy_lines = height / 2;
-    const unsigned copy_pitch = src_pitch[1];
-
-    const int i_extra_pitch_uv = dst->p[1].i_pitch - 2 * copy_pitch;
-    const int i_extra_pitch_u  = src_pitch[U_PLANE] - copy_pitch;
-    const int i_extra_pitch_v  = src_pitch[V_PLANE] - copy_pitch;
-
-    uint8_t *dstUV = dst->p[1].p_pixels;
-    uint8_t *srcU  = src[U_PLANE];
-    uint8_t *srcV  = src[V_PLANE];
-    for ( unsigned int line = 0; line < copy_lines; line++ )
-    {
-        for ( unsigned int col = 0; col < copy_pitch; col++ )
-        {
-            *dstUV++ = *srcU++;
-            *dstUV++ = *srcV++;
-        }
-        dstUV += i_extra_pitch_uv;
-        srcU  += i_extra_pitch_u;
-        srcV  += i_extra_pitch_v;
-    }
+    InterleavePlanes(dst[1].p_pixels, dst[1].i_pitch,
+                     src[U_PLANE], src_pitch[U_PLANE],
+                     src[V_PLANE], src_pitch[V_PLANE],
+                     src_pitch[1], height / 2);
 }
 
-void CopyFromI420_10ToP010(picture_t *dst, uint8_t *src[3], size_t src_pitch[3],
-                        unsigned height, copy_cache_t *cache)
+static void CopyI420_10ToP010(plane_t *dst, uint8_t *src[], size_t src_pitch[],
+                              unsigned height, copy_cache_t *cache)
 {
     (void) cache;
+#ifdef CAN_COMPILE_SSE2
+    unsigned cpu = vlc_CPU();
+    VLC_UNUSED(cpu);
+# ifdef CAN_COMPILE_AVX2
+    if (vlc_CPU_AVX2())
+        return AVX2_CopyFromI420_10ToP010(dst, src, src_pitch, height);
+# endif
+    if (vlc_CPU_SSE2())
+        return SSE2_CopyFromI420_10ToP010(dst, src, src_pitch, height);
+#endif
 
-    const int i_extra_pitch_dst_y = (dst->p[0].i_pitch  - src_pitch[0]) / 2;
-    const int i_extra_pitch_src_y = (src_pitch[Y_PLANE] - src_pitch[0]) / 2;
-    uint16_t *dstY = dst->p[0].p_pixels;
-    uint16_t *srcY = src[Y_PLANE];
+    const unsigned width = src_pitch[0] / 2;
     for (unsigned y = 0; y < height; y++) {
-        for (unsigned x = 0; x < (src_pitch[0] / 2); x++) {
-            *dstY++ = *srcY++ << 6;
-        }
-        dstY += i_extra_pitch_dst_y;
-        srcY += i_extra_pitch_src_y;
+        const uint16_t *srcY = (const uint16_t *)(src[Y_PLANE] + y * src_pitch[Y_PLANE]);
+        uint16_t *dstY = (uint16_t *)(dst[0].p_pixels + y * dst[0].i_pitch);
+        for (unsigned x = 0; x < width; x++)
+            dstY[x] = srcY[x] << 6;
     }
 
-    const unsigned copy_lines = height / 2;
-    const unsigned copy_pitch = src_pitch[1] / 2;
-
-    const int i_extra_pitch_uv = dst->p[1].i_pitch / 2 - 2 * copy_pitch;
-    const int i_extra_pitch_u  = src_pitch[U_PLANE] / 2 - copy_pitch;
-    const int i_extra_pitch_v  = src_pitch[V_PLANE] / 2 - copy_pitch;
-
-    uint16_t *dstUV = dst->p[1].p_pixels;
-    uint16_t *srcU  = src[U_PLANE];
-    uint16_t *srcV  = src[V_PLANE];
-    for ( unsigned int line = 0; line < copy_lines; line++ )
-    {
-        for ( unsigned int col = 0; col < copy_pitch; col++ )
-        {
-            *dstUV++ = *srcU++ << 6;
-            *dstUV++ = *srcV++ << 6;
+    const unsigned chroma_width = src_pitch[1] / 2;
+    for (unsigned y = 0; y < height / 2; y++) {
+        const uint16_t *srcU = (const uint16_t *)(src[U_PLANE] + y * src_pitch[U_PLANE]);
+        const uint16_t *srcV = (const uint16_t *)(src[V_PLANE] + y * src_pitch[V_PLANE]);
+        uint16_t *dstUV = (uint16_t *)(dst[1].p_pixels + y * dst[1].i_pitch);
+        for (unsigned x = 0; x < chroma_width; x++) {
+            dstUV[2*x+0] = srcU[x] << 6;
+            dstUV[2*x+1] = srcV[x] << 6;
         }
-        dstUV += i_extra_pitch_uv;
-        srcU  += i_extra_pitch_u;
-        srcV  += i_extra_pitch_v;
     }
 }
 
-
-void CopyFromYv12ToYv12(picture_t *dst, uint8_t *src[3], size_t src_pitch[3],
-                        unsigned height, copy_cache_t *cache)
+static void CopyYv12ToYv12(plane_t *dst, uint8_t *src[], size_t src_pitch[],
+                           unsigned height, copy_cache_t *cache)
 {
 #ifdef CAN_COMPILE_SSE2
     unsigned cpu = vlc_CPU();
@@ -716,14 +1010,115 @@ void CopyFromYv12ToYv12(picture_t *dst, uint8_t *src[3], size_t src_pitch[3],
     (void) cache;
 #endif
 
-     CopyPlane(dst->p[0].p_pixels, dst->p[0].i_pitch,
+     CopyPlane(dst[0].p_pixels, dst[0].i_pitch,
                src[0], src_pitch[0], height);
-     CopyPlane(dst->p[1].p_pixels, dst->p[1].i_pitch,
+     CopyPlane(dst[1].p_pixels, dst[1].i_pitch,
                src[1], src_pitch[1], height / 2);
-     CopyPlane(dst->p[2].p_pixels, dst->p[2].i_pitch,
+     CopyPlane(dst[2].p_pixels, dst[2].i_pitch,
                src[2], src_pitch[2], height / 2);
 }
 
+/*
+ * Large pictures are split in horizontal stripes copied in parallel, each
+ * with its own part of the cache buffer.
+ */
+struct copy_slices
+{
+    copy_planes_t    copy;
+    const picture_t *dst;
+    uint8_t        **src;
+    size_t          *src_pitch;
+    unsigned         planes;
+    unsigned         height;
+    copy_cache_t    *cache;
+};
+
+static void CopySlice(void *opaque, unsigned slice, unsigned slices)
+{
+    const struct copy_slices *ctx = opaque;
+    plane_t dst[PICTURE_PLANE_MAX];
+    uint8_t *src[PICTURE_PLANE_MAX];
+    int start, end;
+
+    /* The stripes start on even lines, so that they match the lines of the
+     * chroma planes */
+    filter_GetSliceLines((ctx->height + 1) / 2, slice, slices, &start, &end);
+    start *= 2;
+    end = __MIN(2 * end, (int)ctx->height);
+
+    for (int n = 0; n < ctx->dst->i_planes; n++) {
+        dst[n] = ctx->dst->p[n];
+        dst[n].p_pixels += (n > 0 ? start / 2 : start) * dst[n].i_pitch;
+    }
+    for (unsigned n = 0; n < ctx->planes; n++)
+        src[n] = ctx->src[n] + (n > 0 ? start / 2 : start) * ctx->src_pitch[n];
+
+    copy_cache_t cache = *ctx->cache;
+#ifdef CAN_COMPILE_SSE2
+    cache.buffer += slice * cache.size;
+#endif
+    ctx->copy(dst, src, ctx->src_pitch, end - start, &cache);
+}
+
+static void CopySlices(copy_planes_t copy, picture_t *dst,
+                       uint8_t *src[], size_t src_pitch[], unsigned planes,
+                       unsigned height, copy_cache_t *cache)
+{
+    unsigned slices = __MIN(filter_GetSliceThreads(cache->slices),
+                            src_pitch[0] * height / COPY_SLICE_MIN_SIZE);
+    if (slices <= 1) {
+        copy(dst->p, src, src_pitch, height, cache);
+        return;
+    }
+
+    struct copy_slices ctx = {
+        .copy = copy,
+        .dst = dst,
+        .src = src,
+        .src_pitch = src_pitch,
+        .planes = planes,
+        .height = height,
+        .cache = cache,
+    };
+    filter_RunSlices(cache->slices, slices, CopySlice, &ctx);
+}
+
+void CopyFromNv12ToYv12(picture_t *dst, uint8_t *src[2], size_t src_pitch[2],
+                        unsigned height, copy_cache_t *cache)
+{
+    CopySlices(CopyNv12ToYv12, dst, src, src_pitch, 2, height, cache);
+}
+
+void CopyFromNv12ToNv12(picture_t *dst, uint8_t *src[2], size_t src_pitch[2],
+                  unsigned height, copy_cache_t *cache)
+{
+    CopySlices(CopyNv12ToNv12, dst, src, src_pitch, 2, height, cache);
+}
+
+void CopyFromNv12ToI420(picture_t *dst, uint8_t *src[2], size_t src_pitch[2],
+                        unsigned height, copy_cache_t *cache)
+{
+    CopySlices(CopyNv12ToI420, dst, src, src_pitch, 2, height, cache);
+}
+
+void CopyFromI420ToNv12(picture_t *dst, uint8_t *src[3], size_t src_pitch[3],
+                        unsigned height, copy_cache_t *cache)
+{
+    CopySlices(CopyI420ToNv12, dst, src, src_pitch, 3, height, cache);
+}
+
+void CopyFromI420_10ToP010(picture_t *dst, uint8_t *src[3], size_t src_pitch[3],
+                        unsigned height, copy_cache_t *cache)
+{
+    CopySlices(CopyI420_10ToP010, dst, src, src_pitch, 3, height, cache);
+}
+
+void CopyFromYv12ToYv12(picture_t *dst, uint8_t *src[3], size_t src_pitch[3],
+                        unsigned height, copy_cache_t *cache)
+{
+    CopySlices(CopyYv12ToYv12, dst, src, src_pitch, 3, height, cache);
+}
+
 int picture_UpdatePlanes(picture_t *picture, uint8_t *data, unsigned pitch)
 {
     /* fill in buffer info in first plane */
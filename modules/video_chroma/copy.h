@@ -29,9 +29,16 @@ typedef struct {
     uint8_t *buffer;
     size_t  size;
 # endif
+    struct filter_slices_t *slices;
 } copy_cache_t;
 
 int  CopyInitCache(copy_cache_t *cache, unsigned width);
+/**
+ * Initializes a cache for copies split in horizontal slices, run in
+ * parallel by up to threads threads (0 for the number of CPUs). Only the
+ * large pictures are split.
+ */
+int  CopyInitCacheSlices(copy_cache_t *cache, unsigned width, unsigned threads);
 void CopyCleanCache(copy_cache_t *cache);
 
 /* Copy planes from NV12 to YV12 */
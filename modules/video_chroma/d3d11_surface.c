@@ -648,7 +648,7 @@ static int OpenConverter( vlc_object_t *obj )
     if (!p_sys)
          goto done;
 
-    CopyInitCache(&p_sys->cache, p_filter->fmt_in.video.i_width );
+    CopyInitCacheSlices(&p_sys->cache, p_filter->fmt_in.video.i_width, 0);
     vlc_mutex_init(&p_sys->staging_lock);
     p_sys->hd3d_dll = hd3d_dll;
     p_filter->p_sys = p_sys;
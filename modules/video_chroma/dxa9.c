@@ -323,7 +323,7 @@ static int OpenConverter( vlc_object_t *obj )
          err = VLC_ENOMEM;
          goto done;
     }
-    CopyInitCache(&p_sys->cache, p_filter->fmt_in.video.i_width );
+    CopyInitCacheSlices(&p_sys->cache, p_filter->fmt_in.video.i_width, 0);
     p_filter->p_sys = p_sys;
     err = VLC_SUCCESS;
 
@@ -81,8 +81,8 @@ static int Create( vlc_object_t *p_this )
          return VLC_ENOMEM;
 
     p_filter->pf_video_filter = I420_10_P010_Filter;
-    CopyInitCache( &p_sys->cache, p_filter->fmt_in.video.i_x_offset +
-                                  p_filter->fmt_in.video.i_visible_width );
+    CopyInitCacheSlices( &p_sys->cache, p_filter->fmt_in.video.i_x_offset +
+                                        p_filter->fmt_in.video.i_visible_width, 0 );
     p_filter->p_sys = p_sys;
 
     return 0;
@@ -94,8 +94,8 @@ static int Create( vlc_object_t *p_this )
     if (!p_sys)
          return VLC_ENOMEM;
 
-    CopyInitCache( &p_sys->cache, p_filter->fmt_in.video.i_x_offset +
-                                  p_filter->fmt_in.video.i_visible_width );
+    CopyInitCacheSlices( &p_sys->cache, p_filter->fmt_in.video.i_x_offset +
+                                        p_filter->fmt_in.video.i_visible_width, 0 );
     p_filter->p_sys = p_sys;
 
     return 0;
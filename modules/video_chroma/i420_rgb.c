@@ -56,6 +56,7 @@ static picture_t *I420_R8G8B8A8_Filter( filter_t *, picture_t * );
 static picture_t *I420_B8G8R8A8_Filter( filter_t *, picture_t * );
 static picture_t *I420_A8B8G8R8_Filter( filter_t *, picture_t * );
 #endif
+static picture_t *I420_RGB_Line_Filter( filter_t *, picture_t * );
 
 /*****************************************************************************
  * RGB2PIXEL: assemble RGB components to a pixel value, returns a uint32_t
@@ -76,17 +77,17 @@ static void Deactivate ( vlc_object_t * );
 
 vlc_module_begin ()
 #if defined (SSE2)
-    set_description( N_( "SSE2 I420,IYUV,YV12 to "
+    set_description( N_( "SSE2 I420,IYUV,YV12,I0AL,P010 to "
                         "RV15,RV16,RV24,RV32 conversions") )
     set_capability( "video converter", 120 )
 # define vlc_CPU_capable() vlc_CPU_SSE2()
 #elif defined (MMX)
-    set_description( N_( "MMX I420,IYUV,YV12 to "
+    set_description( N_( "MMX I420,IYUV,YV12,I0AL,P010 to "
                         "RV15,RV16,RV24,RV32 conversions") )
     set_capability( "video converter", 100 )
 # define vlc_CPU_capable() vlc_CPU_MMX()
 #else
-    set_description( N_("I420,IYUV,YV12 to "
+    set_description( N_("I420,IYUV,YV12,I0AL,P010 to "
                        "RGB2,RV15,RV16,RV24,RV32 conversions") )
     set_capability( "video converter", 80 )
 # define vlc_CPU_capable() (true)
@@ -119,6 +120,12 @@ static int Activate( vlc_object_t *p_this )
         return VLC_EGENERIC;
     }
 
+    if( I420_RGB_SetupLine( p_filter ) == VLC_SUCCESS )
+    {
+        p_filter->pf_video_filter = I420_RGB_Line_Filter;
+        return VLC_SUCCESS;
+    }
+
     switch( p_filter->fmt_in.video.i_chroma )
     {
         case VLC_CODEC_YV12:
@@ -296,6 +303,7 @@ static void Deactivate( vlc_object_t *p_this )
     free( p_filter->p_sys );
 }
 
+VIDEO_FILTER_WRAPPER( I420_RGB_Line )
 #ifndef PLAIN
 VIDEO_FILTER_WRAPPER( I420_R5G5B5 )
 VIDEO_FILTER_WRAPPER( I420_R5G6B5 )
@@ -28,6 +28,15 @@
 /** Number of entries in RGB palette/colormap */
 #define CMAP_RGB2_SIZE 256
 
+/**
+ * Converts a line without scaling. p_u and p_v point to the chroma line,
+ * p_v is unused for semi-planar sources. RV32 converters place the red,
+ * green and blue bytes at the bit positions in pi_shift.
+ */
+typedef void (*i420_rgb_line_t)( void *p_dst, const void *p_y,
+                                 const void *p_u, const void *p_v,
+                                 unsigned i_width, const unsigned *pi_shift );
+
 /**
  * filter_sys_t: chroma method descriptor
 
@@ -39,6 +48,10 @@ struct filter_sys_t
     uint8_t  *p_buffer;
     int *p_offset;
 
+    i420_rgb_line_t pf_line;           /**< line converter, see i420_rgb_line.c */
+    unsigned  pi_shift[3];             /**< RV32 red, green and blue shifts */
+    bool      b_swap_uv;               /**< YV12 source */
+
 #ifdef PLAIN
     /**< Pre-calculated conversion tables */
     void *p_base;                      /**< base for all conversion tables */
@@ -72,6 +85,14 @@ void I420_B8G8R8A8     ( filter_t *, picture_t *, picture_t * );
 void I420_A8B8G8R8     ( filter_t *, picture_t *, picture_t * );
 #endif
 
+/**
+ * Sets up the line converters, which handle the conversions without scaling
+ * from 10 bits sources, and from 8 bits ones when AVX2 is available.
+ * \return VLC_SUCCESS with p_filter->p_sys allocated, or an error
+ */
+int  I420_RGB_SetupLine( filter_t * );
+void I420_RGB_Line     ( filter_t *, picture_t *, picture_t * );
+
 /*****************************************************************************
  * CONVERT_*_PIXEL: pixel conversion macros
  *****************************************************************************
@@ -0,0 +1,493 @@
+/*****************************************************************************
+ * i420_rgb_line.c : line based YUV to RGB conversions for vlc
+ *****************************************************************************
+ * Copyright (C) 2018 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_filter.h>
+#include <vlc_picture.h>
+#include <vlc_cpu.h>
+
+#include "i420_rgb.h"
+
+#ifdef CAN_COMPILE_AVX2
+# include <immintrin.h>
+# define VLC_AVX2 __attribute__ ((__target__ ("avx2")))
+#endif
+
+/*
+ * These converters use the fixed point arithmetic of the SSE2 ones: the
+ * samples are scaled to 11 bits, multiplied by the 16 bits ITU-R BT.601
+ * coefficients keeping the high word, and added with signed saturation.
+ * 10 bits samples scale to the same range as 8 bits ones, so a 10 bits
+ * picture made of 8 bits samples shifted left by 2 converts identically.
+ *
+ * The C versions are the reference for the SIMD ones, and also convert the
+ * last pixels of the lines.
+ */
+#define COEF_Y        0x253f
+#define COEF_U_BLUE   0x4093
+#define COEF_U_GREEN (-0x0c83)
+#define COEF_V_GREEN (-0x1a04)
+#define COEF_V_RED    0x3312
+
+/* Source layouts */
+enum
+{
+    LINE_8,     /**< 8 bits planes */
+    LINE_10,    /**< 10 bits little endian planes */
+    LINE_P010,  /**< 16 bits luma and interleaved chroma, 10 significant bits */
+    LINE_SOURCES
+};
+
+/* Destination layouts */
+enum
+{
+    LINE_RV15,
+    LINE_RV16,
+    LINE_RV32,  /**< components at the shifts given to the converter */
+    LINE_OUTPUTS
+};
+
+static inline int MulHigh( int a, int b )
+{
+    return (a * b) >> 16;
+}
+
+static inline int AddSat( int a, int b )
+{
+    return VLC_CLIP( a + b, INT16_MIN, INT16_MAX );
+}
+
+static inline void LoadC( int i_src, const void *p_y, const void *p_u,
+                          const void *p_v, unsigned i,
+                          int *pi_y, int *pi_u, int *pi_v )
+{
+    int y, u, v;
+
+    switch( i_src )
+    {
+        case LINE_8:
+            y = ((const uint8_t *)p_y)[i];
+            u = ((const uint8_t *)p_u)[i / 2];
+            v = ((const uint8_t *)p_v)[i / 2];
+            *pi_y = (y > 16 ? y - 16 : 0) * 8;
+            *pi_u = (u - 128) * 8;
+            *pi_v = (v - 128) * 8;
+            return;
+        case LINE_10:
+            y = ((const uint16_t *)p_y)[i] & 0x3ff;
+            u = ((const uint16_t *)p_u)[i / 2] & 0x3ff;
+            v = ((const uint16_t *)p_v)[i / 2] & 0x3ff;
+            break;
+        default: /* LINE_P010 */
+            y = ((const uint16_t *)p_y)[i] >> 6;
+            u = ((const uint16_t *)p_u)[i & ~1u] >> 6;
+            v = ((const uint16_t *)p_u)[i | 1u] >> 6;
+            break;
+    }
+    *pi_y = (y > 64 ? y - 64 : 0) * 2;
+    *pi_u = (u - 512) * 2;
+    *pi_v = (v - 512) * 2;
+}
+
+static inline void StoreC( int i_out, void *p_dst, unsigned i,
+                           unsigned r, unsigned g, unsigned b,
+                           const unsigned *pi_shift )
+{
+    switch( i_out )
+    {
+        case LINE_RV15:
+            ((uint16_t *)p_dst)[i] = ((r & 0xf8) << 7) | ((g & 0xf8) << 2)
+                                   | (b >> 3);
+            break;
+        case LINE_RV16:
+            ((uint16_t *)p_dst)[i] = ((r & 0xf8) << 8) | ((g & 0xfc) << 3)
+                                   | (b >> 3);
+            break;
+        default: /* LINE_RV32 */
+            ((uint32_t *)p_dst)[i] = ((uint32_t)r << pi_shift[0])
+                                   | ((uint32_t)g << pi_shift[1])
+                                   | ((uint32_t)b << pi_shift[2]);
+            break;
+    }
+}
+
+static inline void LineC( int i_src, int i_out, void *p_dst,
+                          const void *p_y, const void *p_u, const void *p_v,
+                          unsigned i_start, unsigned i_width,
+                          const unsigned *pi_shift )
+{
+    for( unsigned i = i_start; i < i_width; i++ )
+    {
+        int y, u, v;
+
+        LoadC( i_src, p_y, p_u, p_v, i, &y, &u, &v );
+        y = MulHigh( y, COEF_Y );
+
+        int b = AddSat( y, MulHigh( u, COEF_U_BLUE ) );
+        int r = AddSat( y, MulHigh( v, COEF_V_RED ) );
+        int g = AddSat( y, AddSat( MulHigh( u, COEF_U_GREEN ),
+                                   MulHigh( v, COEF_V_GREEN ) ) );
+
+        StoreC( i_out, p_dst, i, VLC_CLIP( r, 0, 255 ), VLC_CLIP( g, 0, 255 ),
+                VLC_CLIP( b, 0, 255 ), pi_shift );
+    }
+}
+
+#define LINE_C( src, out ) \
+static void Line_##src##_##out##_C( void *p_dst, const void *p_y, \
+                                    const void *p_u, const void *p_v, \
+                                    unsigned i_width, const unsigned *pi_shift ) \
+{ \
+    LineC( LINE_##src, LINE_##out, p_dst, p_y, p_u, p_v, 0, i_width, \
+           pi_shift ); \
+}
+
+LINE_C( 8, RV15 )
+LINE_C( 8, RV16 )
+LINE_C( 8, RV32 )
+LINE_C( 10, RV15 )
+LINE_C( 10, RV16 )
+LINE_C( 10, RV32 )
+LINE_C( P010, RV15 )
+LINE_C( P010, RV16 )
+LINE_C( P010, RV32 )
+
+static const i420_rgb_line_t lines_c[LINE_SOURCES][LINE_OUTPUTS] = {
+    { Line_8_RV15_C, Line_8_RV16_C, Line_8_RV32_C },
+    { Line_10_RV15_C, Line_10_RV16_C, Line_10_RV32_C },
+    { Line_P010_RV15_C, Line_P010_RV16_C, Line_P010_RV32_C },
+};
+
+#ifdef CAN_COMPILE_AVX2
+/* Loads the 11 bits luma and chroma of 16 pixels */
+VLC_AVX2
+static inline void LoadAVX2( int i_src, const void *p_y, const void *p_u,
+                             const void *p_v, unsigned i,
+                             __m256i *p_ymm_y, __m256i *p_ymm_u,
+                             __m256i *p_ymm_v )
+{
+    __m256i y, u, v;
+
+    switch( i_src )
+    {
+        case LINE_8:
+        {
+            __m128i u8 = _mm_loadl_epi64( (const __m128i *)
+                                          &((const uint8_t *)p_u)[i / 2] );
+            __m128i v8 = _mm_loadl_epi64( (const __m128i *)
+                                          &((const uint8_t *)p_v)[i / 2] );
+
+            y = _mm256_cvtepu8_epi16( _mm_loadu_si128( (const __m128i *)
+                                          &((const uint8_t *)p_y)[i] ) );
+            u = _mm256_cvtepu8_epi16( _mm_unpacklo_epi8( u8, u8 ) );
+            v = _mm256_cvtepu8_epi16( _mm_unpacklo_epi8( v8, v8 ) );
+            *p_ymm_y = _mm256_slli_epi16( _mm256_subs_epu16( y,
+                                              _mm256_set1_epi16( 16 ) ), 3 );
+            *p_ymm_u = _mm256_slli_epi16( _mm256_sub_epi16( u,
+                                              _mm256_set1_epi16( 128 ) ), 3 );
+            *p_ymm_v = _mm256_slli_epi16( _mm256_sub_epi16( v,
+                                              _mm256_set1_epi16( 128 ) ), 3 );
+            return;
+        }
+        case LINE_10:
+        {
+            const __m128i mask = _mm_set1_epi16( 0x3ff );
+            __m128i u10 = _mm_and_si128( mask, _mm_loadu_si128(
+                    (const __m128i *)&((const uint16_t *)p_u)[i / 2] ) );
+            __m128i v10 = _mm_and_si128( mask, _mm_loadu_si128(
+                    (const __m128i *)&((const uint16_t *)p_v)[i / 2] ) );
+
+            y = _mm256_and_si256( _mm256_set1_epi16( 0x3ff ),
+                    _mm256_loadu_si256( (const __m256i *)
+                                        &((const uint16_t *)p_y)[i] ) );
+            u = _mm256_cvtepu16_epi32( u10 );
+            u = _mm256_or_si256( u, _mm256_slli_epi32( u, 16 ) );
+            v = _mm256_cvtepu16_epi32( v10 );
+            v = _mm256_or_si256( v, _mm256_slli_epi32( v, 16 ) );
+            break;
+        }
+        default: /* LINE_P010 */
+        {
+            const __m256i shuf_u = _mm256_setr_epi8(
+                0, 1, 0, 1, 4, 5, 4, 5, 8, 9, 8, 9, 12, 13, 12, 13,
+                0, 1, 0, 1, 4, 5, 4, 5, 8, 9, 8, 9, 12, 13, 12, 13 );
+            const __m256i shuf_v = _mm256_setr_epi8(
+                2, 3, 2, 3, 6, 7, 6, 7, 10, 11, 10, 11, 14, 15, 14, 15,
+                2, 3, 2, 3, 6, 7, 6, 7, 10, 11, 10, 11, 14, 15, 14, 15 );
+            __m256i uv = _mm256_srli_epi16( _mm256_loadu_si256(
+                    (const __m256i *)&((const uint16_t *)p_u)[i] ), 6 );
+
+            y = _mm256_srli_epi16( _mm256_loadu_si256(
+                    (const __m256i *)&((const uint16_t *)p_y)[i] ), 6 );
+            u = _mm256_shuffle_epi8( uv, shuf_u );
+            v = _mm256_shuffle_epi8( uv, shuf_v );
+            break;
+        }
+    }
+    *p_ymm_y = _mm256_slli_epi16( _mm256_subs_epu16( y,
+                                      _mm256_set1_epi16( 64 ) ), 1 );
+    *p_ymm_u = _mm256_slli_epi16( _mm256_sub_epi16( u,
+                                      _mm256_set1_epi16( 512 ) ), 1 );
+    *p_ymm_v = _mm256_slli_epi16( _mm256_sub_epi16( v,
+                                      _mm256_set1_epi16( 512 ) ), 1 );
+}
+
+/* Stores 16 pixels from the 0..255 components */
+VLC_AVX2
+static inline void StoreAVX2( int i_out, void *p_dst, unsigned i,
+                              __m256i r, __m256i g, __m256i b,
+                              const __m128i *p_shift )
+{
+    switch( i_out )
+    {
+        case LINE_RV15:
+        case LINE_RV16:
+        {
+            const __m256i mask_rb = _mm256_set1_epi16( 0xf8 );
+            __m256i px;
+
+            if( i_out == LINE_RV15 )
+                px = _mm256_or_si256(
+                    _mm256_slli_epi16( _mm256_and_si256( r, mask_rb ), 7 ),
+                    _mm256_slli_epi16( _mm256_and_si256( g, mask_rb ), 2 ) );
+            else
+                px = _mm256_or_si256(
+                    _mm256_slli_epi16( _mm256_and_si256( r, mask_rb ), 8 ),
+                    _mm256_slli_epi16( _mm256_and_si256( g,
+                                           _mm256_set1_epi16( 0xfc ) ), 3 ) );
+            px = _mm256_or_si256( px, _mm256_srli_epi16( b, 3 ) );
+            _mm256_storeu_si256( (__m256i *)&((uint16_t *)p_dst)[i], px );
+            break;
+        }
+        default: /* LINE_RV32 */
+        {
+#define RV32_HALF( n ) \
+            _mm256_or_si256( _mm256_or_si256( \
+                _mm256_sll_epi32( _mm256_cvtepu16_epi32( \
+                    _mm256_extracti128_si256( r, n ) ), p_shift[0] ), \
+                _mm256_sll_epi32( _mm256_cvtepu16_epi32( \
+                    _mm256_extracti128_si256( g, n ) ), p_shift[1] ) ), \
+                _mm256_sll_epi32( _mm256_cvtepu16_epi32( \
+                    _mm256_extracti128_si256( b, n ) ), p_shift[2] ) )
+
+            uint32_t *p_px = &((uint32_t *)p_dst)[i];
+
+            _mm256_storeu_si256( (__m256i *)p_px, RV32_HALF( 0 ) );
+            _mm256_storeu_si256( (__m256i *)(p_px + 8), RV32_HALF( 1 ) );
+#undef RV32_HALF
+            break;
+        }
+    }
+}
+
+VLC_AVX2
+static inline void LineAVX2( int i_src, int i_out, void *p_dst,
+                             const void *p_y, const void *p_u,
+                             const void *p_v, unsigned i_width,
+                             const unsigned *pi_shift )
+{
+    const __m256i coef_y = _mm256_set1_epi16( COEF_Y );
+    const __m256i coef_ub = _mm256_set1_epi16( COEF_U_BLUE );
+    const __m256i coef_ug = _mm256_set1_epi16( COEF_U_GREEN );
+    const __m256i coef_vg = _mm256_set1_epi16( COEF_V_GREEN );
+    const __m256i coef_vr = _mm256_set1_epi16( COEF_V_RED );
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i max = _mm256_set1_epi16( 255 );
+    const __m128i shift[3] = {
+        _mm_cvtsi32_si128( pi_shift[0] ),
+        _mm_cvtsi32_si128( pi_shift[1] ),
+        _mm_cvtsi32_si128( pi_shift[2] ),
+    };
+    unsigned i;
+
+    for( i = 0; i + 16 <= i_width; i += 16 )
+    {
+        __m256i y, u, v;
+
+        LoadAVX2( i_src, p_y, p_u, p_v, i, &y, &u, &v );
+        y = _mm256_mulhi_epi16( y, coef_y );
+
+        __m256i b = _mm256_adds_epi16( y, _mm256_mulhi_epi16( u, coef_ub ) );
+        __m256i r = _mm256_adds_epi16( y, _mm256_mulhi_epi16( v, coef_vr ) );
+        __m256i g = _mm256_adds_epi16( y, _mm256_adds_epi16(
+                                    _mm256_mulhi_epi16( u, coef_ug ),
+                                    _mm256_mulhi_epi16( v, coef_vg ) ) );
+
+        r = _mm256_min_epi16( _mm256_max_epi16( r, zero ), max );
+        g = _mm256_min_epi16( _mm256_max_epi16( g, zero ), max );
+        b = _mm256_min_epi16( _mm256_max_epi16( b, zero ), max );
+        StoreAVX2( i_out, p_dst, i, r, g, b, shift );
+    }
+    LineC( i_src, i_out, p_dst, p_y, p_u, p_v, i, i_width, pi_shift );
+}
+
+#define LINE_AVX2( src, out ) \
+VLC_AVX2 \
+static void Line_##src##_##out##_AVX2( void *p_dst, const void *p_y, \
+                                       const void *p_u, const void *p_v, \
+                                       unsigned i_width, \
+                                       const unsigned *pi_shift ) \
+{ \
+    LineAVX2( LINE_##src, LINE_##out, p_dst, p_y, p_u, p_v, i_width, \
+              pi_shift ); \
+}
+
+LINE_AVX2( 8, RV15 )
+LINE_AVX2( 8, RV16 )
+LINE_AVX2( 8, RV32 )
+LINE_AVX2( 10, RV15 )
+LINE_AVX2( 10, RV16 )
+LINE_AVX2( 10, RV32 )
+LINE_AVX2( P010, RV15 )
+LINE_AVX2( P010, RV16 )
+LINE_AVX2( P010, RV32 )
+
+static const i420_rgb_line_t lines_avx2[LINE_SOURCES][LINE_OUTPUTS] = {
+    { Line_8_RV15_AVX2, Line_8_RV16_AVX2, Line_8_RV32_AVX2 },
+    { Line_10_RV15_AVX2, Line_10_RV16_AVX2, Line_10_RV32_AVX2 },
+    { Line_P010_RV15_AVX2, Line_P010_RV16_AVX2, Line_P010_RV32_AVX2 },
+};
+#endif
+
+/* Returns the position of a byte wide component, or -1 */
+static int GetByteShift( uint32_t i_mask )
+{
+    for( int i_shift = 0; i_shift < 32; i_shift += 8 )
+        if( i_mask == 0xffu << i_shift )
+            return i_shift;
+    return -1;
+}
+
+int I420_RGB_SetupLine( filter_t *p_filter )
+{
+    const video_format_t *p_in = &p_filter->fmt_in.video;
+    const video_format_t *p_out = &p_filter->fmt_out.video;
+    unsigned pi_shift[3] = { 0, 0, 0 };
+    bool b_swap_uv = false;
+    int i_src, i_out;
+
+    if( p_in->i_x_offset + p_in->i_visible_width
+            != p_out->i_x_offset + p_out->i_visible_width
+     || p_in->i_y_offset + p_in->i_visible_height
+            != p_out->i_y_offset + p_out->i_visible_height )
+        return VLC_EGENERIC;
+
+    switch( p_in->i_chroma )
+    {
+        case VLC_CODEC_YV12:
+            b_swap_uv = true;
+            /* fall through */
+        case VLC_CODEC_I420:
+            i_src = LINE_8;
+            break;
+        case VLC_CODEC_I420_10L:
+            i_src = LINE_10;
+            break;
+        case VLC_CODEC_P010:
+            i_src = LINE_P010;
+            break;
+        default:
+            return VLC_EGENERIC;
+    }
+
+    switch( p_out->i_chroma )
+    {
+        case VLC_CODEC_RGB15:
+        case VLC_CODEC_RGB16:
+            if( p_out->i_rmask == 0x7c00 && p_out->i_gmask == 0x03e0
+             && p_out->i_bmask == 0x001f )
+                i_out = LINE_RV15;
+            else if( p_out->i_rmask == 0xf800 && p_out->i_gmask == 0x07e0
+                  && p_out->i_bmask == 0x001f )
+                i_out = LINE_RV16;
+            else
+                return VLC_EGENERIC;
+            break;
+        case VLC_CODEC_RGB32:
+        {
+            int i_rshift = GetByteShift( p_out->i_rmask );
+            int i_gshift = GetByteShift( p_out->i_gmask );
+            int i_bshift = GetByteShift( p_out->i_bmask );
+
+            if( i_rshift < 0 || i_gshift < 0 || i_bshift < 0
+             || i_rshift == i_gshift || i_gshift == i_bshift
+             || i_bshift == i_rshift )
+                return VLC_EGENERIC;
+            pi_shift[0] = i_rshift;
+            pi_shift[1] = i_gshift;
+            pi_shift[2] = i_bshift;
+            i_out = LINE_RV32;
+            break;
+        }
+        default:
+            return VLC_EGENERIC;
+    }
+
+    i420_rgb_line_t pf_line = NULL;
+#ifdef CAN_COMPILE_AVX2
+    if( vlc_CPU_AVX2() )
+        pf_line = lines_avx2[i_src][i_out];
+#endif
+    /* The 8 bits C converters would not be faster than the existing ones */
+    if( pf_line == NULL && i_src != LINE_8 )
+        pf_line = lines_c[i_src][i_out];
+    if( pf_line == NULL )
+        return VLC_EGENERIC;
+
+    filter_sys_t *p_sys = calloc( 1, sizeof( *p_sys ) );
+    if( p_sys == NULL )
+        return VLC_ENOMEM;
+
+    p_sys->pf_line = pf_line;
+    memcpy( p_sys->pi_shift, pi_shift, sizeof( pi_shift ) );
+    p_sys->b_swap_uv = b_swap_uv;
+    p_filter->p_sys = p_sys;
+    return VLC_SUCCESS;
+}
+
+void I420_RGB_Line( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    const unsigned i_width = p_filter->fmt_in.video.i_x_offset
+                           + p_filter->fmt_in.video.i_visible_width;
+    const unsigned i_height = p_filter->fmt_in.video.i_y_offset
+                            + p_filter->fmt_in.video.i_visible_height;
+    const plane_t *p_y = &p_src->p[Y_PLANE];
+    const plane_t *p_u = &p_src->p[U_PLANE];
+    const plane_t *p_v = p_src->i_planes > V_PLANE ? &p_src->p[V_PLANE] : p_u;
+
+    if( p_sys->b_swap_uv )
+    {
+        const plane_t *p_tmp = p_u;
+        p_u = p_v;
+        p_v = p_tmp;
+    }
+
+    for( unsigned i_line = 0; i_line < i_height; i_line++ )
+        p_sys->pf_line( &p_dest->p->p_pixels[i_line * p_dest->p->i_pitch],
+                        &p_y->p_pixels[i_line * p_y->i_pitch],
+                        &p_u->p_pixels[i_line / 2 * p_u->i_pitch],
+                        &p_v->p_pixels[i_line / 2 * p_v->i_pitch],
+                        i_width, p_sys->pi_shift );
+}
@@ -42,6 +42,11 @@
 
 #include "i420_yuy2.h"
 
+#if defined (MODULE_NAME_IS_i420_yuy2_sse2) && defined (CAN_COMPILE_AVX2)
+#   include <immintrin.h>
+#   define VLC_AVX2 __attribute__ ((__target__ ("avx2")))
+#endif
+
 #define SRC_FOURCC  "I420,IYUV,YV12"
 
 #if defined (MODULE_NAME_IS_i420_yuy2)
@@ -77,6 +82,10 @@ static picture_t *I420_IUYV_Filter    ( filter_t *, picture_t * );
 static void I420_Y211           ( filter_t *, picture_t *, picture_t * );
 static picture_t *I420_Y211_Filter    ( filter_t *, picture_t * );
 #endif
+#if defined (MODULE_NAME_IS_i420_yuy2_sse2) && defined (CAN_COMPILE_AVX2)
+static void AVX2_I420_422       ( filter_t *, picture_t *, picture_t *,
+                                  bool, bool );
+#endif
 
 /*****************************************************************************
  * Module descriptor.
@@ -339,6 +348,14 @@ static void I420_YUY2( filter_t *p_filter, picture_t *p_source,
 #endif
 
 #else // defined(MODULE_NAME_IS_i420_yuy2_sse2)
+#if defined (CAN_COMPILE_AVX2)
+    if( vlc_CPU_AVX2() )
+    {
+        AVX2_I420_422( p_filter, p_source, p_dest, false, false );
+        return;
+    }
+#endif
+
     /*
     ** SSE2 128 bits fetch/store instructions are faster
     ** if memory access is 16 bytes aligned
@@ -550,6 +567,14 @@ static void I420_YVYU( filter_t *p_filter, picture_t *p_source,
 #endif
 
 #else // defined(MODULE_NAME_IS_i420_yuy2_sse2)
+#if defined (CAN_COMPILE_AVX2)
+    if( vlc_CPU_AVX2() )
+    {
+        AVX2_I420_422( p_filter, p_source, p_dest, true, false );
+        return;
+    }
+#endif
+
     /*
     ** SSE2 128 bits fetch/store instructions are faster
     ** if memory access is 16 bytes aligned
@@ -763,6 +788,14 @@ static void I420_UYVY( filter_t *p_filter, picture_t *p_source,
 #endif
 
 #else // defined(MODULE_NAME_IS_i420_yuy2_sse2)
+#if defined (CAN_COMPILE_AVX2)
+    if( vlc_CPU_AVX2() )
+    {
+        AVX2_I420_422( p_filter, p_source, p_dest, false, true );
+        return;
+    }
+#endif
+
     /*
     ** SSE2 128 bits fetch/store instructions are faster
     ** if memory access is 16 bytes aligned
@@ -829,6 +862,87 @@ static void I420_UYVY( filter_t *p_filter, picture_t *p_source,
 #endif // defined(MODULE_NAME_IS_i420_yuy2_sse2)
 }
 
+#if defined (MODULE_NAME_IS_i420_yuy2_sse2) && defined (CAN_COMPILE_AVX2)
+/*****************************************************************************
+ * AVX2_I420_422: planar YUV 4:2:0 to packed YUYV, YVYU or UYVY 4:2:2
+ *****************************************************************************
+ * 32 pixels of two lines are packed at a time, the rest with C code.
+ *****************************************************************************/
+VLC_AVX2
+static void AVX2_I420_422( filter_t *p_filter, picture_t *p_source,
+                           picture_t *p_dest, bool b_swap_uv, bool b_uv_first )
+{
+    const unsigned i_width = p_filter->fmt_in.video.i_x_offset
+                           + p_filter->fmt_in.video.i_visible_width;
+    const unsigned i_height = p_filter->fmt_in.video.i_y_offset
+                            + p_filter->fmt_in.video.i_visible_height;
+    const plane_t *p_y = &p_source->p[Y_PLANE];
+    const plane_t *p_c1 = &p_source->p[b_swap_uv ? V_PLANE : U_PLANE];
+    const plane_t *p_c2 = &p_source->p[b_swap_uv ? U_PLANE : V_PLANE];
+
+    for( unsigned i_y = 0; i_y < i_height / 2; i_y++ )
+    {
+        const uint8_t *p_y1 = &p_y->p_pixels[2 * i_y * p_y->i_pitch];
+        const uint8_t *p_y2 = p_y1 + p_y->i_pitch;
+        const uint8_t *p_1 = &p_c1->p_pixels[i_y * p_c1->i_pitch];
+        const uint8_t *p_2 = &p_c2->p_pixels[i_y * p_c2->i_pitch];
+        uint8_t *p_line1 = &p_dest->p->p_pixels[2 * i_y * p_dest->p->i_pitch];
+        uint8_t *p_line2 = p_line1 + p_dest->p->i_pitch;
+        unsigned i_x;
+
+        for( i_x = 0; i_x + 32 <= i_width; i_x += 32 )
+        {
+            __m128i c1 = _mm_loadu_si128( (const __m128i *)&p_1[i_x / 2] );
+            __m128i c2 = _mm_loadu_si128( (const __m128i *)&p_2[i_x / 2] );
+            /* chroma of pixels 0-15 in the low lane, 16-31 in the high one,
+             * like the luma */
+            __m256i uv = _mm256_inserti128_si256(
+                _mm256_castsi128_si256( _mm_unpacklo_epi8( c1, c2 ) ),
+                _mm_unpackhi_epi8( c1, c2 ), 1 );
+            __m256i y1 = _mm256_loadu_si256( (const __m256i *)&p_y1[i_x] );
+            __m256i y2 = _mm256_loadu_si256( (const __m256i *)&p_y2[i_x] );
+            __m256i lo1, hi1, lo2, hi2;
+
+            if( b_uv_first )
+            {
+                lo1 = _mm256_unpacklo_epi8( uv, y1 );
+                hi1 = _mm256_unpackhi_epi8( uv, y1 );
+                lo2 = _mm256_unpacklo_epi8( uv, y2 );
+                hi2 = _mm256_unpackhi_epi8( uv, y2 );
+            }
+            else
+            {
+                lo1 = _mm256_unpacklo_epi8( y1, uv );
+                hi1 = _mm256_unpackhi_epi8( y1, uv );
+                lo2 = _mm256_unpacklo_epi8( y2, uv );
+                hi2 = _mm256_unpackhi_epi8( y2, uv );
+            }
+            _mm256_storeu_si256( (__m256i *)&p_line1[2 * i_x],
+                                 _mm256_permute2x128_si256( lo1, hi1, 0x20 ) );
+            _mm256_storeu_si256( (__m256i *)&p_line1[2 * i_x + 32],
+                                 _mm256_permute2x128_si256( lo1, hi1, 0x31 ) );
+            _mm256_storeu_si256( (__m256i *)&p_line2[2 * i_x],
+                                 _mm256_permute2x128_si256( lo2, hi2, 0x20 ) );
+            _mm256_storeu_si256( (__m256i *)&p_line2[2 * i_x + 32],
+                                 _mm256_permute2x128_si256( lo2, hi2, 0x31 ) );
+        }
+
+        for( ; i_x < i_width; i_x += 2 )
+        {
+            uint8_t *p_px1 = &p_line1[2 * i_x], *p_px2 = &p_line2[2 * i_x];
+            const int i_luma = b_uv_first ? 1 : 0;
+
+            p_px1[i_luma]     = p_y1[i_x];
+            p_px1[i_luma + 2] = p_y1[i_x + 1];
+            p_px2[i_luma]     = p_y2[i_x];
+            p_px2[i_luma + 2] = p_y2[i_x + 1];
+            p_px1[1 - i_luma] = p_px2[1 - i_luma] = p_1[i_x / 2];
+            p_px1[3 - i_luma] = p_px2[3 - i_luma] = p_2[i_x / 2];
+        }
+    }
+}
+#endif
+
 #if !defined (MODULE_NAME_IS_i420_yuy2_altivec)
 /*****************************************************************************
  * I420_IUYV: planar YUV 4:2:0 to interleaved packed UYVY 4:2:2
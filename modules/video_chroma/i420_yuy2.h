@@ -334,7 +334,7 @@ movdqu    %%xmm1, 16(%1)  # Store high UYVY                               \n\
     xmm4 = _mm_unpacklo_epi8(xmm4, xmm1);           \
     _mm_stream_si128((__m128i*)(p_line2), xmm4);    \
     xmm3 = _mm_unpackhi_epi8(xmm3, xmm1);           \
-    _mm_stream_si128((__m128i*)(p_line1+16), xmm3);
+    _mm_stream_si128((__m128i*)(p_line2+16), xmm3);
 
 #define SSE2_YUV420_YUYV_UNALIGNED                  \
     xmm1 = _mm_loadl_epi64((__m128i *)p_u);         \
@@ -353,7 +353,7 @@ movdqu    %%xmm1, 16(%1)  # Store high UYVY                               \n\
     xmm4 = _mm_unpacklo_epi8(xmm4, xmm1);           \
     _mm_storeu_si128((__m128i*)(p_line2), xmm4);    \
     xmm3 = _mm_unpackhi_epi8(xmm3, xmm1);           \
-    _mm_storeu_si128((__m128i*)(p_line1+16), xmm3);
+    _mm_storeu_si128((__m128i*)(p_line2+16), xmm3);
 
 #define SSE2_YUV420_YVYU_ALIGNED                    \
     xmm1 = _mm_loadl_epi64((__m128i *)p_v);         \
@@ -370,7 +370,7 @@ movdqu    %%xmm1, 16(%1)  # Store high UYVY                               \n\
     xmm4 = _mm_unpacklo_epi8(xmm4, xmm1);           \
     _mm_stream_si128((__m128i*)(p_line2), xmm4);    \
     xmm3 = _mm_unpackhi_epi8(xmm3, xmm1);           \
-    _mm_stream_si128((__m128i*)(p_line1+16), xmm3);
+    _mm_stream_si128((__m128i*)(p_line2+16), xmm3);
 
 #define SSE2_YUV420_YVYU_UNALIGNED                  \
     xmm1 = _mm_loadl_epi64((__m128i *)p_v);         \
@@ -389,7 +389,7 @@ movdqu    %%xmm1, 16(%1)  # Store high UYVY                               \n\
     xmm4 = _mm_unpacklo_epi8(xmm4, xmm1);           \
     _mm_storeu_si128((__m128i*)(p_line2), xmm4);    \
     xmm3 = _mm_unpackhi_epi8(xmm3, xmm1);           \
-    _mm_storeu_si128((__m128i*)(p_line1+16), xmm3);
+    _mm_storeu_si128((__m128i*)(p_line2+16), xmm3);
 
 #define SSE2_YUV420_UYVY_ALIGNED                    \
     xmm1 = _mm_loadl_epi64((__m128i *)p_u);         \
@@ -407,7 +407,7 @@ movdqu    %%xmm1, 16(%1)  # Store high UYVY                               \n\
     xmm4 = _mm_unpacklo_epi8(xmm4, xmm3);           \
     _mm_stream_si128((__m128i*)(p_line2), xmm4);    \
     xmm1 = _mm_unpackhi_epi8(xmm1, xmm3);           \
-    _mm_stream_si128((__m128i*)(p_line1+16), xmm1);
+    _mm_stream_si128((__m128i*)(p_line2+16), xmm1);
 
 #define SSE2_YUV420_UYVY_UNALIGNED                  \
     xmm1 = _mm_loadl_epi64((__m128i *)p_u);         \
@@ -427,7 +427,7 @@ movdqu    %%xmm1, 16(%1)  # Store high UYVY                               \n\
     xmm4 = _mm_unpacklo_epi8(xmm4, xmm3);           \
     _mm_storeu_si128((__m128i*)(p_line2), xmm4);    \
     xmm1 = _mm_unpackhi_epi8(xmm1, xmm3);           \
-    _mm_storeu_si128((__m128i*)(p_line1+16), xmm1);
+    _mm_storeu_si128((__m128i*)(p_line2+16), xmm1);
 
 #endif
 
@@ -72,6 +72,9 @@ static int AdjustCallback( vlc_object_t *p_this, char const *psz_var,
 #define LUM_LONGTEXT N_("Set the image brightness, between 0 and 2. Defaults to 1.")
 #define GAMMA_TEXT N_("Image gamma (0-10)")
 #define GAMMA_LONGTEXT N_("Set the image gamma, between 0.01 and 10. Defaults to 1.")
+#define THREADS_TEXT N_("Adjust threads")
+#define THREADS_LONGTEXT N_("Number of threads processing each picture. " \
+        "Defaults to 0, one per CPU.")
 
 vlc_module_begin ()
     set_description( N_("Image properties filter") )
@@ -98,6 +101,8 @@ vlc_module_begin ()
     add_bool( "brightness-threshold", false,
               THRES_TEXT, THRES_LONGTEXT, false )
         change_safe()
+    add_integer_with_range( "adjust-threads", 0, 0, 64,
+                            THREADS_TEXT, THREADS_LONGTEXT, true )
 
     add_shortcut( "adjust" )
     set_callbacks( Create, Destroy )
@@ -105,7 +110,7 @@ vlc_module_end ()
 
 static const char *const ppsz_filter_options[] = {
     "contrast", "brightness", "hue", "saturation", "gamma",
-    "brightness-threshold", NULL
+    "brightness-threshold", "adjust-threads", NULL
 };
 
 /*****************************************************************************
@@ -123,6 +128,7 @@ struct filter_sys_t
                                int, int );
     int (*pf_process_sat_hue_clip)( picture_t *, picture_t *, int, int,
                                     int, int, int );
+    filter_slices_t *p_slices;
 };
 
 /*****************************************************************************
@@ -195,6 +201,9 @@ static int Create( vlc_object_t *p_this )
     atomic_init( &p_sys->b_brightness_threshold,
                  var_CreateGetBoolCommand( p_filter, "brightness-threshold" ) );
 
+    p_sys->p_slices = filter_NewSlices(
+                            var_InheritInteger( p_filter, "adjust-threads" ) );
+
     var_AddCallback( p_filter, "contrast",   AdjustCallback, p_sys );
     var_AddCallback( p_filter, "brightness", AdjustCallback, p_sys );
     var_AddCallback( p_filter, "hue",        AdjustCallback, p_sys );
@@ -222,9 +231,228 @@ static void Destroy( vlc_object_t *p_this )
     var_DelCallback( p_filter, "brightness-threshold",
                                              AdjustCallback, p_sys );
 
+    filter_DeleteSlices( p_sys->p_slices );
     free( p_sys );
 }
 
+/*****************************************************************************
+ * Slices: the pictures are cut in horizontal stripes processed in parallel
+ *****************************************************************************/
+struct adjust_job
+{
+    filter_sys_t *p_sys;
+    picture_t    *p_pic;
+    picture_t    *p_outpic;
+    const int    *pi_luma;
+    bool          b_16bit;
+    bool          b_clip;
+    int           i_sin, i_cos, i_sat, i_x, i_y;
+    atomic_bool   b_error;
+};
+
+/* Fills a shallow copy of a picture, restricted to the lines of a slice */
+static void SliceView( picture_t *p_view, const picture_t *p_pic,
+                       unsigned i_slice, unsigned i_slices )
+{
+    *p_view = *p_pic;
+    for( int i = 0; i < p_pic->i_planes; i++ )
+    {
+        plane_t *p = &p_view->p[i];
+        int i_start, i_end;
+
+        filter_GetSliceLines( p->i_visible_lines, i_slice, i_slices,
+                              &i_start, &i_end );
+        p->p_pixels += i_start * p->i_pitch;
+        p->i_lines = p->i_visible_lines = i_end - i_start;
+    }
+}
+
+static void AdjustPlanarSlice( void *opaque, unsigned i_slice,
+                               unsigned i_slices )
+{
+    struct adjust_job *job = opaque;
+    filter_sys_t *p_sys = job->p_sys;
+    const int *pi_luma = job->pi_luma;
+    picture_t pic, outpic;
+    picture_t *p_pic = &pic, *p_outpic = &outpic;
+
+    SliceView( p_pic, job->p_pic, i_slice, i_slices );
+    SliceView( p_outpic, job->p_outpic, i_slice, i_slices );
+
+    /*
+     * Do the Y plane
+     */
+    if ( job->b_16bit )
+    {
+        uint16_t *p_in, *p_in_end, *p_line_end;
+        uint16_t *p_out;
+        p_in = (uint16_t *) p_pic->p[Y_PLANE].p_pixels;
+        p_in_end = p_in + p_pic->p[Y_PLANE].i_visible_lines
+            * (p_pic->p[Y_PLANE].i_pitch >> 1) - 8;
+
+        p_out = (uint16_t *) p_outpic->p[Y_PLANE].p_pixels;
+
+        for( ; p_in < p_in_end ; )
+        {
+            p_line_end = p_in + (p_pic->p[Y_PLANE].i_visible_pitch >> 1) - 8;
+
+            for( ; p_in < p_line_end ; )
+            {
+                /* Do 8 pixels at a time */
+                *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ];
+                *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ];
+                *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ];
+                *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ];
+            }
+
+            p_line_end += 8;
+
+            for( ; p_in < p_line_end ; )
+            {
+                *p_out++ = pi_luma[ *p_in++ ];
+            }
+
+            p_in += (p_pic->p[Y_PLANE].i_pitch >> 1)
+                - (p_pic->p[Y_PLANE].i_visible_pitch >> 1);
+            p_out += (p_outpic->p[Y_PLANE].i_pitch >> 1)
+                - (p_outpic->p[Y_PLANE].i_visible_pitch >> 1);
+        }
+    }
+    else
+    {
+        uint8_t *p_in, *p_in_end, *p_line_end;
+        uint8_t *p_out;
+        p_in = p_pic->p[Y_PLANE].p_pixels;
+        p_in_end = p_in + p_pic->p[Y_PLANE].i_visible_lines
+                 * p_pic->p[Y_PLANE].i_pitch - 8;
+
+        p_out = p_outpic->p[Y_PLANE].p_pixels;
+
+        for( ; p_in < p_in_end ; )
+        {
+            p_line_end = p_in + p_pic->p[Y_PLANE].i_visible_pitch - 8;
+
+            for( ; p_in < p_line_end ; )
+            {
+                /* Do 8 pixels at a time */
+                *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ];
+                *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ];
+                *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ];
+                *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ];
+            }
+
+            p_line_end += 8;
+
+            for( ; p_in < p_line_end ; )
+            {
+                *p_out++ = pi_luma[ *p_in++ ];
+            }
+
+            p_in += p_pic->p[Y_PLANE].i_pitch
+                  - p_pic->p[Y_PLANE].i_visible_pitch;
+            p_out += p_outpic->p[Y_PLANE].i_pitch
+                   - p_outpic->p[Y_PLANE].i_visible_pitch;
+        }
+    }
+
+    /*
+     * Do the U and V planes
+     */
+    if ( job->b_clip )
+    {
+        /* Currently no errors are implemented in the function, if any are added
+         * check them here */
+        p_sys->pf_process_sat_hue_clip( p_pic, p_outpic, job->i_sin, job->i_cos,
+                                        job->i_sat, job->i_x, job->i_y );
+    }
+    else
+    {
+        /* Currently no errors are implemented in the function, if any are added
+         * check them here */
+        p_sys->pf_process_sat_hue( p_pic, p_outpic, job->i_sin, job->i_cos,
+                                   job->i_sat, job->i_x, job->i_y );
+    }
+}
+
+static void AdjustPackedSlice( void *opaque, unsigned i_slice,
+                               unsigned i_slices )
+{
+    struct adjust_job *job = opaque;
+    filter_sys_t *p_sys = job->p_sys;
+    const int *pi_luma = job->pi_luma;
+    picture_t pic, outpic;
+    picture_t *p_pic = &pic, *p_outpic = &outpic;
+    uint8_t *p_in, *p_in_end, *p_line_end;
+    uint8_t *p_out;
+    int i_y_offset, i_u_offset, i_v_offset;
+    int i_pitch, i_visible_pitch;
+    int i_ret;
+
+    SliceView( p_pic, job->p_pic, i_slice, i_slices );
+    SliceView( p_outpic, job->p_outpic, i_slice, i_slices );
+
+    i_pitch = p_pic->p->i_pitch;
+    i_visible_pitch = p_pic->p->i_visible_pitch;
+
+    if( GetPackedYuvOffsets( p_pic->format.i_chroma, &i_y_offset,
+                             &i_u_offset, &i_v_offset ) != VLC_SUCCESS )
+    {
+        atomic_store( &job->b_error, true );
+        return;
+    }
+
+    /*
+     * Do the Y plane
+     */
+
+    p_in = p_pic->p->p_pixels + i_y_offset;
+    p_in_end = p_in + p_pic->p->i_visible_lines * p_pic->p->i_pitch - 8 * 4;
+
+    p_out = p_outpic->p->p_pixels + i_y_offset;
+
+    for( ; p_in < p_in_end ; )
+    {
+        p_line_end = p_in + i_visible_pitch - 8 * 4;
+
+        for( ; p_in < p_line_end ; )
+        {
+            /* Do 8 pixels at a time */
+            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
+            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
+            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
+            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
+            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
+            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
+            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
+            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
+        }
+
+        p_line_end += 8 * 4;
+
+        for( ; p_in < p_line_end ; )
+        {
+            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
+        }
+
+        p_in += i_pitch - p_pic->p->i_visible_pitch;
+        p_out += i_pitch - p_outpic->p->i_visible_pitch;
+    }
+
+    /*
+     * Do the U and V planes
+     */
+    if ( job->b_clip )
+        i_ret = p_sys->pf_process_sat_hue_clip( p_pic, p_outpic, job->i_sin,
+                                                job->i_cos, job->i_sat,
+                                                job->i_x, job->i_y );
+    else
+        i_ret = p_sys->pf_process_sat_hue( p_pic, p_outpic, job->i_sin,
+                                           job->i_cos, job->i_sat,
+                                           job->i_x, job->i_y );
+    if( i_ret != VLC_SUCCESS )
+        atomic_store( &job->b_error, true );
+}
+
 /*****************************************************************************
  * Run the filter on a Planar YUV picture
  *****************************************************************************/
@@ -316,82 +544,6 @@ static picture_t *FilterPlanar( filter_t *p_filter, picture_t *p_pic )
         i_sat = 0;
     }
 
-    /*
-     * Do the Y plane
-     */
-    if ( b_16bit )
-    {
-        uint16_t *p_in, *p_in_end, *p_line_end;
-        uint16_t *p_out;
-        p_in = (uint16_t *) p_pic->p[Y_PLANE].p_pixels;
-        p_in_end = p_in + p_pic->p[Y_PLANE].i_visible_lines
-            * (p_pic->p[Y_PLANE].i_pitch >> 1) - 8;
-
-        p_out = (uint16_t *) p_outpic->p[Y_PLANE].p_pixels;
-
-        for( ; p_in < p_in_end ; )
-        {
-            p_line_end = p_in + (p_pic->p[Y_PLANE].i_visible_pitch >> 1) - 8;
-
-            for( ; p_in < p_line_end ; )
-            {
-                /* Do 8 pixels at a time */
-                *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ];
-                *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ];
-                *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ];
-                *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ];
-            }
-
-            p_line_end += 8;
-
-            for( ; p_in < p_line_end ; )
-            {
-                *p_out++ = pi_luma[ *p_in++ ];
-            }
-
-            p_in += (p_pic->p[Y_PLANE].i_pitch >> 1)
-                - (p_pic->p[Y_PLANE].i_visible_pitch >> 1);
-            p_out += (p_outpic->p[Y_PLANE].i_pitch >> 1)
-                - (p_outpic->p[Y_PLANE].i_visible_pitch >> 1);
-        }
-    }
-    else
-    {
-        uint8_t *p_in, *p_in_end, *p_line_end;
-        uint8_t *p_out;
-        p_in = p_pic->p[Y_PLANE].p_pixels;
-        p_in_end = p_in + p_pic->p[Y_PLANE].i_visible_lines
-                 * p_pic->p[Y_PLANE].i_pitch - 8;
-
-        p_out = p_outpic->p[Y_PLANE].p_pixels;
-
-        for( ; p_in < p_in_end ; )
-        {
-            p_line_end = p_in + p_pic->p[Y_PLANE].i_visible_pitch - 8;
-
-            for( ; p_in < p_line_end ; )
-            {
-                /* Do 8 pixels at a time */
-                *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ];
-                *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ];
-                *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ];
-                *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ];
-            }
-
-            p_line_end += 8;
-
-            for( ; p_in < p_line_end ; )
-            {
-                *p_out++ = pi_luma[ *p_in++ ];
-            }
-
-            p_in += p_pic->p[Y_PLANE].i_pitch
-                  - p_pic->p[Y_PLANE].i_visible_pitch;
-            p_out += p_outpic->p[Y_PLANE].i_pitch
-                   - p_outpic->p[Y_PLANE].i_visible_pitch;
-        }
-    }
-
     /*
      * Do the U and V planes
      */
@@ -403,20 +555,17 @@ static picture_t *FilterPlanar( filter_t *p_filter, picture_t *p_pic )
     int i_x = ( cosf(f_hue) + sinf(f_hue) ) * f_range * i_mid;
     int i_y = ( cosf(f_hue) - sinf(f_hue) ) * f_range * i_mid;
 
-    if ( i_sat > i_range )
-    {
-        /* Currently no errors are implemented in the function, if any are added
-         * check them here */
-        p_sys->pf_process_sat_hue_clip( p_pic, p_outpic, i_sin, i_cos, i_sat,
-                                        i_x, i_y );
-    }
-    else
-    {
-        /* Currently no errors are implemented in the function, if any are added
-         * check them here */
-        p_sys->pf_process_sat_hue( p_pic, p_outpic, i_sin, i_cos, i_sat,
-                                        i_x, i_y );
-    }
+    struct adjust_job job = {
+        .p_sys = p_sys, .p_pic = p_pic, .p_outpic = p_outpic,
+        .pi_luma = pi_luma, .b_16bit = b_16bit,
+        .b_clip = i_sat > i_range,
+        .i_sin = i_sin, .i_cos = i_cos, .i_sat = i_sat, .i_x = i_x, .i_y = i_y,
+    };
+    atomic_init( &job.b_error, false );
+
+    filter_RunSlices( p_sys->p_slices,
+                      filter_GetSliceThreads( p_sys->p_slices ),
+                      AdjustPlanarSlice, &job );
 
     return CopyInfoAndRelease( p_outpic, p_pic );
 }
@@ -430,12 +579,8 @@ static picture_t *FilterPacked( filter_t *p_filter, picture_t *p_pic )
     int pi_gamma[256];
 
     picture_t *p_outpic;
-    uint8_t *p_in, *p_in_end, *p_line_end;
-    uint8_t *p_out;
     int i_y_offset, i_u_offset, i_v_offset;
 
-    int i_pitch, i_visible_pitch;
-
     double  f_hue;
     double  f_gamma;
     int32_t i_cont, i_lum;
@@ -445,9 +590,6 @@ static picture_t *FilterPacked( filter_t *p_filter, picture_t *p_pic )
 
     if( !p_pic ) return NULL;
 
-    i_pitch = p_pic->p->i_pitch;
-    i_visible_pitch = p_pic->p->i_visible_pitch;
-
     if( GetPackedYuvOffsets( p_pic->format.i_chroma, &i_y_offset,
                              &i_u_offset, &i_v_offset ) != VLC_SUCCESS )
     {
@@ -513,43 +655,6 @@ static picture_t *FilterPacked( filter_t *p_filter, picture_t *p_pic )
         i_sat = 0;
     }
 
-    /*
-     * Do the Y plane
-     */
-
-    p_in = p_pic->p->p_pixels + i_y_offset;
-    p_in_end = p_in + p_pic->p->i_visible_lines * p_pic->p->i_pitch - 8 * 4;
-
-    p_out = p_outpic->p->p_pixels + i_y_offset;
-
-    for( ; p_in < p_in_end ; )
-    {
-        p_line_end = p_in + i_visible_pitch - 8 * 4;
-
-        for( ; p_in < p_line_end ; )
-        {
-            /* Do 8 pixels at a time */
-            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
-            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
-            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
-            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
-            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
-            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
-            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
-            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
-        }
-
-        p_line_end += 8 * 4;
-
-        for( ; p_in < p_line_end ; )
-        {
-            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
-        }
-
-        p_in += i_pitch - p_pic->p->i_visible_pitch;
-        p_out += i_pitch - p_outpic->p->i_visible_pitch;
-    }
-
     /*
      * Do the U and V planes
      */
@@ -560,31 +665,25 @@ static picture_t *FilterPacked( filter_t *p_filter, picture_t *p_pic )
     i_x = ( cos(f_hue) + sin(f_hue) ) * 32768;
     i_y = ( cos(f_hue) - sin(f_hue) ) * 32768;
 
-    if ( i_sat > 256 )
-    {
-        if ( p_sys->pf_process_sat_hue_clip( p_pic, p_outpic, i_sin, i_cos, i_sat,
-                                             i_x, i_y ) != VLC_SUCCESS )
-        {
-            /* Currently only one error can happen in the function, but if there
-             * will be more of them, this message must go away */
-            msg_Warn( p_filter, "Unsupported input chroma (%4.4s)",
-                      (char*)&(p_pic->format.i_chroma) );
-            picture_Release( p_pic );
-            return NULL;
-        }
-    }
-    else
+    struct adjust_job job = {
+        .p_sys = p_sys, .p_pic = p_pic, .p_outpic = p_outpic,
+        .pi_luma = pi_luma, .b_clip = i_sat > 256,
+        .i_sin = i_sin, .i_cos = i_cos, .i_sat = i_sat, .i_x = i_x, .i_y = i_y,
+    };
+    atomic_init( &job.b_error, false );
+
+    filter_RunSlices( p_sys->p_slices,
+                      filter_GetSliceThreads( p_sys->p_slices ),
+                      AdjustPackedSlice, &job );
+
+    if( atomic_load( &job.b_error ) )
     {
-        if ( p_sys->pf_process_sat_hue( p_pic, p_outpic, i_sin, i_cos, i_sat,
-                                        i_x, i_y ) != VLC_SUCCESS )
-        {
-            /* Currently only one error can happen in the function, but if there
-             * will be more of them, this message must go away */
-            msg_Warn( p_filter, "Unsupported input chroma (%4.4s)",
-                      (char*)&(p_pic->format.i_chroma) );
-            picture_Release( p_pic );
-            return NULL;
-        }
+        /* Currently only one error can happen in the function, but if there
+         * will be more of them, this message must go away */
+        msg_Warn( p_filter, "Unsupported input chroma (%4.4s)",
+                  (char*)&(p_pic->format.i_chroma) );
+        picture_Release( p_pic );
+        return NULL;
     }
 
     return CopyInfoAndRelease( p_outpic, p_pic );
@@ -32,8 +32,18 @@
 #include <vlc_plugin.h>
 #include <vlc_filter.h>
 #include <vlc_picture.h>
+#include <vlc_cpu.h>
 #include "filter_picture.h"
 
+#if defined(CAN_COMPILE_SSE2)
+# include <emmintrin.h>
+# define VLC_SSE2 __attribute__ ((__target__ ("sse2")))
+#endif
+#if defined(CAN_COMPILE_AVX2)
+# include <immintrin.h>
+# define VLC_AVX2 __attribute__ ((__target__ ("avx2")))
+#endif
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -83,6 +93,21 @@ public:
     {
         return true;
     }
+    unsigned getX() const
+    {
+        return x;
+    }
+    unsigned getY() const
+    {
+        return y;
+    }
+    /* Address of the pixel at (dx, dy) from the origin */
+    uint8_t *getPixels(unsigned plane, unsigned dx, unsigned dy,
+                       unsigned rx = 1, unsigned ry = 1, unsigned size = 1) const
+    {
+        const plane_t *p = &picture->p[plane];
+        return &p->p_pixels[(y + dy) / ry * p->i_pitch + (x + dx) / rx * size];
+    }
 
 protected:
     template <unsigned ry>
@@ -551,6 +576,449 @@ void Blend(const CPicture &dst_data, const CPicture &src_data,
 typedef void (*blend_function_t)(const CPicture &dst_data, const CPicture &src_data,
                                  unsigned width, unsigned height, int alpha);
 
+/*
+ * Line kernels, used to blend the most common formats a line at a time:
+ *  - alpha:     a[i] = div255(alpha * src_a[i])
+ *  - merge:     merge(&dst[i], src[i], a[i])
+ *  - even:      dst[i] = src[2 * i]
+ *  - interleave: dst[2 * i] = u[2 * i] and dst[2 * i + 1] = v[2 * i]
+ *  - rgba:      RGBA pixels merged into 32 bits RGB pixels, whose
+ *               component offsets are given
+ * They give the same results as the generic Blend().
+ */
+struct KernelsC {
+    static void alpha(uint8_t *a, const uint8_t *src, unsigned count, unsigned alpha)
+    {
+        for (unsigned i = 0; i < count; i++)
+            a[i] = div255(alpha * src[i]);
+    }
+    static void merge(uint8_t *dst, const uint8_t *src, const uint8_t *a, unsigned count)
+    {
+        for (unsigned i = 0; i < count; i++)
+            ::merge(&dst[i], src[i], a[i]);
+    }
+    static void even(uint8_t *dst, const uint8_t *src, unsigned count)
+    {
+        for (unsigned i = 0; i < count; i++)
+            dst[i] = src[2 * i];
+    }
+    static void interleave(uint8_t *dst, const uint8_t *u, const uint8_t *v,
+                           unsigned count)
+    {
+        for (unsigned i = 0; i < count; i++) {
+            dst[2 * i + 0] = u[2 * i];
+            dst[2 * i + 1] = v[2 * i];
+        }
+    }
+    static void rgba(uint8_t *dst, const uint8_t *src, unsigned count,
+                     unsigned alpha, const unsigned offsets[3])
+    {
+        for (unsigned i = 0; i < count; i++, dst += 4, src += 4) {
+            const unsigned a = div255(alpha * src[3]);
+            ::merge(&dst[offsets[0]], src[0], a);
+            ::merge(&dst[offsets[1]], src[1], a);
+            ::merge(&dst[offsets[2]], src[2], a);
+        }
+    }
+};
+
+#if defined(CAN_COMPILE_SSE2)
+VLC_SSE2
+static inline __m128i Div255SSE2(__m128i v)
+{
+    v = _mm_add_epi16(v, _mm_srli_epi16(v, 8));
+    v = _mm_add_epi16(v, _mm_set1_epi16(1));
+    return _mm_srli_epi16(v, 8);
+}
+
+VLC_SSE2
+static inline __m128i MergeSSE2(__m128i d, __m128i s, __m128i a)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ia = _mm_xor_si128(a, _mm_set1_epi8(-1)); /* 255 - a */
+
+    __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(d,  zero),
+                                               _mm_unpacklo_epi8(ia, zero)),
+                               _mm_mullo_epi16(_mm_unpacklo_epi8(s,  zero),
+                                               _mm_unpacklo_epi8(a,  zero)));
+    __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(d,  zero),
+                                               _mm_unpackhi_epi8(ia, zero)),
+                               _mm_mullo_epi16(_mm_unpackhi_epi8(s,  zero),
+                                               _mm_unpackhi_epi8(a,  zero)));
+    return _mm_packus_epi16(Div255SSE2(lo), Div255SSE2(hi));
+}
+
+struct KernelsSSE2 {
+    VLC_SSE2
+    static void alpha(uint8_t *a, const uint8_t *src, unsigned count, unsigned alpha)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i k = _mm_set1_epi16(alpha);
+        unsigned i = 0;
+
+        for (; i + 16 <= count; i += 16) {
+            __m128i v = _mm_loadu_si128((const __m128i *)&src[i]);
+            __m128i lo = Div255SSE2(_mm_mullo_epi16(_mm_unpacklo_epi8(v, zero), k));
+            __m128i hi = Div255SSE2(_mm_mullo_epi16(_mm_unpackhi_epi8(v, zero), k));
+            _mm_storeu_si128((__m128i *)&a[i], _mm_packus_epi16(lo, hi));
+        }
+        KernelsC::alpha(&a[i], &src[i], count - i, alpha);
+    }
+    VLC_SSE2
+    static void merge(uint8_t *dst, const uint8_t *src, const uint8_t *a, unsigned count)
+    {
+        unsigned i = 0;
+
+        for (; i + 16 <= count; i += 16) {
+            __m128i d = _mm_loadu_si128((const __m128i *)&dst[i]);
+            __m128i s = _mm_loadu_si128((const __m128i *)&src[i]);
+            __m128i k = _mm_loadu_si128((const __m128i *)&a[i]);
+            _mm_storeu_si128((__m128i *)&dst[i], MergeSSE2(d, s, k));
+        }
+        KernelsC::merge(&dst[i], &src[i], &a[i], count - i);
+    }
+    VLC_SSE2
+    static void even(uint8_t *dst, const uint8_t *src, unsigned count)
+    {
+        const __m128i mask = _mm_set1_epi16(0xff);
+        unsigned i = 0;
+
+        /* src[2 * count - 1] may not be readable */
+        for (; i + 16 < count; i += 16) {
+            __m128i lo = _mm_loadu_si128((const __m128i *)&src[2 * i]);
+            __m128i hi = _mm_loadu_si128((const __m128i *)&src[2 * i + 16]);
+            _mm_storeu_si128((__m128i *)&dst[i],
+                             _mm_packus_epi16(_mm_and_si128(lo, mask),
+                                              _mm_and_si128(hi, mask)));
+        }
+        KernelsC::even(&dst[i], &src[2 * i], count - i);
+    }
+    VLC_SSE2
+    static void interleave(uint8_t *dst, const uint8_t *u, const uint8_t *v,
+                           unsigned count)
+    {
+        const __m128i mask = _mm_set1_epi16(0xff);
+        unsigned i = 0;
+
+        for (; i + 8 < count; i += 8) {
+            __m128i vu = _mm_loadu_si128((const __m128i *)&u[2 * i]);
+            __m128i vv = _mm_loadu_si128((const __m128i *)&v[2 * i]);
+            _mm_storeu_si128((__m128i *)&dst[2 * i],
+                             _mm_or_si128(_mm_and_si128(vu, mask),
+                                          _mm_slli_epi16(vv, 8)));
+        }
+        KernelsC::interleave(&dst[2 * i], &u[2 * i], &v[2 * i], count - i);
+    }
+    VLC_SSE2
+    static void rgba(uint8_t *dst, const uint8_t *src, unsigned count,
+                     unsigned alpha, const unsigned offsets[3])
+    {
+        const __m128i mask = _mm_set1_epi32(0xff);
+        const __m128i k = _mm_set1_epi16(alpha);
+        const __m128i shift_r = _mm_cvtsi32_si128(8 * offsets[0]);
+        const __m128i shift_g = _mm_cvtsi32_si128(8 * offsets[1]);
+        const __m128i shift_b = _mm_cvtsi32_si128(8 * offsets[2]);
+        unsigned i = 0;
+
+        for (; i + 4 <= count; i += 4) {
+            __m128i s = _mm_loadu_si128((const __m128i *)&src[4 * i]);
+            __m128i d = _mm_loadu_si128((const __m128i *)&dst[4 * i]);
+
+            /* Alpha in the low byte of each pixel */
+            __m128i a = Div255SSE2(_mm_mullo_epi16(_mm_srli_epi32(s, 24), k));
+
+            /* Source and alpha with the destination layout */
+            __m128i sd = _mm_or_si128(
+                _mm_or_si128(_mm_sll_epi32(_mm_and_si128(s, mask), shift_r),
+                             _mm_sll_epi32(_mm_and_si128(_mm_srli_epi32(s, 8), mask), shift_g)),
+                _mm_sll_epi32(_mm_and_si128(_mm_srli_epi32(s, 16), mask), shift_b));
+            __m128i ad = _mm_or_si128(_mm_or_si128(_mm_sll_epi32(a, shift_r),
+                                                   _mm_sll_epi32(a, shift_g)),
+                                      _mm_sll_epi32(a, shift_b));
+
+            _mm_storeu_si128((__m128i *)&dst[4 * i], MergeSSE2(d, sd, ad));
+        }
+        KernelsC::rgba(&dst[4 * i], &src[4 * i], count - i, alpha, offsets);
+    }
+};
+#endif
+
+#if defined(CAN_COMPILE_AVX2)
+VLC_AVX2
+static inline __m256i Div255AVX2(__m256i v)
+{
+    v = _mm256_add_epi16(v, _mm256_srli_epi16(v, 8));
+    v = _mm256_add_epi16(v, _mm256_set1_epi16(1));
+    return _mm256_srli_epi16(v, 8);
+}
+
+VLC_AVX2
+static inline __m256i MergeAVX2(__m256i d, __m256i s, __m256i a)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i ia = _mm256_xor_si256(a, _mm256_set1_epi8(-1)); /* 255 - a */
+
+    /* Unpacking and packing both work within 128 bits lanes, so that the
+     * order of the bytes is kept */
+    __m256i lo = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(d,  zero),
+                                                     _mm256_unpacklo_epi8(ia, zero)),
+                                  _mm256_mullo_epi16(_mm256_unpacklo_epi8(s,  zero),
+                                                     _mm256_unpacklo_epi8(a,  zero)));
+    __m256i hi = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(d,  zero),
+                                                     _mm256_unpackhi_epi8(ia, zero)),
+                                  _mm256_mullo_epi16(_mm256_unpackhi_epi8(s,  zero),
+                                                     _mm256_unpackhi_epi8(a,  zero)));
+    return _mm256_packus_epi16(Div255AVX2(lo), Div255AVX2(hi));
+}
+
+struct KernelsAVX2 {
+    VLC_AVX2
+    static void alpha(uint8_t *a, const uint8_t *src, unsigned count, unsigned alpha)
+    {
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i k = _mm256_set1_epi16(alpha);
+        unsigned i = 0;
+
+        for (; i + 32 <= count; i += 32) {
+            __m256i v = _mm256_loadu_si256((const __m256i *)&src[i]);
+            __m256i lo = Div255AVX2(_mm256_mullo_epi16(_mm256_unpacklo_epi8(v, zero), k));
+            __m256i hi = Div255AVX2(_mm256_mullo_epi16(_mm256_unpackhi_epi8(v, zero), k));
+            _mm256_storeu_si256((__m256i *)&a[i], _mm256_packus_epi16(lo, hi));
+        }
+        KernelsC::alpha(&a[i], &src[i], count - i, alpha);
+    }
+    VLC_AVX2
+    static void merge(uint8_t *dst, const uint8_t *src, const uint8_t *a, unsigned count)
+    {
+        unsigned i = 0;
+
+        for (; i + 32 <= count; i += 32) {
+            __m256i d = _mm256_loadu_si256((const __m256i *)&dst[i]);
+            __m256i s = _mm256_loadu_si256((const __m256i *)&src[i]);
+            __m256i k = _mm256_loadu_si256((const __m256i *)&a[i]);
+            _mm256_storeu_si256((__m256i *)&dst[i], MergeAVX2(d, s, k));
+        }
+        KernelsC::merge(&dst[i], &src[i], &a[i], count - i);
+    }
+    VLC_AVX2
+    static void even(uint8_t *dst, const uint8_t *src, unsigned count)
+    {
+        const __m256i mask = _mm256_set1_epi16(0xff);
+        unsigned i = 0;
+
+        /* src[2 * count - 1] may not be readable */
+        for (; i + 32 < count; i += 32) {
+            __m256i lo = _mm256_loadu_si256((const __m256i *)&src[2 * i]);
+            __m256i hi = _mm256_loadu_si256((const __m256i *)&src[2 * i + 32]);
+            __m256i v = _mm256_packus_epi16(_mm256_and_si256(lo, mask),
+                                            _mm256_and_si256(hi, mask));
+            /* Packing interleaved the 64 bits quarters of lo and hi */
+            _mm256_storeu_si256((__m256i *)&dst[i],
+                                _mm256_permute4x64_epi64(v, 0xd8));
+        }
+        KernelsC::even(&dst[i], &src[2 * i], count - i);
+    }
+    VLC_AVX2
+    static void interleave(uint8_t *dst, const uint8_t *u, const uint8_t *v,
+                           unsigned count)
+    {
+        const __m256i mask = _mm256_set1_epi16(0xff);
+        unsigned i = 0;
+
+        for (; i + 16 < count; i += 16) {
+            __m256i vu = _mm256_loadu_si256((const __m256i *)&u[2 * i]);
+            __m256i vv = _mm256_loadu_si256((const __m256i *)&v[2 * i]);
+            _mm256_storeu_si256((__m256i *)&dst[2 * i],
+                                _mm256_or_si256(_mm256_and_si256(vu, mask),
+                                                _mm256_slli_epi16(vv, 8)));
+        }
+        KernelsC::interleave(&dst[2 * i], &u[2 * i], &v[2 * i], count - i);
+    }
+    VLC_AVX2
+    static void rgba(uint8_t *dst, const uint8_t *src, unsigned count,
+                     unsigned alpha, const unsigned offsets[3])
+    {
+        const __m256i mask = _mm256_set1_epi32(0xff);
+        const __m256i k = _mm256_set1_epi16(alpha);
+        const __m128i shift_r = _mm_cvtsi32_si128(8 * offsets[0]);
+        const __m128i shift_g = _mm_cvtsi32_si128(8 * offsets[1]);
+        const __m128i shift_b = _mm_cvtsi32_si128(8 * offsets[2]);
+        unsigned i = 0;
+
+        for (; i + 8 <= count; i += 8) {
+            __m256i s = _mm256_loadu_si256((const __m256i *)&src[4 * i]);
+            __m256i d = _mm256_loadu_si256((const __m256i *)&dst[4 * i]);
+
+            __m256i a = Div255AVX2(_mm256_mullo_epi16(_mm256_srli_epi32(s, 24), k));
+
+            __m256i sd = _mm256_or_si256(
+                _mm256_or_si256(_mm256_sll_epi32(_mm256_and_si256(s, mask), shift_r),
+                                _mm256_sll_epi32(_mm256_and_si256(_mm256_srli_epi32(s, 8), mask), shift_g)),
+                _mm256_sll_epi32(_mm256_and_si256(_mm256_srli_epi32(s, 16), mask), shift_b));
+            __m256i ad = _mm256_or_si256(_mm256_or_si256(_mm256_sll_epi32(a, shift_r),
+                                                         _mm256_sll_epi32(a, shift_g)),
+                                         _mm256_sll_epi32(a, shift_b));
+
+            _mm256_storeu_si256((__m256i *)&dst[4 * i], MergeAVX2(d, sd, ad));
+        }
+        KernelsC::rgba(&dst[4 * i], &src[4 * i], count - i, alpha, offsets);
+    }
+};
+#endif
+
+/* Number of pixels blended at once by the line kernels (even) */
+#define BLEND_CHUNK 512
+
+/* YUVA onto 8 bits 4:2:0 planar pictures */
+template <class K, bool swap_uv>
+void BlendYUVAToI420(const CPicture &dst, const CPicture &src,
+                     unsigned width, unsigned height, int alpha)
+{
+    uint8_t a[BLEND_CHUNK];
+    uint8_t ca[BLEND_CHUNK / 2], cu[BLEND_CHUNK / 2], cv[BLEND_CHUNK / 2];
+
+    for (unsigned y = 0; y < height; y++) {
+        const bool full = ((dst.getY() + y) % 2) == 0;
+
+        for (unsigned x = 0; x < width; x += BLEND_CHUNK) {
+            const unsigned count = __MIN(width - x, BLEND_CHUNK);
+
+            K::alpha(a, src.getPixels(3, x, y), count, alpha);
+            K::merge(dst.getPixels(0, x, y), src.getPixels(0, x, y), a, count);
+
+            /* The chroma is blended from the pixels of even columns */
+            const unsigned first = (dst.getX() + x) % 2;
+            if (!full || count <= first)
+                continue;
+            const unsigned chroma_count = (count - first + 1) / 2;
+
+            K::even(ca, &a[first], chroma_count);
+            K::even(cu, src.getPixels(1, x + first, y), chroma_count);
+            K::even(cv, src.getPixels(2, x + first, y), chroma_count);
+            K::merge(dst.getPixels(swap_uv ? 2 : 1, x + first, y, 2, 2),
+                     cu, ca, chroma_count);
+            K::merge(dst.getPixels(swap_uv ? 1 : 2, x + first, y, 2, 2),
+                     cv, ca, chroma_count);
+        }
+    }
+}
+
+/* YUVA onto NV12 and NV21 */
+template <class K, bool swap_uv>
+void BlendYUVAToNV12(const CPicture &dst, const CPicture &src,
+                     unsigned width, unsigned height, int alpha)
+{
+    uint8_t a[BLEND_CHUNK], ca[BLEND_CHUNK], cuv[BLEND_CHUNK];
+
+    for (unsigned y = 0; y < height; y++) {
+        const bool full = ((dst.getY() + y) % 2) == 0;
+
+        for (unsigned x = 0; x < width; x += BLEND_CHUNK) {
+            const unsigned count = __MIN(width - x, BLEND_CHUNK);
+
+            K::alpha(a, src.getPixels(3, x, y), count, alpha);
+            K::merge(dst.getPixels(0, x, y), src.getPixels(0, x, y), a, count);
+
+            const unsigned first = (dst.getX() + x) % 2;
+            if (!full || count <= first)
+                continue;
+            const unsigned chroma_count = (count - first + 1) / 2;
+
+            K::interleave(ca, &a[first], &a[first], chroma_count);
+            K::interleave(cuv, src.getPixels(swap_uv ? 2 : 1, x + first, y),
+                               src.getPixels(swap_uv ? 1 : 2, x + first, y),
+                          chroma_count);
+            K::merge(dst.getPixels(1, x + first, y, 2, 2, 2),
+                     cuv, ca, 2 * chroma_count);
+        }
+    }
+}
+
+/* RGBA onto 32 bits RGB, when the components are whole bytes */
+template <class K>
+void BlendRGBAToRGB32(const CPicture &dst, const CPicture &src,
+                      unsigned width, unsigned height, int alpha)
+{
+    const video_format_t *fmt = dst.getFormat();
+    unsigned offsets[3];
+#ifdef WORDS_BIGENDIAN
+    offsets[0] = (32 - fmt->i_lrshift) / 8;
+    offsets[1] = (32 - fmt->i_lgshift) / 8;
+    offsets[2] = (32 - fmt->i_lbshift) / 8;
+#else
+    offsets[0] = fmt->i_lrshift / 8;
+    offsets[1] = fmt->i_lgshift / 8;
+    offsets[2] = fmt->i_lbshift / 8;
+#endif
+    if (offsets[0] > 3 || offsets[1] > 3 || offsets[2] > 3 ||
+        offsets[0] == offsets[1] || offsets[1] == offsets[2] ||
+        offsets[0] == offsets[2]) {
+        Blend<CPictureRGB32, CPictureRGBA, compose<convertNone, convertNone> >(
+            dst, src, width, height, alpha);
+        return;
+    }
+
+    for (unsigned y = 0; y < height; y++)
+        K::rgba(dst.getPixels(0, 0, y, 1, 1, 4), src.getPixels(0, 0, y, 1, 1, 4),
+                width, alpha, offsets);
+}
+
+#define FAST_BLENDS(kernels) \
+    { VLC_CODEC_I420,  VLC_CODEC_YUVA, BlendYUVAToI420<kernels, false> }, \
+    { VLC_CODEC_J420,  VLC_CODEC_YUVA, BlendYUVAToI420<kernels, false> }, \
+    { VLC_CODEC_YV12,  VLC_CODEC_YUVA, BlendYUVAToI420<kernels, true> }, \
+    { VLC_CODEC_NV12,  VLC_CODEC_YUVA, BlendYUVAToNV12<kernels, false> }, \
+    { VLC_CODEC_NV21,  VLC_CODEC_YUVA, BlendYUVAToNV12<kernels, true> }, \
+    { VLC_CODEC_RGB32, VLC_CODEC_RGBA, BlendRGBAToRGB32<kernels> }
+
+struct fast_blend_t {
+    vlc_fourcc_t     dst;
+    vlc_fourcc_t     src;
+    blend_function_t blend;
+};
+
+#if defined(CAN_COMPILE_AVX2)
+static const fast_blend_t fast_blends_avx2[] = { FAST_BLENDS(KernelsAVX2) };
+#endif
+#if defined(CAN_COMPILE_SSE2)
+static const fast_blend_t fast_blends_sse2[] = { FAST_BLENDS(KernelsSSE2) };
+#endif
+static const fast_blend_t fast_blends_c[] = { FAST_BLENDS(KernelsC) };
+
+static blend_function_t FindFastBlend(const fast_blend_t *blends, size_t count,
+                                      vlc_fourcc_t dst, vlc_fourcc_t src)
+{
+    for (size_t i = 0; i < count; i++) {
+        if (blends[i].dst == dst && blends[i].src == src)
+            return blends[i].blend;
+    }
+    return NULL;
+}
+
+/**
+ * It returns the line based blending function for the formats, if any,
+ * using the widest SIMD kernels supported by the CPU.
+ */
+static blend_function_t GetFastBlend(vlc_fourcc_t dst, vlc_fourcc_t src)
+{
+    blend_function_t blend = NULL;
+#define TRY(blends) \
+    if (!blend) \
+        blend = FindFastBlend(blends, sizeof(blends) / sizeof(*blends), dst, src)
+
+#if defined(CAN_COMPILE_AVX2)
+    if (vlc_CPU_AVX2())
+        TRY(fast_blends_avx2);
+#endif
+#if defined(CAN_COMPILE_SSE2)
+    if (vlc_CPU_SSE2())
+        TRY(fast_blends_sse2);
+#endif
+    TRY(fast_blends_c);
+#undef TRY
+    return blend;
+}
+
 static const struct {
     vlc_fourcc_t     dst;
     vlc_fourcc_t     src;
@@ -671,7 +1139,8 @@ static int Open(vlc_object_t *object)
     const vlc_fourcc_t dst = filter->fmt_out.video.i_chroma;
 
     filter_sys_t *sys = new filter_sys_t();
-    for (size_t i = 0; i < sizeof(blends) / sizeof(*blends); i++) {
+    sys->blend = GetFastBlend(dst, src);
+    for (size_t i = 0; i < sizeof(blends) / sizeof(*blends) && !sys->blend; i++) {
         if (blends[i].src == src && blends[i].dst == dst)
             sys->blend = blends[i].blend;
     }
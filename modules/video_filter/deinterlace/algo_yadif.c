@@ -47,6 +47,81 @@
    Necessary preprocessor macros are defined in common.h. */
 #include "yadif.h"
 
+typedef void (*yadif_filter_t)(uint8_t *dst, uint8_t *prev, uint8_t *cur,
+                               uint8_t *next, int w, int prefs, int mrefs,
+                               int parity, int mode);
+
+struct yadif_job
+{
+    picture_t     *p_dst;
+    picture_t     *p_prev;
+    picture_t     *p_cur;
+    picture_t     *p_next;
+    yadif_filter_t filter;
+    unsigned       i_pixel_size;
+    int            i_field;
+    int            i_parity;
+};
+
+/* Renders one horizontal stripe of every plane. The first and last lines
+ * are duplicated by the stripes holding the second and next to last lines. */
+static void RenderYadifSlice( void *opaque, unsigned i_slice,
+                              unsigned i_slices )
+{
+    const struct yadif_job *job = opaque;
+    const int i_field = job->i_field;
+    const int yadif_parity = job->i_parity;
+    picture_t *p_dst = job->p_dst;
+
+    for( int n = 0; n < p_dst->i_planes; n++ )
+    {
+        const plane_t *prevp = &job->p_prev->p[n];
+        const plane_t *curp  = &job->p_cur->p[n];
+        const plane_t *nextp = &job->p_next->p[n];
+        plane_t *dstp        = &p_dst->p[n];
+        int i_start, i_end;
+
+        filter_GetSliceLines( dstp->i_visible_lines - 2, i_slice, i_slices,
+                              &i_start, &i_end );
+
+        for( int y = 1 + i_start; y < 1 + i_end; y++ )
+        {
+            if( (y % 2) == i_field  ||  yadif_parity == 2 )
+            {
+                memcpy( &dstp->p_pixels[y * dstp->i_pitch],
+                            &curp->p_pixels[y * curp->i_pitch], dstp->i_visible_pitch );
+            }
+            else
+            {
+                int mode;
+                /* Spatial checks only when enough data */
+                mode = (y >= 2 && y < dstp->i_visible_lines - 2) ? 0 : 2;
+
+                assert( prevp->i_pitch == curp->i_pitch && curp->i_pitch == nextp->i_pitch );
+                job->filter( &dstp->p_pixels[y * dstp->i_pitch],
+                             &prevp->p_pixels[y * prevp->i_pitch],
+                             &curp->p_pixels[y * curp->i_pitch],
+                             &nextp->p_pixels[y * nextp->i_pitch],
+                             dstp->i_visible_pitch / job->i_pixel_size,
+                             y < dstp->i_visible_lines - 2  ? curp->i_pitch : -curp->i_pitch,
+                             y  - 1  ?  -curp->i_pitch : curp->i_pitch,
+                             yadif_parity,
+                             mode );
+            }
+
+            /* We duplicate the first and last lines */
+            if( y == 1 )
+                memcpy(&dstp->p_pixels[(y-1) * dstp->i_pitch],
+                           &dstp->p_pixels[ y    * dstp->i_pitch],
+                           dstp->i_pitch);
+            else if( y == dstp->i_visible_lines - 2 )
+                memcpy(&dstp->p_pixels[(y+1) * dstp->i_pitch],
+                           &dstp->p_pixels[ y    * dstp->i_pitch],
+                           dstp->i_pitch);
+        }
+    }
+}
+
 int RenderYadifSingle( filter_t *p_filter, picture_t *p_dst, picture_t *p_src )
 {
     return RenderYadif( p_filter, p_dst, p_src, 0, 0 );
@@ -110,8 +185,7 @@ int RenderYadif( filter_t *p_filter, picture_t *p_dst, picture_t *p_src,
     if( p_prev && p_cur && p_next )
     {
         /* */
-        void (*filter)(uint8_t *dst, uint8_t *prev, uint8_t *cur, uint8_t *next,
-                       int w, int prefs, int mrefs, int parity, int mode);
+        yadif_filter_t filter;
 
 #if defined(HAVE_YADIF_SSSE3)
         if( vlc_CPU_SSSE3() )
@@ -133,49 +207,18 @@ int RenderYadif( filter_t *p_filter, picture_t *p_dst, picture_t *p_src,
         if( p_sys->chroma->pixel_size == 2 )
             filter = yadif_filter_line_c_16bit;
 
-        for( int n = 0; n < p_dst->i_planes; n++ )
-        {
-            const plane_t *prevp = &p_prev->p[n];
-            const plane_t *curp  = &p_cur->p[n];
-            const plane_t *nextp = &p_next->p[n];
-            plane_t *dstp        = &p_dst->p[n];
-
-            for( int y = 1; y < dstp->i_visible_lines - 1; y++ )
-            {
-                if( (y % 2) == i_field  ||  yadif_parity == 2 )
-                {
-                    memcpy( &dstp->p_pixels[y * dstp->i_pitch],
-                                &curp->p_pixels[y * curp->i_pitch], dstp->i_visible_pitch );
-                }
-                else
-                {
-                    int mode;
-                    /* Spatial checks only when enough data */
-                    mode = (y >= 2 && y < dstp->i_visible_lines - 2) ? 0 : 2;
-
-                    assert( prevp->i_pitch == curp->i_pitch && curp->i_pitch == nextp->i_pitch );
-                    filter( &dstp->p_pixels[y * dstp->i_pitch],
-                            &prevp->p_pixels[y * prevp->i_pitch],
-                            &curp->p_pixels[y * curp->i_pitch],
-                            &nextp->p_pixels[y * nextp->i_pitch],
-                            dstp->i_visible_pitch,
-                            y < dstp->i_visible_lines - 2  ? curp->i_pitch : -curp->i_pitch,
-                            y  - 1  ?  -curp->i_pitch : curp->i_pitch,
-                            yadif_parity,
-                            mode );
-                }
-
-                /* We duplicate the first and last lines */
-                if( y == 1 )
-                    memcpy(&dstp->p_pixels[(y-1) * dstp->i_pitch],
-                               &dstp->p_pixels[ y    * dstp->i_pitch],
-                               dstp->i_pitch);
-                else if( y == dstp->i_visible_lines - 2 )
-                    memcpy(&dstp->p_pixels[(y+1) * dstp->i_pitch],
-                               &dstp->p_pixels[ y    * dstp->i_pitch],
-                               dstp->i_pitch);
-            }
-        }
+        struct yadif_job job = {
+            .p_dst = p_dst,
+            .p_prev = p_prev,
+            .p_cur = p_cur,
+            .p_next = p_next,
+            .filter = filter,
+            .i_pixel_size = p_sys->chroma->pixel_size,
+            .i_field = i_field,
+            .i_parity = yadif_parity,
+        };
+        filter_RunSlices( p_sys->slices, filter_GetSliceThreads( p_sys->slices ),
+                          RenderYadifSlice, &job );
 
         p_sys->context.i_frame_offset = 1; /* p_cur will be rendered at next frame, too */
 
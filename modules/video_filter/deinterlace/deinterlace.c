@@ -93,6 +93,10 @@
                                     "in the Phosphor framerate doubler. "\
                                     "Default: Low.")
 
+#define THREADS_TEXT N_("Threads")
+#define THREADS_LONGTEXT N_("Number of threads used by the Yadif "\
+                            "deinterlacers. 0 uses one thread per CPU.")
+
 vlc_module_begin ()
     set_description( N_("Deinterlacing video filter") )
     set_shortname( N_("Deinterlace" ))
@@ -112,6 +116,8 @@ vlc_module_begin ()
                 PHOSPHOR_DIMMER_LONGTEXT, true )
         change_integer_list( phosphor_dimmer_list, phosphor_dimmer_list_text )
         change_safe ()
+    add_integer_with_range( FILTER_CFG_PREFIX "threads", 0, 0, 64,
+                            THREADS_TEXT, THREADS_LONGTEXT, true )
     add_shortcut( "deinterlace" )
     set_callbacks( Open, Close )
 vlc_module_end ()
@@ -127,7 +133,7 @@ vlc_module_end ()
  * and reading logic for them implemented in Open().
  */
 static const char *const ppsz_filter_options[] = {
-    "mode", "phosphor-chroma", "phosphor-dimmer",
+    "mode", "phosphor-chroma", "phosphor-dimmer", "threads",
     NULL
 };
 
@@ -325,6 +331,12 @@ notsupp:
     char *psz_mode = var_InheritString( p_filter, FILTER_CFG_PREFIX "mode" );
     SetFilterMethod( p_filter, psz_mode, packed );
 
+    p_sys->slices = NULL;
+    if( p_sys->context.pf_render_ordered == RenderYadif
+     || p_sys->context.pf_render_single_pic == RenderYadifSingle )
+        p_sys->slices = filter_NewSlices(
+                var_InheritInteger( p_filter, FILTER_CFG_PREFIX "threads" ) );
+
     IVTCClearState( p_filter );
 
 #if defined(CAN_COMPILE_C_ALTIVEC)
@@ -448,5 +460,6 @@ void Close( vlc_object_t *p_this )
     filter_t *p_filter = (filter_t*)p_this;
 
     Flush( p_filter );
+    filter_DeleteSlices( p_filter->p_sys->slices );
     free( p_filter->p_sys );
 }
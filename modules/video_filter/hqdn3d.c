@@ -58,6 +58,9 @@ static int DenoiseCallback( vlc_object_t *p_this, char const *psz_var,
 #define CHROMA_SPAT_TEXT        N_("Spatial chroma strength (0-254)")
 #define LUMA_TEMP_TEXT          N_("Temporal luma strength (0-254)")
 #define CHROMA_TEMP_TEXT        N_("Temporal chroma strength (0-254)")
+#define THREADS_TEXT            N_("Threads")
+#define THREADS_LONGTEXT        N_("Number of planes denoised in parallel "\
+                                   "(0 = automatic).")
 
 vlc_module_begin()
     set_shortname(N_("HQ Denoiser 3D"))
@@ -74,6 +77,8 @@ vlc_module_begin()
             LUMA_TEMP_TEXT, LUMA_TEMP_TEXT, false)
     add_float_with_range(FILTER_PREFIX "chroma-temp", 4.5, 0.0, 254.0,
             CHROMA_TEMP_TEXT, CHROMA_TEMP_TEXT, false)
+    add_integer_with_range(FILTER_PREFIX "threads", 0, 0, 3,
+            THREADS_TEXT, THREADS_LONGTEXT, true)
 
     add_shortcut("hqdn3d")
 
@@ -81,7 +86,7 @@ vlc_module_begin()
 vlc_module_end()
 
 static const char *const filter_options[] = {
-    "luma-spat", "chroma-spat", "luma-temp", "chroma-temp", NULL
+    "luma-spat", "chroma-spat", "luma-temp", "chroma-temp", "threads", NULL
 };
 
 /*****************************************************************************
@@ -96,6 +101,8 @@ struct filter_sys_t
     bool   b_recalc_coefs;
     vlc_mutex_t coefs_mutex;
     float  luma_spat, luma_temp, chroma_spat, chroma_temp;
+
+    filter_slices_t *slices;
 };
 
 /*****************************************************************************
@@ -110,7 +117,6 @@ static int Open(vlc_object_t *this)
     const video_format_t *fmt_out = &filter->fmt_out.video;
     const vlc_fourcc_t fourcc_in  = fmt_in->i_chroma;
     const vlc_fourcc_t fourcc_out = fmt_out->i_chroma;
-    int wmax = 0;
 
     const vlc_chroma_description_t *chroma =
             vlc_fourcc_GetChromaDescription(fourcc_in);
@@ -133,20 +139,25 @@ static int Open(vlc_object_t *this)
 
     sys->chroma = chroma;
 
+    /* The spatial filter is recursive along the columns, so the planes are
+     * the slices, each with its own line buffer. */
     for (int i = 0; i < 3; ++i) {
         sys->w[i] = fmt_in->i_width  * chroma->p[i].w.num / chroma->p[i].w.den;
-        if (sys->w[i] > wmax) wmax = sys->w[i];
         sys->h[i] = fmt_out->i_height * chroma->p[i].h.num / chroma->p[i].h.den;
-    }
-    cfg->Line = malloc(wmax*sizeof(unsigned int));
-    if (!cfg->Line) {
-        free(sys);
-        return VLC_ENOMEM;
+        cfg->Line[i] = malloc(sys->w[i]*sizeof(unsigned int));
+        if (!cfg->Line[i]) {
+            for (int j = 0; j < i; ++j)
+                free(cfg->Line[j]);
+            free(sys);
+            return VLC_ENOMEM;
+        }
     }
 
     config_ChainParse(filter, FILTER_PREFIX, filter_options,
                       filter->p_cfg);
 
+    sys->slices = filter_NewSlices(var_InheritInteger(filter,
+                                                      FILTER_PREFIX "threads"));
 
     vlc_mutex_init( &sys->coefs_mutex );
     sys->b_recalc_coefs = true;
@@ -182,16 +193,40 @@ static void Close(vlc_object_t *this)
 
     vlc_mutex_destroy( &sys->coefs_mutex );
 
+    filter_DeleteSlices(sys->slices);
+
     for (int i = 0; i < 3; ++i) {
         free(cfg->Frame[i]);
+        free(cfg->Line[i]);
     }
-    free(cfg->Line);
     free(sys);
 }
 
 /*****************************************************************************
  * Filter
  *****************************************************************************/
+struct denoise_job
+{
+    filter_sys_t *sys;
+    picture_t *src, *dst;
+};
+
+static void DenoisePlane(void *opaque, unsigned i, unsigned count)
+{
+    struct denoise_job *job = opaque;
+    filter_sys_t *sys = job->sys;
+    struct vf_priv_s *cfg = &sys->cfg;
+    /* luma coefficients for the first plane, chroma ones for the others */
+    int *spat = cfg->Coefs[i ? 2 : 0];
+    int *temp = cfg->Coefs[i ? 3 : 1];
+
+    VLC_UNUSED(count);
+    deNoise(job->src->p[i].p_pixels, job->dst->p[i].p_pixels,
+            cfg->Line[i], &cfg->Frame[i], sys->w[i], sys->h[i],
+            job->src->p[i].i_pitch, job->dst->p[i].i_pitch,
+            spat, spat, temp);
+}
+
 static picture_t *Filter(filter_t *filter, picture_t *src)
 {
     picture_t *dst;
@@ -221,24 +256,8 @@ static picture_t *Filter(filter_t *filter, picture_t *src)
     }
     vlc_mutex_unlock( &sys->coefs_mutex );
 
-    deNoise(src->p[0].p_pixels, dst->p[0].p_pixels,
-            cfg->Line, &cfg->Frame[0], sys->w[0], sys->h[0],
-            src->p[0].i_pitch, dst->p[0].i_pitch,
-            cfg->Coefs[0],
-            cfg->Coefs[0],
-            cfg->Coefs[1]);
-    deNoise(src->p[1].p_pixels, dst->p[1].p_pixels,
-            cfg->Line, &cfg->Frame[1], sys->w[1], sys->h[1],
-            src->p[1].i_pitch, dst->p[1].i_pitch,
-            cfg->Coefs[2],
-            cfg->Coefs[2],
-            cfg->Coefs[3]);
-    deNoise(src->p[2].p_pixels, dst->p[2].p_pixels,
-            cfg->Line, &cfg->Frame[2], sys->w[2], sys->h[2],
-            src->p[2].i_pitch, dst->p[2].i_pitch,
-            cfg->Coefs[2],
-            cfg->Coefs[2],
-            cfg->Coefs[3]);
+    struct denoise_job job = { sys, src, dst };
+    filter_RunSlices(sys->slices, 3, DenoisePlane, &job);
 
     if(unlikely(!cfg->Frame[0] || !cfg->Frame[1] || !cfg->Frame[2]))
     {
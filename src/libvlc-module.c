@@ -831,6 +831,16 @@ static const char *const ppsz_prefres[] = {
     "However allocation of port numbers below 1025 is usually restricted " \
     "by the operating system." )
 
+#define HTTP_THREADS_TEXT N_( "HTTP server threads" )
+#define HTTP_THREADS_LONGTEXT N_( \
+    "Number of threads serving the clients of each HTTP, HTTPS or RTSP " \
+    "server. 0 uses one thread per CPU, up to four." )
+
+#define HTTP_BACKLOG_TEXT N_( "HTTP client backlog (kB)" )
+#define HTTP_BACKLOG_LONGTEXT N_( \
+    "Amount of live stream data kept for the HTTP clients. " \
+    "Clients lagging further behind skip to the live data." )
+
 #define HTTP_CERT_TEXT N_("HTTP/TLS server certificate")
 #define CERT_LONGTEXT N_( \
    "This X.509 certicate file (PEM format) is used for server-side TLS. " \
@@ -1010,6 +1020,12 @@ static const char *const ppsz_prefres[] = {
     "You can select which VoD server module you want to use. Set this " \
     "to 'vod_rtsp' to switch back to the old, legacy module." )
 
+#define BLOCK_POOL_TEXT N_("Pool data blocks")
+#define BLOCK_POOL_LONGTEXT N_( \
+    "Recycle the memory of data blocks of common sizes within each thread " \
+    "instead of returning it to the system. This reduces the allocation " \
+    "overhead and memory fragmentation of long-running streaming sessions." )
+
 #define RT_PRIORITY_TEXT N_("Allow real-time priority")
 #define RT_PRIORITY_LONGTEXT N_( \
     "Running VLC in real-time priority will allow for much more precise " \
@@ -1110,8 +1126,18 @@ static const char *const ppsz_prefres[] = {
 #define PREPARSE_TIMEOUT_LONGTEXT N_( \
     "Maximum time (in milliseconds) allowed to preparse an item" )
 
+#define PREPARSE_THREADS_TEXT N_( "Preparsing threads" )
+#define PREPARSE_THREADS_LONGTEXT N_( \
+    "Maximum number of items preparsed concurrently. " \
+    "0 uses one thread per CPU, up to four." )
+
 #define METADATA_NETWORK_TEXT N_( "Allow metadata network access" )
 
+#define METADATA_THREADS_TEXT N_( "Metadata fetching threads" )
+#define METADATA_THREADS_LONGTEXT N_( \
+    "Maximum number of items whose meta data and art are searched or " \
+    "downloaded concurrently, for each kind of lookup." )
+
 static const char *const psz_recursive_list[] = {
     "none", "collapse", "expand" };
 static const char *const psz_recursive_list_text[] = {
@@ -1782,6 +1808,12 @@ vlc_module_begin ()
         change_integer_range( 1, 65535 )
     add_integer( "https-port", 8443, HTTPS_PORT_TEXT, HTTPS_PORT_LONGTEXT, true )
         change_integer_range( 1, 65535 )
+    add_integer( "http-threads", 0, HTTP_THREADS_TEXT,
+                 HTTP_THREADS_LONGTEXT, true )
+        change_integer_range( 0, 64 )
+    add_integer( "http-backlog", 5000, HTTP_BACKLOG_TEXT,
+                 HTTP_BACKLOG_LONGTEXT, true )
+        change_integer_range( 64, 1000000 )
     add_string( "rtsp-host", NULL, RTSP_HOST_TEXT, RTSP_HOST_LONGTEXT, true )
     add_integer( "rtsp-port", 554, RTSP_PORT_TEXT, RTSP_PORT_LONGTEXT, true )
         change_integer_range( 1, 65535 )
@@ -2010,6 +2042,9 @@ vlc_module_begin ()
 
     set_section( N_("Performance options"), NULL )
 
+    add_bool( "block-pool", false, BLOCK_POOL_TEXT,
+              BLOCK_POOL_LONGTEXT, true )
+
 #if defined (LIBVLC_USE_PTHREAD) && !defined (__APPLE__)
     add_bool( "rt-priority", false, RT_PRIORITY_TEXT,
               RT_PRIORITY_LONGTEXT, true )
@@ -2080,10 +2115,16 @@ vlc_module_begin ()
 
     add_integer( "preparse-timeout", 5000, PREPARSE_TIMEOUT_TEXT,
                  PREPARSE_TIMEOUT_LONGTEXT, false )
+    add_integer_with_range( "preparse-threads", 0, 0, 32,
+                            PREPARSE_THREADS_TEXT,
+                            PREPARSE_THREADS_LONGTEXT, true )
 
     add_obsolete_integer( "album-art" )
     add_bool( "metadata-network-access", false, METADATA_NETWORK_TEXT,
                  METADATA_NETWORK_TEXT, false )
+    add_integer_with_range( "metadata-fetch-threads", 2, 1, 16,
+                            METADATA_THREADS_TEXT,
+                            METADATA_THREADS_LONGTEXT, true )
 
     add_string( "recursive", "collapse" , RECURSIVE_TEXT,
                 RECURSIVE_LONGTEXT, false )
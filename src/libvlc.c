@@ -162,6 +162,7 @@ int libvlc_InternalInit( libvlc_int_t *p_libvlc, int i_argc,
         goto error;
 
     vlc_LogInit(p_libvlc);
+    vlc_block_pool_setup(p_libvlc);
 
     /*
      * Support for gettext
@@ -417,6 +418,7 @@ void libvlc_InternalCleanup( libvlc_int_t *p_libvlc )
         playlist_preparser_Delete(priv->parser);
 
     libvlc_InternalActionsClean( p_libvlc );
+    vlc_block_pool_dump( VLC_OBJECT(p_libvlc) );
 
     /* Save the configuration */
     if( !var_InheritBool( p_libvlc, "ignore-config" ) )
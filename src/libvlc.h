@@ -63,6 +63,12 @@ void vlc_assert_locked (vlc_mutex_t *);
 # define vlc_assert_locked( m ) (void)m
 #endif
 
+/*
+ * Data blocks
+ */
+void vlc_block_pool_setup(libvlc_int_t *);
+void vlc_block_pool_dump(vlc_object_t *);
+
 /*
  * Logging
  */
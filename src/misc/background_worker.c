@@ -20,142 +20,276 @@
 #  include "config.h"
 #endif
 
+#include <assert.h>
+
 #include <vlc_common.h>
 #include <vlc_threads.h>
-#include <vlc_arrays.h>
 
 #include "libvlc.h"
 #include "background_worker.h"
 
+/** Number of hash buckets used to look queued entities up by id */
+#define BG_ID_BUCKETS 64
+
 struct bg_queued_item {
     void* id; /**< id associated with entity */
     void* entity; /**< the entity to process */
-    int timeout; /**< timeout duration in microseconds */
+    int timeout; /**< timeout duration in milliseconds */
+    bool urgent; /**< true if queued in the priority queue */
+
+    struct bg_queued_item* prev; /**< previous item in the queue */
+    struct bg_queued_item* next; /**< next item in the queue */
+    struct bg_queued_item* id_prev; /**< previous item in the id bucket */
+    struct bg_queued_item* id_next; /**< next item in the id bucket */
+};
+
+struct bg_queue {
+    struct bg_queued_item* first;
+    struct bg_queued_item* last;
+};
+
+struct bg_thread {
+    bool active; /**< true if a thread uses this slot */
+    bool probe_request; /**< true if a probe is requested */
+    void* id; /**< id of the current task, if any */
+    mtime_t deadline; /**< deadline of the current task */
 };
 
 struct background_worker {
     void* owner;
     struct background_worker_config conf;
 
-    struct {
-        bool probe_request; /**< true if a probe is requested */
-        vlc_mutex_t lock; /**< acquire to inspect members that follow */
-        vlc_cond_t wait; /**< wait for update in terms of head */
-        mtime_t deadline; /**< deadline of the current task */
-        void* id; /**< id of the current task */
-        bool active; /**< true if there is an active thread */
-    } head;
-
-    struct {
-        vlc_mutex_t lock; /**< acquire to inspect members that follow */
-        vlc_array_t data; /**< queue of pending entities to process */
-    } tail;
+    vlc_mutex_t lock; /**< acquire to inspect members that follow */
+    vlc_cond_t wait; /**< wait for an update of the tasks */
+
+    struct bg_queue queues[2]; /**< pending entities (urgent, then normal) */
+    struct bg_queued_item* ids[BG_ID_BUCKETS]; /**< pending entities by id */
+    size_t pending; /**< number of pending entities */
+
+    unsigned threads; /**< number of running threads */
+    unsigned idle; /**< number of running threads without a task */
+    struct bg_thread* slots; /**< state of each thread (max_threads) */
+
+    struct background_worker_stats stats;
 };
 
-static void* Thread( void* data )
+static struct bg_queued_item** IdBucket( struct background_worker* worker,
+                                         void* id )
 {
-    struct background_worker* worker = data;
+    uintptr_t h = (uintptr_t)id;
 
-    for( ;; )
+    h ^= h >> 17;
+    h *= UINT32_C(0x9E3779B1);
+    return &worker->ids[(h >> 8) % BG_ID_BUCKETS];
+}
+
+static void QueueAppend( struct background_worker* worker,
+                         struct bg_queued_item* item )
+{
+    struct bg_queue* queue = &worker->queues[item->urgent ? 0 : 1];
+    struct bg_queued_item** bucket = IdBucket( worker, item->id );
+
+    item->next = NULL;
+    item->prev = queue->last;
+    if( queue->last != NULL )
+        queue->last->next = item;
+    else
+        queue->first = item;
+    queue->last = item;
+
+    item->id_prev = NULL;
+    item->id_next = *bucket;
+    if( *bucket != NULL )
+        (*bucket)->id_prev = item;
+    *bucket = item;
+
+    worker->pending++;
+    if( worker->pending > worker->stats.max_pending )
+        worker->stats.max_pending = worker->pending;
+}
+
+static void QueueRemove( struct background_worker* worker,
+                         struct bg_queued_item* item )
+{
+    struct bg_queue* queue = &worker->queues[item->urgent ? 0 : 1];
+
+    if( item->prev != NULL )
+        item->prev->next = item->next;
+    else
+        queue->first = item->next;
+    if( item->next != NULL )
+        item->next->prev = item->prev;
+    else
+        queue->last = item->prev;
+
+    if( item->id_prev != NULL )
+        item->id_prev->id_next = item->id_next;
+    else
+        *IdBucket( worker, item->id ) = item->id_next;
+    if( item->id_next != NULL )
+        item->id_next->id_prev = item->id_prev;
+
+    assert( worker->pending > 0 );
+    worker->pending--;
+}
+
+static struct bg_queued_item* QueuePop( struct background_worker* worker )
+{
+    for( size_t i = 0; i < ARRAY_SIZE( worker->queues ); i++ )
     {
-        struct bg_queued_item* item = NULL;
-        void* handle;
+        struct bg_queued_item* item = worker->queues[i].first;
 
-        vlc_mutex_lock( &worker->tail.lock );
+        if( item != NULL )
         {
-            if( vlc_array_count( &worker->tail.data ) )
-            {
-                item = vlc_array_item_at_index( &worker->tail.data, 0 );
-                handle = NULL;
+            QueueRemove( worker, item );
+            return item;
+        }
+    }
+    return NULL;
+}
 
-                vlc_array_remove( &worker->tail.data, 0 );
-            }
+static void* Thread( void* data )
+{
+    struct background_worker* worker = data;
+    struct bg_thread* slot = NULL;
 
-            vlc_mutex_lock( &worker->head.lock );
-            {
-                worker->head.deadline = INT64_MAX;
-                worker->head.active = item != NULL;
-                worker->head.id = item ? item->id : NULL;
+    vlc_mutex_lock( &worker->lock );
+    for( unsigned i = 0; slot == NULL; i++ )
+    {
+        assert( i < worker->conf.max_threads );
+        if( !worker->slots[i].active )
+            slot = &worker->slots[i];
+    }
+    slot->active = true;
 
-                if( item && item->timeout > 0 )
-                    worker->head.deadline = mdate() + item->timeout * 1000;
-            }
-            vlc_cond_broadcast( &worker->head.wait );
-            vlc_mutex_unlock( &worker->head.lock );
-        }
-        vlc_mutex_unlock( &worker->tail.lock );
+    for( ;; )
+    {
+        struct bg_queued_item* item = QueuePop( worker );
+        void* handle = NULL;
 
         if( item == NULL )
             break;
 
-        if( worker->conf.pf_start( worker->owner, item->entity, &handle ) )
-        {
-            worker->conf.pf_release( item->entity );
-            free( item );
-            continue;
-        }
+        worker->idle--;
+        slot->id = item->id;
+        slot->probe_request = false;
+        slot->deadline = INT64_MAX;
+        if( item->timeout > 0 )
+            slot->deadline = mdate() + item->timeout * 1000;
+        vlc_mutex_unlock( &worker->lock );
+
+        mtime_t start = mdate();
+        bool started =
+            !worker->conf.pf_start( worker->owner, item->entity, &handle );
 
-        for( ;; )
+        while( started )
         {
-            vlc_mutex_lock( &worker->head.lock );
+            vlc_mutex_lock( &worker->lock );
 
-            bool const b_timeout = worker->head.deadline <= mdate();
-            worker->head.probe_request = false;
+            bool const b_timeout = slot->deadline <= mdate();
+            slot->probe_request = false;
 
-            vlc_mutex_unlock( &worker->head.lock );
+            vlc_mutex_unlock( &worker->lock );
 
             if( b_timeout ||
                 worker->conf.pf_probe( worker->owner, handle ) )
             {
                 worker->conf.pf_stop( worker->owner, handle );
-                worker->conf.pf_release( item->entity );
-                free( item );
                 break;
             }
 
-            vlc_mutex_lock( &worker->head.lock );
-            if( worker->head.probe_request == false &&
-                worker->head.deadline > mdate() )
+            vlc_mutex_lock( &worker->lock );
+            if( slot->probe_request == false && slot->deadline > mdate() )
             {
-                vlc_cond_timedwait( &worker->head.wait, &worker->head.lock,
-                                     worker->head.deadline );
+                vlc_cond_timedwait( &worker->wait, &worker->lock,
+                                     slot->deadline );
             }
-            vlc_mutex_unlock( &worker->head.lock );
+            vlc_mutex_unlock( &worker->lock );
         }
+
+        worker->conf.pf_release( item->entity );
+        free( item );
+
+        vlc_mutex_lock( &worker->lock );
+        if( started )
+        {
+            worker->stats.completed++;
+            worker->stats.busy += mdate() - start;
+        }
+        else
+            worker->stats.failed++;
+        worker->idle++;
+        slot->id = NULL;
+        vlc_cond_broadcast( &worker->wait );
     }
 
+    slot->active = false;
+    slot->id = NULL;
+    worker->idle--;
+    worker->threads--;
+    vlc_cond_broadcast( &worker->wait );
+    vlc_mutex_unlock( &worker->lock );
     return NULL;
 }
 
+static bool IsRunning( struct background_worker* worker, void* id )
+{
+    for( unsigned i = 0; i < worker->conf.max_threads; i++ )
+    {
+        struct bg_thread* slot = &worker->slots[i];
+
+        if( slot->active && slot->id != NULL
+         && ( id == NULL || slot->id == id ) )
+            return true;
+    }
+    return false;
+}
+
 static void BackgroundWorkerCancel( struct background_worker* worker, void* id)
 {
-    vlc_mutex_lock( &worker->tail.lock );
-    for( size_t i = 0; i < vlc_array_count( &worker->tail.data ); )
+    vlc_mutex_lock( &worker->lock );
+    if( id == NULL )
     {
-        struct bg_queued_item* item =
-            vlc_array_item_at_index( &worker->tail.data, i );
+        struct bg_queued_item* item;
 
-        if( id == NULL || item->id == id )
+        while( ( item = QueuePop( worker ) ) != NULL )
         {
-            vlc_array_remove( &worker->tail.data, i );
             worker->conf.pf_release( item->entity );
             free( item );
-            continue;
         }
+    }
+    else
+    {
+        struct bg_queued_item* item = *IdBucket( worker, id );
 
-        ++i;
+        while( item != NULL )
+        {
+            struct bg_queued_item* next = item->id_next;
+
+            if( item->id == id )
+            {
+                QueueRemove( worker, item );
+                worker->conf.pf_release( item->entity );
+                free( item );
+            }
+            item = next;
+        }
     }
-    vlc_mutex_unlock( &worker->tail.lock );
 
-    vlc_mutex_lock( &worker->head.lock );
-    while( ( id == NULL && worker->head.active )
-        || ( id != NULL && worker->head.id == id ) )
+    while( IsRunning( worker, id ) )
     {
-        worker->head.deadline = VLC_TS_0;
-        vlc_cond_broadcast( &worker->head.wait );
-        vlc_cond_wait( &worker->head.wait, &worker->head.lock );
+        for( unsigned i = 0; i < worker->conf.max_threads; i++ )
+        {
+            struct bg_thread* slot = &worker->slots[i];
+
+            if( slot->active && slot->id != NULL
+             && ( id == NULL || slot->id == id ) )
+                slot->deadline = VLC_TS_0;
+        }
+        vlc_cond_broadcast( &worker->wait );
+        vlc_cond_wait( &worker->wait, &worker->lock );
     }
-    vlc_mutex_unlock( &worker->head.lock );
+    vlc_mutex_unlock( &worker->lock );
 }
 
 struct background_worker* background_worker_New( void* owner,
@@ -167,22 +301,35 @@ struct background_worker* background_worker_New( void* owner,
         return NULL;
 
     worker->conf = *conf;
-    worker->owner = owner;
-    worker->head.id = NULL;
-    worker->head.active = false;
-    worker->head.deadline = VLC_TS_INVALID;
+    if( worker->conf.max_threads == 0 )
+        worker->conf.max_threads = 1;
 
-    vlc_mutex_init( &worker->head.lock );
-    vlc_cond_init( &worker->head.wait );
+    worker->slots = calloc( worker->conf.max_threads,
+                            sizeof( *worker->slots ) );
+    if( unlikely( !worker->slots ) )
+    {
+        free( worker );
+        return NULL;
+    }
 
-    vlc_array_init( &worker->tail.data );
-    vlc_mutex_init( &worker->tail.lock );
+    worker->owner = owner;
+    for( size_t i = 0; i < ARRAY_SIZE( worker->queues ); i++ )
+        worker->queues[i].first = worker->queues[i].last = NULL;
+    for( size_t i = 0; i < BG_ID_BUCKETS; i++ )
+        worker->ids[i] = NULL;
+    worker->pending = 0;
+    worker->threads = 0;
+    worker->idle = 0;
+    memset( &worker->stats, 0, sizeof( worker->stats ) );
+
+    vlc_mutex_init( &worker->lock );
+    vlc_cond_init( &worker->wait );
 
     return worker;
 }
 
 int background_worker_Push( struct background_worker* worker, void* entity,
-                        void* id, int timeout )
+                        void* id, int timeout, bool urgent )
 {
     struct bg_queued_item* item = malloc( sizeof( *item ) );
 
@@ -192,24 +339,30 @@ int background_worker_Push( struct background_worker* worker, void* entity,
     item->id = id;
     item->entity = entity;
     item->timeout = timeout < 0 ? worker->conf.default_timeout : timeout;
+    item->urgent = urgent;
 
-    vlc_mutex_lock( &worker->tail.lock );
-    vlc_array_append( &worker->tail.data, item );
-    vlc_mutex_unlock( &worker->tail.lock );
+    vlc_mutex_lock( &worker->lock );
+    QueueAppend( worker, item );
 
-    vlc_mutex_lock( &worker->head.lock );
-    if( worker->head.active == false )
+    /* Start another thread if every thread is busy */
+    if( worker->idle < worker->pending
+     && worker->threads < worker->conf.max_threads
+     && !vlc_clone_detach( NULL, Thread, worker, VLC_THREAD_PRIORITY_LOW ) )
     {
-        worker->head.probe_request = false;
-        worker->head.active =
-            !vlc_clone_detach( NULL, Thread, worker, VLC_THREAD_PRIORITY_LOW );
+        worker->threads++;
+        worker->idle++;
     }
 
-    if( worker->head.active )
+    int ret = VLC_SUCCESS;
+    if( worker->threads > 0 )
         worker->conf.pf_hold( item->entity );
-
-    int ret = worker->head.active ? VLC_SUCCESS : VLC_EGENERIC;
-    vlc_mutex_unlock( &worker->head.lock );
+    else
+    {
+        QueueRemove( worker, item );
+        free( item );
+        ret = VLC_EGENERIC;
+    }
+    vlc_mutex_unlock( &worker->lock );
 
     return ret;
 }
@@ -221,15 +374,33 @@ void background_worker_Cancel( struct background_worker* worker, void* id )
 
 void background_worker_RequestProbe( struct background_worker* worker )
 {
-    vlc_mutex_lock( &worker->head.lock );
-    worker->head.probe_request = true;
-    vlc_cond_broadcast( &worker->head.wait );
-    vlc_mutex_unlock( &worker->head.lock );
+    vlc_mutex_lock( &worker->lock );
+    for( unsigned i = 0; i < worker->conf.max_threads; i++ )
+        worker->slots[i].probe_request = true;
+    vlc_cond_broadcast( &worker->wait );
+    vlc_mutex_unlock( &worker->lock );
+}
+
+void background_worker_GetStats( struct background_worker* worker,
+                                 struct background_worker_stats* stats )
+{
+    vlc_mutex_lock( &worker->lock );
+    *stats = worker->stats;
+    vlc_mutex_unlock( &worker->lock );
 }
 
 void background_worker_Delete( struct background_worker* worker )
 {
     BackgroundWorkerCancel( worker, NULL );
-    vlc_array_clear( &worker->tail.data );
+
+    /* Wait for the threads to exit */
+    vlc_mutex_lock( &worker->lock );
+    while( worker->threads > 0 )
+        vlc_cond_wait( &worker->wait, &worker->lock );
+    vlc_mutex_unlock( &worker->lock );
+
+    vlc_cond_destroy( &worker->wait );
+    vlc_mutex_destroy( &worker->lock );
+    free( worker->slots );
     free( worker );
 }
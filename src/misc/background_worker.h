@@ -29,6 +29,15 @@ struct background_worker_config {
      **/
     mtime_t default_timeout;
 
+    /**
+     * Maximum number of entities processed concurrently
+     *
+     * The background-worker spawns threads on demand, up to this number, and
+     * lets them exit once the queue of pending entities is empty. A value of
+     * `0` is treated as `1`, which processes entities one at a time.
+     **/
+    unsigned max_threads;
+
     /**
      * Release an entity
      *
@@ -101,6 +110,16 @@ struct background_worker_config {
     void( *pf_stop )( void* owner, void* handle );
 };
 
+/**
+ * Statistics of a background-worker
+ **/
+struct background_worker_stats {
+    size_t max_pending; /**< highest number of queued entities */
+    unsigned long completed; /**< number of tasks run until stopped */
+    unsigned long failed; /**< number of tasks that failed to start */
+    mtime_t busy; /**< cumulated run time of the completed tasks */
+};
+
 /**
  * Create a background-worker
  *
@@ -137,7 +156,11 @@ void background_worker_RequestProbe( struct background_worker* worker );
  *
  * This function is used to push an entity into the queue of pending work. The
  * entities will be processed in the order in which they are received (in terms
- * of the order of invocations in a single-threaded environment).
+ * of the order of invocations in a single-threaded environment), urgent
+ * entities being processed before any other pending entity.
+ *
+ * \note With more than one thread, entities are only started in order; they
+ *       may complete in any order.
  *
  * \param worker the background-worker
  * \param entity the entity which is to be queued
@@ -145,11 +168,12 @@ void background_worker_RequestProbe( struct background_worker* worker );
  * \param timeout the timeout of the entity in milliseconds, `0` denotes no
  *                timeout, a negative value will use the default timeout
  *                associated with the background-worker.
+ * \param urgent true to queue the entity ahead of the non-urgent ones
  * \return VLC_SUCCESS if the entity was successfully queued, an error-code on
  *         failure.
  **/
 int background_worker_Push( struct background_worker* worker, void* entity,
-    void* id, int timeout );
+    void* id, int timeout, bool urgent );
 
 /**
  * Remove entities from the background-worker
@@ -167,6 +191,15 @@ int background_worker_Push( struct background_worker* worker, void* entity,
  **/
 void background_worker_Cancel( struct background_worker* worker, void* id );
 
+/**
+ * Retrieve the statistics of a background-worker
+ *
+ * \param worker the background-worker
+ * \param stats [out] the statistics collected since creation
+ **/
+void background_worker_GetStats( struct background_worker* worker,
+    struct background_worker_stats* stats );
+
 /**
  * Delete a background-worker
  *
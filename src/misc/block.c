@@ -34,6 +34,8 @@
 #include <vlc_common.h>
 #include <vlc_block.h>
 #include <vlc_fs.h>
+#include <vlc_atomic.h>
+#include "libvlc.h"
 
 #ifndef NDEBUG
 static void BlockNoRelease( block_t *b )
@@ -117,8 +119,331 @@ static void BlockMetaCopy( block_t *restrict out, const block_t *in )
 /** Initial reserved header and footer size. */
 #define BLOCK_PADDING      32
 
+/*
+ * Pooled allocator
+ *
+ * Blocks of a few common sizes are recycled instead of being returned to the
+ * system allocator. Each thread keeps one magazine (a small stack of free
+ * blocks) per size class, so that most allocations and releases do not take
+ * any lock. Full and empty magazines are exchanged with a global depot.
+ */
+
+/** Payload sizes of the pooled block classes */
+static const size_t block_pool_sizes[] = {
+    188, /* one TS packet */
+    7 * 188, /* one UDP/RTP datagram of TS packets */
+    1500, /* Ethernet MTU */
+    4096,
+    16384,
+    65536,
+};
+
+#define BLOCK_POOL_CLASSES ARRAY_SIZE(block_pool_sizes)
+
+/** Number of blocks per magazine */
+#define BLOCK_MAGAZINE_SIZE 32
+
+/** Maximum amount of memory kept in the depot per size class */
+#define BLOCK_DEPOT_BYTES (16 << 20)
+
+typedef struct block_magazine
+{
+    struct block_magazine *next;
+    unsigned count;
+    block_t *rounds[BLOCK_MAGAZINE_SIZE];
+} block_magazine_t;
+
+typedef struct
+{
+    vlc_mutex_t lock;
+    block_magazine_t *full;
+    block_magazine_t *empty;
+    unsigned full_count;
+    unsigned full_max;
+    uint64_t allocs;
+    uint64_t misses;
+} block_depot_t;
+
+typedef struct
+{
+    block_magazine_t *loaded[BLOCK_POOL_CLASSES];
+    /* Statistics not yet accounted in the depot */
+    unsigned allocs[BLOCK_POOL_CLASSES];
+    unsigned misses[BLOCK_POOL_CLASSES];
+} block_cache_t;
+
+static atomic_bool block_pool_enabled = ATOMIC_VAR_INIT(false);
+static vlc_threadvar_t block_pool_key;
+static block_depot_t block_depots[BLOCK_POOL_CLASSES];
+
+static size_t block_pool_AllocSize(unsigned c)
+{
+    /* Same layout as block_Alloc() */
+    return sizeof (block_t) + BLOCK_ALIGN + (2 * BLOCK_PADDING)
+           + block_pool_sizes[c];
+}
+
+/** Flushes the statistics of a thread cache (depot lock must be held). */
+static void block_depot_Account(block_depot_t *depot, block_cache_t *cache,
+                                unsigned c)
+{
+    vlc_assert_locked(&depot->lock);
+    depot->allocs += cache->allocs[c];
+    depot->misses += cache->misses[c];
+    cache->allocs[c] = cache->misses[c] = 0;
+}
+
+/**
+ * Returns a magazine to the depot.
+ * The blocks are freed if the depot is already full.
+ */
+static void block_depot_Put(block_depot_t *depot, block_magazine_t *mag)
+{
+    if (mag->count > 0 && depot->full_count >= depot->full_max)
+    {
+        while (mag->count > 0)
+            free(mag->rounds[--mag->count]);
+    }
+
+    if (mag->count > 0)
+    {
+        mag->next = depot->full;
+        depot->full = mag;
+        depot->full_count++;
+    }
+    else
+    {
+        mag->next = depot->empty;
+        depot->empty = mag;
+    }
+}
+
+/**
+ * Exchanges the loaded magazine of a thread cache with the depot.
+ * @param full true to get a non-empty magazine (allocation),
+ *             false to get an empty magazine (release)
+ * @return the new loaded magazine, or NULL if none is available
+ */
+static block_magazine_t *block_cache_Exchange(block_cache_t *cache,
+                                              unsigned c, bool full)
+{
+    block_depot_t *depot = &block_depots[c];
+    block_magazine_t *mag;
+
+    vlc_mutex_lock(&depot->lock);
+    block_depot_Account(depot, cache, c);
+
+    if (full)
+    {
+        mag = depot->full;
+        if (mag != NULL)
+        {
+            depot->full = mag->next;
+            depot->full_count--;
+        }
+    }
+    else
+    {
+        mag = depot->empty;
+        if (mag != NULL)
+            depot->empty = mag->next;
+    }
+
+    if (mag != NULL && cache->loaded[c] != NULL)
+        block_depot_Put(depot, cache->loaded[c]);
+    vlc_mutex_unlock(&depot->lock);
+
+    if (mag == NULL && !full)
+    {   /* No spare empty magazine: allocate one */
+        mag = malloc(sizeof (*mag));
+        if (unlikely(mag == NULL))
+            return NULL;
+        mag->count = 0;
+
+        if (cache->loaded[c] != NULL)
+        {
+            vlc_mutex_lock(&depot->lock);
+            block_depot_Put(depot, cache->loaded[c]);
+            vlc_mutex_unlock(&depot->lock);
+        }
+    }
+
+    if (mag != NULL)
+        cache->loaded[c] = mag;
+    return mag;
+}
+
+static void block_cache_Destroy(void *data)
+{
+    block_cache_t *cache = data;
+
+    for (unsigned c = 0; c < BLOCK_POOL_CLASSES; c++)
+    {
+        block_depot_t *depot = &block_depots[c];
+
+        vlc_mutex_lock(&depot->lock);
+        block_depot_Account(depot, cache, c);
+        if (cache->loaded[c] != NULL)
+            block_depot_Put(depot, cache->loaded[c]);
+        vlc_mutex_unlock(&depot->lock);
+    }
+    free(cache);
+}
+
+static block_cache_t *block_cache_Get(void)
+{
+    block_cache_t *cache = vlc_threadvar_get(block_pool_key);
+
+    if (likely(cache != NULL))
+        return cache;
+
+    cache = calloc(1, sizeof (*cache));
+    if (unlikely(cache == NULL))
+        return NULL;
+
+    if (vlc_threadvar_set(block_pool_key, cache))
+    {
+        free(cache);
+        return NULL;
+    }
+    return cache;
+}
+
+static unsigned block_pool_Class(size_t size)
+{
+    for (unsigned c = 0; c < BLOCK_POOL_CLASSES; c++)
+        if (size <= block_pool_sizes[c])
+            return c;
+    return BLOCK_POOL_CLASSES;
+}
+
+static void block_pool_Release(block_t *block)
+{
+    unsigned c = block_pool_Class(block->i_size - BLOCK_ALIGN
+                                  - (2 * BLOCK_PADDING));
+
+    assert(c < BLOCK_POOL_CLASSES);
+    assert(block->p_start == (unsigned char *)(block + 1));
+    assert(sizeof (*block) + block->i_size == block_pool_AllocSize(c));
+    block_Invalidate(block);
+
+    block_cache_t *cache = block_cache_Get();
+    if (unlikely(cache == NULL))
+        goto drop;
+
+    block_magazine_t *mag = cache->loaded[c];
+    if (mag == NULL || mag->count >= BLOCK_MAGAZINE_SIZE)
+    {
+        mag = block_cache_Exchange(cache, c, false);
+        if (unlikely(mag == NULL))
+            goto drop;
+    }
+
+    assert(mag->count < BLOCK_MAGAZINE_SIZE);
+    mag->rounds[mag->count++] = block;
+    return;
+drop:
+    free(block);
+}
+
+static block_t *block_pool_Alloc(size_t size)
+{
+    unsigned c = block_pool_Class(size);
+    if (c >= BLOCK_POOL_CLASSES)
+        return NULL; /* too big, use the system allocator */
+
+    block_cache_t *cache = block_cache_Get();
+    if (unlikely(cache == NULL))
+        return NULL;
+
+    block_magazine_t *mag = cache->loaded[c];
+    block_t *b;
+
+    if (mag == NULL || mag->count == 0)
+        mag = block_cache_Exchange(cache, c, true);
+
+    cache->allocs[c]++;
+    if (mag != NULL && mag->count > 0)
+        b = mag->rounds[--mag->count];
+    else
+    {
+        cache->misses[c]++;
+        b = malloc(block_pool_AllocSize(c));
+        if (unlikely(b == NULL))
+            return NULL;
+    }
+
+    block_Init(b, b + 1, block_pool_AllocSize(c) - sizeof (*b));
+    b->p_buffer += BLOCK_PADDING + BLOCK_ALIGN - 1;
+    b->p_buffer = (void *)(((uintptr_t)b->p_buffer) & ~(BLOCK_ALIGN - 1));
+    b->i_buffer = size;
+    b->pf_release = block_pool_Release;
+    return b;
+}
+
+void vlc_block_pool_setup(libvlc_int_t *libvlc)
+{
+    static vlc_mutex_t lock = VLC_STATIC_MUTEX;
+
+    if (!var_InheritBool(libvlc, "block-pool"))
+        return;
+
+    vlc_mutex_lock(&lock);
+    if (!atomic_load(&block_pool_enabled)
+     && vlc_threadvar_create(&block_pool_key, block_cache_Destroy) == 0)
+    {
+        for (unsigned c = 0; c < BLOCK_POOL_CLASSES; c++)
+        {
+            block_depot_t *depot = &block_depots[c];
+            size_t bytes = BLOCK_MAGAZINE_SIZE * block_pool_AllocSize(c);
+
+            vlc_mutex_init(&depot->lock);
+            depot->full = depot->empty = NULL;
+            depot->full_count = 0;
+            depot->full_max = __MAX(BLOCK_DEPOT_BYTES / bytes, 2);
+            depot->allocs = depot->misses = 0;
+        }
+        atomic_store(&block_pool_enabled, true);
+        msg_Dbg(libvlc, "using pooled block allocator");
+    }
+    vlc_mutex_unlock(&lock);
+}
+
+void vlc_block_pool_dump(vlc_object_t *obj)
+{
+    if (!atomic_load(&block_pool_enabled))
+        return;
+
+    for (unsigned c = 0; c < BLOCK_POOL_CLASSES; c++)
+    {
+        block_depot_t *depot = &block_depots[c];
+        uint64_t allocs, misses;
+        unsigned cached;
+
+        vlc_mutex_lock(&depot->lock);
+        allocs = depot->allocs;
+        misses = depot->misses;
+        cached = depot->full_count;
+        vlc_mutex_unlock(&depot->lock);
+
+        if (allocs == 0)
+            continue;
+        msg_Dbg(obj, "block pool %zu bytes: %"PRIu64" allocations, "
+                "%.1f%% recycled, %u magazine(s) in depot",
+                block_pool_sizes[c], allocs,
+                100. * (allocs - misses) / allocs, cached);
+    }
+}
+
 block_t *block_Alloc (size_t size)
 {
+    if (atomic_load_explicit(&block_pool_enabled, memory_order_relaxed))
+    {
+        block_t *b = block_pool_Alloc(size);
+        if (b != NULL)
+            return b;
+    }
+
     /* 2 * BLOCK_PADDING: pre + post padding */
     const size_t alloc = sizeof (block_t) + BLOCK_ALIGN + (2 * BLOCK_PADDING)
                        + size;
@@ -139,6 +464,117 @@ block_t *block_Alloc (size_t size)
     return b;
 }
 
+/*
+ * Shared payload blocks
+ *
+ * Several blocks can reference the same payload, each with its own properties
+ * and its own bounds within the payload. The payload is released with the
+ * last of them. It is read-only while it is shared: growing a block copies it,
+ * and block_Unshare() must be called before writing to it in place.
+ */
+typedef struct
+{
+    atomic_uint refs;
+    block_t *block; /**< Owner of the payload */
+} block_payload_t;
+
+typedef struct
+{
+    block_t self;
+    block_payload_t *payload;
+} block_shared_t;
+
+static void block_shared_Release (block_t *block)
+{
+    block_payload_t *payload = ((block_shared_t *)block)->payload;
+
+    block_Invalidate (block);
+    free (block);
+
+    if (atomic_fetch_sub_explicit (&payload->refs, 1,
+                                   memory_order_acq_rel) == 1)
+    {
+        block_Release (payload->block);
+        free (payload);
+    }
+}
+
+static block_t *block_shared_New (block_t *block, block_payload_t *payload)
+{
+    block_shared_t *sh = malloc (sizeof (*sh));
+    if (unlikely(sh == NULL))
+        return NULL;
+
+    block_Init (&sh->self, block->p_start, block->i_size);
+    sh->self.p_buffer = block->p_buffer;
+    sh->self.i_buffer = block->i_buffer;
+    block_CopyProperties (&sh->self, block);
+    sh->self.pf_release = block_shared_Release;
+    sh->payload = payload;
+    return &sh->self;
+}
+
+/** Tells whether the payload of a block is referenced by other blocks */
+static bool block_IsShared (block_t *block)
+{
+    return block->pf_release == block_shared_Release
+        && atomic_load_explicit (&((block_shared_t *)block)->payload->refs,
+                                 memory_order_acquire) > 1;
+}
+
+block_t *block_Shared (block_t *block)
+{
+    if (block->pf_release == block_shared_Release)
+        return block;
+
+    block_payload_t *payload = malloc (sizeof (*payload));
+    if (unlikely(payload == NULL))
+    {
+        block_Release (block);
+        return NULL;
+    }
+    atomic_init (&payload->refs, 1);
+    payload->block = block;
+
+    block_t *sh = block_shared_New (block, payload);
+    if (unlikely(sh == NULL))
+    {
+        free (payload);
+        block_Release (block);
+        return NULL;
+    }
+    sh->p_next = block->p_next;
+    block->p_next = NULL;
+    return sh;
+}
+
+block_t *block_Share (block_t *block)
+{
+    assert (block->pf_release == block_shared_Release);
+
+    block_payload_t *payload = ((block_shared_t *)block)->payload;
+    block_t *sh = block_shared_New (block, payload);
+
+    if (likely(sh != NULL))
+        atomic_fetch_add_explicit (&payload->refs, 1, memory_order_relaxed);
+    return sh;
+}
+
+block_t *block_Unshare (block_t *block)
+{
+    if (!block_IsShared (block))
+        return block;
+
+    block_t *dup = block_Alloc (block->i_buffer);
+    if (likely(dup != NULL))
+    {
+        memcpy (dup->p_buffer, block->p_buffer, block->i_buffer);
+        BlockMetaCopy (dup, block);
+    }
+    block_Release (block);
+    return dup;
+}
+
 block_t *block_TryRealloc (block_t *p_block, ssize_t i_prebody, size_t i_body)
 {
     block_Check( p_block );
@@ -173,9 +609,13 @@ block_t *block_TryRealloc (block_t *p_block, ssize_t i_prebody, size_t i_body)
 
     size_t requested = i_prebody + i_body;
 
+    /* A shared payload cannot grow in place, the other blocks use it */
+    bool b_shared = ( i_prebody > 0 || i_body > p_block->i_buffer )
+                 && block_IsShared( p_block );
+
     if( p_block->i_buffer == 0 )
     {   /* Corner case: nothing to preserve */
-        if( requested <= p_block->i_size )
+        if( requested <= p_block->i_size && !b_shared )
         {   /* Enough room: recycle buffer */
             size_t extra = p_block->i_size - requested;
 
@@ -199,7 +639,8 @@ block_t *block_TryRealloc (block_t *p_block, ssize_t i_prebody, size_t i_body)
 
     /* Second, reallocate the buffer if we lack space. */
     assert( i_prebody >= 0 );
-    if( (size_t)(p_block->p_buffer - p_start) < (size_t)i_prebody
+    if( b_shared
+     || (size_t)(p_block->p_buffer - p_start) < (size_t)i_prebody
      || (size_t)(p_end - p_block->p_buffer) < i_body )
     {
         block_t *p_rea = block_Alloc( requested );
@@ -30,6 +30,7 @@
 
 #include <vlc_common.h>
 #include <vlc_block.h>
+#include <vlc_atomic.h>
 #include "libvlc.h"
 
 /**
@@ -233,3 +234,245 @@ size_t block_FifoCount (block_fifo_t *fifo)
     vlc_mutex_unlock (&fifo->lock);
     return depth;
 }
+
+/**
+ * Single-producer single-consumer FIFO
+ *
+ * Blocks are stored in a linked list of fixed-size arrays (segments). The
+ * producer fills the tail segment and appends a new one when it is full,
+ * the consumer drains the head segment and hands it back when it is empty.
+ *
+ * Each side only writes to its own counters, which are kept on separate
+ * cache lines: the number of queued blocks (and bytes) is the difference
+ * between the produced and consumed counters. Storing the produced counter
+ * publishes the block pointers to the consumer (release/acquire ordering).
+ */
+#define SPSC_SEGMENT_SIZE 255
+
+typedef struct block_spsc_segment
+{
+    _Atomic(struct block_spsc_segment *) next;
+    block_t *slots[SPSC_SEGMENT_SIZE];
+} block_spsc_segment_t;
+
+struct block_spsc_t
+{
+    /* Producer state */
+    atomic_size_t       i_produced;
+    atomic_size_t       i_bytes_in;
+    block_spsc_segment_t *p_tail;
+    unsigned            i_tail;
+    char                pad1[64];
+
+    /* Consumer state */
+    atomic_size_t       i_consumed;
+    atomic_size_t       i_bytes_out;
+    size_t              i_available; /**< Last known produced count */
+    block_spsc_segment_t *p_head;
+    unsigned            i_head;
+    char                pad2[64];
+
+    /* Shared state */
+    _Atomic(block_spsc_segment_t *) spare; /**< Recycled segment */
+    atomic_bool         b_waiting; /**< Whether the consumer is sleeping */
+    vlc_mutex_t         lock; /**< Only used to sleep and wake up */
+    vlc_cond_t          wait;
+};
+
+static block_spsc_segment_t *block_SpscNewSegment(block_spsc_t *fifo)
+{
+    block_spsc_segment_t *seg = atomic_exchange_explicit(&fifo->spare, NULL,
+                                                        memory_order_acquire);
+    if (seg == NULL)
+    {
+        seg = malloc(sizeof (*seg));
+        if (unlikely(seg == NULL))
+            return NULL;
+    }
+    atomic_init(&seg->next, NULL);
+    return seg;
+}
+
+block_spsc_t *block_SpscNew(void)
+{
+    block_spsc_t *fifo = malloc(sizeof (*fifo));
+    if (unlikely(fifo == NULL))
+        return NULL;
+
+    atomic_init(&fifo->spare, NULL);
+
+    block_spsc_segment_t *seg = block_SpscNewSegment(fifo);
+    if (unlikely(seg == NULL))
+    {
+        free(fifo);
+        return NULL;
+    }
+
+    atomic_init(&fifo->i_produced, 0);
+    atomic_init(&fifo->i_bytes_in, 0);
+    fifo->p_tail = seg;
+    fifo->i_tail = 0;
+    atomic_init(&fifo->i_consumed, 0);
+    atomic_init(&fifo->i_bytes_out, 0);
+    fifo->i_available = 0;
+    fifo->p_head = seg;
+    fifo->i_head = 0;
+    atomic_init(&fifo->b_waiting, false);
+    vlc_mutex_init(&fifo->lock);
+    vlc_cond_init(&fifo->wait);
+    return fifo;
+}
+
+void block_SpscRelease(block_spsc_t *fifo)
+{
+    block_t *block;
+
+    while ((block = block_SpscTryGet(fifo)) != NULL)
+        block_Release(block);
+
+    assert(fifo->p_head == fifo->p_tail);
+    free(fifo->p_head);
+    free(atomic_load(&fifo->spare));
+    vlc_cond_destroy(&fifo->wait);
+    vlc_mutex_destroy(&fifo->lock);
+    free(fifo);
+}
+
+void block_SpscPut(block_spsc_t *fifo, block_t *block)
+{
+    size_t produced = atomic_load_explicit(&fifo->i_produced,
+                                           memory_order_relaxed);
+    size_t bytes = atomic_load_explicit(&fifo->i_bytes_in,
+                                        memory_order_relaxed);
+
+    if (block == NULL)
+        return;
+
+    do
+    {
+        block_t *next = block->p_next;
+
+        block->p_next = NULL;
+
+        if (fifo->i_tail == SPSC_SEGMENT_SIZE)
+        {
+            block_spsc_segment_t *seg = block_SpscNewSegment(fifo);
+            if (unlikely(seg == NULL))
+            {
+                block_ChainRelease(block);
+                break;
+            }
+            atomic_store_explicit(&fifo->p_tail->next, seg,
+                                  memory_order_release);
+            fifo->p_tail = seg;
+            fifo->i_tail = 0;
+        }
+
+        fifo->p_tail->slots[fifo->i_tail++] = block;
+        bytes += block->i_buffer;
+        atomic_store_explicit(&fifo->i_bytes_in, bytes,
+                              memory_order_relaxed);
+        atomic_store_explicit(&fifo->i_produced, ++produced,
+                              memory_order_release);
+        block = next;
+    }
+    while (block != NULL);
+
+    /* Only wake the consumer up if it is (about to be) asleep */
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&fifo->b_waiting, memory_order_relaxed))
+    {
+        vlc_mutex_lock(&fifo->lock);
+        vlc_cond_signal(&fifo->wait);
+        vlc_mutex_unlock(&fifo->lock);
+    }
+}
+
+block_t *block_SpscTryGet(block_spsc_t *fifo)
+{
+    size_t consumed = atomic_load_explicit(&fifo->i_consumed,
+                                           memory_order_relaxed);
+
+    if (fifo->i_available == consumed)
+    {
+        fifo->i_available = atomic_load_explicit(&fifo->i_produced,
+                                                 memory_order_acquire);
+        if (fifo->i_available == consumed)
+            return NULL;
+    }
+
+    if (fifo->i_head == SPSC_SEGMENT_SIZE)
+    {
+        block_spsc_segment_t *seg = fifo->p_head;
+
+        fifo->p_head = atomic_load_explicit(&seg->next, memory_order_acquire);
+        fifo->i_head = 0;
+        assert(fifo->p_head != NULL);
+
+        seg = atomic_exchange_explicit(&fifo->spare, seg,
+                                       memory_order_acq_rel);
+        free(seg);
+    }
+
+    block_t *block = fifo->p_head->slots[fifo->i_head++];
+    size_t bytes = atomic_load_explicit(&fifo->i_bytes_out,
+                                        memory_order_relaxed);
+
+    atomic_store_explicit(&fifo->i_bytes_out, bytes + block->i_buffer,
+                          memory_order_relaxed);
+    atomic_store_explicit(&fifo->i_consumed, consumed + 1,
+                          memory_order_relaxed);
+    return block;
+}
+
+static void block_SpscCleanup(void *data)
+{
+    block_spsc_t *fifo = data;
+
+    atomic_store(&fifo->b_waiting, false);
+    vlc_mutex_unlock(&fifo->lock);
+}
+
+block_t *block_SpscGet(block_spsc_t *fifo)
+{
+    block_t *block;
+
+    vlc_testcancel();
+
+    while ((block = block_SpscTryGet(fifo)) == NULL)
+    {
+        size_t consumed = atomic_load_explicit(&fifo->i_consumed,
+                                               memory_order_relaxed);
+
+        vlc_mutex_lock(&fifo->lock);
+        atomic_store(&fifo->b_waiting, true);
+        vlc_cleanup_push(block_SpscCleanup, fifo);
+        while (atomic_load(&fifo->i_produced) == consumed)
+            vlc_cond_wait(&fifo->wait, &fifo->lock);
+        vlc_cleanup_pop();
+        block_SpscCleanup(fifo);
+    }
+    return block;
+}
+
+size_t block_SpscCount(const block_spsc_t *fifo)
+{
+    block_spsc_t *f = (block_spsc_t *)fifo;
+    size_t consumed = atomic_load_explicit(&f->i_consumed,
+                                           memory_order_relaxed);
+    size_t produced = atomic_load_explicit(&f->i_produced,
+                                           memory_order_acquire);
+
+    return produced - consumed;
+}
+
+size_t block_SpscSize(const block_spsc_t *fifo)
+{
+    block_spsc_t *f = (block_spsc_t *)fifo;
+    size_t bytes_out = atomic_load_explicit(&f->i_bytes_out,
+                                            memory_order_relaxed);
+    size_t bytes_in = atomic_load_explicit(&f->i_bytes_in,
+                                           memory_order_acquire);
+
+    return bytes_in - bytes_out;
+}
@@ -28,6 +28,7 @@
 #include <vlc_filter.h>
 #include <vlc_modules.h>
 #include <vlc_mouse.h>
+#include <vlc_picture_pool.h>
 #include <vlc_spu.h>
 #include <libvlc.h>
 #include <assert.h>
@@ -42,6 +43,14 @@ typedef struct chained_filter_t
     picture_t *pending;
 } chained_filter_t;
 
+/* Pool of the pictures exchanged between two filters of a chain */
+typedef struct chained_pool_t
+{
+    struct chained_pool_t *next;
+    video_format_t fmt; /**< Format of the pooled pictures */
+    picture_pool_t *pool;
+} chained_pool_t;
+
 /* Only use this with filter objects from _this_ C module */
 static inline chained_filter_t *chained(filter_t *filter)
 {
@@ -61,12 +70,17 @@ struct filter_chain_t
     bool b_allow_fmt_out_change; /**< Can the output format be changed? */
     const char *filter_cap; /**< Filter modules capability */
     const char *conv_cap; /**< Converter modules capability */
+
+    chained_pool_t *pools; /**< Intermediate picture pools, per format */
+    unsigned pool_allocs; /**< Intermediate pictures allocated */
+    unsigned pool_misses; /**< Intermediate pictures not from a pool */
 };
 
 /**
  * Local prototypes
  */
 static void FilterDeletePictures( picture_t * );
+static void FilterDeletePools( filter_chain_t * );
 
 static filter_chain_t *filter_chain_NewInner( const filter_owner_t *callbacks,
     const char *cap, const char *conv_cap, bool fmt_out_change,
@@ -89,6 +103,9 @@ static filter_chain_t *filter_chain_NewInner( const filter_owner_t *callbacks,
     chain->b_allow_fmt_out_change = fmt_out_change;
     chain->filter_cap = cap;
     chain->conv_cap = conv_cap;
+    chain->pools = NULL;
+    chain->pool_allocs = 0;
+    chain->pool_misses = 0;
     return chain;
 }
 
@@ -106,14 +123,64 @@ filter_chain_t *filter_chain_New( vlc_object_t *obj, const char *cap,
     return filter_chain_NewInner( &callbacks, cap, NULL, false, NULL, cat );
 }
 
+/**
+ * Gets the pool of intermediate pictures of a given format, creating it
+ * if needed. Filters with the same output format share the same pool.
+ */
+static picture_pool_t *filter_chain_GetPool( filter_chain_t *chain,
+                                             const video_format_t *fmt )
+{
+    if( fmt->p_palette != NULL )
+        return NULL;
+
+    for( chained_pool_t *p = chain->pools; p != NULL; p = p->next )
+        if( video_format_IsSimilar( &p->fmt, fmt ) )
+            return p->pool;
+
+    /* Every filter downstream may hold a picture, the producing filter may
+     * hold its previous output while filling the next one. */
+    unsigned count = 1;
+    for( chained_filter_t *f = chain->first; f != NULL; f = f->next )
+        count++;
+
+    chained_pool_t *p = malloc( sizeof (*p) );
+    if( unlikely(p == NULL) )
+        return NULL;
+
+    p->pool = picture_pool_NewFromFormat( fmt, count );
+    if( p->pool == NULL )
+    {
+        free( p );
+        return NULL;
+    }
+    p->fmt = *fmt;
+    p->next = chain->pools;
+    chain->pools = p;
+    return p->pool;
+}
+
 /** Chained filter picture allocator function */
 static picture_t *filter_chain_VideoBufferNew( filter_t *filter )
 {
     if( chained(filter)->next != NULL )
     {
-        picture_t *pic = picture_NewFromFormat( &filter->fmt_out.video );
-        if( pic == NULL )
-            msg_Err( filter, "Failed to allocate picture" );
+        filter_chain_t *chain = filter->owner.sys;
+        picture_pool_t *pool = filter_chain_GetPool( chain,
+                                                     &filter->fmt_out.video );
+        picture_t *pic = NULL;
+
+        chain->pool_allocs++;
+        if( pool != NULL )
+            pic = picture_pool_Get( pool );
+        if( pic != NULL )
+            pic->format = filter->fmt_out.video;
+        else
+        {
+            chain->pool_misses++;
+            pic = picture_NewFromFormat( &filter->fmt_out.video );
+            if( pic == NULL )
+                msg_Err( filter, "Failed to allocate picture" );
+        }
         return pic;
     }
     else
@@ -150,6 +217,7 @@ void filter_chain_Delete( filter_chain_t *p_chain )
 {
     while( p_chain->first != NULL )
         filter_chain_DeleteFilter( p_chain, &p_chain->first->filter );
+    FilterDeletePools( p_chain );
 
     es_format_Clean( &p_chain->fmt_in );
     es_format_Clean( &p_chain->fmt_out );
@@ -225,6 +293,9 @@ static filter_t *filter_chain_AppendInner( filter_chain_t *chain,
     if( filter->p_module == NULL )
         goto error;
 
+    /* The pools are sized for the chain depth */
+    FilterDeletePools( chain );
+
     if( filter->b_allow_fmt_out_change )
     {
         es_format_Clean( &chain->fmt_out );
@@ -305,6 +376,7 @@ void filter_chain_DeleteFilter( filter_chain_t *chain, filter_t *filter )
 
     msg_Dbg( obj, "Filter %p removed from chain", (void *)filter );
     FilterDeletePictures( chained->pending );
+    FilterDeletePools( chain );
 
     free( chained->mouse );
     es_format_Clean( &filter->fmt_out );
@@ -378,6 +450,11 @@ bool filter_chain_IsEmpty(const filter_chain_t *chain)
     return chain->first == NULL;
 }
 
+unsigned filter_chain_GetPoolMisses(const filter_chain_t *chain)
+{
+    return chain->pool_misses;
+}
+
 const es_format_t *filter_chain_GetFmtOut( filter_chain_t *p_chain )
 {
 
@@ -527,3 +604,28 @@ static void FilterDeletePictures( picture_t *picture )
         picture = next;
     }
 }
+
+/**
+ * Releases the intermediate picture pools. Pictures still in use remain
+ * valid until they are released.
+ */
+static void FilterDeletePools( filter_chain_t *chain )
+{
+    if( chain->pool_allocs > 0 )
+    {
+        vlc_object_t *obj = chain->callbacks.sys;
+
+        msg_Dbg( obj, "%u intermediate pictures, %u not from a pool",
+                 chain->pool_allocs, chain->pool_misses );
+        chain->pool_allocs = chain->pool_misses = 0;
+    }
+
+    while( chain->pools != NULL )
+    {
+        chained_pool_t *p = chain->pools;
+
+        chain->pools = p->next;
+        picture_pool_Release( p->pool );
+        free( p );
+    }
+}
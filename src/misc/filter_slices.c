@@ -0,0 +1,231 @@
+/*****************************************************************************
+ * filter_slices.c : slice-threaded execution of video filters
+ *****************************************************************************
+ * Copyright (C) 2018 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include <vlc_common.h>
+#include <vlc_threads.h>
+#include <vlc_filter.h>
+
+/* The workers are shared by all the filters, and run as long as at least one
+ * filter holds a filter_slices_t. The filter thread also runs slices of its
+ * own jobs, so the pool has one thread less than the largest thread count
+ * requested by a filter. */
+
+struct slice_job
+{
+    struct slice_job *next;
+    filter_slice_cb   cb;
+    void             *opaque;
+    unsigned          slices;  /**< number of slices */
+    unsigned          started; /**< slices handed to a thread */
+    unsigned          pending; /**< slices not completed yet */
+    unsigned          helpers; /**< workers running a slice */
+    unsigned          max_helpers;
+};
+
+struct filter_slices_t
+{
+    unsigned threads;
+};
+
+static struct
+{
+    vlc_mutex_t        lock;
+    vlc_cond_t         wait; /**< wait for queued jobs */
+    vlc_cond_t         done; /**< wait for completed slices */
+    struct slice_job  *jobs; /**< jobs with slices left to start */
+    bool               quit;
+
+    unsigned           users;
+    unsigned           count;
+    vlc_thread_t      *threads;
+} pool = {
+    VLC_STATIC_MUTEX, VLC_STATIC_COND, VLC_STATIC_COND, NULL, false,
+    0, 0, NULL,
+};
+
+/* Serializes the creation and destruction of the workers */
+static vlc_mutex_t pool_users_lock = VLC_STATIC_MUTEX;
+
+/* Runs the next slice of a job, with the pool lock held */
+static void RunSlice( struct slice_job *job, bool helper )
+{
+    unsigned slice = job->started++;
+
+    if( job->started == job->slices )
+    {   /* last slice: nothing left for the other threads */
+        struct slice_job **pp = &pool.jobs;
+        while( *pp != job )
+            pp = &(*pp)->next;
+        *pp = job->next;
+    }
+    if( helper )
+        job->helpers++;
+
+    vlc_mutex_unlock( &pool.lock );
+    job->cb( job->opaque, slice, job->slices );
+    vlc_mutex_lock( &pool.lock );
+
+    if( helper )
+        job->helpers--;
+    if( --job->pending == 0 )
+        vlc_cond_broadcast( &pool.done );
+}
+
+static struct slice_job *NextJob( void )
+{
+    for( struct slice_job *job = pool.jobs; job != NULL; job = job->next )
+        if( job->helpers < job->max_helpers )
+            return job;
+    return NULL;
+}
+
+static void *Worker( void *data )
+{
+    struct slice_job *job;
+
+    VLC_UNUSED(data);
+    vlc_mutex_lock( &pool.lock );
+    for( ;; )
+    {
+        while( !pool.quit && (job = NextJob()) == NULL )
+            vlc_cond_wait( &pool.wait, &pool.lock );
+        if( pool.quit )
+            break;
+
+        RunSlice( job, true );
+    }
+    vlc_mutex_unlock( &pool.lock );
+    return NULL;
+}
+
+static void PoolHold( unsigned threads )
+{
+    vlc_mutex_lock( &pool_users_lock );
+    pool.users++;
+    if( threads - 1 > pool.count )
+    {
+        vlc_thread_t *tab = realloc( pool.threads,
+                                     (threads - 1) * sizeof (*tab) );
+        if( likely(tab != NULL) )
+        {
+            pool.threads = tab;
+            while( pool.count < threads - 1
+                && !vlc_clone( &pool.threads[pool.count], Worker, NULL,
+                               VLC_THREAD_PRIORITY_VIDEO ) )
+                pool.count++;
+        }
+    }
+    vlc_mutex_unlock( &pool_users_lock );
+}
+
+static void PoolRelease( void )
+{
+    vlc_mutex_lock( &pool_users_lock );
+    assert( pool.users > 0 );
+    if( --pool.users == 0 )
+    {
+        vlc_mutex_lock( &pool.lock );
+        assert( pool.jobs == NULL );
+        pool.quit = true;
+        vlc_cond_broadcast( &pool.wait );
+        vlc_mutex_unlock( &pool.lock );
+
+        for( unsigned i = 0; i < pool.count; i++ )
+            vlc_join( pool.threads[i], NULL );
+        free( pool.threads );
+        pool.threads = NULL;
+        pool.count = 0;
+        pool.quit = false;
+    }
+    vlc_mutex_unlock( &pool_users_lock );
+}
+
+filter_slices_t *filter_NewSlices( unsigned threads )
+{
+    filter_slices_t *slices = malloc( sizeof (*slices) );
+    if( unlikely(slices == NULL) )
+        return NULL;
+
+    if( threads == 0 )
+        threads = vlc_GetCPUCount();
+    slices->threads = threads;
+    if( threads > 1 )
+        PoolHold( threads );
+    return slices;
+}
+
+void filter_DeleteSlices( filter_slices_t *slices )
+{
+    if( slices == NULL )
+        return;
+    if( slices->threads > 1 )
+        PoolRelease();
+    free( slices );
+}
+
+unsigned filter_GetSliceThreads( const filter_slices_t *slices )
+{
+    return slices != NULL ? slices->threads : 1;
+}
+
+void filter_RunSlices( filter_slices_t *slices, unsigned count,
+                       filter_slice_cb cb, void *opaque )
+{
+    if( count == 0 )
+        return;
+
+    if( count == 1 || slices == NULL || slices->threads <= 1 )
+    {
+        for( unsigned i = 0; i < count; i++ )
+            cb( opaque, i, count );
+        return;
+    }
+
+    struct slice_job job = {
+        .next = NULL,
+        .cb = cb,
+        .opaque = opaque,
+        .slices = count,
+        .started = 0,
+        .pending = count,
+        .helpers = 0,
+        .max_helpers = slices->threads - 1,
+    };
+
+    vlc_mutex_lock( &pool.lock );
+    struct slice_job **pp = &pool.jobs;
+    while( *pp != NULL )
+        pp = &(*pp)->next;
+    *pp = &job;
+    vlc_cond_broadcast( &pool.wait );
+
+    while( job.started < job.slices )
+        RunSlice( &job, false );
+    while( job.pending > 0 )
+        vlc_cond_wait( &pool.done, &pool.lock );
+    vlc_mutex_unlock( &pool.lock );
+}
@@ -203,7 +203,7 @@ void subpicture_region_private_Delete( subpicture_region_private_t *p_private )
     free( p_private );
 }
 
-subpicture_region_t *subpicture_region_New( const video_format_t *p_fmt )
+static subpicture_region_t *RegionNew( const video_format_t *p_fmt )
 {
     subpicture_region_t *p_region = calloc( 1, sizeof(*p_region ) );
     if( !p_region )
@@ -231,6 +231,14 @@ subpicture_region_t *subpicture_region_New( const video_format_t *p_fmt )
 
     p_region->i_alpha = 0xff;
     p_region->b_balanced_text = true;
+    return p_region;
+}
+
+subpicture_region_t *subpicture_region_New( const video_format_t *p_fmt )
+{
+    subpicture_region_t *p_region = RegionNew( p_fmt );
+    if( !p_region )
+        return NULL;
 
     if( p_fmt->i_chroma == VLC_CODEC_TEXT )
         return p_region;
@@ -246,6 +254,15 @@ subpicture_region_t *subpicture_region_New( const video_format_t *p_fmt )
     return p_region;
 }
 
+subpicture_region_t *subpicture_region_NewFromPicture( const video_format_t *p_fmt,
+                                                       picture_t *p_picture )
+{
+    subpicture_region_t *p_region = RegionNew( p_fmt );
+    if( p_region )
+        p_region->p_picture = picture_Hold( p_picture );
+    return p_region;
+}
+
 void subpicture_region_Delete( subpicture_region_t *p_region )
 {
     if( !p_region )
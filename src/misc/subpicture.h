@@ -29,3 +29,9 @@ struct subpicture_region_private_t {
 subpicture_region_private_t *subpicture_region_private_New(video_format_t *);
 void subpicture_region_private_Delete(subpicture_region_private_t *);
 
+/**
+ * Creates a region showing an existing picture, which is held and not copied.
+ */
+subpicture_region_t *subpicture_region_NewFromPicture(const video_format_t *,
+                                                      picture_t *);
+
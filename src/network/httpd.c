@@ -40,6 +40,9 @@
 #include <vlc_url.h>
 #include <vlc_mime.h>
 #include <vlc_block.h>
+#include <vlc_atomic.h>
+#include <vlc_cpu.h>
+#include <vlc_fs.h>
 #include "../libvlc.h"
 
 #include <string.h>
@@ -53,6 +56,10 @@
 # include <poll.h>
 #endif
 
+#ifdef HAVE_SYS_EPOLL_H
+# include <sys/epoll.h>
+#endif
+
 #if defined(_WIN32)
 #   include <winsock2.h>
 #else
@@ -66,10 +73,37 @@
 #define HTTPD_CL_BUFSIZE 10000
 #endif
 
+/* stream data queued to a client at once */
+#define HTTPD_CL_QUEUE (1 << 20)
+/* buffers written to a client in a single call */
+#define HTTPD_CL_IOV 64
+
 static void httpd_ClientDestroy(httpd_client_t *cl);
-static void httpd_AppendData(httpd_stream_t *stream, uint8_t *p_data, int i_data);
+static void httpd_HostWake(httpd_host_t *host);
+
+/* each worker thread polls its own share of the clients of a host */
+typedef struct httpd_worker_t
+{
+    httpd_host_t    *host;
+    vlc_thread_t    thread;
+#ifdef HAVE_SYS_EPOLL_H
+    int             epfd;
+#endif
+#ifndef _WIN32
+    /* pipe waking the thread up when there is new data to send */
+    int             wake[2];
+    atomic_bool     b_woken;
+#endif
+
+    /* written with the host lock, also by the accepting worker */
+    int             i_client;
+    httpd_client_t  **client;
+
+    uint64_t        i_sent;     /* bytes sent */
+} httpd_worker_t;
+
+static void httpd_WorkerWake(httpd_worker_t *w);
 
-/* each host run in his own thread */
 struct httpd_host_t
 {
     VLC_COMMON_MEMBERS
@@ -82,7 +116,8 @@ struct httpd_host_t
     unsigned     nfd;
     unsigned     port;
 
-    vlc_thread_t thread;
+    /* the lock protects the urls and the client tables, and serializes the
+     * callbacks; the client sockets are read and written without it */
     vlc_mutex_t lock;
     vlc_cond_t  wait;
 
@@ -93,8 +128,16 @@ struct httpd_host_t
     int         i_url;
     httpd_url_t **url;
 
-    int            i_client;
-    httpd_client_t **client;
+    /* the first worker also accepts the new connections */
+    unsigned        i_worker;
+    httpd_worker_t  *worker;
+
+    /* statistics */
+    uint64_t    i_clients;      /* connections accepted */
+    unsigned    i_clients_cur;
+    unsigned    i_clients_max;
+    uint64_t    i_drops;        /* stream clients skipping to the live data */
+    uint64_t    i_dropped;      /* bytes they skipped */
 
     /* TLS data */
     vlc_tls_creds_t *p_tls;
@@ -144,6 +187,7 @@ enum
 
 struct httpd_client_t
 {
+    httpd_worker_t *worker;
     httpd_url_t *url;
     vlc_tls_t   *sock;
 
@@ -155,11 +199,19 @@ struct httpd_client_t
     mtime_t i_activity_date;
     mtime_t i_activity_timeout;
 
+    /* polled events, and if the socket is registered with epoll */
+    short   i_events;
+    bool    b_watched;
+
     /* buffer for reading header */
     int     i_buffer_size;
     int     i_buffer;
     uint8_t *p_buffer;
 
+    /* shared data sent after the answer body */
+    block_t *p_send;
+    block_t **pp_send_last;
+
     /*
      * If waiting for a keyframe, this is the position (in bytes) of the
      * last keyframe the stream saw before this client connected.
@@ -589,6 +641,145 @@ void httpd_RedirectDelete(httpd_redirect_t *rdir)
     free(rdir);
 }
 
+/*****************************************************************************
+ * Shared buffers
+ *****************************************************************************/
+/* Data sent to many clients is copied once in shared blocks, each client
+ * queues views of them and writes them directly to its socket. */
+typedef struct
+{
+    struct httpd_buffer
+    {
+        block_t *block;
+        int64_t i_pos;      /* absolute position of the block data */
+    } *p_entries;           /* circular, oldest first */
+    unsigned    i_size;
+    unsigned    i_first;
+    unsigned    i_count;
+    int64_t     i_start;    /* position of the oldest data kept */
+    int64_t     i_end;      /* position after the newest data */
+} httpd_buffers_t;
+
+static void httpd_BuffersInit(httpd_buffers_t *b, int64_t i_pos)
+{
+    b->p_entries = NULL;
+    b->i_size = 0;
+    b->i_first = 0;
+    b->i_count = 0;
+    b->i_start = i_pos;
+    b->i_end = i_pos;
+}
+
+static void httpd_BuffersClean(httpd_buffers_t *b)
+{
+    for (unsigned i = 0; i < b->i_count; i++)
+        block_Release(b->p_entries[(b->i_first + i) % b->i_size].block);
+    free(b->p_entries);
+}
+
+static int httpd_BuffersAppend(httpd_buffers_t *b, const block_t *p_block)
+{
+    if (p_block->i_buffer == 0)
+        return VLC_SUCCESS;
+
+    if (b->i_count == b->i_size) {
+        unsigned i_size = b->i_size ? 2 * b->i_size : 64;
+        struct httpd_buffer *p_entries = malloc(i_size * sizeof (*p_entries));
+        if (unlikely(p_entries == NULL))
+            return VLC_ENOMEM;
+
+        for (unsigned i = 0; i < b->i_count; i++)
+            p_entries[i] = b->p_entries[(b->i_first + i) % b->i_size];
+        free(b->p_entries);
+        b->p_entries = p_entries;
+        b->i_size = i_size;
+        b->i_first = 0;
+    }
+
+    block_t *block = block_Alloc(p_block->i_buffer);
+    if (unlikely(block == NULL))
+        return VLC_ENOMEM;
+    memcpy(block->p_buffer, p_block->p_buffer, p_block->i_buffer);
+
+    block = block_Shared(block);
+    if (unlikely(block == NULL))
+        return VLC_ENOMEM;
+
+    struct httpd_buffer *e =
+        &b->p_entries[(b->i_first + b->i_count++) % b->i_size];
+    e->block = block;
+    e->i_pos = b->i_end;
+    b->i_end += block->i_buffer;
+    return VLC_SUCCESS;
+}
+
+/* Drops the oldest data beyond i_max bytes, but always keeps the newest */
+static void httpd_BuffersTrim(httpd_buffers_t *b, size_t i_max)
+{
+    while (b->i_count > 1 && b->i_end - b->i_start > (int64_t)i_max) {
+        struct httpd_buffer *e = &b->p_entries[b->i_first];
+
+        b->i_start = e->i_pos + e->block->i_buffer;
+        block_Release(e->block);
+        b->i_first = (b->i_first + 1) % b->i_size;
+        b->i_count--;
+    }
+}
+
+static void httpd_ClientQueue(httpd_client_t *cl, block_t *block)
+{
+    block_ChainLastAppend(&cl->pp_send_last, block);
+}
+
+/* Queues the data from i_pos to the client, up to about i_max bytes */
+static size_t httpd_BuffersQueue(const httpd_buffers_t *b, httpd_client_t *cl,
+                                 int64_t i_pos, size_t i_max)
+{
+    assert(i_pos >= b->i_start && i_pos <= b->i_end);
+
+    /* look for the last block starting at or before i_pos */
+    unsigned lo = 0, hi = b->i_count;
+    while (hi - lo > 1) {
+        unsigned mid = (lo + hi) / 2;
+
+        if (b->p_entries[(b->i_first + mid) % b->i_size].i_pos <= i_pos)
+            lo = mid;
+        else
+            hi = mid;
+    }
+
+    size_t i_queued = 0;
+    for (unsigned i = lo; i < b->i_count && i_queued < i_max; i++) {
+        const struct httpd_buffer *e =
+            &b->p_entries[(b->i_first + i) % b->i_size];
+        size_t i_skip = i_pos > e->i_pos ? i_pos - e->i_pos : 0;
+
+        if (i_skip >= e->block->i_buffer)
+            continue;
+
+        block_t *block = block_Share(e->block);
+        if (unlikely(block == NULL))
+            break;
+        block->p_buffer += i_skip;
+        block->i_buffer -= i_skip;
+        httpd_ClientQueue(cl, block);
+        i_queued += block->i_buffer;
+    }
+    return i_queued;
+}
+
+/* Queues a small piece of data private to the client */
+static void httpd_ClientQueueData(httpd_client_t *cl, const void *p_data,
+                                  size_t i_data)
+{
+    block_t *block = block_Alloc(i_data);
+
+    if (likely(block != NULL)) {
+        memcpy(block->p_buffer, p_data, i_data);
+        httpd_ClientQueue(cl, block);
+    }
+}
+
 /*****************************************************************************
  * High Level Funtions: httpd_stream_t
  *****************************************************************************/
@@ -611,10 +802,9 @@ struct httpd_stream_t
     bool        b_has_keyframes;
     int64_t     i_last_keyframe_seen_pos;
 
-    /* circular buffer */
-    int         i_buffer_size;      /* buffer size, can't be reallocated smaller */
-    uint8_t     *p_buffer;          /* buffer */
-    int64_t     i_buffer_pos;       /* absolute position from beginning */
+    /* the last data sent, kept up to the client backlog */
+    httpd_buffers_t buffers;
+    size_t      i_backlog;
     int64_t     i_buffer_last_pos;  /* a new connection will start with that */
 
     /* custom headers */
@@ -632,45 +822,47 @@ static int httpd_StreamCallBack(httpd_callback_sys_t *p_sys,
         return VLC_SUCCESS;
 
     if (answer->i_body_offset > 0) {
-        int     i_pos;
+        httpd_host_t *host = stream->url->host;
+        int64_t i_pos = answer->i_body_offset;
 
-        if (answer->i_body_offset >= stream->i_buffer_pos)
+        vlc_mutex_lock(&stream->lock);
+        if (i_pos >= stream->buffers.i_end) {
+            vlc_mutex_unlock(&stream->lock);
             return VLC_EGENERIC;    /* wait, no data available */
+        }
 
         if (cl->i_keyframe_wait_to_pass >= 0) {
-            if (stream->i_last_keyframe_seen_pos <= cl->i_keyframe_wait_to_pass)
+            if (stream->i_last_keyframe_seen_pos <= cl->i_keyframe_wait_to_pass) {
+                vlc_mutex_unlock(&stream->lock);
                 /* still waiting for the next keyframe */
                 return VLC_EGENERIC;
+            }
 
             /* seek to the new keyframe */
-            answer->i_body_offset = stream->i_last_keyframe_seen_pos;
+            i_pos = stream->i_last_keyframe_seen_pos;
             cl->i_keyframe_wait_to_pass = -1;
         }
 
-        if (answer->i_body_offset + stream->i_buffer_size < stream->i_buffer_pos)
-            answer->i_body_offset = stream->i_buffer_last_pos; /* this client isn't fast enough */
+        if (i_pos < stream->buffers.i_start) {
+            /* this client isn't fast enough */
+            host->i_drops++;
+            host->i_dropped += stream->i_buffer_last_pos - i_pos;
+            i_pos = stream->i_buffer_last_pos;
+        }
 
-        i_pos   = answer->i_body_offset % stream->i_buffer_size;
-        int64_t i_write = stream->i_buffer_pos - answer->i_body_offset;
+        size_t i_write = httpd_BuffersQueue(&stream->buffers, cl, i_pos,
+                                    __MIN(stream->i_backlog, HTTPD_CL_QUEUE));
+        vlc_mutex_unlock(&stream->lock);
 
-        if (i_write > HTTPD_CL_BUFSIZE)
-            i_write = HTTPD_CL_BUFSIZE;
-        else if (i_write <= 0)
+        if (i_write == 0)
             return VLC_EGENERIC;    /* wait, no data available */
 
-        /* Don't go past the end of the circular buffer */
-        i_write = __MIN(i_write, stream->i_buffer_size - i_pos);
-
         /* using HTTPD_MSG_ANSWER -> data available */
         answer->i_proto  = HTTPD_PROTO_HTTP;
         answer->i_version= 0;
         answer->i_type   = HTTPD_MSG_ANSWER;
 
-        answer->i_body = i_write;
-        answer->p_body = xmalloc(i_write);
-        memcpy(answer->p_body, &stream->p_buffer[i_pos], i_write);
-
-        answer->i_body_offset += i_write;
+        answer->i_body_offset = i_pos + i_write;
 
         return VLC_SUCCESS;
     } else {
@@ -765,11 +957,10 @@ httpd_stream_t *httpd_StreamNew(httpd_host_t *host,
 
     stream->i_header = 0;
     stream->p_header = NULL;
-    stream->i_buffer_size = 5000000;    /* 5 Mo per stream */
-    stream->p_buffer = xmalloc(stream->i_buffer_size);
-    /* We set to 1 to make life simpler
+    /* We start at 1 to make life simpler
      * (this way i_body_offset can never be 0) */
-    stream->i_buffer_pos = 1;
+    httpd_BuffersInit(&stream->buffers, 1);
+    stream->i_backlog = var_InheritInteger(host, "http-backlog") * 1000;
     stream->i_buffer_last_pos = 1;
     stream->b_has_keyframes = false;
     stream->i_last_keyframe_seen_pos = 0;
@@ -802,24 +993,6 @@ int httpd_StreamHeader(httpd_stream_t *stream, uint8_t *p_data, int i_data)
     return VLC_SUCCESS;
 }
 
-static void httpd_AppendData(httpd_stream_t *stream, uint8_t *p_data, int i_data)
-{
-    int i_pos = stream->i_buffer_pos % stream->i_buffer_size;
-    int i_count = i_data;
-    while (i_count > 0) {
-        int i_copy = __MIN(i_count, stream->i_buffer_size - i_pos);
-
-        /* Ok, we can't go past the end of our buffer */
-        memcpy(&stream->p_buffer[i_pos], p_data, i_copy);
-
-        i_pos = (i_pos + i_copy) % stream->i_buffer_size;
-        i_count -= i_copy;
-        p_data  += i_copy;
-    }
-
-    stream->i_buffer_pos += i_data;
-}
-
 int httpd_StreamSend(httpd_stream_t *stream, const block_t *p_block)
 {
     if (!p_block || !p_block->p_buffer)
@@ -828,17 +1001,20 @@ int httpd_StreamSend(httpd_stream_t *stream, const block_t *p_block)
     vlc_mutex_lock(&stream->lock);
 
     /* save this pointer (to be used by new connection) */
-    stream->i_buffer_last_pos = stream->i_buffer_pos;
+    stream->i_buffer_last_pos = stream->buffers.i_end;
 
     if (p_block->i_flags & BLOCK_FLAG_TYPE_I) {
         stream->b_has_keyframes = true;
-        stream->i_last_keyframe_seen_pos = stream->i_buffer_pos;
+        stream->i_last_keyframe_seen_pos = stream->buffers.i_end;
     }
 
-    httpd_AppendData(stream, p_block->p_buffer, p_block->i_buffer);
+    int ret = httpd_BuffersAppend(&stream->buffers, p_block);
+    httpd_BuffersTrim(&stream->buffers, stream->i_backlog);
 
     vlc_mutex_unlock(&stream->lock);
-    return VLC_SUCCESS;
+
+    httpd_HostWake(stream->url->host);
+    return ret;
 }
 
 void httpd_StreamDelete(httpd_stream_t *stream)
@@ -852,14 +1028,173 @@ void httpd_StreamDelete(httpd_stream_t *stream)
     vlc_mutex_destroy(&stream->lock);
     free(stream->psz_mime);
     free(stream->p_header);
-    free(stream->p_buffer);
+    httpd_BuffersClean(&stream->buffers);
     free(stream);
 }
 
+/*****************************************************************************
+ * High Level Functions: httpd_segment_t
+ *****************************************************************************/
+struct httpd_segment_t
+{
+    vlc_mutex_t lock;
+    httpd_url_t *url;
+
+    char    *psz_mime;
+
+    /* data received so far, served while the segment is still growing */
+    httpd_buffers_t buffers;
+    bool    b_complete;
+};
+
+static int httpd_SegmentCallBack(httpd_callback_sys_t *p_sys,
+                                  httpd_client_t *cl, httpd_message_t *answer,
+                                  const httpd_message_t *query)
+{
+    httpd_segment_t *seg = (httpd_segment_t*)p_sys;
+
+    if (!answer || !query || !cl)
+        return VLC_SUCCESS;
+
+    /* HTTP/1.0 clients get a growing segment until the connection closes */
+    bool b_chunked = query->i_version > 0;
+    int64_t i_pos = 0;
+
+    vlc_mutex_lock(&seg->lock);
+    /* i_body_offset is the position plus one while the segment is streamed,
+     * so that it is never 0 before the end */
+    bool b_stream = answer->i_body_offset > 0 || !seg->b_complete;
+
+    if (answer->i_body_offset > 0) {
+        i_pos = answer->i_body_offset - 1;
+        if (i_pos >= seg->buffers.i_end && !seg->b_complete) {
+            vlc_mutex_unlock(&seg->lock);
+            return VLC_EGENERIC;    /* wait, no data available */
+        }
+    } else {
+        answer->i_status = 200;
+
+        httpd_MsgAdd(answer, "Content-type", "%s", seg->psz_mime);
+        if (b_stream) {
+            if (b_chunked)
+                httpd_MsgAdd(answer, "Transfer-Encoding", "chunked");
+            httpd_MsgAdd(answer, "Cache-Control", "no-cache");
+            if (query->i_type != HTTPD_MSG_HEAD)
+                cl->b_stream_mode = true;
+        } else
+            httpd_MsgAdd(answer, "Content-Length", "%"PRId64,
+                         seg->buffers.i_end);
+    }
+
+    answer->i_proto  = HTTPD_PROTO_HTTP;
+    answer->i_version= 1;
+    answer->i_type   = HTTPD_MSG_ANSWER;
+
+    if (query->i_type == HTTPD_MSG_HEAD) {
+        vlc_mutex_unlock(&seg->lock);
+        return VLC_SUCCESS;
+    }
+
+    /* Send everything available, in a single chunk: the chunk size goes in
+     * the body, sent before the queued data */
+    bool b_framed = b_stream && b_chunked;
+    size_t i_write = httpd_BuffersQueue(&seg->buffers, cl, i_pos, SIZE_MAX);
+
+    i_pos += i_write;
+    if (b_framed && i_write > 0) {
+        char *psz;
+
+        answer->i_body = asprintf(&psz, "%zx\r\n", i_write);
+        if (answer->i_body < 0)
+            answer->i_body = 0;
+        else
+            answer->p_body = (uint8_t *)psz;
+        httpd_ClientQueueData(cl, "\r\n", 2);
+    }
+
+    if (b_stream) {
+        if (seg->b_complete && i_pos >= seg->buffers.i_end) {
+            if (b_framed)
+                httpd_ClientQueueData(cl, "0\r\n\r\n", 5);
+            answer->i_body_offset = 0; /* done */
+        } else
+            answer->i_body_offset = 1 + i_pos;
+    }
+    vlc_mutex_unlock(&seg->lock);
+
+    return VLC_SUCCESS;
+}
+
+httpd_segment_t *httpd_SegmentNew(httpd_host_t *host,
+                                   const char *psz_url, const char *psz_mime,
+                                   const char *psz_user,
+                                   const char *psz_password)
+{
+    httpd_segment_t *seg = malloc(sizeof(*seg));
+    if (!seg)
+        return NULL;
+
+    seg->url = httpd_UrlNew(host, psz_url, psz_user, psz_password);
+    if (!seg->url) {
+        free(seg);
+        return NULL;
+    }
+
+    vlc_mutex_init(&seg->lock);
+    if (psz_mime == NULL || psz_mime[0] == '\0')
+        psz_mime = vlc_mime_Ext2Mime(psz_url);
+    seg->psz_mime = xstrdup(psz_mime);
+
+    httpd_BuffersInit(&seg->buffers, 0);
+    seg->b_complete = false;
+
+    httpd_UrlCatch(seg->url, HTTPD_MSG_HEAD, httpd_SegmentCallBack,
+                    (httpd_callback_sys_t*)seg);
+    httpd_UrlCatch(seg->url, HTTPD_MSG_GET, httpd_SegmentCallBack,
+                    (httpd_callback_sys_t*)seg);
+
+    return seg;
+}
+
+int httpd_SegmentSend(httpd_segment_t *seg, const block_t *p_block)
+{
+    if (!p_block || !p_block->p_buffer)
+        return VLC_SUCCESS;
+
+    vlc_mutex_lock(&seg->lock);
+    assert(!seg->b_complete);
+    int ret = httpd_BuffersAppend(&seg->buffers, p_block);
+    vlc_mutex_unlock(&seg->lock);
+
+    httpd_HostWake(seg->url->host);
+    return ret;
+}
+
+void httpd_SegmentEnd(httpd_segment_t *seg)
+{
+    vlc_mutex_lock(&seg->lock);
+    seg->b_complete = true;
+    vlc_mutex_unlock(&seg->lock);
+
+    httpd_HostWake(seg->url->host);
+}
+
+void httpd_SegmentDelete(httpd_segment_t *seg)
+{
+    /* This closes the connections still reading the segment */
+    httpd_UrlDelete(seg->url);
+    vlc_mutex_destroy(&seg->lock);
+    free(seg->psz_mime);
+    httpd_BuffersClean(&seg->buffers);
+    free(seg);
+}
+
 /*****************************************************************************
  * Low level
  *****************************************************************************/
-static void* httpd_HostThread(void *);
+static void* httpd_WorkerThread(void *);
+static int httpd_WorkerInit(httpd_host_t *, httpd_worker_t *, bool);
+static void httpd_WorkerClean(httpd_worker_t *);
 static httpd_host_t *httpd_HostCreate(vlc_object_t *, const char *,
                                        const char *, vlc_tls_creds_t *);
 
@@ -912,6 +1247,7 @@ static httpd_host_t *httpd_HostCreate(vlc_object_t *p_this,
                                        vlc_tls_creds_t *p_tls)
 {
     httpd_host_t *host;
+    unsigned i_init = 0, i_started = 0;
     char *hostname = var_InheritString(p_this, hostvar);
     unsigned port = var_InheritInteger(p_this, portvar);
 
@@ -959,6 +1295,7 @@ static httpd_host_t *httpd_HostCreate(vlc_object_t *p_this,
     vlc_mutex_init(&host->lock);
     vlc_cond_init(&host->wait);
     host->i_ref = 1;
+    host->worker = NULL;
 
     host->fds = net_ListenTCP(p_this, url.psz_host, port);
     if (!host->fds) {
@@ -970,16 +1307,31 @@ static httpd_host_t *httpd_HostCreate(vlc_object_t *p_this,
     host->port     = port;
     host->i_url    = 0;
     host->url      = NULL;
-    host->i_client = 0;
-    host->client   = NULL;
+    host->i_clients = 0;
+    host->i_clients_cur = 0;
+    host->i_clients_max = 0;
+    host->i_drops  = 0;
+    host->i_dropped = 0;
     host->p_tls    = p_tls;
 
-    /* create the thread */
-    if (vlc_clone(&host->thread, httpd_HostThread, host,
-                   VLC_THREAD_PRIORITY_LOW)) {
-        msg_Err(p_this, "cannot spawn http host thread");
+    /* create the worker threads */
+    host->i_worker = var_InheritInteger(p_this, "http-threads");
+    if (host->i_worker == 0)
+        host->i_worker = __MIN(vlc_GetCPUCount(), 4);
+    host->worker = malloc(host->i_worker * sizeof (*host->worker));
+    if (unlikely(host->worker == NULL))
         goto error;
-    }
+
+    for (; i_init < host->i_worker; i_init++)
+        if (httpd_WorkerInit(host, &host->worker[i_init], i_init == 0))
+            goto error;
+
+    for (; i_started < host->i_worker; i_started++)
+        if (vlc_clone(&host->worker[i_started].thread, httpd_WorkerThread,
+                      &host->worker[i_started], VLC_THREAD_PRIORITY_LOW)) {
+            msg_Err(p_this, "cannot spawn http host thread");
+            goto error;
+        }
 
     /* now add it to httpd */
     TAB_APPEND(httpd.i_host, httpd.host, host);
@@ -993,6 +1345,14 @@ error:
     vlc_mutex_unlock(&httpd.mutex);
 
     if (host) {
+        /* the started threads wait for an url */
+        for (unsigned i = 0; i < i_started; i++)
+            vlc_cancel(host->worker[i].thread);
+        for (unsigned i = 0; i < i_started; i++)
+            vlc_join(host->worker[i].thread, NULL);
+        for (unsigned i = 0; i < i_init; i++)
+            httpd_WorkerClean(&host->worker[i]);
+        free(host->worker);
         net_ListenClose(host->fds);
         vlc_cond_destroy(&host->wait);
         vlc_mutex_destroy(&host->lock);
@@ -1024,19 +1384,34 @@ void httpd_HostDelete(httpd_host_t *host)
     }
     TAB_REMOVE(httpd.i_host, httpd.host, host);
 
-    vlc_cancel(host->thread);
-    vlc_join(host->thread, NULL);
+    for (unsigned i = 0; i < host->i_worker; i++)
+        vlc_cancel(host->worker[i].thread);
+    for (unsigned i = 0; i < host->i_worker; i++)
+        vlc_join(host->worker[i].thread, NULL);
 
     msg_Dbg(host, "HTTP host removed");
 
     for (int i = 0; i < host->i_url; i++)
         msg_Err(host, "url still registered: %s", host->url[i]->psz_url);
 
-    for (int i = 0; i < host->i_client; i++) {
-        msg_Warn(host, "client still connected");
-        httpd_ClientDestroy(host->client[i]);
+    uint64_t i_sent = 0;
+    for (unsigned i = 0; i < host->i_worker; i++) {
+        httpd_worker_t *w = &host->worker[i];
+
+        for (int j = 0; j < w->i_client; j++) {
+            msg_Warn(host, "client still connected");
+            httpd_ClientDestroy(w->client[j]);
+        }
+        TAB_CLEAN(w->i_client, w->client);
+        i_sent += w->i_sent;
+        httpd_WorkerClean(w);
     }
-    TAB_CLEAN(host->i_client, host->client);
+    free(host->worker);
+
+    msg_Dbg(host, "%u threads served %"PRIu64" clients (up to %u at once), "
+            "%"PRIu64" bytes sent, %"PRIu64" lagging clients skipped "
+            "%"PRIu64" bytes", host->i_worker, host->i_clients,
+            host->i_clients_max, i_sent, host->i_drops, host->i_dropped);
 
     vlc_tls_Delete(host->p_tls);
     net_ListenClose(host->fds);
@@ -1075,7 +1450,7 @@ httpd_url_t *httpd_UrlNew(httpd_host_t *host, const char *psz_url,
     }
 
     TAB_APPEND(host->i_url, host->url, url);
-    vlc_cond_signal(&host->wait);
+    vlc_cond_broadcast(&host->wait);
     vlc_mutex_unlock(&host->lock);
 
     return url;
@@ -1106,17 +1481,26 @@ void httpd_UrlDelete(httpd_url_t *url)
     free(url->psz_user);
     free(url->psz_password);
 
-    for (int i = 0; i < host->i_client; i++) {
-        httpd_client_t *client = host->client[i];
+    /* The connections are closed by their worker, as they may be sending
+     * without the lock */
+    for (unsigned i = 0; i < host->i_worker; i++) {
+        httpd_worker_t *w = &host->worker[i];
+        bool b_wake = false;
 
-        if (client->url != url)
-            continue;
+        for (int j = 0; j < w->i_client; j++) {
+            httpd_client_t *client = w->client[j];
 
-        /* TODO complete it */
-        msg_Warn(host, "force closing connections");
-        TAB_REMOVE(host->i_client, host->client, client);
-        httpd_ClientDestroy(client);
-        i--;
+            if (client->url != url)
+                continue;
+
+            /* TODO complete it */
+            msg_Warn(host, "force closing connections");
+            client->url = NULL;
+            client->i_ref = -1;
+            b_wake = true;
+        }
+        if (b_wake)
+            httpd_WorkerWake(w);
     }
     free(url);
     vlc_mutex_unlock(&host->lock);
@@ -1201,6 +1585,8 @@ static void httpd_ClientInit(httpd_client_t *cl, mtime_t now)
     cl->p_buffer = xmalloc(cl->i_buffer_size);
     cl->i_keyframe_wait_to_pass = -1;
     cl->b_stream_mode = false;
+    cl->p_send = NULL;
+    cl->pp_send_last = &cl->p_send;
 
     httpd_MsgInit(&cl->query);
     httpd_MsgInit(&cl->answer);
@@ -1222,6 +1608,7 @@ static void httpd_ClientDestroy(httpd_client_t *cl)
     httpd_MsgClean(&cl->answer);
     httpd_MsgClean(&cl->query);
 
+    block_ChainRelease(cl->p_send);
     free(cl->p_buffer);
     free(cl);
 }
@@ -1232,9 +1619,12 @@ static httpd_client_t *httpd_ClientNew(vlc_tls_t *sock, mtime_t now)
 
     if (!cl) return NULL;
 
+    cl->worker  = NULL;
     cl->i_ref   = 0;
     cl->sock    = sock;
     cl->url     = NULL;
+    cl->i_events = 0;
+    cl->b_watched = false;
 
     httpd_ClientInit(cl, now);
     return cl;
@@ -1256,6 +1646,14 @@ ssize_t httpd_NetSend (httpd_client_t *cl, const uint8_t *p, size_t i_len)
     return sock->writev(sock, &iov, 1);
 }
 
+static
+ssize_t httpd_NetSendv(httpd_client_t *cl, const struct iovec *iov,
+                       unsigned count)
+{
+    vlc_tls_t *sock = cl->sock;
+    return sock->writev(sock, iov, count);
+}
+
 
 static const struct
 {
@@ -1562,7 +1960,7 @@ static void httpd_ClientRecv(httpd_client_t *cl)
 
 static void httpd_ClientSend(httpd_client_t *cl)
 {
-    int i_len;
+    ssize_t i_len;
 
     if (cl->i_buffer < 0) {
         /* We need to create the header */
@@ -1595,24 +1993,45 @@ static void httpd_ClientSend(httpd_client_t *cl)
         cl->i_buffer_size = (uint8_t*)p - cl->p_buffer;
     }
 
-    i_len = httpd_NetSend(cl, &cl->p_buffer[cl->i_buffer],
-                           cl->i_buffer_size - cl->i_buffer);
-    if (i_len >= 0) {
-        cl->i_buffer += i_len;
+    /* The shared data follows the body, write as much as possible at once */
+    struct iovec iov[HTTPD_CL_IOV];
+    unsigned i_iov = 0;
 
-        if (cl->i_buffer >= cl->i_buffer_size) {
-            if (cl->answer.i_body == 0  && cl->answer.i_body_offset > 0) {
-                /* catch more body data */
-                int     i_msg = cl->query.i_type;
-                int64_t i_offset = cl->answer.i_body_offset;
+    if (cl->i_buffer < cl->i_buffer_size) {
+        iov[0].iov_base = &cl->p_buffer[cl->i_buffer];
+        iov[0].iov_len = cl->i_buffer_size - cl->i_buffer;
+        i_iov++;
+    }
+    if (cl->answer.i_body == 0)
+        for (block_t *b = cl->p_send; b != NULL && i_iov < HTTPD_CL_IOV;
+             b = b->p_next) {
+            iov[i_iov].iov_base = b->p_buffer;
+            iov[i_iov].iov_len = b->i_buffer;
+            i_iov++;
+        }
 
-                httpd_MsgClean(&cl->answer);
-                cl->answer.i_body_offset = i_offset;
+    i_len = i_iov > 0 ? httpd_NetSendv(cl, iov, i_iov) : 0;
+    if (i_len >= 0) {
+        cl->worker->i_sent += i_len;
 
-                cl->url->catch[i_msg].cb(cl->url->catch[i_msg].p_sys, cl,
-                                          &cl->answer, &cl->query);
+        int i_done = __MIN(i_len, (ssize_t)(cl->i_buffer_size - cl->i_buffer));
+        cl->i_buffer += i_done;
+        i_len -= i_done;
+
+        for (block_t *b; (b = cl->p_send) != NULL;) {
+            if ((size_t)i_len < b->i_buffer) {
+                b->p_buffer += i_len;
+                b->i_buffer -= i_len;
+                break;
             }
+            i_len -= b->i_buffer;
+            cl->p_send = b->p_next;
+            block_Release(b);
+        }
+        if (cl->p_send == NULL)
+            cl->pp_send_last = &cl->p_send;
 
+        if (cl->i_buffer >= cl->i_buffer_size) {
             if (cl->answer.i_body > 0) {
                 /* send the body data */
                 free(cl->p_buffer);
@@ -1622,7 +2041,7 @@ static void httpd_ClientSend(httpd_client_t *cl)
 
                 cl->answer.i_body = 0;
                 cl->answer.p_body = NULL;
-            } else /* send finished */
+            } else if (cl->p_send == NULL) /* send finished */
                 cl->i_state = HTTPD_CLIENT_SEND_DONE;
         }
     } else {
@@ -1689,57 +2108,158 @@ auth_failed:
     return false;
 }
 
-static void httpdLoop(httpd_host_t *host)
+/*****************************************************************************
+ * Worker threads
+ *****************************************************************************/
+static void httpd_WorkerWake(httpd_worker_t *w)
+{
+#ifndef _WIN32
+    if (!atomic_exchange(&w->b_woken, true))
+        vlc_write(w->wake[1], "", 1);
+#else
+    VLC_UNUSED(w);
+#endif
+}
+
+static void httpd_HostWake(httpd_host_t *host)
+{
+    for (unsigned i = 0; i < host->i_worker; i++)
+        httpd_WorkerWake(&host->worker[i]);
+}
+
+static void httpd_WorkerDrain(httpd_worker_t *w)
 {
-    struct pollfd ufd[host->nfd + host->i_client];
-    unsigned nfd;
-    for (nfd = 0; nfd < host->nfd; nfd++) {
-        ufd[nfd].fd = host->fds[nfd];
-        ufd[nfd].events = POLLIN;
-        ufd[nfd].revents = 0;
+#ifndef _WIN32
+    /* at most one byte is pending */
+    char buf[16];
+    ssize_t len = read(w->wake[0], buf, sizeof (buf));
+
+    VLC_UNUSED(len);
+    atomic_store(&w->b_woken, false);
+#else
+    VLC_UNUSED(w);
+#endif
+}
+
+static int httpd_WorkerInit(httpd_host_t *host, httpd_worker_t *w,
+                            bool b_listen)
+{
+    w->host = host;
+    w->i_client = 0;
+    w->client = NULL;
+    w->i_sent = 0;
+#ifndef _WIN32
+    if (vlc_pipe(w->wake)) {
+        msg_Err(host, "cannot create pipe: %s", vlc_strerror_c(errno));
+        return VLC_EGENERIC;
     }
+    atomic_init(&w->b_woken, false);
+#endif
+#ifdef HAVE_SYS_EPOLL_H
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = w };
 
-    /* add all socket that should be read/write and close dead connection */
-    while (host->i_url <= 0) {
-        mutex_cleanup_push(&host->lock);
-        vlc_cond_wait(&host->wait, &host->lock);
-        vlc_cleanup_pop();
+    w->epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (w->epfd == -1)
+        goto error;
+    if (epoll_ctl(w->epfd, EPOLL_CTL_ADD, w->wake[0], &ev))
+        goto error;
+    for (unsigned i = 0; b_listen && i < host->nfd; i++) {
+        ev.data.ptr = &host->fds[i];
+        if (epoll_ctl(w->epfd, EPOLL_CTL_ADD, host->fds[i], &ev))
+            goto error;
     }
+#else
+    VLC_UNUSED(b_listen);
+#endif
+    return VLC_SUCCESS;
 
-    mtime_t now = mdate();
+#ifdef HAVE_SYS_EPOLL_H
+error:
+    msg_Err(host, "cannot poll HTTP connections: %s", vlc_strerror_c(errno));
+    if (w->epfd != -1)
+        vlc_close(w->epfd);
+    vlc_close(w->wake[1]);
+    vlc_close(w->wake[0]);
+    return VLC_EGENERIC;
+#endif
+}
+
+static void httpd_WorkerClean(httpd_worker_t *w)
+{
+#ifdef HAVE_SYS_EPOLL_H
+    vlc_close(w->epfd);
+#endif
+#ifndef _WIN32
+    vlc_close(w->wake[1]);
+    vlc_close(w->wake[0]);
+#else
+    VLC_UNUSED(w);
+#endif
+}
+
+/* Updates the events a client is polled for */
+static void httpd_WorkerWatch(httpd_worker_t *w, httpd_client_t *cl,
+                              short events)
+{
+#ifdef HAVE_SYS_EPOLL_H
+    if (cl->b_watched && cl->i_events == events)
+        return;
+
+    struct epoll_event ev = {
+        .events = ((events & POLLIN) ? EPOLLIN : 0)
+                | ((events & POLLOUT) ? EPOLLOUT : 0),
+        .data.ptr = cl,
+    };
+
+    if (epoll_ctl(w->epfd, cl->b_watched ? EPOLL_CTL_MOD : EPOLL_CTL_ADD,
+                  vlc_tls_GetFD(cl->sock), &ev) == 0)
+        cl->b_watched = true;
+    else
+        cl->i_state = HTTPD_CLIENT_DEAD;
+#else
+    VLC_UNUSED(w);
+#endif
+    cl->i_events = events;
+}
+
+static void httpd_WorkerUnwatch(httpd_worker_t *w, httpd_client_t *cl)
+{
+#ifdef HAVE_SYS_EPOLL_H
+    if (cl->b_watched)
+        epoll_ctl(w->epfd, EPOLL_CTL_DEL, vlc_tls_GetFD(cl->sock), NULL);
+#else
+    VLC_UNUSED(w); VLC_UNUSED(cl);
+#endif
+}
+
+static bool httpd_ClientIsDead(const httpd_client_t *cl, mtime_t now)
+{
+    return cl->i_ref < 0 || (cl->i_ref == 0 &&
+                (cl->i_state == HTTPD_CLIENT_DEAD ||
+                  (cl->i_activity_timeout > 0 &&
+                    cl->i_activity_date+cl->i_activity_timeout < now)));
+}
+
+/* Handles the clients of a worker, with the host lock */
+static bool httpd_WorkerProcess(httpd_worker_t *w, mtime_t now)
+{
+    httpd_host_t *host = w->host;
     bool b_low_delay = false;
 
-    int canc = vlc_savecancel();
-    for (int i_client = 0; i_client < host->i_client; i_client++) {
+    for (int i_client = 0; i_client < w->i_client; i_client++) {
         int64_t i_offset;
-        httpd_client_t *cl = host->client[i_client];
-        if (cl->i_ref < 0 || (cl->i_ref == 0 &&
-                    (cl->i_state == HTTPD_CLIENT_DEAD ||
-                      (cl->i_activity_timeout > 0 &&
-                        cl->i_activity_date+cl->i_activity_timeout < now)))) {
-            TAB_REMOVE(host->i_client, host->client, cl);
+        httpd_client_t *cl = w->client[i_client];
+
+        if (httpd_ClientIsDead(cl, now)) {
+            TAB_REMOVE(w->i_client, w->client, cl);
             i_client--;
+            httpd_WorkerUnwatch(w, cl);
             httpd_ClientDestroy(cl);
+            host->i_clients_cur--;
             continue;
         }
 
-        struct pollfd *pufd = ufd + nfd;
-        assert (pufd < ufd + (sizeof (ufd) / sizeof (ufd[0])));
-
-        pufd->fd = vlc_tls_GetFD(cl->sock);
-        pufd->events = pufd->revents = 0;
-
         switch (cl->i_state) {
-            case HTTPD_CLIENT_RECEIVING:
-            case HTTPD_CLIENT_TLS_HS_IN:
-                pufd->events = POLLIN;
-                break;
-
-            case HTTPD_CLIENT_SENDING:
-            case HTTPD_CLIENT_TLS_HS_OUT:
-                pufd->events = POLLOUT;
-                break;
-
             case HTTPD_CLIENT_RECEIVE_DONE: {
                 httpd_message_t *answer = &cl->answer;
                 httpd_message_t *query  = &cl->query;
@@ -1880,6 +2400,30 @@ static void httpdLoop(httpd_host_t *host)
             }
 
             case HTTPD_CLIENT_SEND_DONE:
+                if (cl->answer.i_body_offset > 0 && cl->url != NULL) {
+                    /* catch more body data */
+                    int i_msg = cl->query.i_type;
+
+                    i_offset = cl->answer.i_body_offset;
+                    httpd_MsgClean(&cl->answer);
+                    cl->answer.i_body_offset = i_offset;
+
+                    cl->url->catch[i_msg].cb(cl->url->catch[i_msg].p_sys, cl,
+                                              &cl->answer, &cl->query);
+                    if (cl->answer.i_body > 0 || cl->p_send != NULL) {
+                        /* send the body data */
+                        free(cl->p_buffer);
+                        cl->p_buffer = cl->answer.p_body;
+                        cl->i_buffer_size = cl->answer.i_body;
+                        cl->i_buffer = 0;
+
+                        cl->answer.i_body = 0;
+                        cl->answer.p_body = NULL;
+                        cl->i_state = HTTPD_CLIENT_SENDING;
+                        break;
+                    }
+                }
+
                 if (!cl->b_stream_mode || cl->answer.i_body_offset == 0) {
                     const char *psz_connection = httpd_MsgGet(&cl->answer, "Connection");
                     const char *psz_query = httpd_MsgGet(&cl->query, "Connection");
@@ -1904,6 +2448,7 @@ static void httpdLoop(httpd_host_t *host)
                         httpd_MsgClean(&cl->query);
                         httpd_MsgInit(&cl->query);
 
+                        cl->b_stream_mode = false;
                         cl->i_buffer = 0;
                         cl->i_buffer_size = 1000;
                         free(cl->p_buffer);
@@ -1946,108 +2491,225 @@ static void httpdLoop(httpd_host_t *host)
                 }
         }
 
-        if (pufd->events != 0)
-            nfd++;
-        else
-            b_low_delay = true;
+        if (httpd_ClientIsDead(cl, now)) {
+            /* close it right away */
+            i_client--;
+            continue;
+        }
+
+        short events = 0;
+        switch (cl->i_state) {
+            case HTTPD_CLIENT_RECEIVING:
+            case HTTPD_CLIENT_TLS_HS_IN:
+                events = POLLIN;
+                break;
+
+            case HTTPD_CLIENT_SENDING:
+            case HTTPD_CLIENT_TLS_HS_OUT:
+                events = POLLOUT;
+                break;
+
+            case HTTPD_CLIENT_WAITING:
+                b_low_delay = true;
+                break;
+        }
+        httpd_WorkerWatch(w, cl, events);
     }
-    vlc_mutex_unlock(&host->lock);
-    vlc_restorecancel(canc);
+    return b_low_delay;
+}
 
-    /* we will wait 20ms (not too big) if HTTPD_CLIENT_WAITING */
-    while (poll(ufd, nfd, b_low_delay ? 20 : -1) < 0)
+/* Reads or writes a client socket, without the host lock */
+static void httpd_ClientIO(httpd_client_t *cl, bool b_error, mtime_t now)
+{
+    cl->i_activity_date = now;
+
+    switch (cl->i_state) {
+        case HTTPD_CLIENT_RECEIVING: httpd_ClientRecv(cl); break;
+        case HTTPD_CLIENT_SENDING:   httpd_ClientSend(cl); break;
+        case HTTPD_CLIENT_TLS_HS_IN:
+        case HTTPD_CLIENT_TLS_HS_OUT:
+            httpd_ClientTlsHandshake(cl->worker->host, cl);
+            break;
+        default:
+            /* the connection broke while waiting for data */
+            if (b_error)
+                cl->i_state = HTTPD_CLIENT_DEAD;
+    }
+}
+
+/* Accepts a new connection, served by the least busy worker */
+static void httpd_HostAccept(httpd_host_t *host, int fd, mtime_t now)
+{
+    fd = vlc_accept (fd, NULL, NULL, true);
+    if (fd == -1)
+        return;
+    setsockopt (fd, SOL_SOCKET, SO_REUSEADDR,
+            &(int){ 1 }, sizeof(int));
+
+    vlc_tls_t *sk = vlc_tls_SocketOpen(fd);
+    if (unlikely(sk == NULL))
     {
-        if (errno != EINTR)
-            msg_Err(host, "polling error: %s", vlc_strerror_c(errno));
+        vlc_close(fd);
+        return;
     }
 
-    canc = vlc_savecancel();
-    vlc_mutex_lock(&host->lock);
+    if (host->p_tls != NULL)
+    {
+        const char *alpn[] = { "http/1.1", NULL };
+        vlc_tls_t *tls;
 
-    /* Handle client sockets */
-    now = mdate();
-    nfd = host->nfd;
+        tls = vlc_tls_ServerSessionCreate(host->p_tls, sk, alpn);
+        if (tls == NULL)
+        {
+            vlc_tls_SessionDelete(sk);
+            return;
+        }
+        sk = tls;
+    }
 
-    for (int i_client = 0; i_client < host->i_client; i_client++) {
-        httpd_client_t *cl = host->client[i_client];
-        const struct pollfd *pufd = &ufd[nfd];
+    httpd_client_t *cl = httpd_ClientNew(sk, now);
+    if (unlikely(cl == NULL))
+    {
+        vlc_tls_Close(sk);
+        return;
+    }
 
-        assert(pufd < &ufd[sizeof(ufd) / sizeof(ufd[0])]);
+    if (host->p_tls != NULL)
+        cl->i_state = HTTPD_CLIENT_TLS_HS_OUT;
 
-        if (vlc_tls_GetFD(cl->sock) != pufd->fd)
-            continue; // we were not waiting for this client
-        ++nfd;
-        if (pufd->revents == 0)
-            continue; // no event received
+    vlc_mutex_lock(&host->lock);
+    httpd_worker_t *w = &host->worker[0];
+    for (unsigned i = 1; i < host->i_worker; i++)
+        if (host->worker[i].i_client < w->i_client)
+            w = &host->worker[i];
+
+    cl->worker = w;
+    TAB_APPEND(w->i_client, w->client, cl);
+    host->i_clients++;
+    if (++host->i_clients_cur > host->i_clients_max)
+        host->i_clients_max = host->i_clients_cur;
+    vlc_mutex_unlock(&host->lock);
 
-        cl->i_activity_date = now;
+    if (w != &host->worker[0])
+        httpd_WorkerWake(w);
+}
 
-        switch (cl->i_state) {
-            case HTTPD_CLIENT_RECEIVING: httpd_ClientRecv(cl); break;
-            case HTTPD_CLIENT_SENDING:   httpd_ClientSend(cl); break;
-            case HTTPD_CLIENT_TLS_HS_IN:
-            case HTTPD_CLIENT_TLS_HS_OUT:
-                httpd_ClientTlsHandshake(host, cl);
-                break;
-        }
-    }
+#define HTTPD_EVENTS 64
 
-    /* Handle server sockets (accept new connections) */
-    for (nfd = 0; nfd < host->nfd; nfd++) {
-        httpd_client_t *cl;
-        int fd = ufd[nfd].fd;
+static void httpdLoop(httpd_worker_t *w)
+{
+    httpd_host_t *host = w->host;
 
-        assert (fd == host->fds[nfd]);
+    /* the clients of a deleted url still need to be closed */
+    while (host->i_url <= 0 && w->i_client == 0) {
+        mutex_cleanup_push(&host->lock);
+        vlc_cond_wait(&host->wait, &host->lock);
+        vlc_cleanup_pop();
+    }
 
-        if (ufd[nfd].revents == 0)
-            continue;
+    mtime_t now = mdate();
 
-        /* */
-        fd = vlc_accept (fd, NULL, NULL, true);
-        if (fd == -1)
-            continue;
-        setsockopt (fd, SOL_SOCKET, SO_REUSEADDR,
-                &(int){ 1 }, sizeof(int));
+    int canc = vlc_savecancel();
+    bool b_low_delay = httpd_WorkerProcess(w, now);
+    /* check the activity timeouts now and then */
+    int timeout = w->i_client > 0 ? 1000 : -1;
+#ifdef _WIN32
+    /* we will wait 20ms (not too big) if HTTPD_CLIENT_WAITING, as the
+     * worker cannot be woken up */
+    if (b_low_delay)
+        timeout = 20;
+#else
+    VLC_UNUSED(b_low_delay);
+#endif
 
-        vlc_tls_t *sk = vlc_tls_SocketOpen(fd);
-        if (unlikely(sk == NULL))
-        {
-            vlc_close(fd);
-            continue;
+#ifdef HAVE_SYS_EPOLL_H
+    struct epoll_event ev[HTTPD_EVENTS];
+#else
+    struct pollfd ufd[1 + host->nfd + w->i_client];
+    httpd_client_t *clients[w->i_client + 1];
+    unsigned nfd = 0;
+
+# ifndef _WIN32
+    ufd[nfd].fd = w->wake[0];
+    ufd[nfd].events = POLLIN;
+    nfd++;
+# endif
+    const unsigned nlisten = nfd;
+    if (w == &host->worker[0])
+        for (unsigned i = 0; i < host->nfd; i++, nfd++) {
+            ufd[nfd].fd = host->fds[i];
+            ufd[nfd].events = POLLIN;
         }
 
-        if (host->p_tls != NULL)
-        {
-            const char *alpn[] = { "http/1.1", NULL };
-            vlc_tls_t *tls;
+    const unsigned nclients = nfd;
+    for (int i = 0; i < w->i_client; i++) {
+        httpd_client_t *cl = w->client[i];
 
-            tls = vlc_tls_ServerSessionCreate(host->p_tls, sk, alpn);
-            if (tls == NULL)
-            {
-                vlc_tls_SessionDelete(sk);
-                continue;
-            }
-            sk = tls;
-        }
+        if (cl->i_events == 0)
+            continue;
+        clients[nfd - nclients] = cl;
+        ufd[nfd].fd = vlc_tls_GetFD(cl->sock);
+        ufd[nfd].events = cl->i_events;
+        nfd++;
+    }
+#endif
+    vlc_mutex_unlock(&host->lock);
+    vlc_restorecancel(canc);
 
-        cl = httpd_ClientNew(sk, now);
+#ifdef HAVE_SYS_EPOLL_H
+    int n = epoll_wait(w->epfd, ev, HTTPD_EVENTS, timeout);
+#else
+    int n = poll(ufd, nfd, timeout);
+#endif
+    if (n < 0 && errno != EINTR)
+        msg_Err(host, "polling error: %s", vlc_strerror_c(errno));
+
+    canc = vlc_savecancel();
+    now = mdate();
 
-        if (host->p_tls != NULL)
-            cl->i_state = HTTPD_CLIENT_TLS_HS_OUT;
+#ifdef HAVE_SYS_EPOLL_H
+    for (int i = 0; i < n; i++) {
+        void *p = ev[i].data.ptr;
 
-        TAB_APPEND(host->i_client, host->client, cl);
+        if (p == w)
+            httpd_WorkerDrain(w);
+        else if ((uintptr_t)p >= (uintptr_t)host->fds
+              && (uintptr_t)p < (uintptr_t)(host->fds + host->nfd))
+            httpd_HostAccept(host, *(int *)p, now);
+        else
+            httpd_ClientIO(p, (ev[i].events & (EPOLLERR|EPOLLHUP)) != 0,
+                           now);
+    }
+#else
+    if (n > 0) {
+        /* Handle client sockets */
+        for (unsigned i = nclients; i < nfd; i++)
+            if (ufd[i].revents != 0)
+                httpd_ClientIO(clients[i - nclients],
+                    (ufd[i].revents & (POLLERR|POLLHUP|POLLNVAL)) != 0, now);
+
+        if (nlisten > 0 && ufd[0].revents != 0)
+            httpd_WorkerDrain(w);
+
+        /* Handle server sockets (accept new connections) */
+        for (unsigned i = nlisten; i < nclients; i++)
+            if (ufd[i].revents != 0)
+                httpd_HostAccept(host, ufd[i].fd, now);
     }
+#endif
 
+    vlc_mutex_lock(&host->lock);
     vlc_restorecancel(canc);
 }
 
-static void* httpd_HostThread(void *data)
+static void* httpd_WorkerThread(void *data)
 {
-    httpd_host_t *host = data;
+    httpd_worker_t *w = data;
+    httpd_host_t *host = w->host;
 
     vlc_mutex_lock(&host->lock);
     while (host->i_ref > 0)
-        httpdLoop(host);
+        httpdLoop(w);
     vlc_mutex_unlock(&host->lock);
     return NULL;
 }
@@ -0,0 +1,228 @@
+/*****************************************************************************
+ * album_store.c: on-disk copy of the album cache of the fetcher
+ *****************************************************************************
+ * Copyright © 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#ifdef HAVE_FLOCK
+# include <sys/file.h>
+#endif
+#ifdef HAVE_FCNTL
+# include <fcntl.h>
+#endif
+
+#include <vlc_common.h>
+#include <vlc_fs.h>
+#include <vlc_arrays.h>
+
+#include "album_store.h"
+
+#define ALBUM_STORE_MAGIC "VLCalb01"
+#define ALBUM_STORE_MAGIC_SIZE 8
+
+int album_store_Lock( char const *path )
+{
+    char *lockpath;
+
+    /* The store itself cannot be locked, as it is replaced by compactions */
+    if( asprintf( &lockpath, "%s.lock", path ) == -1 )
+        return -1;
+
+    int fd = vlc_open( lockpath, O_RDWR | O_CREAT, 0600 );
+    free( lockpath );
+    if( fd == -1 )
+        return -1;
+
+#ifdef HAVE_FLOCK
+    int val = flock( fd, LOCK_EX );
+#elif defined (HAVE_FCNTL) && defined (F_SETLKW)
+    struct flock lock = {
+        .l_type = F_WRLCK,
+        .l_whence = SEEK_SET,
+    };
+    int val = fcntl( fd, F_SETLKW, &lock );
+#else
+    int val = 0; /* no advisory locks */
+#endif
+    if( val )
+    {
+        vlc_close( fd );
+        return -1;
+    }
+    return fd;
+}
+
+void album_store_Unlock( int lock )
+{
+    vlc_close( lock );
+}
+
+static void FreeValue( void *data, void *obj )
+{
+    free( data );
+    VLC_UNUSED( obj );
+}
+
+static int Read( FILE *file, char **key, char **art )
+{
+    uint8_t header[4];
+
+    if( fread( header, sizeof( header ), 1, file ) != 1 )
+        return VLC_EGENERIC;
+
+    size_t key_len = GetWBE( &header[0] );
+    size_t art_len = GetWBE( &header[2] );
+
+    *key = malloc( key_len + 1 );
+    *art = malloc( art_len + 1 );
+
+    if( unlikely( !*key || !*art ) ||
+        fread( *key, 1, key_len, file ) != key_len ||
+        fread( *art, 1, art_len, file ) != art_len )
+    {
+        free( *key );
+        free( *art );
+        return VLC_EGENERIC;
+    }
+
+    (*key)[key_len] = '\0';
+    (*art)[art_len] = '\0';
+    return VLC_SUCCESS;
+}
+
+static int Write( FILE *file, char const *key, char const *art )
+{
+    size_t key_len = strlen( key );
+    size_t art_len = strlen( art );
+    uint8_t header[4];
+
+    if( key_len > UINT16_MAX || art_len > UINT16_MAX )
+        return VLC_EGENERIC;
+
+    SetWBE( &header[0], key_len );
+    SetWBE( &header[2], art_len );
+
+    if( fwrite( header, sizeof( header ), 1, file ) != 1 ||
+        fwrite( key, 1, key_len, file ) != key_len ||
+        fwrite( art, 1, art_len, file ) != art_len )
+        return VLC_EGENERIC;
+
+    return VLC_SUCCESS;
+}
+
+int album_store_Load( char const *path, vlc_dictionary_t *cache,
+                      size_t *records )
+{
+    FILE *file = vlc_fopen( path, "rb" );
+
+    *records = 0;
+    if( file == NULL )
+        return VLC_EGENERIC;
+
+    char magic[ALBUM_STORE_MAGIC_SIZE];
+    char *key, *art;
+    bool valid = fread( magic, sizeof( magic ), 1, file ) == 1 &&
+                 !memcmp( magic, ALBUM_STORE_MAGIC, sizeof( magic ) );
+
+    long end = valid ? ftell( file ) : -1;
+
+    while( valid && !Read( file, &key, &art ) )
+    {
+        vlc_dictionary_remove_value_for_key( cache, key, FreeValue, NULL );
+        vlc_dictionary_insert( cache, key, art );
+        free( key );
+        (*records)++;
+        end = ftell( file );
+    }
+
+    /* a truncated record must not be followed by the appended ones */
+    if( valid && ( fseek( file, 0, SEEK_END ) || ftell( file ) != end ) )
+        valid = false;
+    fclose( file );
+    return valid ? VLC_SUCCESS : VLC_EGENERIC;
+}
+
+int album_store_Compact( char const *path, const vlc_dictionary_t *cache )
+{
+    char *tmp;
+
+    /* Unique name, in case the store is not locked (no advisory locks) */
+    if( asprintf( &tmp, "%s.XXXXXX", path ) == -1 )
+        return VLC_ENOMEM;
+
+    int fd = vlc_mkstemp( tmp );
+    FILE *file = fd != -1 ? fdopen( fd, "wb" ) : NULL;
+    int ret = VLC_EGENERIC;
+
+    if( file )
+    {
+        char **keys = vlc_dictionary_all_keys( cache );
+
+        ret = fwrite( ALBUM_STORE_MAGIC, ALBUM_STORE_MAGIC_SIZE, 1, file ) == 1
+            && keys ? VLC_SUCCESS : VLC_EGENERIC;
+
+        for( size_t i = 0; keys && keys[i]; i++ )
+        {
+            char const *art = vlc_dictionary_value_for_key( cache, keys[i] );
+
+            if( ret == VLC_SUCCESS )
+                ret = Write( file, keys[i], art );
+            free( keys[i] );
+        }
+        free( keys );
+
+        if( fclose( file ) )
+            ret = VLC_EGENERIC;
+        if( ret == VLC_SUCCESS )
+            ret = vlc_rename( tmp, path ) ? VLC_EGENERIC : VLC_SUCCESS;
+        if( ret != VLC_SUCCESS )
+            vlc_unlink( tmp );
+    }
+    else if( fd != -1 )
+    {
+        vlc_close( fd );
+        vlc_unlink( tmp );
+    }
+
+    free( tmp );
+    return ret;
+}
+
+int album_store_Append( char const *path, char const *key, char const *art )
+{
+    int lock = album_store_Lock( path );
+    if( lock == -1 )
+        return VLC_EGENERIC;
+
+    FILE *file = vlc_fopen( path, "ab" );
+    int ret = VLC_EGENERIC;
+
+    if( file )
+    {
+        ret = Write( file, key, art );
+        if( fclose( file ) )
+            ret = VLC_EGENERIC;
+    }
+
+    album_store_Unlock( lock );
+    return ret;
+}
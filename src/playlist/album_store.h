@@ -0,0 +1,75 @@
+/*****************************************************************************
+ * album_store.h: on-disk copy of the album cache of the fetcher
+ *****************************************************************************
+ * Copyright © 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef _PLAYLIST_ALBUM_STORE_H
+#define _PLAYLIST_ALBUM_STORE_H 1
+
+#include <vlc_arrays.h>
+
+/**
+ * The album store persists the entries of the album cache that refer to local
+ * files (typically art that was already downloaded to the art cache), so that
+ * they survive restarts without invoking any module again.
+ *
+ * It is a log of records, each made of the 16-bits big-endian lengths of the
+ * key and of the art URL, followed by both strings (without terminators).
+ * Later records override earlier ones; the file is rewritten without the
+ * overridden records when it is loaded, if they use too much space.
+ *
+ * The file is shared by all the instances of the user: it is only accessed
+ * with the store locked, and opened again every time, since a compaction
+ * replaces it.
+ */
+
+/**
+ * Locks the store, waiting for the other instances to unlock it.
+ *
+ * \return a lock handle, or -1 on error
+ */
+int album_store_Lock( char const *path );
+
+void album_store_Unlock( int lock );
+
+/**
+ * Loads the records of the store into a cache of strings.
+ *
+ * The store must be locked.
+ *
+ * \param records number of records read [OUT]
+ * \return VLC_SUCCESS, or VLC_EGENERIC if the file is missing, is not a
+ * store or ends with a truncated record, in which case it must be compacted
+ * before anything is appended to it
+ */
+int album_store_Load( char const *path, vlc_dictionary_t *cache,
+                      size_t *records );
+
+/**
+ * Rewrites the store with one record per entry of a cache of strings.
+ *
+ * The store must be locked.
+ */
+int album_store_Compact( char const *path, const vlc_dictionary_t *cache );
+
+/**
+ * Appends a record to the store, locking it.
+ */
+int album_store_Append( char const *path, char const *key, char const *art );
+
+#endif
@@ -23,7 +23,11 @@
 # include "config.h"
 #endif
 
+#include <sys/stat.h>
+
 #include <vlc_common.h>
+#include <vlc_fs.h>
+#include <vlc_url.h>
 #include <vlc_stream.h>
 #include <vlc_modules.h>
 #include <vlc_interrupt.h>
@@ -33,6 +37,7 @@
 #include <vlc_memstream.h>
 #include <vlc_meta_fetcher.h>
 
+#include "album_store.h"
 #include "art.h"
 #include "libvlc.h"
 #include "fetcher.h"
@@ -46,6 +51,7 @@ struct playlist_fetcher_t {
     struct background_worker* downloader;
 
     vlc_dictionary_t album_cache;
+    char* album_store; /**< path of the on-disk copy of album_cache */
     vlc_object_t* owner;
     vlc_mutex_t lock;
 };
@@ -103,6 +109,84 @@ static void FreeCacheEntry( void* data, void* obj )
     VLC_UNUSED( obj );
 }
 
+/* Path of the album store, creating its directory if needed */
+static char* AlbumStorePath( void )
+{
+    char* cachedir = config_GetUserDir( VLC_CACHE_DIR );
+    char* path;
+
+    if( unlikely( cachedir == NULL ) )
+        return NULL;
+
+    vlc_mkdir( cachedir, 0700 );
+    if( asprintf( &path, "%s" DIR_SEP "art", cachedir ) != -1 )
+    {
+        vlc_mkdir( path, 0700 );
+        free( path );
+    }
+
+    if( asprintf( &path, "%s" DIR_SEP "art" DIR_SEP "albums.idx",
+                  cachedir ) == -1 )
+        path = NULL;
+    free( cachedir );
+    return path;
+}
+
+static void AlbumStoreOpen( playlist_fetcher_t* fetcher )
+{
+    char* path = AlbumStorePath();
+
+    fetcher->album_store = NULL;
+    if( unlikely( !path ) )
+        return;
+
+    /* other instances may be appending to it, or compacting it */
+    int lock = album_store_Lock( path );
+    if( lock == -1 )
+    {
+        msg_Warn( fetcher->owner, "cannot lock album cache %s", path );
+        free( path );
+        return;
+    }
+
+    size_t records;
+    int ret = album_store_Load( path, &fetcher->album_cache, &records );
+    size_t entries = vlc_dictionary_keys_count( &fetcher->album_cache );
+
+    if( ret != VLC_SUCCESS || records > 2 * entries + 64 )
+    {
+        if( records > 0 )
+            msg_Dbg( fetcher->owner, "compacting album cache (%zu records, "
+                     "%zu entries)", records, entries );
+        ret = album_store_Compact( path, &fetcher->album_cache );
+    }
+    else
+        msg_Dbg( fetcher->owner, "loaded %zu album cache entries", entries );
+    album_store_Unlock( lock );
+
+    if( ret != VLC_SUCCESS )
+    {
+        msg_Warn( fetcher->owner, "cannot write album cache %s", path );
+        free( path );
+        return;
+    }
+    fetcher->album_store = path;
+}
+
+static bool AlbumCacheValid( char const* art )
+{
+    if( strncasecmp( art, "file://", 7 ) )
+        return true;
+
+    /* the art may have been removed from the disk since it was cached */
+    char* path = vlc_uri2path( art );
+    struct stat st;
+    bool valid = path && !vlc_stat( path, &st );
+
+    free( path );
+    return valid;
+}
+
 static int ReadAlbumCache( playlist_fetcher_t* fetcher, input_item_t* item )
 {
     char* key = CreateCacheKey( item );
@@ -111,12 +195,18 @@ static int ReadAlbumCache( playlist_fetcher_t* fetcher, input_item_t* item )
         return VLC_EGENERIC;
 
     vlc_mutex_lock( &fetcher->lock );
-    char const* art = vlc_dictionary_value_for_key( &fetcher->album_cache,
-                                                    key );
+    char const* value = vlc_dictionary_value_for_key( &fetcher->album_cache,
+                                                      key );
+    char* art = value ? strdup( value ) : NULL;
+    vlc_mutex_unlock( &fetcher->lock );
+
+    if( art && !AlbumCacheValid( art ) )
+        FREENULL( art );
+
     if( art )
         input_item_SetArtURL( item, art );
-    vlc_mutex_unlock( &fetcher->lock );
 
+    free( art );
     free( key );
     return art ? VLC_SUCCESS : VLC_EGENERIC;
 }
@@ -132,6 +222,11 @@ static void AddAlbumCache( playlist_fetcher_t* fetcher, input_item_t* item,
         vlc_mutex_lock( &fetcher->lock );
         if( overwrite || !vlc_dictionary_has_key( &fetcher->album_cache, key ) )
         {
+            if( fetcher->album_store && !strncasecmp( art, "file://", 7 ) )
+                album_store_Append( fetcher->album_store, key, art );
+
+            vlc_dictionary_remove_value_for_key( &fetcher->album_cache, key,
+                                                 FreeCacheEntry, NULL );
             vlc_dictionary_insert( &fetcher->album_cache, key, art );
             art = NULL;
         }
@@ -194,6 +289,14 @@ static int SearchByScope( playlist_fetcher_t* fetcher,
 {
     input_item_t* item = req->item;
 
+    /* Known album: do not invoke any module, only download the art */
+    if( CheckArt( item ) && !ReadAlbumCache( fetcher, item ) )
+    {
+        if( !background_worker_Push( fetcher->downloader, req, NULL, 0, false ) )
+            return VLC_SUCCESS;
+        return VLC_EGENERIC;
+    }
+
     if( CheckMeta( item ) &&
         InvokeModule( fetcher, req->item, scope, "meta fetcher" ) )
     {
@@ -207,7 +310,7 @@ static int SearchByScope( playlist_fetcher_t* fetcher,
         ! SearchArt( fetcher, item, scope ) )
     {
         AddAlbumCache( fetcher, req->item, false );
-        if( !background_worker_Push( fetcher->downloader, req, NULL, 0 ) )
+        if( !background_worker_Push( fetcher->downloader, req, NULL, 0, false ) )
             return VLC_SUCCESS;
     }
 
@@ -297,7 +400,7 @@ static void SearchLocal( playlist_fetcher_t* fetcher, struct fetcher_request* re
     if( var_InheritBool( fetcher->owner, "metadata-network-access" ) ||
         req->options & META_REQUEST_OPTION_SCOPE_NETWORK )
     {
-        if( background_worker_Push( fetcher->network, req, NULL, 0 ) )
+        if( background_worker_Push( fetcher->network, req, NULL, 0, false ) )
             SetPreparsed( req );
     }
     else
@@ -404,6 +507,8 @@ static void WorkerInit( playlist_fetcher_t* fetcher,
 {
     struct background_worker_config conf = {
         .default_timeout = 0,
+        .max_threads = var_InheritInteger( fetcher->owner,
+                                           "metadata-fetch-threads" ),
         .pf_start = starter,
         .pf_probe = ProbeWorker,
         .pf_stop = CloseWorker,
@@ -443,6 +548,7 @@ playlist_fetcher_t* playlist_fetcher_New( vlc_object_t* owner )
 
     vlc_mutex_init( &fetcher->lock );
     vlc_dictionary_init( &fetcher->album_cache, 0 );
+    AlbumStoreOpen( fetcher );
 
     return fetcher;
 }
@@ -462,7 +568,7 @@ int playlist_fetcher_Push( playlist_fetcher_t* fetcher, input_item_t* item,
     atomic_init( &req->refs, 1 );
     input_item_Hold( item );
 
-    if( background_worker_Push( fetcher->local, req, NULL, 0 ) )
+    if( background_worker_Push( fetcher->local, req, NULL, 0, false ) )
         SetPreparsed( req );
 
     RequestRelease( req );
@@ -475,6 +581,8 @@ void playlist_fetcher_Delete( playlist_fetcher_t* fetcher )
     background_worker_Delete( fetcher->network );
     background_worker_Delete( fetcher->downloader );
 
+    free( fetcher->album_store );
+
     vlc_dictionary_clear( &fetcher->album_cache, FreeCacheEntry, NULL );
     vlc_mutex_destroy( &fetcher->lock );
 
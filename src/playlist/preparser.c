@@ -24,6 +24,7 @@
 #endif
 
 #include <vlc_common.h>
+#include <vlc_cpu.h>
 
 #include "misc/background_worker.h"
 #include "input/input_interface.h"
@@ -122,8 +123,13 @@ playlist_preparser_t* playlist_preparser_New( vlc_object_t *parent )
 {
     playlist_preparser_t* preparser = malloc( sizeof *preparser );
 
+    unsigned threads = var_InheritInteger( parent, "preparse-threads" );
+    if( threads == 0 )
+        threads = __MIN( vlc_GetCPUCount(), 4 );
+
     struct background_worker_config conf = {
         .default_timeout = var_InheritInteger( parent, "preparse-timeout" ),
+        .max_threads = threads,
         .pf_start = PreparserOpenInput,
         .pf_probe = PreparserProbeInput,
         .pf_stop = PreparserCloseInput,
@@ -175,7 +181,8 @@ void playlist_preparser_Push( playlist_preparser_t *preparser,
             return;
     }
 
-    if( background_worker_Push( preparser->worker, item, id, timeout ) )
+    if( background_worker_Push( preparser->worker, item, id, timeout,
+                                i_options & META_REQUEST_OPTION_PRIORITY ) )
         input_item_SignalPreparseEnded( item, ITEM_PREPARSE_FAILED );
 }
 
@@ -199,6 +206,15 @@ void playlist_preparser_Deactivate( playlist_preparser_t* preparser )
 
 void playlist_preparser_Delete( playlist_preparser_t *preparser )
 {
+    struct background_worker_stats stats;
+
+    background_worker_GetStats( preparser->worker, &stats );
+    if( stats.completed > 0 )
+        msg_Dbg( preparser->owner, "preparsed %lu item(s) (%lu failed), "
+                 "%"PRId64" ms on average, up to %zu item(s) pending",
+                 stats.completed, stats.failed,
+                 stats.busy / stats.completed / 1000, stats.max_pending );
+
     background_worker_Delete( preparser->worker );
 
     if( preparser->fetcher )
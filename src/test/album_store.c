@@ -0,0 +1,188 @@
+/*****************************************************************************
+ * album_store.c: test src/playlist/album_store.c
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <vlc_common.h>
+#include "../playlist/album_store.c"
+
+#undef NDEBUG
+#include <assert.h>
+
+static char dir[] = "/tmp/vlc_album_store_XXXXXX";
+static char path[sizeof (dir) + 16];
+
+static const char *const keys[] = { "a:1:x:1", "b:1:y:1", "c:1:z:1" };
+static const char *const arts[] = {
+    "file:///a.jpg", "file:///b.jpg", "file:///c.jpg", "file:///a2.jpg",
+};
+
+static int Load(vlc_dictionary_t *cache, size_t *records)
+{
+    vlc_dictionary_clear(cache, FreeValue, NULL);
+    vlc_dictionary_init(cache, 0);
+
+    int lock = album_store_Lock(path);
+    assert(lock != -1);
+    int ret = album_store_Load(path, cache, records);
+    album_store_Unlock(lock);
+    return ret;
+}
+
+static void Compact(const vlc_dictionary_t *cache)
+{
+    int lock = album_store_Lock(path);
+    assert(lock != -1);
+    assert(album_store_Compact(path, cache) == VLC_SUCCESS);
+    album_store_Unlock(lock);
+}
+
+static void Check(const vlc_dictionary_t *cache, const char *key,
+                  const char *art)
+{
+    const char *value = vlc_dictionary_value_for_key(cache, key);
+
+    if (art == NULL)
+        assert(value == NULL);
+    else
+        assert(value != NULL && !strcmp(value, art));
+}
+
+static off_t FileSize(void)
+{
+    struct stat st;
+
+    assert(stat(path, &st) == 0);
+    return st.st_size;
+}
+
+static size_t RecordSize(const char *key, const char *art)
+{
+    return 4 + strlen(key) + strlen(art);
+}
+
+/* Only the store and its lock file: no temporary file left behind */
+static void CheckDir(void)
+{
+    DIR *d = opendir(dir);
+    struct dirent *ent;
+    unsigned count = 0;
+
+    assert(d != NULL);
+    while ((ent = readdir(d)) != NULL)
+    {
+        if (!strcmp(ent->d_name, ".") || !strcmp(ent->d_name, ".."))
+            continue;
+        assert(!strcmp(ent->d_name, "albums.idx")
+            || !strcmp(ent->d_name, "albums.idx.lock"));
+        count++;
+    }
+    closedir(d);
+    assert(count == 2);
+}
+
+int main(void)
+{
+    vlc_dictionary_t cache;
+    size_t records;
+
+    assert(mkdtemp(dir) != NULL);
+    snprintf(path, sizeof (path), "%s/albums.idx", dir);
+    vlc_dictionary_init(&cache, 0);
+
+    /* Missing store */
+    assert(Load(&cache, &records) == VLC_EGENERIC);
+    assert(records == 0);
+
+    /* Not a store */
+    FILE *file = fopen(path, "wb");
+    assert(file != NULL);
+    fputs("VLCalb00", file);
+    fclose(file);
+    assert(Load(&cache, &records) == VLC_EGENERIC);
+
+    /* Empty store */
+    Compact(&cache);
+    assert(FileSize() == ALBUM_STORE_MAGIC_SIZE);
+    assert(Load(&cache, &records) == VLC_SUCCESS);
+    assert(records == 0 && vlc_dictionary_keys_count(&cache) == 0);
+
+    /* Round trip, later records overriding earlier ones */
+    assert(album_store_Append(path, keys[0], arts[0]) == VLC_SUCCESS);
+    assert(album_store_Append(path, keys[1], arts[1]) == VLC_SUCCESS);
+    assert(album_store_Append(path, keys[0], arts[3]) == VLC_SUCCESS);
+    assert(Load(&cache, &records) == VLC_SUCCESS);
+    assert(records == 3 && vlc_dictionary_keys_count(&cache) == 2);
+    Check(&cache, keys[0], arts[3]);
+    Check(&cache, keys[1], arts[1]);
+
+    /* Too long for the record format */
+    char *big = malloc(UINT16_MAX + 2);
+    assert(big != NULL);
+    memset(big, 'x', UINT16_MAX + 1);
+    big[UINT16_MAX + 1] = '\0';
+    off_t size = FileSize();
+    assert(album_store_Append(path, keys[2], big) == VLC_EGENERIC);
+    assert(FileSize() == size);
+    free(big);
+
+    /* Truncated trailing record: dropped, the others are loaded */
+    assert(album_store_Append(path, keys[2], arts[2]) == VLC_SUCCESS);
+    assert(truncate(path, FileSize() - 2) == 0);
+    assert(Load(&cache, &records) == VLC_EGENERIC);
+    assert(records == 3 && vlc_dictionary_keys_count(&cache) == 2);
+    Check(&cache, keys[0], arts[3]);
+    Check(&cache, keys[1], arts[1]);
+    Check(&cache, keys[2], NULL);
+
+    /* Compaction: one record per entry */
+    Compact(&cache);
+    assert(FileSize() == (off_t)(ALBUM_STORE_MAGIC_SIZE
+                                 + RecordSize(keys[0], arts[3])
+                                 + RecordSize(keys[1], arts[1])));
+    CheckDir();
+    assert(Load(&cache, &records) == VLC_SUCCESS);
+    assert(records == 2 && vlc_dictionary_keys_count(&cache) == 2);
+    Check(&cache, keys[0], arts[3]);
+    Check(&cache, keys[1], arts[1]);
+
+    /* Appending after a compaction goes to the new store */
+    assert(album_store_Append(path, keys[2], arts[2]) == VLC_SUCCESS);
+    assert(Load(&cache, &records) == VLC_SUCCESS);
+    assert(records == 3 && vlc_dictionary_keys_count(&cache) == 3);
+    Check(&cache, keys[2], arts[2]);
+
+    vlc_dictionary_clear(&cache, FreeValue, NULL);
+
+    char lockpath[sizeof (path) + 5];
+    snprintf(lockpath, sizeof (lockpath), "%s.lock", path);
+    assert(unlink(lockpath) == 0);
+    assert(unlink(path) == 0);
+    assert(rmdir(dir) == 0);
+    return 0;
+}
@@ -0,0 +1,232 @@
+/*****************************************************************************
+ * background_worker.c: test src/misc/background_worker.c
+ *****************************************************************************
+ * Copyright (C) 2018 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <pthread.h>
+
+#include <vlc_common.h>
+#include <vlc_atomic.h>
+#include "../misc/background_worker.c"
+#undef msleep
+
+#undef NDEBUG
+#include <assert.h>
+
+#define TASK_DURATION 40000
+
+/* vlc_clone_detach() is not exported by libvlccore */
+int vlc_clone_detach(vlc_thread_t *th, void *(*entry)(void *), void *data,
+                     int priority)
+{
+    pthread_t thread;
+    VLC_UNUSED(th); VLC_UNUSED(priority);
+
+    if (pthread_create(&thread, NULL, entry, data))
+        return VLC_EGENERIC;
+    pthread_detach(thread);
+    return VLC_SUCCESS;
+}
+
+struct task
+{
+    struct background_worker *worker;
+    vlc_thread_t thread;
+    atomic_bool done;
+};
+
+static struct
+{
+    vlc_mutex_t lock;
+    int refs;
+    unsigned running;
+    unsigned max_running;
+    unsigned started;
+    int order[16];
+} ctx = { VLC_STATIC_MUTEX, 0, 0, 0, 0, { 0 } };
+
+static struct background_worker *current;
+
+static void Hold(void *entity)
+{
+    VLC_UNUSED(entity);
+    vlc_mutex_lock(&ctx.lock);
+    ctx.refs++;
+    vlc_mutex_unlock(&ctx.lock);
+}
+
+static void Release(void *entity)
+{
+    VLC_UNUSED(entity);
+    vlc_mutex_lock(&ctx.lock);
+    ctx.refs--;
+    vlc_mutex_unlock(&ctx.lock);
+}
+
+static void *Run(void *data)
+{
+    struct task *task = data;
+
+    msleep(TASK_DURATION);
+    atomic_store(&task->done, true);
+    background_worker_RequestProbe(task->worker);
+    return NULL;
+}
+
+static int Start(void *owner, void *entity, void **out)
+{
+    struct task *task = malloc(sizeof (*task));
+    VLC_UNUSED(owner);
+
+    assert(task != NULL);
+    task->worker = current;
+    atomic_init(&task->done, false);
+
+    vlc_mutex_lock(&ctx.lock);
+    if (ctx.started < ARRAY_SIZE(ctx.order))
+        ctx.order[ctx.started] = (intptr_t)entity;
+    ctx.started++;
+    if (++ctx.running > ctx.max_running)
+        ctx.max_running = ctx.running;
+    vlc_mutex_unlock(&ctx.lock);
+
+    if (vlc_clone(&task->thread, Run, task, VLC_THREAD_PRIORITY_LOW))
+        abort();
+    *out = task;
+    return VLC_SUCCESS;
+}
+
+static int Probe(void *owner, void *handle)
+{
+    struct task *task = handle;
+    VLC_UNUSED(owner);
+
+    return atomic_load(&task->done);
+}
+
+static void Stop(void *owner, void *handle)
+{
+    struct task *task = handle;
+    VLC_UNUSED(owner);
+
+    vlc_join(task->thread, NULL);
+    free(task);
+
+    vlc_mutex_lock(&ctx.lock);
+    ctx.running--;
+    vlc_mutex_unlock(&ctx.lock);
+}
+
+static struct background_worker *Create(unsigned max_threads)
+{
+    struct background_worker_config conf = {
+        .default_timeout = 0,
+        .max_threads = max_threads,
+        .pf_start = Start,
+        .pf_probe = Probe,
+        .pf_stop = Stop,
+        .pf_release = Release,
+        .pf_hold = Hold };
+
+    ctx.running = ctx.max_running = ctx.started = 0;
+    current = background_worker_New(NULL, &conf);
+    assert(current != NULL);
+    return current;
+}
+
+static void WaitIdle(unsigned count)
+{
+    for (;;)
+    {
+        vlc_mutex_lock(&ctx.lock);
+        bool idle = ctx.started == count && ctx.running == 0;
+        vlc_mutex_unlock(&ctx.lock);
+        if (idle)
+            break;
+        msleep(TASK_DURATION / 2);
+    }
+}
+
+/* Entities are processed concurrently, within the limit of threads */
+static void test_concurrency(void)
+{
+    struct background_worker *worker = Create(4);
+    struct background_worker_stats stats;
+
+    for (intptr_t i = 1; i <= 12; i++)
+        assert(background_worker_Push(worker, (void *)i, NULL, -1,
+                                      false) == VLC_SUCCESS);
+    WaitIdle(12);
+
+    assert(ctx.max_running > 1 && ctx.max_running <= 4);
+    background_worker_GetStats(worker, &stats);
+    assert(stats.completed == 12 && stats.failed == 0);
+    assert(stats.busy >= 12 * TASK_DURATION);
+
+    background_worker_Delete(worker);
+    assert(ctx.refs == 0);
+}
+
+/* Urgent entities overtake the queued ones, cancelled ones never start */
+static void test_priority(void)
+{
+    struct background_worker *worker = Create(1);
+    int id;
+
+    background_worker_Push(worker, (void *)(intptr_t)1, NULL, -1, false);
+    background_worker_Push(worker, (void *)(intptr_t)2, NULL, -1, false);
+    background_worker_Push(worker, (void *)(intptr_t)3, &id, -1, false);
+    background_worker_Push(worker, (void *)(intptr_t)4, NULL, -1, true);
+    background_worker_Cancel(worker, &id);
+    WaitIdle(3);
+
+    assert(ctx.order[0] == 1 || ctx.order[0] == 4);
+    if (ctx.order[0] == 1)
+        assert(ctx.order[1] == 4 && ctx.order[2] == 2);
+    else
+        assert(ctx.order[1] == 1 && ctx.order[2] == 2);
+
+    background_worker_Delete(worker);
+    assert(ctx.refs == 0);
+}
+
+/* Deleting the worker stops the running tasks and drops the queued ones */
+static void test_delete(void)
+{
+    struct background_worker *worker = Create(2);
+
+    for (intptr_t i = 1; i <= 8; i++)
+        background_worker_Push(worker, (void *)i, NULL, -1, false);
+    background_worker_Delete(worker);
+
+    assert(ctx.running == 0 && ctx.started < 8);
+    assert(ctx.refs == 0);
+}
+
+int main(void)
+{
+    test_concurrency();
+    test_priority();
+    test_delete();
+    return 0;
+}
@@ -86,11 +86,69 @@ static void test_block (void)
     //assert (block == NULL);
 }
 
+static void test_block_Share (void)
+{
+    block_t *block = block_Alloc (sizeof (text));
+    assert (block != NULL);
+    memcpy (block->p_buffer, text, sizeof (text));
+    block->i_pts = 42;
+
+    block = block_Shared (block);
+    assert (block != NULL);
+    assert (block_Shared (block) == block);
+
+    /* A shared block is a view on the same payload */
+    block_t *a = block_Share (block);
+    assert (a != NULL);
+    assert (a != block);
+    assert (a->p_buffer == block->p_buffer);
+    assert (a->i_buffer == sizeof (text));
+    assert (a->i_pts == 42);
+    block_Release (block);
+    assert (!memcmp (a->p_buffer, text, sizeof (text)));
+
+    /* Growing a shared payload copies it */
+    block_t *b = block_Share (a);
+    assert (b != NULL);
+    b = block_Realloc (b, 1, sizeof (text));
+    assert (b != NULL);
+    assert (b->p_buffer + 1 != a->p_buffer);
+    b->p_buffer[0] = '!';
+    b->p_buffer[1] = '?';
+    assert (!memcmp (b->p_buffer + 2, text + 1, sizeof (text) - 1));
+    assert (!memcmp (a->p_buffer, text, sizeof (text)));
+
+    /* Shrinking does not */
+    block_t *c = block_Share (a);
+    assert (c != NULL);
+    c = block_Realloc (c, -5, sizeof (text));
+    assert (c != NULL);
+    assert (c->p_buffer == a->p_buffer + 5);
+
+    /* Writing does, unless nobody else uses the payload */
+    c = block_Unshare (c);
+    assert (c != NULL);
+    assert (c->p_buffer != a->p_buffer + 5);
+    assert (c->i_buffer == sizeof (text) - 5);
+    assert (!memcmp (c->p_buffer, a->p_buffer + 5, c->i_buffer));
+    memset (c->p_buffer, '*', c->i_buffer);
+    assert (!memcmp (a->p_buffer, text, sizeof (text)));
+    block_Release (c);
+    block_Release (b);
+
+    uint8_t *p = a->p_buffer;
+    a = block_Unshare (a);
+    assert (a != NULL);
+    assert (a->p_buffer == p);
+    block_Release (a);
+}
+
 int main (void)
 {
     test_block_File(false);
     test_block_File(true);
     test_block ();
+    test_block_Share ();
     return 0;
 }
 
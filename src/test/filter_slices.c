@@ -0,0 +1,156 @@
+/*****************************************************************************
+ * filter_slices.c: test slice-threaded filtering
+ *****************************************************************************
+ * Copyright (C) 2018 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+
+#include <vlc_common.h>
+#include <vlc_atomic.h>
+#include <vlc_filter.h>
+
+#define SLICES 64
+
+struct job
+{
+    atomic_uint done[SLICES];
+    atomic_uint running;
+    atomic_uint max_running;
+    unsigned    slices;
+};
+
+static void Slice(void *opaque, unsigned slice, unsigned slices)
+{
+    struct job *job = opaque;
+
+    assert(slices == job->slices);
+    assert(slice < slices);
+
+    unsigned running = atomic_fetch_add(&job->running, 1) + 1;
+    unsigned max = atomic_load(&job->max_running);
+    while (running > max
+        && !atomic_compare_exchange_weak(&job->max_running, &max, running));
+
+    /* keep busy for a while so that the slices overlap */
+    mtime_t deadline = mdate() + 200;
+    while (mdate() < deadline);
+
+    atomic_fetch_add(&job->done[slice], 1);
+    atomic_fetch_sub(&job->running, 1);
+}
+
+static void Run(filter_slices_t *ctx, unsigned slices, unsigned max_threads)
+{
+    struct job job;
+
+    for (unsigned i = 0; i < SLICES; i++)
+        atomic_init(&job.done[i], 0);
+    atomic_init(&job.running, 0);
+    atomic_init(&job.max_running, 0);
+    job.slices = slices;
+
+    filter_RunSlices(ctx, slices, Slice, &job);
+
+    /* every slice ran exactly once, and all of them are over */
+    for (unsigned i = 0; i < SLICES; i++)
+        assert(atomic_load(&job.done[i]) == (i < slices));
+    assert(atomic_load(&job.running) == 0);
+    assert(atomic_load(&job.max_running) <= max_threads);
+}
+
+static void *Thread(void *data)
+{
+    filter_slices_t *ctx = data;
+
+    for (unsigned i = 0; i < 10; i++)
+        Run(ctx, SLICES, filter_GetSliceThreads(ctx));
+    return NULL;
+}
+
+static void test_lines(void)
+{
+    for (int lines = 0; lines < 100; lines++)
+        for (unsigned slices = 1; slices < 12; slices++)
+        {
+            int next = 0;
+
+            for (unsigned i = 0; i < slices; i++)
+            {
+                int start, end;
+
+                filter_GetSliceLines(lines, i, slices, &start, &end);
+                assert(start == next && end >= start);
+                assert(end - start <= lines / (int)slices + 1);
+                next = end;
+            }
+            assert(next == lines);
+        }
+}
+
+int main(void)
+{
+    test_lines();
+
+    /* without context, the slices run in the calling thread */
+    Run(NULL, SLICES, 1);
+    Run(NULL, 0, 1);
+
+    filter_slices_t *single = filter_NewSlices(1);
+    assert(single != NULL);
+    assert(filter_GetSliceThreads(single) == 1);
+    Run(single, SLICES, 1);
+    filter_DeleteSlices(single);
+
+    filter_slices_t *automatic = filter_NewSlices(0);
+    assert(automatic != NULL);
+    assert(filter_GetSliceThreads(automatic) == vlc_GetCPUCount());
+    Run(automatic, 1, 1);
+    Run(automatic, SLICES, vlc_GetCPUCount());
+    filter_DeleteSlices(automatic);
+
+    /* several filters share the workers, each within its own limit */
+    filter_slices_t *ctx[3];
+    vlc_thread_t th[3];
+
+    for (unsigned i = 0; i < 3; i++)
+    {
+        ctx[i] = filter_NewSlices(i + 2);
+        assert(ctx[i] != NULL);
+        assert(filter_GetSliceThreads(ctx[i]) == i + 2);
+    }
+    for (unsigned i = 0; i < 3; i++)
+        assert(!vlc_clone(&th[i], Thread, ctx[i], VLC_THREAD_PRIORITY_LOW));
+    for (unsigned i = 0; i < 3; i++)
+        vlc_join(th[i], NULL);
+    for (unsigned i = 0; i < 3; i++)
+        filter_DeleteSlices(ctx[i]);
+
+    /* the workers are restarted after they were all released */
+    ctx[0] = filter_NewSlices(4);
+    assert(ctx[0] != NULL);
+    Run(ctx[0], 7, 4);
+    filter_DeleteSlices(ctx[0]);
+
+    filter_DeleteSlices(NULL);
+    return 0;
+}
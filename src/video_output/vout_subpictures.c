@@ -61,6 +61,8 @@ typedef struct {
     spu_heap_entry_t entry[VOUT_MAX_SUBPICTURES];
 } spu_heap_t;
 
+typedef struct spu_render_entry spu_render_entry_t;
+
 struct spu_private_t {
     vlc_mutex_t  lock;            /* lock to protect all followings fields */
     vlc_object_t *input;
@@ -93,6 +95,12 @@ struct spu_private_t {
     vlc_mutex_t    filter_chain_lock;
     filter_chain_t *filter_chain;
 
+    /* Regions rendered by the previous spu_Render() call */
+    spu_render_entry_t *render_cache;
+    unsigned           render_cache_count;
+    unsigned           reused_count;         /**< regions reused so far */
+    unsigned           rendered_count;     /**< regions rendered so far */
+
     /* */
     mtime_t             last_sort_date;
     vout_thread_t       *vout;
@@ -651,6 +659,195 @@ static void SpuSelectSubpictures(spu_t *spu,
 
 
 
+/**
+ * A region rendered by SpuRenderRegion(), along with the parameters of its
+ * rendering. The source picture is held, so that another one cannot be
+ * allocated at the same address: a region still showing it with the same
+ * parameters can then be output again without being rendered.
+ */
+struct spu_render_entry {
+    const subpicture_t        *subpic;
+    const subpicture_region_t *region;
+    picture_t                 *source;
+
+    /* Parameters */
+    int                region_x;
+    int                region_y;
+    int                region_align;
+    int                max_width;
+    int                max_height;
+    video_format_t     region_fmt;             /**< palette not included */
+    spu_scale_t        scale;
+    unsigned           display_width;
+    unsigned           display_height;
+    const vlc_fourcc_t *chroma_list;
+
+    /* Output region */
+    video_format_t     fmt;                    /**< palette not included */
+    int                x;
+    int                y;
+    picture_t          *picture;
+    spu_area_t         area;
+};
+
+static void SpuRenderEntryClean(spu_render_entry_t *entry)
+{
+    picture_Release(entry->source);
+    picture_Release(entry->picture);
+}
+
+static void SpuRenderCacheFlush(spu_private_t *sys)
+{
+    for (unsigned i = 0; i < sys->render_cache_count; i++)
+        SpuRenderEntryClean(&sys->render_cache[i]);
+    free(sys->render_cache);
+    sys->render_cache = NULL;
+    sys->render_cache_count = 0;
+}
+
+static bool SpuRenderEntryMatch(const spu_render_entry_t *entry,
+                                const subpicture_t *subpic,
+                                const subpicture_region_t *region,
+                                spu_scale_t scale,
+                                const vlc_fourcc_t *chroma_list,
+                                const video_format_t *fmt)
+{
+    return entry->subpic == subpic && entry->region == region &&
+           entry->source == region->p_picture &&
+           entry->region_x == region->i_x &&
+           entry->region_y == region->i_y &&
+           entry->region_align == region->i_align &&
+           entry->max_width == region->i_max_width &&
+           entry->max_height == region->i_max_height &&
+           entry->region_fmt.i_chroma == region->fmt.i_chroma &&
+           entry->region_fmt.i_x_offset == region->fmt.i_x_offset &&
+           entry->region_fmt.i_y_offset == region->fmt.i_y_offset &&
+           entry->region_fmt.i_visible_width == region->fmt.i_visible_width &&
+           entry->region_fmt.i_visible_height == region->fmt.i_visible_height &&
+           entry->scale.w == scale.w && entry->scale.h == scale.h &&
+           entry->display_width == fmt->i_visible_width &&
+           entry->display_height == fmt->i_visible_height &&
+           entry->chroma_list == chroma_list;
+}
+
+/**
+ * Finds the region rendered by the previous call for the same parameters.
+ * The entry is removed from the cache, and belongs to the caller.
+ */
+static bool SpuRenderCacheTake(spu_private_t *sys, spu_render_entry_t *entry,
+                               const subpicture_t *subpic,
+                               const subpicture_region_t *region,
+                               spu_scale_t scale,
+                               const vlc_fourcc_t *chroma_list,
+                               const video_format_t *fmt)
+{
+    for (unsigned i = 0; i < sys->render_cache_count; i++) {
+        spu_render_entry_t *cached = &sys->render_cache[i];
+
+        if (!SpuRenderEntryMatch(cached, subpic, region, scale,
+                                 chroma_list, fmt))
+            continue;
+
+        *entry = *cached;
+        *cached = sys->render_cache[--sys->render_cache_count];
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Tells whether a region rendered by SpuRenderRegion() can be output again
+ * without being rendered.
+ */
+static bool SpuRenderIsReusable(const spu_private_t *sys,
+                                const subpicture_t *subpic,
+                                const subpicture_region_t *region)
+{
+    /* Text to render again, eg. karaoke */
+    if (region->fmt.i_chroma == VLC_CODEC_TEXT || !region->p_picture)
+        return false;
+    /* The forced palette is written into the region */
+    if (region->fmt.i_chroma == VLC_CODEC_YUVP && sys->force_palette)
+        return false;
+    /* Placed with respect to the other subtitles */
+    if (subpic->b_subtitle && !subpic->b_absolute)
+        return false;
+    return true;
+}
+
+static void SpuRenderEntryInit(spu_render_entry_t *entry,
+                               const subpicture_t *subpic,
+                               const subpicture_region_t *region,
+                               spu_scale_t scale,
+                               const vlc_fourcc_t *chroma_list,
+                               const video_format_t *fmt,
+                               const subpicture_region_t *dst,
+                               spu_area_t area)
+{
+    entry->subpic         = subpic;
+    entry->region         = region;
+    entry->source         = picture_Hold(region->p_picture);
+    entry->region_x       = region->i_x;
+    entry->region_y       = region->i_y;
+    entry->region_align   = region->i_align;
+    entry->max_width      = region->i_max_width;
+    entry->max_height     = region->i_max_height;
+    entry->region_fmt     = region->fmt;
+    entry->region_fmt.p_palette = NULL;
+    entry->scale          = scale;
+    entry->display_width  = fmt->i_visible_width;
+    entry->display_height = fmt->i_visible_height;
+    entry->chroma_list    = chroma_list;
+
+    entry->fmt            = dst->fmt;
+    entry->fmt.p_palette  = NULL;
+    entry->x              = dst->i_x;
+    entry->y              = dst->i_y;
+    entry->picture        = picture_Hold(dst->p_picture);
+    entry->area           = area;
+}
+
+static int SpuRegionAlpha(const subpicture_t *subpic,
+                          const subpicture_region_t *region,
+                          mtime_t render_date)
+{
+    int fade_alpha = 255;
+    if (subpic->b_fade) {
+        mtime_t fade_start = subpic->i_start + 3 * (subpic->i_stop - subpic->i_start) / 4;
+
+        if (fade_start <= render_date && fade_start < subpic->i_stop)
+            fade_alpha = 255 * (subpic->i_stop - render_date) /
+                               (subpic->i_stop - fade_start);
+    }
+    return fade_alpha * subpic->i_alpha * region->i_alpha / 65025;
+}
+
+/**
+ * Outputs a region rendered by a previous call again.
+ */
+static subpicture_region_t *SpuRenderCachedRegion(const spu_render_entry_t *entry,
+                                                  const subpicture_t *subpic,
+                                                  const subpicture_region_t *region,
+                                                  mtime_t render_date)
+{
+    video_format_t fmt = entry->fmt;
+
+    /* The palette may have been updated since */
+    if (fmt.i_chroma == VLC_CODEC_YUVP)
+        fmt.p_palette = entry->picture == region->p_picture ?
+                        region->fmt.p_palette : region->p_private->fmt.p_palette;
+
+    subpicture_region_t *dst = subpicture_region_NewFromPicture(&fmt,
+                                                                entry->picture);
+    if (dst) {
+        dst->i_x     = entry->x;
+        dst->i_y     = entry->y;
+        dst->i_align = 0;
+        dst->i_alpha = SpuRegionAlpha(subpic, region, render_date);
+    }
+    return dst;
+}
+
 /**
  * It will transform the provided region into another region suitable for rendering.
  */
@@ -956,23 +1153,13 @@ static void SpuRenderRegion(spu_t *spu,
         }
     }
 
-    subpicture_region_t *dst = *dst_ptr = subpicture_region_New(&region_fmt);
+    subpicture_region_t *dst = *dst_ptr =
+        subpicture_region_NewFromPicture(&region_fmt, region_picture);
     if (dst) {
         dst->i_x       = x_offset;
         dst->i_y       = y_offset;
         dst->i_align   = 0;
-        if (dst->p_picture)
-            picture_Release(dst->p_picture);
-        dst->p_picture = picture_Hold(region_picture);
-        int fade_alpha = 255;
-        if (subpic->b_fade) {
-            mtime_t fade_start = subpic->i_start + 3 * (subpic->i_stop - subpic->i_start) / 4;
-
-            if (fade_start <= render_date && fade_start < subpic->i_stop)
-                fade_alpha = 255 * (subpic->i_stop - render_date) /
-                                   (subpic->i_stop - fade_start);
-        }
-        dst->i_alpha   = fade_alpha * subpic->i_alpha * region->i_alpha / 65025;
+        dst->i_alpha   = SpuRegionAlpha(subpic, region, render_date);
     }
 
 exit:
@@ -1022,8 +1209,10 @@ static subpicture_t *SpuRenderSubpictures(spu_t *spu,
             subtitle_region_count += count;
         region_count += count;
     }
-    if (region_count <= 0)
+    if (region_count <= 0) {
+        SpuRenderCacheFlush(sys);
         return NULL;
+    }
 
     /* Create the output subpicture */
     subpicture_t *output = subpicture_New(NULL);
@@ -1044,6 +1233,11 @@ static subpicture_t *SpuRenderSubpictures(spu_t *spu,
     if (subtitle_region_count > sizeof(subtitle_area_buffer)/sizeof(*subtitle_area_buffer))
         subtitle_area = calloc(subtitle_region_count, sizeof(*subtitle_area));
 
+    /* Regions rendered by this call, to be reused by the next one */
+    spu_render_entry_t *render_cache = malloc(region_count *
+                                              sizeof(*render_cache));
+    unsigned render_cache_count = 0;
+
     /* Process all subpictures and regions (in the right order) */
     for (unsigned int index = 0; index < i_subpicture; index++) {
         subpicture_t        *subpic = pp_subpicture[index];
@@ -1104,12 +1298,36 @@ static subpicture_t *SpuRenderSubpictures(spu_t *spu,
             if (scale.w <= 0 || scale.h <= 0)
                 continue;
 
-            /* */
-            SpuRenderRegion(spu, output_last_ptr, &area,
-                            subpic, region, scale,
-                            chroma_list, fmt_dst,
-                            subtitle_area, subtitle_area_count,
-                            subpic->b_subtitle ? render_subtitle_date : render_osd_date);
+            /* Reuse the region rendered by the previous call if nothing
+             * it depends on has changed */
+            const mtime_t render_date = subpic->b_subtitle ? render_subtitle_date
+                                                           : render_osd_date;
+            spu_render_entry_t *entry = render_cache ?
+                &render_cache[render_cache_count] : NULL;
+
+            if (entry && SpuRenderCacheTake(sys, entry, subpic, region, scale,
+                                            chroma_list, fmt_dst)) {
+                *output_last_ptr = SpuRenderCachedRegion(entry, subpic, region,
+                                                         render_date);
+                area = entry->area;
+                render_cache_count++;
+                sys->reused_count++;
+            } else {
+                SpuRenderRegion(spu, output_last_ptr, &area,
+                                subpic, region, scale,
+                                chroma_list, fmt_dst,
+                                subtitle_area, subtitle_area_count,
+                                render_date);
+                sys->rendered_count++;
+
+                if (entry && *output_last_ptr &&
+                    SpuRenderIsReusable(sys, subpic, region)) {
+                    SpuRenderEntryInit(entry, subpic, region, scale,
+                                       chroma_list, fmt_dst,
+                                       *output_last_ptr, area);
+                    render_cache_count++;
+                }
+            }
             if (*output_last_ptr)
                 output_last_ptr = &(*output_last_ptr)->p_next;
 
@@ -1127,6 +1345,11 @@ static subpicture_t *SpuRenderSubpictures(spu_t *spu,
             subpic->b_absolute = true;
     }
 
+    /* Keep the regions of this call only */
+    SpuRenderCacheFlush(sys);
+    sys->render_cache = render_cache;
+    sys->render_cache_count = render_cache_count;
+
     /* */
     if (subtitle_area != subtitle_area_buffer)
         free(subtitle_area);
@@ -1151,6 +1374,9 @@ static void UpdateSPU(spu_t *spu, vlc_object_t *object)
 
     vlc_mutex_lock(&sys->lock);
 
+    /* Regions are cropped and their palette forced when rendered */
+    SpuRenderCacheFlush(sys);
+
     sys->force_palette = false;
     sys->force_crop = false;
 
@@ -1304,6 +1530,11 @@ spu_t *spu_Create(vlc_object_t *object, vout_thread_t *vout)
 
     sys->margin = var_InheritInteger(spu, "sub-margin");
 
+    sys->render_cache = NULL;
+    sys->render_cache_count = 0;
+    sys->reused_count = 0;
+    sys->rendered_count = 0;
+
     /* Register the default subpicture channel */
     sys->channel = VOUT_SPU_CHANNEL_AVAIL_FIRST;
 
@@ -1368,6 +1599,10 @@ void spu_Destroy(spu_t *spu)
     free(sys->source_chain_update);
     free(sys->filter_chain_update);
 
+    msg_Dbg(spu, "%u regions rendered, %u reused",
+            sys->rendered_count, sys->reused_count);
+    SpuRenderCacheFlush(sys);
+
     /* Destroy all remaining subpictures */
     SpuHeapClean(&sys->heap);
 
@@ -1581,6 +1816,7 @@ subpicture_t *spu_Render(spu_t *spu,
     SpuSelectSubpictures(spu, &subpicture_count, subpicture_array,
                          render_subtitle_date, render_osd_date, ignore_osd);
     if (subpicture_count <= 0) {
+        SpuRenderCacheFlush(sys);
         vlc_mutex_unlock(&sys->lock);
         return NULL;
     }
@@ -1700,12 +1936,24 @@ void spu_ChangeFilters(spu_t *spu, const char *filters)
     vlc_mutex_unlock(&sys->lock);
 }
 
+void spu_GetRenderStatistics(spu_t *spu, unsigned *reused,
+                             unsigned *rendered)
+{
+    spu_private_t *sys = spu->p;
+
+    vlc_mutex_lock(&sys->lock);
+    *reused   = sys->reused_count;
+    *rendered = sys->rendered_count;
+    vlc_mutex_unlock(&sys->lock);
+}
+
 void spu_ChangeMargin(spu_t *spu, int margin)
 {
     spu_private_t *sys = spu->p;
 
     vlc_mutex_lock(&sys->lock);
     sys->margin = margin;
+    SpuRenderCacheFlush(sys);
     vlc_mutex_unlock(&sys->lock);
 }
 
@@ -0,0 +1,227 @@
+/*****************************************************************************
+ * transcode.c: test of the transcode ABR ladder
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+
+#include <string.h>
+
+#define WIDTH  64
+#define HEIGHT 48
+#define FRAMES 25
+
+static char dir[] = "/tmp/vlc_transcode_XXXXXX";
+
+static void write_y4m(const char *path)
+{
+    FILE *f = fopen(path, "wb");
+    assert(f != NULL);
+
+    fprintf(f, "YUV4MPEG2 W%u H%u F25:1 Ip A1:1 C420jpeg\n", WIDTH, HEIGHT);
+    for (unsigned n = 0; n < FRAMES; n++)
+    {
+        fputs("FRAME\n", f);
+        for (unsigned i = 0; i < WIDTH * HEIGHT * 3 / 2; i++)
+            fputc((i * 7 + n * 13 + (i / WIDTH) * n) & 0xff, f);
+    }
+    assert(fclose(f) == 0);
+}
+
+/* Streams the input through a stream output chain, returns false on error */
+static bool transcode(const char *psz_sout)
+{
+    const char *args[] = {
+        "-v", "--ignore-config", "--no-audio", "--rawvid-fps=25",
+        "--rawvid-chroma=J420",
+    };
+    char *psz_opt, *psz_in;
+    libvlc_state_t state;
+
+    log("Transcoding with %s\n", psz_sout);
+    assert(asprintf(&psz_opt, ":sout=%s", psz_sout) != -1);
+    assert(asprintf(&psz_in, "%s/in.y4m", dir) != -1);
+
+    libvlc_instance_t *vlc = libvlc_new(sizeof (args) / sizeof (args[0]), args);
+    assert(vlc != NULL);
+
+    libvlc_media_t *md = libvlc_media_new_path(vlc, psz_in);
+    assert(md != NULL);
+    libvlc_media_add_option(md, psz_opt);
+
+    libvlc_media_player_t *mp = libvlc_media_player_new_from_media(md);
+    assert(mp != NULL);
+    libvlc_media_release(md);
+
+    assert(libvlc_media_player_play(mp) == 0);
+    do
+    {
+        usleep(10000);
+        state = libvlc_media_player_get_state(mp);
+    }
+    while (state != libvlc_Ended && state != libvlc_Error);
+
+    libvlc_media_player_stop(mp);
+    libvlc_media_player_release(mp);
+    libvlc_release(vlc);
+    free(psz_in);
+    free(psz_opt);
+    return state == libvlc_Ended;
+}
+
+static void *load(const char *name, size_t *size)
+{
+    char *path;
+    assert(asprintf(&path, "%s/%s", dir, name) != -1);
+
+    FILE *f = fopen(path, "rb");
+    free(path);
+    if (f == NULL)
+        return NULL;
+
+    char *data = NULL;
+    size_t len = 0;
+    for (;;)
+    {
+        data = realloc(data, len + 65536);
+        assert(data != NULL);
+
+        size_t val = fread(data + len, 1, 65536, f);
+        len += val;
+        if (val < 65536)
+            break;
+    }
+    fclose(f);
+    *size = len;
+    return data;
+}
+
+static void remove_file(const char *name)
+{
+    char *path;
+    assert(asprintf(&path, "%s/%s", dir, name) != -1);
+    unlink(path);
+    free(path);
+}
+
+/* Checks that two outputs have the same bytes, and removes them */
+static void compare(const char *a, const char *b)
+{
+    size_t size_a, size_b;
+    void *data_a = load(a, &size_a);
+    void *data_b = load(b, &size_b);
+
+    log("Comparing %s and %s\n", a, b);
+    assert(data_a != NULL && data_b != NULL);
+    assert(size_a > FRAMES * 100); /* not only the headers */
+    assert(size_a == size_b);
+    assert(!memcmp(data_a, data_b, size_a));
+    free(data_a);
+    free(data_b);
+    remove_file(a);
+    remove_file(b);
+}
+
+/* Output chain to a file of the temporary directory */
+static char *out(const char *name)
+{
+    char *psz_out;
+    assert(asprintf(&psz_out, "std{access=file,mux=avi,dst=%s/%s}",
+                    dir, name) != -1);
+    return psz_out;
+}
+
+int main(void)
+{
+    test_init();
+
+    assert(mkdtemp(dir) != NULL);
+
+    char *psz_in;
+    assert(asprintf(&psz_in, "%s/in.y4m", dir) != -1);
+    write_y4m(psz_in);
+
+    /* A rendition of a ladder is the same as a second transcode{} of the
+     * same input behind a duplicate{} */
+    char *psz_out0 = out("dup0.avi"), *psz_out1 = out("dup1.avi");
+    char *psz_sout;
+    assert(asprintf(&psz_sout, "#duplicate{dst=\"transcode{vcodec=jpeg}:%s\","
+                    "dst=\"transcode{vcodec=jpeg}:%s\"}",
+                    psz_out0, psz_out1) != -1);
+    bool ok = transcode(psz_sout);
+    free(psz_sout);
+    free(psz_out1);
+    free(psz_out0);
+
+    size_t size;
+    void *data = ok ? load("dup0.avi", &size) : NULL;
+    if (data == NULL)
+    {
+        log("SKIP: cannot transcode to jpeg in avi\n");
+        remove_file("dup0.avi");
+        remove_file("dup1.avi");
+        unlink(psz_in);
+        rmdir(dir);
+        free(psz_in);
+        return 77;
+    }
+    free(data);
+
+    psz_out0 = out("ladder0.avi");
+    psz_out1 = out("ladder1.avi");
+    assert(asprintf(&psz_sout, "#transcode{vcodec=jpeg,rendition={dst=%s}}:%s",
+                    psz_out1, psz_out0) != -1);
+    assert(transcode(psz_sout));
+    free(psz_sout);
+    free(psz_out1);
+    free(psz_out0);
+
+    compare("ladder0.avi", "dup0.avi");
+    compare("ladder1.avi", "dup1.avi");
+
+    /* The renditions are encoded on their own threads, with the same
+     * results */
+    const unsigned threads[] = { 0, 2 };
+    for (unsigned i = 0; i < sizeof (threads) / sizeof (threads[0]); i++)
+    {
+        char name[3][16];
+        char *psz_out[3];
+
+        for (unsigned j = 0; j < 3; j++)
+        {
+            snprintf(name[j], sizeof (name[j]), "t%u_%u.avi", threads[i], j);
+            psz_out[j] = out(name[j]);
+        }
+        assert(asprintf(&psz_sout, "#transcode{vcodec=jpeg,threads=%u,"
+                        "rendition={vb=500,dst=%s},rendition={dst=%s}}:%s",
+                        threads[i], psz_out[1], psz_out[2],
+                        psz_out[0]) != -1);
+        assert(transcode(psz_sout));
+        free(psz_sout);
+        for (unsigned j = 0; j < 3; j++)
+            free(psz_out[j]);
+    }
+    compare("t0_0.avi", "t2_0.avi");
+    compare("t0_1.avi", "t2_1.avi");
+    compare("t0_2.avi", "t2_2.avi");
+
+    unlink(psz_in);
+    free(psz_in);
+    assert(rmdir(dir) == 0);
+    return 0;
+}
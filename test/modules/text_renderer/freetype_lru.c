@@ -0,0 +1,171 @@
+/*****************************************************************************
+ * freetype_lru.c: test of the FreeType LRU cache
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#include "../../../modules/text_renderer/freetype/lru.c"
+
+#undef NDEBUG
+#include <assert.h>
+
+#define VALUE_SIZE 100
+/* Accounted size of an entry with a one byte key */
+#define ENTRY_SIZE (VALUE_SIZE + sizeof (lru_entry_t) + 1)
+
+static char released[16];
+static unsigned released_count;
+
+/* The values are the keys themselves, recorded in release order */
+static void Release(void *value)
+{
+    assert(released_count < sizeof (released));
+    released[released_count++] = (char)(uintptr_t)value;
+}
+
+static void Put(lru_cache_t *cache, char key, size_t size)
+{
+    assert(LRUCache_Put(cache, &key, 1, (void *)(uintptr_t)key, size)
+           == VLC_SUCCESS);
+}
+
+static bool Has(lru_cache_t *cache, char key)
+{
+    void *value = LRUCache_Get(cache, &key, 1);
+    assert(value == NULL || value == (void *)(uintptr_t)key);
+    return value != NULL;
+}
+
+static void CheckStats(lru_cache_t *cache, uint64_t hits, uint64_t misses,
+                       uint64_t evictions, size_t entries, size_t size)
+{
+    lru_cache_stats_t stats;
+
+    LRUCache_GetStats(cache, &stats);
+    assert(stats.i_hits == hits);
+    assert(stats.i_misses == misses);
+    assert(stats.i_evictions == evictions);
+    assert(stats.i_entries == entries);
+    assert(stats.i_size == size);
+}
+
+static void test_eviction(void)
+{
+    lru_cache_t *cache = LRUCache_New(3 * ENTRY_SIZE, Release);
+    assert(cache != NULL);
+
+    Put(cache, 'a', VALUE_SIZE);
+    Put(cache, 'b', VALUE_SIZE);
+    Put(cache, 'c', VALUE_SIZE);
+    CheckStats(cache, 0, 0, 0, 3, 3 * ENTRY_SIZE);
+
+    /* Within the limit: nothing to release */
+    LRUCache_Trim(cache);
+    assert(released_count == 0);
+
+    /* From the most recently used: a, c, b */
+    assert(Has(cache, 'a'));
+    CheckStats(cache, 1, 0, 0, 3, 3 * ENTRY_SIZE);
+
+    /* Over the limit, but the values stay valid until trimmed */
+    Put(cache, 'd', VALUE_SIZE);
+    CheckStats(cache, 1, 0, 0, 4, 4 * ENTRY_SIZE);
+    assert(released_count == 0);
+
+    LRUCache_Trim(cache);
+    assert(released_count == 1 && released[0] == 'b');
+    CheckStats(cache, 1, 0, 1, 3, 3 * ENTRY_SIZE);
+
+    assert(!Has(cache, 'b'));
+    assert(Has(cache, 'c'));
+    assert(Has(cache, 'a'));
+    assert(Has(cache, 'd'));
+    CheckStats(cache, 4, 1, 1, 3, 3 * ENTRY_SIZE);
+
+    /* From the most recently used: e, d, a, c. Making room for a value
+     * twice as large releases the two least recently used ones. */
+    Put(cache, 'e', VALUE_SIZE + ENTRY_SIZE);
+    CheckStats(cache, 4, 1, 1, 4, 5 * ENTRY_SIZE);
+    LRUCache_Trim(cache);
+    assert(released_count == 3 && !memcmp(released, "bca", 3));
+    CheckStats(cache, 4, 1, 3, 2, 3 * ENTRY_SIZE);
+
+    /* A value larger than the limit is released on its own */
+    Put(cache, 'f', 4 * ENTRY_SIZE);
+    LRUCache_Trim(cache);
+    assert(released_count == 6 && !memcmp(released, "bcadef", 6));
+    CheckStats(cache, 4, 1, 6, 0, 0);
+
+    Put(cache, 'g', VALUE_SIZE);
+    Put(cache, 'h', VALUE_SIZE);
+    LRUCache_Delete(cache);
+    assert(released_count == 8);
+    assert(memchr(released + 6, 'g', 2) && memchr(released + 6, 'h', 2));
+    released_count = 0;
+}
+
+static void ReleaseNothing(void *value)
+{
+    (void) value;
+}
+
+static void test_keys(void)
+{
+    lru_cache_t *cache = LRUCache_New(SIZE_MAX, ReleaseNothing);
+    assert(cache != NULL);
+
+    /* Enough entries to grow the table, with keys of different lengths
+     * sharing their prefixes */
+    size_t size = 0;
+    for (unsigned i = 0; i < 1000; i++)
+    {
+        char key[8];
+        int len = snprintf(key, sizeof (key), "%u", i);
+        assert(LRUCache_Put(cache, key, len, (void *)(uintptr_t)(i + 1),
+                            i) == VLC_SUCCESS);
+        size += i + sizeof (lru_entry_t) + len;
+    }
+    CheckStats(cache, 0, 0, 0, 1000, size);
+
+    for (unsigned i = 0; i < 1000; i++)
+    {
+        char key[8];
+        int len = snprintf(key, sizeof (key), "%u", i);
+        assert(LRUCache_Get(cache, key, len) == (void *)(uintptr_t)(i + 1));
+    }
+    assert(LRUCache_Get(cache, "1000", 4) == NULL);
+    assert(LRUCache_Get(cache, "", 0) == NULL);
+    CheckStats(cache, 1000, 2, 0, 1000, size);
+
+    LRUCache_Trim(cache);
+    CheckStats(cache, 1000, 2, 0, 1000, size);
+    LRUCache_Delete(cache);
+}
+
+int main(void)
+{
+    test_eviction();
+    test_keys();
+    return 0;
+}
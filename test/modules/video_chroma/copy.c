@@ -0,0 +1,321 @@
+/*****************************************************************************
+ * copy.c: test and benchmark of the picture planes copies
+ *****************************************************************************
+ * Copyright (C) 2018 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <vlc_common.h>
+#include <vlc_picture.h>
+#include <vlc_filter.h>
+
+#include "../../../modules/video_chroma/copy.c"
+
+#undef NDEBUG
+#include <assert.h>
+
+enum conversion
+{
+    NV12_TO_YV12,
+    NV12_TO_NV12,
+    NV12_TO_I420,
+    I420_TO_NV12,
+    I420_10_TO_P010,
+    YV12_TO_YV12,
+};
+
+static const struct
+{
+    const char  *name;
+    vlc_fourcc_t src;
+    vlc_fourcc_t dst;
+} conversions[] = {
+    [NV12_TO_YV12]    = { "NV12 -> YV12",    VLC_CODEC_NV12,     VLC_CODEC_YV12 },
+    [NV12_TO_NV12]    = { "NV12 -> NV12",    VLC_CODEC_NV12,     VLC_CODEC_NV12 },
+    [NV12_TO_I420]    = { "NV12 -> I420",    VLC_CODEC_NV12,     VLC_CODEC_I420 },
+    [I420_TO_NV12]    = { "I420 -> NV12",    VLC_CODEC_I420,     VLC_CODEC_NV12 },
+    [I420_10_TO_P010] = { "I420_10 -> P010", VLC_CODEC_I420_10L, VLC_CODEC_P010 },
+    [YV12_TO_YV12]    = { "YV12 -> YV12",    VLC_CODEC_YV12,     VLC_CODEC_YV12 },
+};
+
+/* Source planes, as given by a hardware surface */
+struct source
+{
+    uint8_t *buffer;
+    uint8_t *planes[3];
+    size_t   pitches[3];
+    unsigned count;
+    size_t   size;
+};
+
+static void SourceInit(struct source *src, enum conversion conv,
+                       unsigned width, unsigned height, unsigned offset)
+{
+    const unsigned bytes = conv == I420_10_TO_P010 ? 2 : 1;
+    size_t pitch = ((width * bytes + 63) & ~63) + offset;
+
+    if (conversions[conv].src == VLC_CODEC_NV12) {
+        src->count = 2;
+        src->pitches[0] = src->pitches[1] = pitch;
+    } else {
+        src->count = 3;
+        src->pitches[0] = pitch;
+        src->pitches[1] = src->pitches[2] = pitch / 2;
+    }
+
+    size_t lines[3] = { height, (height + 1) / 2, (height + 1) / 2 };
+    src->size = 0;
+    for (unsigned n = 0; n < src->count; n++)
+        src->size += src->pitches[n] * lines[n];
+
+    src->buffer = aligned_alloc(64, (src->size + offset + 63) & ~63);
+    assert(src->buffer != NULL);
+    uint32_t seed = rand();
+    for (size_t i = 0; i < src->size + offset; i++) {
+        seed = seed * 1664525 + 1013904223;
+        src->buffer[i] = seed >> 24;
+    }
+    if (conv == I420_10_TO_P010) /* 10 bits samples */
+        for (size_t i = 1; i < src->size + offset; i += 2)
+            src->buffer[i] &= 0x03;
+
+    uint8_t *p = src->buffer + offset;
+    for (unsigned n = 0; n < src->count; n++) {
+        src->planes[n] = p;
+        p += src->pitches[n] * lines[n];
+    }
+}
+
+static void SourceClean(struct source *src)
+{
+    free(src->buffer);
+}
+
+static picture_t *NewPicture(enum conversion conv, const struct source *src,
+                             unsigned height)
+{
+    video_format_t fmt;
+    const unsigned bytes = conv == I420_10_TO_P010 ? 2 : 1;
+
+    /* The destination lines are at least as long as the source lines */
+    video_format_Init(&fmt, conversions[conv].dst);
+    video_format_Setup(&fmt, conversions[conv].dst,
+                       src->pitches[0] / bytes, height,
+                       src->pitches[0] / bytes, height, 1, 1);
+    picture_t *pic = picture_NewFromFormat(&fmt);
+    assert(pic != NULL);
+    for (int n = 0; n < pic->i_planes; n++)
+        memset(pic->p[n].p_pixels, 0x5a, pic->p[n].i_pitch * pic->p[n].i_lines);
+    return pic;
+}
+
+static void Copy(enum conversion conv, picture_t *dst,
+                 struct source *src, unsigned height, copy_cache_t *cache)
+{
+    switch (conv) {
+        case NV12_TO_YV12:
+            CopyFromNv12ToYv12(dst, src->planes, src->pitches, height, cache);
+            break;
+        case NV12_TO_NV12:
+            CopyFromNv12ToNv12(dst, src->planes, src->pitches, height, cache);
+            break;
+        case NV12_TO_I420:
+            CopyFromNv12ToI420(dst, src->planes, src->pitches, height, cache);
+            break;
+        case I420_TO_NV12:
+            CopyFromI420ToNv12(dst, src->planes, src->pitches, height, cache);
+            break;
+        case I420_10_TO_P010:
+            CopyFromI420_10ToP010(dst, src->planes, src->pitches, height, cache);
+            break;
+        case YV12_TO_YV12:
+            CopyFromYv12ToYv12(dst, src->planes, src->pitches, height, cache);
+            break;
+    }
+}
+
+#ifndef COPY_BENCH
+static uint8_t *Line(picture_t *pic, int plane, unsigned y)
+{
+    return &pic->p[plane].p_pixels[y * pic->p[plane].i_pitch];
+}
+
+/* Reference conversion, one pixel at a time */
+static void Reference(enum conversion conv, picture_t *dst,
+                      const struct source *src, unsigned height)
+{
+    const size_t *pitch = src->pitches;
+
+    for (unsigned y = 0; y < height; y++) {
+        const uint8_t *s = src->planes[0] + y * pitch[0];
+        if (conv == I420_10_TO_P010)
+            for (unsigned x = 0; x < pitch[0] / 2; x++)
+                ((uint16_t *)Line(dst, 0, y))[x] = ((const uint16_t *)s)[x] << 6;
+        else
+            memcpy(Line(dst, 0, y), s, pitch[0]);
+    }
+
+    for (unsigned y = 0; y < height / 2; y++) {
+        const uint8_t *s1 = src->planes[1] + y * pitch[1];
+        const uint8_t *s2 = src->count > 2 ? src->planes[2] + y * pitch[2] : NULL;
+
+        switch (conv) {
+            case NV12_TO_YV12:
+            case NV12_TO_I420: {
+                int u = conv == NV12_TO_I420 ? 1 : 2;
+                for (unsigned x = 0; x < pitch[1] / 2; x++) {
+                    Line(dst, u, y)[x] = s1[2*x];
+                    Line(dst, 3 - u, y)[x] = s1[2*x+1];
+                }
+                break;
+            }
+            case NV12_TO_NV12:
+                memcpy(Line(dst, 1, y), s1, pitch[1]);
+                break;
+            case I420_TO_NV12:
+                for (unsigned x = 0; x < pitch[1]; x++) {
+                    Line(dst, 1, y)[2*x] = s1[x];
+                    Line(dst, 1, y)[2*x+1] = s2[x];
+                }
+                break;
+            case I420_10_TO_P010: {
+                uint16_t *d = (uint16_t *)Line(dst, 1, y);
+                for (unsigned x = 0; x < pitch[1] / 2; x++) {
+                    d[2*x]   = ((const uint16_t *)s1)[x] << 6;
+                    d[2*x+1] = ((const uint16_t *)s2)[x] << 6;
+                }
+                break;
+            }
+            case YV12_TO_YV12:
+                memcpy(Line(dst, 1, y), s1, pitch[1]);
+                memcpy(Line(dst, 2, y), s2, pitch[2]);
+                break;
+        }
+    }
+}
+
+static void Check(enum conversion conv, unsigned width, unsigned height,
+                  unsigned offset, unsigned threads)
+{
+    struct source src;
+    copy_cache_t cache;
+
+    SourceInit(&src, conv, width, height, offset);
+    picture_t *out = NewPicture(conv, &src, height);
+    picture_t *ref = NewPicture(conv, &src, height);
+
+    int ret = CopyInitCacheSlices(&cache, src.pitches[0], threads);
+    assert(ret == VLC_SUCCESS);
+    Copy(conv, out, &src, height, &cache);
+    Reference(conv, ref, &src, height);
+    CopyCleanCache(&cache);
+
+    for (int n = 0; n < out->i_planes; n++)
+        if (memcmp(out->p[n].p_pixels, ref->p[n].p_pixels,
+                   out->p[n].i_pitch * out->p[n].i_lines)) {
+            fprintf(stderr, "%s %ux%u offset %u, %u threads: plane %d differs\n",
+                    conversions[conv].name, width, height, offset, threads, n);
+            abort();
+        }
+
+    picture_Release(out);
+    picture_Release(ref);
+    SourceClean(&src);
+}
+
+int main(void)
+{
+    static const unsigned sizes[][2] = {
+        { 16, 2 }, { 100, 30 }, { 250, 64 }, { 720, 576 }, { 1920, 1080 },
+    };
+
+    alarm(10);
+    for (size_t c = 0; c < ARRAY_SIZE(conversions); c++) {
+        for (size_t i = 0; i < ARRAY_SIZE(sizes); i++)
+            for (unsigned offset = 0; offset <= 16; offset += 8)
+                Check(c, sizes[i][0], sizes[i][1], offset, 1);
+        /* Large pictures are split in slices */
+        Check(c, 1920, 1080, 0, 4);
+        Check(c, 3840, 2160, 8, 4);
+        Check(c, 3840, 1088, 0, 3);
+    }
+    return 0;
+}
+#else
+int main(int argc, char *argv[])
+{
+    unsigned width = 3840, height = 2160, loops = 100, threads = 1;
+    int c;
+
+    while ((c = getopt(argc, argv, "n:s:t:")) != -1) {
+        switch (c) {
+            case 'n':
+                loops = strtoul(optarg, NULL, 0);
+                break;
+            case 's':
+                if (sscanf(optarg, "%ux%u", &width, &height) != 2)
+                    goto usage;
+                break;
+            case 't':
+                threads = strtoul(optarg, NULL, 0);
+                break;
+            default:
+                goto usage;
+        }
+    }
+    if (loops == 0 || width == 0 || height == 0)
+        goto usage;
+
+    printf("# %ux%u, %u loops, %u threads\n", width, height, loops, threads);
+    for (size_t conv = 0; conv < ARRAY_SIZE(conversions); conv++) {
+        struct source src;
+        copy_cache_t cache;
+
+        SourceInit(&src, conv, width, height, 0);
+        picture_t *dst = NewPicture(conv, &src, height);
+        if (CopyInitCacheSlices(&cache, src.pitches[0], threads))
+            abort();
+
+        Copy(conv, dst, &src, height, &cache);
+        mtime_t start = mdate();
+        for (unsigned i = 0; i < loops; i++)
+            Copy(conv, dst, &src, height, &cache);
+        mtime_t duration = __MAX(mdate() - start, 1);
+
+        /* Bytes read from the source per second */
+        printf("%-16s %6.2f GB/s %8.3f ms/picture\n", conversions[conv].name,
+               (double)src.size * loops / duration / 1000.,
+               duration / 1000. / loops);
+
+        CopyCleanCache(&cache);
+        picture_Release(dst);
+        SourceClean(&src);
+    }
+    return 0;
+
+usage:
+    fprintf(stderr, "Usage: %s [-n <loops>] [-s <width>x<height>] "
+            "[-t <threads, 0 for one per CPU>]\n", argv[0]);
+    return 1;
+}
+#endif
@@ -0,0 +1,260 @@
+/*****************************************************************************
+ * i420_rgb.c: test of the line based YUV to RGB conversions
+ *****************************************************************************
+ * Copyright (C) 2018 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <vlc_common.h>
+#include <vlc_picture.h>
+#include <vlc_filter.h>
+
+#include "../../../modules/video_chroma/i420_rgb_line.c"
+
+#undef NDEBUG
+#include <assert.h>
+
+#define MAX_WIDTH 1920
+
+static const unsigned rv32_shifts[][3] = {
+    { 16, 8, 0 }, { 24, 16, 8 }, { 8, 16, 24 }, { 0, 8, 16 },
+};
+
+static uint32_t seed = 1;
+
+static uint8_t Random(void)
+{
+    seed = seed * 1103515245 + 12345;
+    return seed >> 16;
+}
+
+/* Sources of a line, in every layout, with the same samples */
+static uint8_t y8[MAX_WIDTH], u8[MAX_WIDTH / 2], v8[MAX_WIDTH / 2];
+static uint16_t y10[MAX_WIDTH], u10[MAX_WIDTH / 2], v10[MAX_WIDTH / 2];
+static uint16_t y16[MAX_WIDTH], uv16[MAX_WIDTH];
+
+/* Fills the sources, the unused bits of the 10 bits ones with garbage */
+static void FillLine(void)
+{
+    for (unsigned i = 0; i < MAX_WIDTH; i++) {
+        y8[i] = Random();
+        y10[i] = (y8[i] << 2) | (Random() << 10);
+        y16[i] = (y8[i] << 8) | (Random() & 0x3f);
+    }
+    for (unsigned i = 0; i < MAX_WIDTH / 2; i++) {
+        u8[i] = Random();
+        v8[i] = Random();
+        u10[i] = (u8[i] << 2) | (Random() << 10);
+        v10[i] = (v8[i] << 2) | (Random() << 10);
+        uv16[2 * i] = (u8[i] << 8) | (Random() & 0x3f);
+        uv16[2 * i + 1] = (v8[i] << 8) | (Random() & 0x3f);
+    }
+}
+
+static void ConvertLine(const i420_rgb_line_t lines[][LINE_OUTPUTS],
+                        int src, int out, void *dst, unsigned width,
+                        const unsigned *shift)
+{
+    switch (src) {
+        case LINE_8:
+            lines[src][out](dst, y8, u8, v8, width, shift);
+            break;
+        case LINE_10:
+            lines[src][out](dst, y10, u10, v10, width, shift);
+            break;
+        default:
+            lines[src][out](dst, y16, uv16, NULL, width, shift);
+            break;
+    }
+}
+
+static size_t LineSize(int out, unsigned width)
+{
+    return width * (out == LINE_RV32 ? 4 : 2);
+}
+
+/* Neutral chroma gives grays, black stays black */
+static void test_grays(void)
+{
+    unsigned shift[3] = { 16, 8, 0 };
+    uint32_t rgb[MAX_WIDTH];
+
+    for (unsigned i = 0; i < 256; i++)
+        y8[i] = i;
+    memset(u8, 128, sizeof (u8));
+    memset(v8, 128, sizeof (v8));
+    lines_c[LINE_8][LINE_RV32](rgb, y8, u8, v8, 256, shift);
+
+    for (unsigned i = 0; i < 256; i++) {
+        unsigned r = (rgb[i] >> 16) & 0xff, g = (rgb[i] >> 8) & 0xff;
+        unsigned b = rgb[i] & 0xff;
+
+        assert(r == g && g == b);
+        assert(i > 16 || r == 0);
+        assert(i == 0 || r >= ((rgb[i - 1] >> 16) & 0xff));
+    }
+    assert((rgb[235] & 0xff) >= 254);
+}
+
+/* The 10 bits layouts convert 8 bits samples like the 8 bits one */
+static void test_depths(void)
+{
+    uint8_t ref[MAX_WIDTH * 4], dst[MAX_WIDTH * 4];
+
+    for (int out = 0; out < LINE_OUTPUTS; out++) {
+        const unsigned *shift = rv32_shifts[0];
+
+        ConvertLine(lines_c, LINE_8, out, ref, MAX_WIDTH, shift);
+        for (int src = LINE_10; src < LINE_SOURCES; src++) {
+            ConvertLine(lines_c, src, out, dst, MAX_WIDTH, shift);
+            assert(!memcmp(ref, dst, LineSize(out, MAX_WIDTH)));
+        }
+    }
+}
+
+#ifdef CAN_COMPILE_AVX2
+/* The AVX2 lines match the C ones, for every width */
+static void test_avx2(void)
+{
+    uint8_t ref[MAX_WIDTH * 4 + 64], dst[MAX_WIDTH * 4 + 64];
+
+    for (int src = 0; src < LINE_SOURCES; src++)
+        for (int out = 0; out < LINE_OUTPUTS; out++)
+            for (unsigned s = 0; s < ARRAY_SIZE(rv32_shifts); s++) {
+                if (s > 0 && out != LINE_RV32)
+                    break;
+                for (unsigned width = 0; width <= MAX_WIDTH;
+                     width += width < 96 ? 2 : 274) {
+                    memset(ref, 0x5a, sizeof (ref));
+                    memset(dst, 0x5a, sizeof (dst));
+                    ConvertLine(lines_c, src, out, ref, width,
+                                rv32_shifts[s]);
+                    ConvertLine(lines_avx2, src, out, dst, width,
+                                rv32_shifts[s]);
+                    assert(!memcmp(ref, dst, sizeof (ref)));
+                }
+            }
+}
+#endif
+
+static picture_t *NewPicture(vlc_fourcc_t chroma, unsigned width,
+                             unsigned height)
+{
+    video_format_t fmt;
+
+    video_format_Init(&fmt, chroma);
+    fmt.i_width = fmt.i_visible_width = width;
+    fmt.i_height = fmt.i_visible_height = height;
+    if (chroma == VLC_CODEC_RGB32) {
+        fmt.i_rmask = 0x00ff0000;
+        fmt.i_gmask = 0x0000ff00;
+        fmt.i_bmask = 0x000000ff;
+    }
+
+    picture_t *pic = picture_NewFromFormat(&fmt);
+    assert(pic != NULL);
+    for (int i = 0; i < pic->i_planes; i++)
+        for (int j = 0; j < pic->p[i].i_lines * pic->p[i].i_pitch; j++)
+            pic->p[i].p_pixels[j] = Random();
+    return pic;
+}
+
+static int ConvertPicture(picture_t *src, picture_t *dst)
+{
+    filter_t filter;
+
+    memset(&filter, 0, sizeof (filter));
+    filter.fmt_in.video = src->format;
+    filter.fmt_out.video = dst->format;
+    if (I420_RGB_SetupLine(&filter) != VLC_SUCCESS)
+        return VLC_EGENERIC;
+    I420_RGB_Line(&filter, src, dst);
+    free(filter.p_sys);
+    return VLC_SUCCESS;
+}
+
+/* YV12 pictures convert like I420 ones with the chroma planes swapped */
+static void test_pictures(void)
+{
+    const unsigned width = 350, height = 64;
+    picture_t *i420 = NewPicture(VLC_CODEC_I420, width, height);
+    picture_t *yv12 = NewPicture(VLC_CODEC_YV12, width, height);
+    picture_t *ref = NewPicture(VLC_CODEC_RGB32, width, height);
+    picture_t *dst = NewPicture(VLC_CODEC_RGB32, width, height);
+
+    for (int i = 0; i < 3; i++) {
+        const plane_t *in = &i420->p[i];
+        plane_t *out = &yv12->p[i == 0 ? 0 : 3 - i];
+
+        for (int y = 0; y < in->i_visible_lines; y++)
+            memcpy(&out->p_pixels[y * out->i_pitch],
+                   &in->p_pixels[y * in->i_pitch], in->i_visible_pitch);
+    }
+
+    /* 8 bits pictures are only converted by lines with AVX2 */
+    if (ConvertPicture(i420, ref) != VLC_SUCCESS) {
+        fprintf(stderr, "8 bits pictures not converted by lines\n");
+        goto end;
+    }
+    assert(ConvertPicture(yv12, dst) == VLC_SUCCESS);
+
+    for (unsigned y = 0; y < height; y++) {
+        const plane_t *p = i420->p;
+        uint32_t line[MAX_WIDTH];
+
+        lines_c[LINE_8][LINE_RV32](line, &p[0].p_pixels[y * p[0].i_pitch],
+                                   &p[1].p_pixels[y / 2 * p[1].i_pitch],
+                                   &p[2].p_pixels[y / 2 * p[2].i_pitch],
+                                   width, rv32_shifts[0]);
+        assert(!memcmp(&ref->p->p_pixels[y * ref->p->i_pitch], line,
+                       width * 4));
+        assert(!memcmp(&dst->p->p_pixels[y * dst->p->i_pitch], line,
+                       width * 4));
+    }
+
+end:
+    picture_Release(dst);
+    picture_Release(ref);
+    picture_Release(yv12);
+    picture_Release(i420);
+}
+
+int main(void)
+{
+    alarm(10);
+
+    test_grays();
+
+    FillLine();
+    test_depths();
+#ifdef CAN_COMPILE_AVX2
+    if (vlc_CPU_AVX2())
+        test_avx2();
+    else
+        fprintf(stderr, "AVX2 not available, only testing the C lines\n");
+#endif
+
+    test_pictures();
+    return 0;
+}
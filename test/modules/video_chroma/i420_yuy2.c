@@ -0,0 +1,134 @@
+/*****************************************************************************
+ * i420_yuy2.c: test of the SIMD planar to packed 4:2:2 conversions
+ *****************************************************************************
+ * Copyright (C) 2018 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/* The SSE2 module also uses AVX2 when available */
+#define MODULE_NAME_IS_i420_yuy2_sse2
+#define MODULE_NAME i420_yuy2_sse2
+#undef MODULE_STRING
+#define MODULE_STRING "i420_yuy2_sse2"
+#include "../../../modules/video_chroma/i420_yuy2.c"
+
+#undef NDEBUG
+#include <assert.h>
+
+static const struct
+{
+    vlc_fourcc_t chroma;
+    void (*convert)(filter_t *, picture_t *, picture_t *);
+    const char order[5]; /* Y for luma, U and V for chroma */
+} conversions[] = {
+    { VLC_CODEC_YUYV, I420_YUY2, "YUYV" },
+    { VLC_CODEC_YVYU, I420_YVYU, "YVYU" },
+    { VLC_CODEC_UYVY, I420_UYVY, "UYVY" },
+};
+
+static uint32_t seed = 1;
+
+static uint8_t Random(void)
+{
+    seed = seed * 1103515245 + 12345;
+    return seed >> 16;
+}
+
+static picture_t *NewPicture(vlc_fourcc_t chroma, unsigned width,
+                             unsigned height)
+{
+    video_format_t fmt;
+
+    video_format_Init(&fmt, chroma);
+    fmt.i_width = fmt.i_visible_width = width;
+    fmt.i_height = fmt.i_visible_height = height;
+
+    picture_t *pic = picture_NewFromFormat(&fmt);
+    assert(pic != NULL);
+    for (int i = 0; i < pic->i_planes; i++)
+        for (int j = 0; j < pic->p[i].i_lines * pic->p[i].i_pitch; j++)
+            pic->p[i].p_pixels[j] = Random();
+    return pic;
+}
+
+static void Check(const picture_t *src, const picture_t *dst,
+                  const char *order, unsigned width, unsigned height)
+{
+    for (unsigned y = 0; y < height; y++) {
+        const uint8_t *line = &dst->p->p_pixels[y * dst->p->i_pitch];
+
+        for (unsigned x = 0; x < width; x += 2) {
+            const uint8_t *py = &src->p[0].p_pixels[y * src->p[0].i_pitch + x];
+            const uint8_t *pu = &src->p[1].p_pixels[y / 2 * src->p[1].i_pitch + x / 2];
+            const uint8_t *pv = &src->p[2].p_pixels[y / 2 * src->p[2].i_pitch + x / 2];
+            unsigned luma = 0;
+
+            for (unsigned i = 0; i < 4; i++) {
+                const uint8_t *px = &line[2 * x + i];
+
+                switch (order[i]) {
+                    case 'Y': assert(*px == py[luma++]); break;
+                    case 'U': assert(*px == *pu); break;
+                    case 'V': assert(*px == *pv); break;
+                }
+            }
+        }
+    }
+}
+
+static void test_conversion(unsigned conv, unsigned width, unsigned height)
+{
+    picture_t *src = NewPicture(VLC_CODEC_I420, width, height);
+    picture_t *dst = NewPicture(conversions[conv].chroma, width, height);
+    filter_t filter;
+
+    memset(&filter, 0, sizeof (filter));
+    filter.fmt_in.video = src->format;
+    filter.fmt_out.video = dst->format;
+    conversions[conv].convert(&filter, src, dst);
+    Check(src, dst, conversions[conv].order, width, height);
+
+    picture_Release(dst);
+    picture_Release(src);
+}
+
+int main(void)
+{
+    static const unsigned sizes[][2] = {
+        { 2, 2 }, { 30, 4 }, { 32, 2 }, { 66, 10 }, { 350, 64 },
+        { 720, 576 }, { 1920, 1080 },
+    };
+
+    alarm(10);
+
+    if (!vlc_CPU_SSE2()) {
+        fprintf(stderr, "SSE2 not available\n");
+        return 77;
+    }
+
+    for (unsigned i = 0; i < ARRAY_SIZE(conversions); i++)
+        for (unsigned j = 0; j < ARRAY_SIZE(sizes); j++)
+            test_conversion(i, sizes[j][0], sizes[j][1]);
+    return 0;
+}
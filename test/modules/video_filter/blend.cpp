@@ -0,0 +1,176 @@
+/*****************************************************************************
+ * blend.cpp: test of the line based blending kernels
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MODULE_STRING "blend"
+#include "../../../modules/video_filter/blend.cpp"
+
+#undef NDEBUG
+#include <assert.h>
+
+#define MAX_WIDTH  1100 /* more than twice BLEND_CHUNK */
+#define MAX_HEIGHT 9
+#define MAX_OFFSET 5
+
+/* RV32 layouts: default, then blue in the low byte, then padding first */
+static const uint32_t rv32_masks[][3] = {
+    { 0, 0, 0 },
+    { 0x000000ff, 0x0000ff00, 0x00ff0000 },
+    { 0xff000000, 0x00ff0000, 0x0000ff00 },
+};
+
+static uint32_t seed = 1;
+
+static uint8_t Random(void)
+{
+    seed = seed * 1103515245 + 12345;
+    return seed >> 16;
+}
+
+static unsigned RandomIn(unsigned min, unsigned max)
+{
+    return min + ((Random() << 8) | Random()) % (max - min + 1);
+}
+
+static void FillPicture(picture_t *pic)
+{
+    for (int i = 0; i < pic->i_planes; i++) {
+        plane_t *p = &pic->p[i];
+        for (int y = 0; y < p->i_lines; y++)
+            for (int x = 0; x < p->i_pitch; x++)
+                p->p_pixels[y * p->i_pitch + x] = Random();
+    }
+}
+
+static bool SamePictures(const picture_t *a, const picture_t *b)
+{
+    for (int i = 0; i < a->i_planes; i++) {
+        const plane_t *pa = &a->p[i], *pb = &b->p[i];
+        for (int y = 0; y < pa->i_visible_lines; y++)
+            if (memcmp(&pa->p_pixels[y * pa->i_pitch],
+                       &pb->p_pixels[y * pb->i_pitch], pa->i_visible_pitch))
+                return false;
+    }
+    return true;
+}
+
+/* Generic per-pixel blending function of the formats */
+static blend_function_t GetReference(vlc_fourcc_t dst, vlc_fourcc_t src)
+{
+    for (size_t i = 0; i < sizeof(blends) / sizeof(*blends); i++)
+        if (blends[i].dst == dst && blends[i].src == src)
+            return blends[i].blend;
+    return NULL;
+}
+
+/* Blends with the kernels and with the reference, and compares the results */
+static void Check(const char *name, const fast_blend_t *fast,
+                  unsigned width, unsigned height, unsigned x, unsigned y,
+                  int alpha, const uint32_t masks[3])
+{
+    video_format_t dst_fmt, src_fmt;
+
+    video_format_Setup(&dst_fmt, fast->dst, width + x, height + y,
+                       width + x, height + y, 1, 1);
+    if (fast->dst == VLC_CODEC_RGB32) {
+        dst_fmt.i_rmask = masks[0];
+        dst_fmt.i_gmask = masks[1];
+        dst_fmt.i_bmask = masks[2];
+    }
+    video_format_FixRgb(&dst_fmt);
+    video_format_Setup(&src_fmt, fast->src, width, height,
+                       width, height, 1, 1);
+
+    picture_t *src = picture_NewFromFormat(&src_fmt);
+    picture_t *ref = picture_NewFromFormat(&dst_fmt);
+    picture_t *dst = picture_NewFromFormat(&dst_fmt);
+    assert(src != NULL && ref != NULL && dst != NULL);
+
+    FillPicture(src);
+    FillPicture(ref);
+    picture_CopyPixels(dst, ref);
+
+    blend_function_t reference = GetReference(fast->dst, fast->src);
+    assert(reference != NULL);
+
+    reference(CPicture(ref, &dst_fmt, x, y), CPicture(src, &src_fmt, 0, 0),
+              width, height, alpha);
+    fast->blend(CPicture(dst, &dst_fmt, x, y), CPicture(src, &src_fmt, 0, 0),
+                width, height, alpha);
+
+    if (!SamePictures(ref, dst)) {
+        fprintf(stderr, "%s: %4.4s onto %4.4s differs, %ux%u at %ux%u, "
+                "alpha %d\n", name, (const char *)&fast->src,
+                (const char *)&fast->dst, width, height, x, y, alpha);
+        abort();
+    }
+
+    picture_Release(dst);
+    picture_Release(ref);
+    picture_Release(src);
+}
+
+static void CheckKernels(const char *name, const fast_blend_t *blends,
+                         size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        const fast_blend_t *fast = &blends[i];
+        const size_t layouts = fast->dst == VLC_CODEC_RGB32
+                             ? sizeof(rv32_masks) / sizeof(*rv32_masks) : 1;
+
+        for (size_t l = 0; l < layouts; l++) {
+            /* Full opacity, then random sizes, offsets and alpha */
+            Check(name, fast, MAX_WIDTH, 2, 0, 0, 255, rv32_masks[l]);
+            for (unsigned n = 0; n < 100; n++)
+                Check(name, fast, RandomIn(1, MAX_WIDTH),
+                      RandomIn(1, MAX_HEIGHT), RandomIn(0, MAX_OFFSET),
+                      RandomIn(0, MAX_OFFSET), RandomIn(1, 255),
+                      rv32_masks[l]);
+        }
+    }
+    printf("%s kernels: ok\n", name);
+}
+
+#define CHECK(name, blends) \
+    CheckKernels(name, blends, sizeof(blends) / sizeof(*blends))
+
+int main(void)
+{
+    alarm(10);
+
+    CHECK("C", fast_blends_c);
+#if defined(CAN_COMPILE_SSE2)
+    if (vlc_CPU_SSE2())
+        CHECK("SSE2", fast_blends_sse2);
+#endif
+#if defined(CAN_COMPILE_AVX2)
+    if (vlc_CPU_AVX2())
+        CHECK("AVX2", fast_blends_avx2);
+#endif
+    return 0;
+}
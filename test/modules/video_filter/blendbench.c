@@ -0,0 +1,224 @@
+/*****************************************************************************
+ * blendbench.c: video blending benchmark
+ *****************************************************************************
+ * Copyright (C) 2018 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+#include <vlc_common.h>
+#include <vlc_filter.h>
+#include <vlc_modules.h>
+#include <vlc_picture.h>
+
+#include "../../../lib/libvlc_internal.h"
+
+static const vlc_fourcc_t dst_chromas[] = {
+    VLC_CODEC_I420, VLC_CODEC_J420, VLC_CODEC_YV12,
+    VLC_CODEC_NV12, VLC_CODEC_NV21,
+    VLC_CODEC_I422, VLC_CODEC_I444, VLC_CODEC_I410, VLC_CODEC_I411,
+    VLC_CODEC_YV9,
+    VLC_CODEC_I420_10L, VLC_CODEC_I422_10L, VLC_CODEC_I444_10L,
+    VLC_CODEC_YUYV, VLC_CODEC_UYVY, VLC_CODEC_YVYU, VLC_CODEC_VYUY,
+    VLC_CODEC_RGB15, VLC_CODEC_RGB16, VLC_CODEC_RGB24, VLC_CODEC_RGB32,
+    VLC_CODEC_RGBA, VLC_CODEC_BGRA,
+};
+
+static const vlc_fourcc_t src_chromas[] = {
+    VLC_CODEC_YUVA, VLC_CODEC_RGBA, VLC_CODEC_YUVP,
+};
+
+static void Usage(const char *name)
+{
+    fprintf(stderr,
+            "Usage: %s [options] [<destination>:<source> ...]\n"
+            "Measures the speed of the blending of the source chroma onto\n"
+            "the destination chroma, for all the known pairs by default.\n"
+            "  -n <loops>   number of blends per pair (default 200)\n"
+            "  -s <w>x<h>   size of the pictures (default 1280x720)\n"
+            "  -a <alpha>   global alpha, from 1 to 255 (default 128)\n",
+            name);
+}
+
+static vlc_fourcc_t ParseChroma(const char *str, size_t len)
+{
+    if (len != 4)
+        return 0;
+    return VLC_FOURCC(str[0], str[1], str[2], str[3]);
+}
+
+static void FillPicture(picture_t *pic)
+{
+    for (int i = 0; i < pic->i_planes; i++) {
+        plane_t *p = &pic->p[i];
+        for (int y = 0; y < p->i_lines; y++)
+            for (int x = 0; x < p->i_pitch; x++)
+                p->p_pixels[y * p->i_pitch + x] = rand();
+    }
+}
+
+/* Returns the speed in megapixels per second, or a negative value if the
+ * pair is not supported */
+static double Bench(vlc_object_t *obj, vlc_fourcc_t dst, vlc_fourcc_t src,
+                    unsigned width, unsigned height, unsigned loops,
+                    int alpha)
+{
+    filter_t *filter = vlc_object_create(obj, sizeof (*filter));
+    if (filter == NULL)
+        return -1.;
+
+    es_format_Init(&filter->fmt_in, VIDEO_ES, src);
+    video_format_Setup(&filter->fmt_in.video, src, width, height,
+                       width, height, 1, 1);
+    if (src == VLC_CODEC_YUVP) {
+        video_palette_t *palette = malloc(sizeof (*palette));
+        if (palette == NULL) {
+            vlc_object_release(filter);
+            return -1.;
+        }
+        palette->i_entries = VIDEO_PALETTE_COLORS_MAX;
+        for (unsigned i = 0; i < VIDEO_PALETTE_COLORS_MAX; i++)
+            for (unsigned j = 0; j < 4; j++)
+                palette->palette[i][j] = rand();
+        filter->fmt_in.video.p_palette = palette;
+    }
+    es_format_Init(&filter->fmt_out, VIDEO_ES, dst);
+    video_format_Setup(&filter->fmt_out.video, dst, width, height,
+                       width, height, 1, 1);
+
+    double speed = -1.;
+    filter->p_module = module_need(filter, "video blending", NULL, false);
+    if (filter->p_module == NULL)
+        goto out;
+
+    picture_t *dst_pic = picture_NewFromFormat(&filter->fmt_out.video);
+    picture_t *src_pic = picture_NewFromFormat(&filter->fmt_in.video);
+    if (dst_pic != NULL && src_pic != NULL) {
+        FillPicture(dst_pic);
+        FillPicture(src_pic);
+
+        /* Warm up the caches */
+        filter->pf_video_blend(filter, dst_pic, src_pic, 0, 0, alpha);
+
+        mtime_t start = mdate();
+        for (unsigned i = 0; i < loops; i++)
+            filter->pf_video_blend(filter, dst_pic, src_pic, 0, 0, alpha);
+        mtime_t duration = mdate() - start;
+
+        speed = (double)width * height * loops / __MAX(duration, 1);
+    }
+    if (dst_pic != NULL)
+        picture_Release(dst_pic);
+    if (src_pic != NULL)
+        picture_Release(src_pic);
+    module_unneed(filter, filter->p_module);
+out:
+    es_format_Clean(&filter->fmt_in);
+    es_format_Clean(&filter->fmt_out);
+    vlc_object_release(filter);
+    return speed;
+}
+
+static void Report(vlc_object_t *obj, vlc_fourcc_t dst, vlc_fourcc_t src,
+                   unsigned width, unsigned height, unsigned loops, int alpha)
+{
+    double speed = Bench(obj, dst, src, width, height, loops, alpha);
+
+    if (speed < 0.)
+        printf("%4.4s:%4.4s %12s\n", (const char *)&dst, (const char *)&src,
+               "unsupported");
+    else
+        printf("%4.4s:%4.4s %8.1f Mpix/s\n", (const char *)&dst,
+               (const char *)&src, speed);
+    fflush(stdout);
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned loops = 200, width = 1280, height = 720;
+    int alpha = 128;
+    int c;
+
+    while ((c = getopt(argc, argv, "n:s:a:h")) != -1) {
+        switch (c) {
+            case 'n':
+                loops = strtoul(optarg, NULL, 0);
+                break;
+            case 's':
+                if (sscanf(optarg, "%ux%u", &width, &height) != 2) {
+                    Usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'a':
+                alpha = atoi(optarg);
+                break;
+            default:
+                Usage(argv[0]);
+                return c != 'h';
+        }
+    }
+    if (loops == 0 || width == 0 || height == 0 || alpha < 1 || alpha > 255) {
+        Usage(argv[0]);
+        return 1;
+    }
+
+#ifdef TOP_BUILDDIR
+    setenv("VLC_PLUGIN_PATH", TOP_BUILDDIR"/modules", 1);
+#endif
+    static const char *const vlc_argv[] = { "--ignore-config", "-q" };
+    libvlc_instance_t *vlc = libvlc_new(ARRAY_SIZE(vlc_argv), vlc_argv);
+    if (vlc == NULL) {
+        fprintf(stderr, "Error: cannot initialize LibVLC.\n");
+        return 1;
+    }
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+
+    printf("# %ux%u, %u loops, alpha %d\n", width, height, loops, alpha);
+
+    if (optind < argc) {
+        for (int i = optind; i < argc; i++) {
+            const char *sep = strchr(argv[i], ':');
+            vlc_fourcc_t dst = 0, src = 0;
+
+            if (sep != NULL) {
+                dst = ParseChroma(argv[i], sep - argv[i]);
+                src = ParseChroma(sep + 1, strlen(sep + 1));
+            }
+            if (dst == 0 || src == 0) {
+                fprintf(stderr, "Invalid chroma pair: %s\n", argv[i]);
+                continue;
+            }
+            Report(obj, dst, src, width, height, loops, alpha);
+        }
+    } else {
+        for (size_t i = 0; i < ARRAY_SIZE(dst_chromas); i++)
+            for (size_t j = 0; j < ARRAY_SIZE(src_chromas); j++)
+                Report(obj, dst_chromas[i], src_chromas[j],
+                       width, height, loops, alpha);
+    }
+
+    libvlc_release(vlc);
+    return 0;
+}
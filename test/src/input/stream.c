@@ -28,9 +28,20 @@
 
 #include <inttypes.h>
 #include <limits.h>
+#include <stddef.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#ifdef HAVE_LINUX_IO_URING_H
+# include <errno.h>
+# include <sys/prctl.h>
+# include <sys/syscall.h>
+# include <linux/filter.h>
+# include <linux/seccomp.h>
+# if defined(__NR_io_uring_enter) && defined(PR_SET_NO_NEW_PRIVS)
+#  define TEST_SUBMIT_FAILURE 1
+# endif
+#endif
 
 #ifndef TEST_NET
 #define RAND_FILE_SIZE (25 * 1024 * 1024)
@@ -182,7 +193,7 @@ stream_close( struct reader *p_reader )
 }
 
 static struct reader *
-stream_open( const char *psz_url )
+stream_open( const char *psz_url, bool b_mmap, const char *psz_filter )
 {
     libvlc_instance_t *p_vlc;
     struct reader *p_reader;
@@ -194,15 +205,24 @@ stream_open( const char *psz_url )
         "--no-media-library",
         "--vout=dummy",
         "--aout=dummy",
+        "--file-mmap",
     };
+    int argc = sizeof(argv) / sizeof(argv[0]) - !b_mmap;
 
     p_reader = calloc( 1, sizeof(struct reader) );
     assert( p_reader );
 
-    p_vlc = libvlc_new( sizeof(argv) / sizeof(argv[0]), argv );
+    p_vlc = libvlc_new( argc, argv );
     assert( p_vlc != NULL );
 
     p_reader->u.s = vlc_stream_NewURL( p_vlc->p_libvlc_int, psz_url );
+    if( p_reader->u.s && psz_filter )
+    {
+        stream_t *p_filter = vlc_stream_FilterNew( p_reader->u.s, psz_filter );
+        if( !p_filter )
+            vlc_stream_Delete( p_reader->u.s );
+        p_reader->u.s = p_filter;
+    }
     if( !p_reader->u.s )
     {
         libvlc_release( p_vlc );
@@ -216,7 +236,8 @@ stream_open( const char *psz_url )
     p_reader->pf_tell = stream_tell;
     p_reader->pf_seek = stream_seek;
     p_reader->p_data = p_vlc;
-    p_reader->psz_name = "stream";
+    p_reader->psz_name = psz_filter ? psz_filter
+                       : b_mmap ? "stream (mmap)" : "stream";
     return p_reader;
 }
 
@@ -343,6 +364,90 @@ test( struct reader **pp_readers, unsigned int i_readers, const char *psz_md5 )
     PEEK_AT( 0, 46 );
 }
 
+#if !defined(TEST_NET) && defined(TEST_SUBMIT_FAILURE)
+struct submit_failure
+{
+    struct reader **pp_readers;
+    uint64_t i_size;
+    bool b_tested;
+};
+
+static void *
+submit_failure_thread( void *data )
+{
+    struct submit_failure *p_sf = data;
+    struct reader **pp_readers = p_sf->pp_readers;
+    const uint64_t i_size = p_sf->i_size;
+    uint8_t p_buf[4096];
+
+    /* Fail the io_uring submissions of this thread, as if the kernel was
+     * short of resources, but not the waits for completions. */
+    struct sock_filter filter[] = {
+        BPF_STMT( BPF_LD | BPF_W | BPF_ABS,
+                  offsetof( struct seccomp_data, nr ) ),
+        BPF_JUMP( BPF_JMP | BPF_JEQ | BPF_K, __NR_io_uring_enter, 0, 3 ),
+        BPF_STMT( BPF_LD | BPF_W | BPF_ABS,
+                  offsetof( struct seccomp_data, args[1] )
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+                  + 4
+#endif
+                ),
+        BPF_JUMP( BPF_JMP | BPF_JEQ | BPF_K, 0, 1, 0 ),
+        BPF_STMT( BPF_RET | BPF_K, SECCOMP_RET_ERRNO | EAGAIN ),
+        BPF_STMT( BPF_RET | BPF_K, SECCOMP_RET_ALLOW ),
+    };
+    struct sock_fprog prog = {
+        .len = ARRAY_SIZE( filter ),
+        .filter = filter,
+    };
+
+    if( prctl( PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0 )
+     || prctl( PR_SET_SECCOMP, SECCOMP_MODE_FILTER, &prog ) )
+        return NULL;
+    p_sf->b_tested = true;
+
+    /* Read on, past a few chunks of the window: the chunks recycled behind
+     * cannot be submitted again */
+    for( uint64_t i_offset = 4096; i_offset < 640 * 1024; i_offset += 4096 )
+        read_at( pp_readers, 2, p_buf, i_offset, 4096, i_size );
+    return NULL;
+}
+
+/* Reads with the readahead filter while its asynchronous submissions fail,
+ * then while they succeed again. */
+static void
+test_submit_failure( const char *psz_path, const char *psz_url )
+{
+    struct reader *pp_readers[2];
+    uint8_t p_buf[4096];
+
+    assert( ( pp_readers[0] = libc_open( psz_path ) ) );
+    assert( ( pp_readers[1] = stream_open( psz_url, false, "readahead" ) ) );
+
+    struct submit_failure sf = {
+        .pp_readers = pp_readers,
+        .i_size = pp_readers[0]->pf_getsize( pp_readers[0] ),
+        .b_tested = false,
+    };
+
+    /* Start with reads in flight */
+    read_at( pp_readers, 2, p_buf, 0, 4096, sf.i_size );
+
+    vlc_thread_t th;
+    assert( vlc_clone( &th, submit_failure_thread, &sf,
+                       VLC_THREAD_PRIORITY_LOW ) == 0 );
+    vlc_join( th, NULL );
+
+    if( sf.b_tested )
+        test( pp_readers, 2, NULL );
+    else
+        log( "SKIP: cannot filter system calls\n" );
+
+    for( unsigned int i = 0; i < 2; ++i )
+        pp_readers[i]->pf_close( pp_readers[i] );
+}
+#endif
+
 #ifndef TEST_NET
 static void
 fill_rand( int i_fd, size_t i_size )
@@ -365,7 +470,7 @@ fill_rand( int i_fd, size_t i_size )
 int
 main( void )
 {
-    struct reader *pp_readers[3];
+    struct reader *pp_readers[4];
 
     test_init();
 
@@ -374,18 +479,30 @@ main( void )
     char *psz_url;
     int i_tmp_fd;
 
-    log( "Test random file with libc, and stream\n" );
+    log( "Test random file with libc, stream, mmap stream, and readahead\n" );
     i_tmp_fd = vlc_mkstemp( psz_tmp_path );
     fill_rand( i_tmp_fd, RAND_FILE_SIZE );
     assert( i_tmp_fd != -1 );
     assert( asprintf( &psz_url, "file://%s", psz_tmp_path ) != -1 );
 
     assert( ( pp_readers[0] = libc_open( psz_tmp_path ) ) );
-    assert( ( pp_readers[1] = stream_open( psz_url ) ) );
+    assert( ( pp_readers[1] = stream_open( psz_url, false, NULL ) ) );
+    unsigned i_readers = 2;
+#ifdef HAVE_MMAP
+    assert( ( pp_readers[i_readers++] = stream_open( psz_url, true, NULL ) ) );
+#endif
+    /* readahead falls back to synchronous reads without io_uring */
+    assert( ( pp_readers[i_readers++] = stream_open( psz_url, false,
+                                                     "readahead" ) ) );
 
-    test( pp_readers, 2, NULL );
-    for( unsigned int i = 0; i < 2; ++i )
+    test( pp_readers, i_readers, NULL );
+    for( unsigned int i = 0; i < i_readers; ++i )
         pp_readers[i]->pf_close( pp_readers[i] );
+
+#ifdef TEST_SUBMIT_FAILURE
+    log( "Test readahead with failing asynchronous submissions\n" );
+    test_submit_failure( psz_tmp_path, psz_url );
+#endif
     free( psz_url );
 
     close( i_tmp_fd );
@@ -393,7 +510,7 @@ main( void )
 
     log( "Test http url with stream\n" );
     alarm( 0 );
-    if( !( pp_readers[0] = stream_open( HTTP_URL ) ) )
+    if( !( pp_readers[0] = stream_open( HTTP_URL, false, NULL ) ) )
     {
         log( "WARNING: can't test http url" );
         return 0;
@@ -0,0 +1,137 @@
+/*****************************************************************************
+ * block_pool.c: test for the pooled block allocator
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+
+#define BLOCKS 10000
+
+static void test_recycle(size_t size)
+{
+    block_t *block = block_Alloc(size);
+    assert(block != NULL);
+    assert(block->i_buffer == size);
+    assert(((uintptr_t)block->p_buffer % 32) == 0);
+    memset(block->p_buffer, 0x47, size);
+
+    void *addr = block;
+    block_Release(block);
+
+    /* The last released block is handed back first */
+    block = block_Alloc(size);
+    assert(block != NULL);
+    assert((void *)block == addr);
+    assert(block->i_buffer == size);
+    assert(block->i_flags == 0);
+    block_Release(block);
+}
+
+static void test_realloc(void)
+{
+    static const char text[] = "This is a test!";
+    block_t *block = block_Alloc(sizeof (text));
+    assert(block != NULL);
+    memcpy(block->p_buffer, text, sizeof (text));
+
+    /* Grow beyond the size class */
+    block = block_Realloc(block, 100, 5000);
+    assert(block != NULL);
+    assert(block->i_buffer == 100 + 5000);
+    assert(!memcmp(block->p_buffer + 100, text, sizeof (text)));
+
+    block = block_Realloc(block, -100, 1000);
+    assert(block != NULL);
+    assert(!memcmp(block->p_buffer, text, sizeof (text)));
+    block_Release(block);
+
+    /* Larger than any class */
+    block = block_Alloc(1 << 20);
+    assert(block != NULL);
+    memset(block->p_buffer, 0, block->i_buffer);
+    block_Release(block);
+}
+
+static void *producer(void *data)
+{
+    block_fifo_t *fifo = data;
+
+    for (unsigned i = 0; i < BLOCKS; i++)
+    {
+        block_t *block = block_Alloc(7 * 188);
+        assert(block != NULL);
+        memset(block->p_buffer, i & 0xff, block->i_buffer);
+        block->i_dts = i;
+        block_FifoPut(fifo, block);
+    }
+    return NULL;
+}
+
+/* Blocks allocated by one thread and released by another */
+static void test_threads(void)
+{
+    block_fifo_t *fifo = block_FifoNew();
+    vlc_thread_t th;
+
+    assert(fifo != NULL);
+    assert(vlc_clone(&th, producer, fifo, VLC_THREAD_PRIORITY_LOW) == 0);
+
+    for (unsigned i = 0; i < BLOCKS; i++)
+    {
+        block_t *block = block_FifoGet(fifo);
+
+        assert(block->i_dts == (mtime_t)i);
+        assert(block->i_buffer == 7 * 188);
+        for (size_t j = 0; j < block->i_buffer; j++)
+            assert(block->p_buffer[j] == (i & 0xff));
+        block_Release(block);
+    }
+
+    vlc_join(th, NULL);
+    block_FifoRelease(fifo);
+}
+
+int main(void)
+{
+    static const char *args[] = { "-v", "--vout=vdummy", "--block-pool" };
+    libvlc_instance_t *vlc;
+
+    test_init();
+
+    vlc = libvlc_new(ARRAY_SIZE(args), args);
+    assert(vlc != NULL);
+
+    log("Testing block recycling\n");
+    test_recycle(188);
+    test_recycle(7 * 188);
+    test_recycle(1000);
+    test_recycle(65536);
+
+    log("Testing block reallocation\n");
+    test_realloc();
+
+    log("Testing blocks across threads\n");
+    test_threads();
+
+    libvlc_release(vlc);
+    return 0;
+}
@@ -0,0 +1,150 @@
+/*****************************************************************************
+ * fifo.c: block FIFO test and benchmark
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+
+#define BLOCKS 200000
+
+static block_t *blocks;
+
+/* Locked FIFO */
+static void *fifo_producer(void *data)
+{
+    block_fifo_t *fifo = data;
+
+    for (unsigned i = 0; i < BLOCKS; i++)
+        block_FifoPut(fifo, &blocks[i]);
+    return NULL;
+}
+
+static mtime_t bench_fifo(void)
+{
+    block_fifo_t *fifo = block_FifoNew();
+    vlc_thread_t th;
+    mtime_t start = mdate();
+
+    assert(fifo != NULL);
+    assert(vlc_clone(&th, fifo_producer, fifo, VLC_THREAD_PRIORITY_LOW) == 0);
+
+    for (unsigned i = 0; i < BLOCKS; i++)
+    {
+        block_t *block = block_FifoGet(fifo);
+        assert(block == &blocks[i]);
+    }
+
+    vlc_join(th, NULL);
+    vlc_fifo_Lock(fifo);
+    assert(vlc_fifo_IsEmpty(fifo));
+    vlc_fifo_Unlock(fifo);
+    block_FifoRelease(fifo);
+    return mdate() - start;
+}
+
+/* Single-producer single-consumer FIFO */
+static void *spsc_producer(void *data)
+{
+    block_spsc_t *fifo = data;
+
+    for (unsigned i = 0; i < BLOCKS; i++)
+        block_SpscPut(fifo, &blocks[i]);
+    return NULL;
+}
+
+static mtime_t bench_spsc(void)
+{
+    block_spsc_t *fifo = block_SpscNew();
+    vlc_thread_t th;
+    mtime_t start = mdate();
+
+    assert(fifo != NULL);
+    assert(vlc_clone(&th, spsc_producer, fifo, VLC_THREAD_PRIORITY_LOW) == 0);
+
+    for (unsigned i = 0; i < BLOCKS; i++)
+    {
+        block_t *block = block_SpscGet(fifo);
+        assert(block == &blocks[i]);
+    }
+
+    vlc_join(th, NULL);
+    assert(block_SpscCount(fifo) == 0);
+    assert(block_SpscTryGet(fifo) == NULL);
+    block_SpscRelease(fifo);
+    return mdate() - start;
+}
+
+static void test_spsc_accounting(void)
+{
+    block_spsc_t *fifo = block_SpscNew();
+    block_t *chain = NULL, **pp = &chain;
+
+    assert(fifo != NULL);
+    assert(block_SpscTryGet(fifo) == NULL);
+
+    /* Cross a few segment boundaries */
+    for (unsigned i = 0; i < 1000; i++)
+    {
+        block_t *block = block_Alloc(i);
+        assert(block != NULL);
+        block->i_dts = i;
+        block_ChainLastAppend(&pp, block);
+    }
+    block_SpscPut(fifo, chain);
+    assert(block_SpscCount(fifo) == 1000);
+    assert(block_SpscSize(fifo) == 999 * 1000 / 2);
+
+    for (unsigned i = 0; i < 500; i++)
+    {
+        block_t *block = block_SpscGet(fifo);
+        assert(block->i_dts == (mtime_t)i);
+        assert(block->p_next == NULL);
+        block_Release(block);
+    }
+    assert(block_SpscCount(fifo) == 500);
+
+    /* Remaining blocks are released with the FIFO */
+    block_SpscRelease(fifo);
+}
+
+int main(void)
+{
+    test_init();
+
+    log("Testing SPSC FIFO accounting\n");
+    test_spsc_accounting();
+
+    blocks = calloc(BLOCKS, sizeof (*blocks));
+    assert(blocks != NULL);
+    for (unsigned i = 0; i < BLOCKS; i++)
+        block_Init(&blocks[i], NULL, 0);
+
+    log("Benchmarking FIFOs with %u blocks\n", BLOCKS);
+    mtime_t fifo = bench_fifo();
+    log(" locked FIFO: %"PRId64" us (%.1f Mblocks/s)\n", fifo,
+        (double)BLOCKS / fifo);
+    mtime_t spsc = bench_spsc();
+    log(" SPSC FIFO:   %"PRId64" us (%.1f Mblocks/s)\n", spsc,
+        (double)BLOCKS / spsc);
+
+    free(blocks);
+    return 0;
+}
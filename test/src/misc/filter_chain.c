@@ -0,0 +1,100 @@
+/*****************************************************************************
+ * filter_chain.c: test of the video filter chain picture pools
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_filter.h>
+#include <vlc_picture.h>
+
+#include "../../libvlc/test.h"
+#include "../../../lib/libvlc_internal.h"
+
+#define FRAMES 50
+
+static const char *const filters[] = { "invert", "invert", "invert" };
+
+/* Allocator of the chain output pictures */
+static picture_t *buffer_new(filter_t *filter)
+{
+    return picture_NewFromFormat(&filter->fmt_out.video);
+}
+
+int main(void)
+{
+    test_init();
+
+    libvlc_instance_t *vlc = libvlc_new(test_defaults_nargs,
+                                        test_defaults_args);
+    assert(vlc != NULL);
+
+    const filter_owner_t owner = {
+        .video = {
+            .buffer_new = buffer_new,
+        },
+    };
+    filter_chain_t *chain = filter_chain_NewVideo(vlc->p_libvlc_int, false,
+                                                  &owner);
+    assert(chain != NULL);
+
+    es_format_t fmt;
+    es_format_Init(&fmt, VIDEO_ES, VLC_CODEC_I420);
+    video_format_Setup(&fmt.video, VLC_CODEC_I420, 64, 48, 64, 48, 1, 1);
+    filter_chain_Reset(chain, &fmt, &fmt);
+
+    for (size_t i = 0; i < sizeof (filters) / sizeof (filters[0]); i++)
+        if (filter_chain_AppendFilter(chain, filters[i], NULL,
+                                      NULL, NULL) == NULL)
+        {
+            log("SKIP: cannot load the %s filter\n", filters[i]);
+            filter_chain_Delete(chain);
+            es_format_Clean(&fmt);
+            libvlc_release(vlc);
+            return 77;
+        }
+
+    /* The pools are created by the first frame, and then every
+     * intermediate picture comes from them. */
+    unsigned misses = 0;
+
+    for (unsigned n = 0; n < FRAMES; n++)
+    {
+        picture_t *pic = picture_NewFromFormat(&fmt.video);
+        assert(pic != NULL);
+
+        pic = filter_chain_VideoFilter(chain, pic);
+        assert(pic != NULL);
+        picture_Release(pic);
+
+        if (n == 0)
+            misses = filter_chain_GetPoolMisses(chain);
+        else
+            assert(filter_chain_GetPoolMisses(chain) == misses);
+    }
+    log("%u intermediate pictures not from a pool\n", misses);
+    assert(misses == 0);
+
+    filter_chain_Delete(chain);
+    es_format_Clean(&fmt);
+    libvlc_release(vlc);
+    return 0;
+}
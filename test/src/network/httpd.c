@@ -0,0 +1,222 @@
+/*****************************************************************************
+ * httpd.c: test of the HTTP server streams and segments
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_httpd.h>
+#include <vlc_network.h>
+#include "../../../lib/libvlc_internal.h"
+#include "../../libvlc/test.h"
+
+#include <vlc/vlc.h>
+
+#define CLIENTS 16
+#define BLOCKS  32
+#define BLOCK_SIZE 4096
+
+static vlc_object_t *parent;
+static unsigned port;
+
+static int Request(const char *method, const char *url, unsigned version)
+{
+    int fd = net_ConnectTCP(parent, "127.0.0.1", port);
+    assert(fd != -1);
+
+    char req[256];
+    int len = snprintf(req, sizeof (req), "%s %s HTTP/1.%u\r\n\r\n",
+                       method, url, version);
+    assert(net_Write(parent, fd, req, len) == len);
+    return fd;
+}
+
+/* Reads the answer header, returns the status code */
+static int ReadHeader(int fd, char *buf, size_t size)
+{
+    size_t len = 0;
+
+    while (len < 4 || memcmp(&buf[len - 4], "\r\n\r\n", 4)) {
+        assert(len + 1 < size);
+        assert(net_Read(parent, fd, &buf[len], 1) == 1);
+        len++;
+    }
+    buf[len] = '\0';
+
+    unsigned code;
+    assert(sscanf(buf, "HTTP/1.%*u %u", &code) == 1);
+    return code;
+}
+
+static void Fill(uint8_t *p, size_t size, unsigned seed)
+{
+    for (size_t i = 0; i < size; i++)
+        p[i] = seed * 7 + i;
+}
+
+static void Check(const uint8_t *p, size_t size, unsigned seed)
+{
+    for (size_t i = 0; i < size; i++)
+        assert(p[i] == (uint8_t)(seed * 7 + i));
+}
+
+static void Send(int (*pf_send)(void *, const block_t *), void *handle,
+                 unsigned seed)
+{
+    uint8_t data[BLOCK_SIZE];
+    block_t block;
+
+    Fill(data, sizeof (data), seed);
+    block_Init(&block, data, sizeof (data));
+    assert(pf_send(handle, &block) == VLC_SUCCESS);
+}
+
+static int StreamSend(void *stream, const block_t *block)
+{
+    return httpd_StreamSend(stream, block);
+}
+
+static int SegmentSend(void *seg, const block_t *block)
+{
+    return httpd_SegmentSend(seg, block);
+}
+
+/* Every client gets every block, whichever thread serves it */
+static void test_stream(httpd_host_t *host)
+{
+    httpd_stream_t *stream = httpd_StreamNew(host, "/stream",
+                                             "application/octet-stream",
+                                             NULL, NULL);
+    assert(stream != NULL);
+
+    int fds[CLIENTS];
+    char buf[1024];
+
+    for (unsigned i = 0; i < CLIENTS; i++) {
+        fds[i] = Request("GET", "/stream", 0);
+        assert(ReadHeader(fds[i], buf, sizeof (buf)) == 200);
+    }
+
+    for (unsigned i = 0; i < BLOCKS; i++) {
+        Send(StreamSend, stream, i);
+
+        for (unsigned j = 0; j < CLIENTS; j++) {
+            uint8_t data[BLOCK_SIZE];
+
+            assert(net_Read(parent, fds[j], data, sizeof (data))
+                   == sizeof (data));
+            Check(data, sizeof (data), i);
+        }
+    }
+
+    /* The connections still open are closed with the stream */
+    httpd_StreamDelete(stream);
+    for (unsigned i = 0; i < CLIENTS; i++) {
+        assert(net_Read(parent, fds[i], buf, 1) == 0);
+        net_Close(fds[i]);
+    }
+}
+
+/* A growing segment is streamed, a complete one has a length */
+static void test_segment(httpd_host_t *host)
+{
+    httpd_segment_t *seg = httpd_SegmentNew(host, "/seg",
+                                            "application/octet-stream",
+                                            NULL, NULL);
+    assert(seg != NULL);
+
+    int fds[CLIENTS];
+    char buf[1024];
+
+    /* the first client connects before any data */
+    fds[0] = Request("GET", "/seg", 0);
+    assert(ReadHeader(fds[0], buf, sizeof (buf)) == 200);
+    assert(strstr(buf, "Content-Length") == NULL);
+
+    for (unsigned i = 0; i < BLOCKS; i++)
+        Send(SegmentSend, seg, i);
+
+    for (unsigned i = 1; i < CLIENTS; i++) {
+        fds[i] = Request("GET", "/seg", 0);
+        assert(ReadHeader(fds[i], buf, sizeof (buf)) == 200);
+    }
+    httpd_SegmentEnd(seg);
+
+    int head = Request("HEAD", "/seg", 1);
+    assert(ReadHeader(head, buf, sizeof (buf)) == 200);
+    assert(strstr(buf, "Content-Length: 131072\r\n") != NULL);
+    net_Close(head);
+
+    /* HTTP/1.0 clients get the data until the connection closes */
+    for (unsigned i = 0; i < CLIENTS; i++) {
+        uint8_t data[BLOCK_SIZE];
+
+        for (unsigned j = 0; j < BLOCKS; j++) {
+            assert(net_Read(parent, fds[i], data, sizeof (data))
+                   == sizeof (data));
+            Check(data, sizeof (data), j);
+        }
+        assert(net_Read(parent, fds[i], data, 1) == 0);
+        net_Close(fds[i]);
+    }
+
+    httpd_SegmentDelete(seg);
+}
+
+int main(void)
+{
+    char portarg[32];
+
+    test_init();
+
+    port = 20000 + getpid() % 20000;
+    snprintf(portarg, sizeof (portarg), "--http-port=%u", port);
+
+    const char *args[] = { "-v", "--http-host=127.0.0.1", portarg,
+                           "--http-threads=3" };
+    libvlc_instance_t *vlc = libvlc_new(ARRAY_SIZE(args), args);
+    assert(vlc != NULL);
+    parent = VLC_OBJECT(vlc->p_libvlc_int);
+
+    httpd_host_t *host = vlc_http_HostNew(parent);
+    if (host == NULL) {
+        fprintf(stderr, "cannot listen on port %u\n", port);
+        libvlc_release(vlc);
+        return 77;
+    }
+
+    log("Testing streams\n");
+    test_stream(host);
+    log("Testing segments\n");
+    test_segment(host);
+
+    httpd_HostDelete(host);
+    libvlc_release(vlc);
+    return 0;
+}
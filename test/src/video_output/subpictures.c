@@ -0,0 +1,154 @@
+/*****************************************************************************
+ * subpictures.c: test the reuse of rendered subpicture regions
+ *****************************************************************************
+ * Copyright (C) 2018 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_picture.h>
+#include <vlc_subpicture.h>
+#include <vlc_spu.h>
+
+#include "../../../lib/libvlc_internal.h"
+#include "../../libvlc/test.h"
+
+static const vlc_fourcc_t chroma_list[] = { VLC_CODEC_RGBA, 0 };
+
+static subpicture_t *NewSubpicture(int channel, int x, int y)
+{
+    video_format_t fmt;
+
+    video_format_Init(&fmt, VLC_CODEC_RGBA);
+    fmt.i_width  = fmt.i_visible_width  = 64;
+    fmt.i_height = fmt.i_visible_height = 32;
+    fmt.i_sar_num = fmt.i_sar_den = 1;
+
+    subpicture_t *subpic = subpicture_New(NULL);
+    assert(subpic != NULL);
+    subpic->i_channel = channel;
+    subpic->i_start = 1;
+    subpic->i_stop = INT64_MAX / 2;
+    subpic->b_absolute = true;
+    subpic->i_original_picture_width  = 640;
+    subpic->i_original_picture_height = 360;
+
+    subpic->p_region = subpicture_region_New(&fmt);
+    assert(subpic->p_region != NULL);
+    subpic->p_region->i_x = x;
+    subpic->p_region->i_y = y;
+    memset(subpic->p_region->p_picture->p[0].p_pixels, 0x80,
+           subpic->p_region->p_picture->p[0].i_pitch *
+           subpic->p_region->p_picture->p[0].i_lines);
+    return subpic;
+}
+
+static subpicture_t *Render(spu_t *spu, mtime_t date, unsigned width,
+                            unsigned height)
+{
+    video_format_t fmt;
+
+    video_format_Init(&fmt, VLC_CODEC_RGBA);
+    fmt.i_width  = fmt.i_visible_width  = width;
+    fmt.i_height = fmt.i_visible_height = height;
+    fmt.i_sar_num = fmt.i_sar_den = 1;
+
+    return spu_Render(spu, chroma_list, &fmt, &fmt, date, date, false);
+}
+
+static void CheckStatistics(spu_t *spu, unsigned reused, unsigned rendered)
+{
+    unsigned r, n;
+
+    spu_GetRenderStatistics(spu, &r, &n);
+    assert(r == reused);
+    assert(n == rendered);
+}
+
+static void test_reuse(vlc_object_t *obj)
+{
+    spu_t *spu = spu_Create(obj, NULL);
+    assert(spu != NULL);
+
+    spu_PutSubpicture(spu, NewSubpicture(spu_RegisterChannel(spu), 10, 20));
+
+    /* The region is rendered once, then reused as is */
+    subpicture_t *first = Render(spu, 1000, 640, 360);
+    assert(first != NULL && first->p_region != NULL);
+    CheckStatistics(spu, 0, 1);
+
+    for (int i = 1; i <= 10; i++) {
+        subpicture_t *out = Render(spu, 1000 + i * 40000, 640, 360);
+        assert(out != NULL && out->p_region != NULL);
+        assert(out->p_region->p_next == NULL);
+        assert(out->p_region->p_picture == first->p_region->p_picture);
+        assert(out->p_region->i_x == first->p_region->i_x);
+        assert(out->p_region->i_y == first->p_region->i_y);
+        assert(out->p_region->i_alpha == first->p_region->i_alpha);
+        assert(video_format_IsSimilar(&out->p_region->fmt,
+                                      &first->p_region->fmt));
+        subpicture_Delete(out);
+        CheckStatistics(spu, i, 1);
+    }
+    subpicture_Delete(first);
+
+    /* A new display size renders the region again */
+    subpicture_t *out = Render(spu, 500000, 1280, 720);
+    assert(out != NULL);
+    subpicture_Delete(out);
+    CheckStatistics(spu, 10, 2);
+
+    out = Render(spu, 540000, 1280, 720);
+    assert(out != NULL);
+    subpicture_Delete(out);
+    CheckStatistics(spu, 11, 2);
+
+    /* Only the new subpicture is rendered */
+    spu_PutSubpicture(spu, NewSubpicture(spu_RegisterChannel(spu), 100, 200));
+    out = Render(spu, 580000, 1280, 720);
+    assert(out != NULL && out->p_region != NULL);
+    assert(out->p_region->p_next != NULL);
+    subpicture_Delete(out);
+    CheckStatistics(spu, 12, 3);
+
+    out = Render(spu, 620000, 1280, 720);
+    assert(out != NULL);
+    subpicture_Delete(out);
+    CheckStatistics(spu, 14, 3);
+
+    spu_Destroy(spu);
+}
+
+int main(void)
+{
+    static const char *args[] = { "-v", "--vout=vdummy" };
+    libvlc_instance_t *vlc;
+
+    test_init();
+
+    vlc = libvlc_new(ARRAY_SIZE(args), args);
+    assert(vlc != NULL);
+
+    log("Testing the reuse of rendered regions\n");
+    test_reuse(VLC_OBJECT(vlc->p_libvlc_int));
+
+    libvlc_release(vlc);
+    return 0;
+}